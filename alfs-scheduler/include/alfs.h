@@ -6,28 +6,70 @@
 #ifndef ALFS_H
 #define ALFS_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <float.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/types.h>
 
 /* ============================================================================
  * Constants
  * ============================================================================ */
 
-#define MAX_TASKS 1024
-#define MAX_CGROUPS 64
+#define MAX_CGROUP_DEPTH 16         /* Levels of nesting below a root cgroup */
 #define MAX_CPUS 128
-#define MAX_TASK_ID_LEN 256
-#define MAX_CGROUP_ID_LEN 256
+#define TASK_POOL_SLAB 64           /* Tasks per pool slab */
+#define CGROUP_POOL_SLAB 16         /* Cgroups per pool slab */
 #define DEFAULT_SOCKET_PATH "event.socket"
 #define NICE_0_WEIGHT 1024
 #define DEFAULT_CPU_SHARES 1024
 #define DEFAULT_CPU_PERIOD_US 100000  /* 100ms */
 #define UNLIMITED_QUOTA -1
+#define TIMER_WHEEL_SLOTS 256       /* Power of two; one slot per tick */
 
 /* Nice value range */
 #define NICE_MIN -20
 #define NICE_MAX 19
 
+/* EEVDF: a task in CPU_BURST requests 1/2^shift of the quanta as its slice */
+#define EEVDF_BURST_SLICE_SHIFT 2
+
+/* CPU capacity (big.LITTLE / P+E cores): the fastest core is 1024 */
+#define SCHED_CAPACITY_SHIFT 10
+#define SCHED_CAPACITY_SCALE (1 << SCHED_CAPACITY_SHIFT)
+
+/* PELT utilization: one period per tick, halved every PELT_HALFLIFE periods */
+#define PELT_HALFLIFE 32
+#define PELT_LOAD_AVG_MAX 47788         /* Sum of 1024 * y^n for y^32 = 1/2 */
+
+/* ============================================================================
+ * Virtual Runtime Representation
+ *
+ * By default vruntime is a double counted in quanta. Building with
+ * -DALFS_FIXED_VRUNTIME (make FIXED_VRUNTIME=1) switches to the kernel's
+ * integer form: nanoseconds of nice-0 runtime, advanced by multiplying
+ * with a cached inverse weight and shifting, as __calc_delta does. Each
+ * task caches its inverse weight either way (inv_weight_t), so the tick
+ * loop never divides.
+ * ============================================================================ */
+
+#ifdef ALFS_FIXED_VRUNTIME
+typedef int64_t vruntime_t;                 /* Nanoseconds (signed: wake-up bonus may dip below 0) */
+typedef uint32_t inv_weight_t;              /* 2^32 / weight */
+#define VRUNTIME_QUANTUM ((vruntime_t)1000000)  /* One quantum (1 ms) */
+#define VRUNTIME_MAX INT64_MAX
+#else
+typedef double vruntime_t;                  /* Quanta */
+typedef double inv_weight_t;                /* NICE_0_WEIGHT / weight */
+#define VRUNTIME_QUANTUM 1.0
+#define VRUNTIME_MAX DBL_MAX
+#endif
+
+#define WMULT_CONST (~0U)
+#define WMULT_SHIFT 32
+
 /* ============================================================================
  * Linux kernel nice to weight mapping table
  * From: kernel/sched/core.c
@@ -83,58 +125,364 @@ typedef enum {
     EVENT_CPU_BURST
 } EventAction;
 
+#define EVENT_ACTION_COUNT (EVENT_CPU_BURST + 1)
+
+/**
+ * How messages are delimited on the socket
+ */
+typedef enum {
+    UDS_FRAME_NEWLINE,              /* One message per line (default) */
+    UDS_FRAME_JSON,                 /* Top-level JSON object boundaries */
+    UDS_FRAME_LENGTH                /* 4-byte big-endian length, then payload */
+} UdsFraming;
+
+/**
+ * Message encoding on the socket
+ */
+typedef enum {
+    WIRE_JSON,                      /* JSON text timeframes and ticks (default) */
+    WIRE_BINARY                     /* Fixed-layout records, IDs sent as handles */
+} WireProtocol;
+
+/**
+ * Task selection policy (--policy=)
+ */
+typedef enum {
+    SCHED_POLICY_CFS,               /* Minimum vruntime first (default) */
+    SCHED_POLICY_EEVDF,             /* Earliest eligible virtual deadline first */
+    SCHED_POLICY_COUNT
+} SchedPolicy;
+
 /* ============================================================================
  * Data Structures
  * ============================================================================ */
 
+struct Task;
+struct Cgroup;
+struct TaskClass;
+
+/**
+ * Fixed-size CPU bitset, one bit per CPU ID below MAX_CPUS.
+ * All bits set means "any CPU". 16-byte aligned for SSE2.
+ */
+typedef struct {
+    _Alignas(16) uint64_t bits[MAX_CPUS / 64];
+} CpuMask;
+
+/**
+ * Interned ID entry shared by every object registered under one ID string.
+ * A task and a cgroup may use the same ID; each has its own slot.
+ */
+typedef struct IdEntry {
+    struct Task *task;              /* Task registered under this ID */
+    struct Cgroup *cgroup;          /* Cgroup registered under this ID */
+    struct Task *members;           /* Tasks whose cgroup_id is this ID */
+    int refs;                       /* Holders; entry is freed at zero */
+    uint32_t hash;
+    uint32_t handle;                /* Binary-protocol handle of this ID, 0 if none */
+    size_t len;
+    const char *json;               /* Quoted, escaped ID for output (in str[]) */
+    size_t json_len;
+    char str[];                     /* NUL-terminated ID, then the json text */
+} IdEntry;
+
+/**
+ * Open-addressing hash index from ID strings to interned entries
+ */
+typedef struct {
+    uint32_t hash;
+    IdEntry *entry;                 /* NULL for an empty slot */
+} IdSlot;
+
+typedef struct {
+    IdSlot *slots;
+    uint32_t mask;                  /* Capacity - 1 (capacity is a power of two) */
+    int count;
+} IdTable;
+
+/**
+ * Fixed-size object pool.
+ * Objects are carved from slabs of `per_slab` slots and recycled through
+ * an intrusive free list, so churn costs no allocator calls once the
+ * pool has grown to the peak object count. Slabs are only freed with
+ * the pool.
+ */
+typedef struct PoolSlab {
+    struct PoolSlab *next;
+} PoolSlab;
+
+typedef struct {
+    void *free_list;                /* Next free slot (its first word links on) */
+    PoolSlab *slabs;
+    size_t object_size;             /* Slot size, a multiple of align */
+    size_t align;                   /* Slot alignment */
+    size_t per_slab;
+    size_t live;                    /* Objects handed out */
+    size_t slab_count;
+} Pool;
+
+/**
+ * Pools backing the tasks of one scheduler
+ */
+typedef struct {
+    Pool tasks;                     /* Task records */
+} TaskPools;
+
+/**
+ * Intrusive links of a task in a pointer-based run queue backend
+ */
+typedef struct {
+    struct Task *left;              /* RB-tree left child; pairing heap first child */
+    struct Task *right;             /* RB-tree right child; pairing heap next sibling */
+    struct Task *parent;            /* RB-tree parent; pairing heap previous sibling or parent */
+    bool red;                       /* RB-tree node color */
+    struct Task *min_deadline;      /* Earliest-deadline task of the subtree (augmented RB-tree) */
+} QueueNode;
+
 /**
- * Task structure representing a process/thread
+ * Task structure representing a process/thread.
+ * The first cache line holds what heap sifts and CPU selection read;
+ * the rest is touched on events. Once registered, both ID strings are
+ * the interned copies in the scheduler's ID index.
  */
 typedef struct Task {
-    char task_id[MAX_TASK_ID_LEN];
-    int nice;                       /* -20 to +19, default 0 */
-    double vruntime;                /* Virtual runtime */
-    int weight;                     /* Computed from nice value */
+    /* Hot: one cache line */
+    _Alignas(64) vruntime_t vruntime; /* Virtual runtime */
+    uint64_t seq;                   /* Creation order, breaks vruntime ties */
+    CpuMask allowed;                /* affinity AND cgroup mask (cached) */
+    struct TaskClass *tclass;       /* Affinity class (queued or running), NULL otherwise */
+    inv_weight_t inv_weight;        /* Inverse of weight x cgroup shares (cached) */
     TaskState state;
-    char cgroup_id[MAX_CGROUP_ID_LEN];
-    int *cpu_affinity;              /* Array of allowed CPU IDs */
-    int affinity_count;             /* Number of allowed CPUs */
+    int heap_index;                 /* Position in an array heap (0 in a node queue), -1 if not queued */
     int current_cpu;                /* Currently assigned CPU (-1 if none) */
+
+    /* Cold */
+    QueueNode qnode;                /* Links for the pairing heap and RB-tree backends */
+    const char *task_id;            /* Interned, or id_copy / the creator's string until registered */
+    const char *cgroup_id;          /* Interned while in a cgroup, else "" or the initial ID */
+    char *id_copy;                  /* IDs owned by a heap-allocated task, NULL if pooled */
+    TaskPools *pools;               /* Owning pools, NULL if heap-allocated */
+    IdEntry *id_entry;              /* Interned task_id (set while registered) */
+    struct Cgroup *cgroup;          /* Resolved cgroup (NULL if not created yet) */
+    IdEntry *cgroup_entry;          /* Interned cgroup_id, owns the membership link */
+    struct Task *group_next;        /* Membership list of cgroup_entry */
+    struct Task *group_prev;
+    CpuMask affinity;               /* Allowed CPUs from SET_AFFINITY */
+    int nice;                       /* -20 to +19, default 0 */
+    int weight;                     /* Computed from nice value */
+    int task_index;                 /* Position in Scheduler.all_tasks */
+    int home_cpu;                   /* Run queue holding the task (per-CPU mode) */
     int burst_remaining;            /* Remaining burst duration */
-    int heap_index;                 /* Position in heap for O(log n) updates */
     bool is_burst;                  /* True if in CPU burst mode */
+    
+    /* EEVDF state and latency accounting */
+    vruntime_t deadline;            /* Virtual deadline: eligible vruntime + slice / weight */
+    vruntime_t vlag;                /* Lag behind the average vruntime, kept while blocked */
+    int avg_weight;                 /* Weight counted in the run queue average while queued */
+    int wake_tick;                  /* Tick count when last made runnable, -1 once it ran */
+    
+    /* Utilization (PELT), capacity-invariant: 1024 = always running on the fastest core */
+    uint64_t util_sum;              /* Decayed sum of running periods x CPU capacity */
+    int util_avg;                   /* util_sum / PELT_LOAD_AVG_MAX */
+    int util_tick;                  /* Tick count util_sum was last decayed to */
 } Task;
 
 /**
- * Min-Heap for efficient task scheduling
+ * Array min-heap for efficient task scheduling (binary or d-ary)
  */
 typedef struct {
     Task **tasks;
     int size;
     int capacity;
+    int shift;                      /* log2 of the arity: 1 binary, 2 4-ary, 3 8-ary */
 } MinHeap;
 
 /**
- * Cgroup structure for resource control
+ * Intrusive pairing heap: O(1) insert, amortized O(log n) extract-min
+ */
+typedef struct {
+    Task *root;                     /* Minimum task, NULL when empty */
+    int size;
+} PairingHeap;
+
+/**
+ * Intrusive red-black tree ordered like the heap, with the leftmost
+ * (minimum) node cached as in the kernel's rb_root_cached
+ */
+typedef struct {
+    Task *root;
+    Task *leftmost;                 /* Minimum task, NULL when empty */
+    int size;
+    bool augmented;                 /* Maintain qnode.min_deadline in every node */
+} RbTree;
+
+/**
+ * Run queue backends (--runqueue=)
+ */
+typedef enum {
+    QUEUE_HEAP = 0,                 /* Binary heap (default) */
+    QUEUE_HEAP4,                    /* 4-ary heap */
+    QUEUE_HEAP8,                    /* 8-ary heap */
+    QUEUE_PAIRING,                  /* Pairing heap */
+    QUEUE_RBTREE,                   /* Red-black tree with cached leftmost */
+    QUEUE_RBTREE_AUG,               /* RB-tree augmented with subtree min deadlines (EEVDF) */
+    QUEUE_BACKEND_COUNT
+} QueueBackend;
+
+/* make RUNQUEUE=<name> changes the backend a scheduler starts with */
+#ifndef ALFS_RUNQUEUE_DEFAULT
+#define ALFS_RUNQUEUE_DEFAULT QUEUE_HEAP
+#endif
+
+/**
+ * Priority queue of tasks in task_before() order. Each backend fills
+ * an operation table and keeps `first` current, so selection reads the
+ * minimum without a call.
+ */
+typedef struct TaskQueue {
+    const struct QueueOps *ops;
+    Task *first;                    /* Minimum task, NULL when empty */
+    union {
+        MinHeap heap;               /* Binary, 4-ary and 8-ary heaps */
+        PairingHeap pairing;
+        RbTree rbtree;
+    } impl;
+} TaskQueue;
+
+/**
+ * Run queue backend operations (one static table per backend)
+ */
+typedef struct QueueOps {
+    QueueBackend backend;
+    const char *name;
+    int (*init)(struct TaskQueue *queue);
+    void (*release)(struct TaskQueue *queue);
+    int (*insert)(struct TaskQueue *queue, Task *task);
+    void (*remove)(struct TaskQueue *queue, Task *task);
+    void (*update)(struct TaskQueue *queue, Task *task);
+    Task *(*extract_min)(struct TaskQueue *queue);
+    Task *(*last)(const struct TaskQueue *queue);
+    int (*size)(const struct TaskQueue *queue);
+    int (*collect)(const struct TaskQueue *queue, Task **out);
+    int (*validate)(const struct TaskQueue *queue);
+    Task *(*pick_eligible)(const struct TaskQueue *queue, vruntime_t avg_vruntime); /* NULL: no deadlines */
+} QueueOps;
+
+/**
+ * Affinity class: the runnable tasks of one run queue that share an
+ * effective CPU mask (task affinity AND cgroup mask) and a cgroup.
+ * Every task in a class is eligible on exactly the same CPUs and is
+ * throttled together, so a CPU only looks at the head of each class.
+ */
+typedef struct TaskClass {
+    CpuMask mask;                   /* Effective CPU mask of members */
+    struct Cgroup *cgroup;          /* Shared cgroup (NULL for none) */
+    TaskQueue queue;                /* Queued members in vruntime order */
+    struct RunQueue *rq;            /* Owning run queue */
+    int rq_index;                   /* Position in rq->classes */
+    int refs;                       /* Bound tasks (queued or running); freed at zero */
+    bool parked;                    /* Cgroup throttled: hidden from selection */
+    struct TaskClass *cgroup_next;  /* Classes list of the cgroup */
+    struct TaskClass *cgroup_prev;
+} TaskClass;
+
+/**
+ * Set of affinity classes holding RUNNABLE tasks.
+ * classes[0, active_count) are schedulable; the rest belong to
+ * throttled cgroups and are parked until their quota refills.
+ */
+typedef struct RunQueue {
+    TaskClass **classes;
+    int class_count;
+    int active_count;
+    int class_capacity;
+    int nr_queued;                  /* Queued tasks across all classes */
+    int nr_parked;                  /* Queued tasks in parked classes */
+    vruntime_t min_vruntime;        /* Monotonic floor of queued/running vruntimes */
+    double avg_sum;                 /* Sum of avg_weight x (vruntime - min_vruntime), queued tasks */
+    int64_t avg_load;               /* Sum of avg_weight, queued tasks */
+    QueueBackend backend;           /* Queue backend of new classes */
+} RunQueue;
+
+/**
+ * Timer in a TimerWheel, embedded in the object it times.
+ * Slot lists are linked like the kernel's hlist: pprev points at the
+ * previous node's next (or the slot head), NULL while unarmed.
+ */
+typedef struct TimerNode {
+    struct TimerNode *next;
+    struct TimerNode **pprev;
+    long long expires;              /* Tick at which the timer fires */
+} TimerNode;
+
+/**
+ * Hashed timing wheel keyed by tick: a timer sits in slot
+ * expires % TIMER_WHEEL_SLOTS, so advancing one tick only visits the
+ * timers of one slot. A zeroed wheel is empty at tick 0.
+ */
+typedef struct TimerWheel {
+    TimerNode *slots[TIMER_WHEEL_SLOTS];
+    long long now;                  /* Last tick advanced to */
+    int armed;                      /* Timers currently armed */
+} TimerWheel;
+
+/**
+ * Cgroup structure for resource control.
+ * Cgroups form a tree: shares and masks compound down it, and runtime
+ * is charged to every cgroup with a quota on the way up. Throttling a
+ * cgroup parks its whole subtree.
  */
 typedef struct Cgroup {
-    char cgroup_id[MAX_CGROUP_ID_LEN];
+    const char *cgroup_id;          /* Interned once registered, like Task.task_id */
+    char *id_copy;                  /* ID owned by a heap-allocated cgroup, NULL if pooled */
+    Pool *pool;                     /* Owning pool, NULL if heap-allocated */
+    int index;                      /* Slot in Scheduler.cgroups */
     int cpu_shares;                 /* Default 1024 */
     int cpu_quota_us;               /* Default -1 (unlimited) */
     int cpu_period_us;              /* Default 100000 (100ms) */
-    int *cpu_mask;                  /* Array of allowed CPU IDs */
-    int cpu_mask_count;
+    CpuMask cpu_mask;               /* Allowed CPUs: requested_mask AND the parent's cpu_mask */
+    CpuMask requested_mask;         /* Mask as configured (all bits set = any CPU) */
     double quota_used;              /* Track quota usage per period */
+    double planned_runtime_us;      /* Runtime committed to CPUs in the current tick */
+    struct Cgroup *planned_next;    /* Scheduler's list of cgroups with planned runtime */
+    bool planned;                   /* On that list */
+    struct TaskClass *classes;      /* Affinity classes of member tasks */
+    bool throttled;                 /* Own quota exhausted */
+    int throttle_count;             /* Throttled cgroups from here to the root; parked when > 0 */
     int period_start_vtime;         /* Start of current period */
+    TimerNode period_timer;         /* Period expiry in the scheduler's period wheel */
+
+    /* Hierarchy */
+    struct Cgroup *parent;          /* NULL for a root cgroup */
+    struct Cgroup *first_child;
+    struct Cgroup *next_sibling;
+    struct Cgroup *prev_sibling;
+    int depth;                      /* 0 for a root cgroup */
+    int effective_shares;           /* cpu_shares x each ancestor's shares / 1024 (cached) */
+    struct Cgroup *quota_group;     /* Nearest cgroup with a quota, itself or an ancestor */
 } Cgroup;
 
+/**
+ * A run queue's best pick for one CPU, chosen before anything is dequeued
+ */
+typedef struct {
+    struct TaskClass *tclass;       /* Class to take from, NULL if none is eligible */
+    Task *task;                     /* EEVDF pick inside tclass, NULL = its head */
+    int deferred;                   /* Queued classes passed over */
+    bool quota;                     /* A quota-limited class was considered */
+} PickChoice;
+
 /**
  * Per-CPU run queue
  */
 typedef struct {
     int cpu_id;
     Task *current_task;             /* Currently running task */
-    double min_vruntime;            /* Minimum vruntime seen */
+    Task *previous_task;            /* Running when the current tick started */
+    int capacity;                   /* Relative compute capacity, 1 to SCHED_CAPACITY_SCALE */
+    RunQueue rq;                    /* Runnable tasks homed here (per-CPU mode) */
+    PickChoice spec;                /* Parallel tick: local pick made ahead of the merge */
+    bool spec_stale;                /* rq lost a task to a steal since spec was made */
 } CPURunQueue;
 
 /**
@@ -143,31 +491,71 @@ typedef struct {
 typedef struct {
     int preemptions;                /* Tasks preempted this tick */
     int migrations;                 /* Tasks that changed CPU */
-    char **runnable_tasks;
+    int throttles;                  /* Cgroups throttled since the last tick */
+    int unthrottles;                /* Cgroups unthrottled since the last tick */
+    bool has_latency;               /* Wake-up latency is reported (--latency) */
+    int wakeups;                    /* Tasks that ran for the first time since waking */
+    int wakeup_latency;             /* Ticks those tasks waited, summed */
+    const char **runnable_tasks;
     int runnable_count;
-    char **blocked_tasks;
+    const char **blocked_tasks;     /* Points into the same buffer as runnable_tasks */
     int blocked_count;
+    const char **removed_tasks;     /* Delta ticks: tasks that left both lists (same buffer) */
+    int removed_count;
+    IdEntry **task_entries;         /* Entry of each listed ID, same layout (one reference each) */
+    int task_capacity;              /* Slots in the shared task list buffers */
 } SchedulerMeta;
 
 /**
- * Scheduler tick output
+ * Scheduler tick output.
+ * Task IDs point at interned strings rather than copies; the tick pins
+ * (takes a reference on) every entry it lists, so the IDs stay valid
+ * after the tasks exit. A tick is reset and refilled by
+ * scheduler_tick_into, so its buffers are only allocated while they grow.
+ *
+ * The schedule's entries are in `pins`, the listed tasks' entries in
+ * meta->task_entries. Full task lists are tagged with the scheduler's
+ * list version (list_serial, list_epoch): while no task changes list,
+ * a refilled tick keeps them as they are, and an encoder may reuse the
+ * bytes it wrote for them (OutputBuffer).
+ *
+ * In a delta tick (scheduler_set_delta) the schedule is still complete,
+ * but only changed_cpus are meant to be sent, and the metadata lists
+ * hold only the tasks whose listing changed since the previous tick:
+ * runnable_tasks became runnable, blocked_tasks became blocked and
+ * removed_tasks left both lists.
  */
 typedef struct {
     int vtime;
-    char **schedule;                /* Task ID per CPU, "idle" if none */
+    const char **schedule;          /* Task ID per CPU, "idle" if none */
     int cpu_count;
+    bool delta;                     /* Changes since the previous tick only */
+    int *changed_cpus;              /* Delta ticks: CPUs whose task changed, ascending */
+    int changed_count;
     SchedulerMeta *meta;            /* Optional metadata */
+    IdTable *ids;                   /* Table owning the pinned entries */
+    IdEntry **pins;                 /* Entries of the busy CPUs, in CPU order */
+    int pin_count;
+    int pin_capacity;
+    uint64_t list_serial;           /* Version of the full task lists held (0 = none) */
+    uint64_t list_epoch;
 } SchedulerTick;
 
 /**
- * Event structure for incoming events
+ * Event structure for incoming events.
+ * The parser clears every field from `nice` on in one memset, so new
+ * scalar fields belong below it and the ID pointers stay above it.
+ * IDs are NULL when absent and otherwise point into decoder-owned
+ * storage that lives as long as the TimeFrame's contents.
  */
 typedef struct {
     EventAction action;
-    char task_id[MAX_TASK_ID_LEN];
-    char cgroup_id[MAX_CGROUP_ID_LEN];
-    char new_cgroup_id[MAX_CGROUP_ID_LEN];
+    const char *task_id;
+    const char *cgroup_id;
+    const char *new_cgroup_id;
+    const char *parent_id;          /* CGROUP_CREATE: parent cgroup, NULL for a root */
     int nice;
+    uint32_t task_handle;           /* Binary-protocol handle of task_id, 0 if none */
     int *cpu_mask;
     int cpu_mask_count;
     int cpu_shares;
@@ -182,14 +570,237 @@ typedef struct {
 } Event;
 
 /**
- * TimeFrame structure for incoming messages
+ * TimeFrame structure for incoming messages.
+ * Events are stored contiguously, every Event.cpu_mask points into
+ * cpu_masks and JSON-decoded IDs point into id_text; the buffers are
+ * reused when the TimeFrame is parsed into again, so they only allocate
+ * while growing.
  */
 typedef struct {
     int vtime;
-    Event **events;
+    Event *events;
     int event_count;
+    int event_capacity;
+    int *cpu_masks;                 /* Backing store of every Event.cpu_mask */
+    int cpu_mask_used;
+    int cpu_mask_capacity;
+    char *id_text;                  /* Backing store of decoded IDs, NUL-terminated */
+    size_t id_text_used;
+    size_t id_text_capacity;
 } TimeFrame;
 
+/**
+ * Buffered socket connection.
+ * Bytes are read in large chunks into buf; buf[start, end) is unconsumed
+ * input that carries over to the next message. Received messages point
+ * into buf and stay valid until the next receive.
+ */
+typedef struct {
+    int sock;
+    UdsFraming framing;
+    char *buf;
+    size_t capacity;
+    size_t start;                   /* First unconsumed byte */
+    size_t end;                     /* One past the last received byte */
+    size_t scanned;                 /* Bytes after start already searched for a frame end */
+    size_t held_pos;                /* Byte overwritten by the last message's '\0' */
+    char held_byte;
+    bool holding;
+    int depth;                      /* JSON framing scan state */
+    bool in_string;
+    bool escaped;
+    bool found_start;
+    int recv_flags;                 /* MSG_DONTWAIT when polled (epoll-driven) */
+} UdsConn;
+
+/**
+ * Reusable buffer holding one outgoing message.
+ * The payload starts at data + OUTPUT_HEADROOM and is NUL-terminated;
+ * the headroom and the terminator byte let the sender add its framing
+ * in place and write the whole message with one call.
+ *
+ * The buffer also keeps the encoded task lists of one list version.
+ * When a version shows up for the second tick in a row its bytes are
+ * captured, and from then on they are copied instead of re-encoded, so
+ * lists that keep changing never pay for the capture.
+ */
+#define OUTPUT_HEADROOM 4           /* Room for a length-prefix header */
+
+typedef struct {
+    char *data;
+    size_t length;                  /* Payload bytes */
+    size_t capacity;                /* Allocated bytes, headroom included */
+    char *lists;                    /* Encoded task lists of the cached version */
+    size_t lists_length;
+    size_t lists_capacity;
+    uint64_t lists_serial;          /* Cached list version (serial 0 = none) */
+    uint64_t lists_epoch;
+    WireProtocol lists_protocol;    /* Encoding of the cached bytes */
+    bool lists_seen;                /* The version was encoded once already */
+    bool lists_ready;               /* Its bytes are captured */
+} OutputBuffer;
+
+/**
+ * ID strings the peer has defined for binary-protocol handles
+ */
+typedef struct {
+    char **names;                   /* Indexed by handle, NULL if undefined */
+    uint32_t capacity;
+} HandleTable;
+
+/**
+ * Wire codec: turns received messages into TimeFrames and ticks into
+ * messages for one protocol. decode only touches the decoder state and
+ * encode none, so the pipeline may run them on different threads.
+ */
+typedef struct Codec {
+    WireProtocol protocol;
+    const char *name;
+    int (*greet)(struct Codec *codec, UdsConn *conn, int cpu_count);
+    int (*check_greeting)(struct Codec *codec, const char *message, size_t length);
+    int (*decode)(struct Codec *codec, const char *message, size_t length, TimeFrame *tf);
+    int (*encode)(const SchedulerTick *tick, bool include_meta, OutputBuffer *out);
+    HandleTable handles;            /* Decoder state (binary protocol) */
+} Codec;
+
+/**
+ * Totals for one trace replay
+ */
+typedef struct {
+    long frames;                    /* Timeframes decoded, one tick each */
+    long events;                    /* Events in decoded timeframes */
+    long rejected;                  /* Events the scheduler rejected */
+    long errors;                    /* Messages that failed to decode */
+    size_t input_bytes;             /* Trace size */
+    size_t output_bytes;            /* Bytes written, framing included */
+    double seconds;                 /* Wall time from first frame to flush */
+} ReplayStats;
+
+/**
+ * Bounded lock-free single-producer/single-consumer pointer queue.
+ * head and tail only grow; an index maps to slots[index & (capacity - 1)].
+ * The mutex and condvar are touched only when one side has to sleep.
+ */
+typedef struct {
+    void **slots;
+    size_t capacity;                /* Power of two */
+    _Alignas(64) atomic_size_t head;    /* Next index to pop (consumer-owned) */
+    _Alignas(64) atomic_size_t tail;    /* Next index to push (producer-owned) */
+    _Alignas(64) atomic_int sleepers;   /* Sides blocked on wake */
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} SpscQueue;
+
+/**
+ * Job run by a work pool: handle indices [begin, end)
+ */
+typedef void (*WorkFn)(void *arg, int begin, int end);
+
+/**
+ * Fork-join thread pool. The calling thread and the helpers split each
+ * job's index range into contiguous chunks. Between jobs helpers spin on
+ * the generation counter for a while, then sleep on the condvar; the
+ * caller only takes the mutex when one is asleep.
+ */
+typedef struct WorkPool {
+    struct WorkPoolSlot *slots;     /* One per helper thread */
+    int helpers;
+    WorkFn fn;                      /* Current job */
+    void *arg;
+    int count;
+    _Alignas(64) atomic_uint generation;    /* Bumped once per job */
+    _Alignas(64) atomic_int pending;        /* Helpers still on the current job */
+    _Alignas(64) atomic_int sleepers;       /* Helpers blocked on wake */
+    atomic_bool stop;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} WorkPool;
+
+/**
+ * Timed hot-path phases. Every event action has its own slot after
+ * STAT_EVENT; the tick's sub-phases add up to STAT_TICK.
+ */
+typedef enum {
+    STAT_PARSE,                     /* codec_decode of one timeframe */
+    STAT_EVENT,                     /* + EventAction */
+    STAT_TICK = STAT_EVENT + EVENT_ACTION_COUNT,
+    STAT_TICK_REQUEUE,              /* Charge running tasks and queue them back */
+    STAT_TICK_BALANCE,              /* Load (and misfit) balancing, when due */
+    STAT_TICK_PICK,                 /* Select a task for every CPU */
+    STAT_TICK_META,                 /* Metadata counters and task lists */
+    STAT_SERIALIZE,                 /* codec_encode of one tick */
+    STAT_PHASE_COUNT
+} StatPhase;
+
+/**
+ * Hot-path event counters
+ */
+typedef enum {
+    STAT_QUEUE_EXTRACT,             /* Tasks taken off a run queue to run */
+    STAT_QUEUE_REINSERT,            /* Running tasks queued back at the tick */
+    STAT_PICK_DEFERRED,             /* Queued classes passed over (affinity, quota, fit) */
+    STAT_STEAL_ATTEMPT,             /* Remote run queues searched by an idle CPU */
+    STAT_STEAL,                     /* Tasks stolen */
+    STAT_IDLE,                      /* CPUs left idle at a tick */
+    STAT_PICK_RETRY,                /* Parallel picks redone by the serial merge */
+    STAT_EVENT_COALESCED,           /* Batched events superseded before they applied */
+    STAT_COUNTER_COUNT
+} StatCounter;
+
+#define STATS_BUCKETS 32            /* Bucket i counts durations in [2^i, 2^(i+1)) ns */
+
+/**
+ * Cumulative duration histogram of one phase
+ */
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t total_ns;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t buckets[STATS_BUCKETS];
+} StatHistogram;
+
+/**
+ * Hot-path instrumentation (--stats-interval).
+ * Each phase is recorded by exactly one thread (parse and serialize run
+ * on the pipeline's stage threads), so updates are relaxed load/store
+ * pairs rather than read-modify-write atomics, yet any thread may read
+ * a consistent count for reporting.
+ */
+typedef struct {
+    StatHistogram phases[STAT_PHASE_COUNT];
+    _Atomic uint64_t counters[STAT_COUNTER_COUNT];
+    uint64_t start_ns;
+    uint64_t interval_ns;           /* Between periodic reports, 0 = only at exit */
+    uint64_t next_report_ns;
+} SchedStats;
+
+/* ============================================================================
+ * Checkpoints
+ * ============================================================================ */
+
+/**
+ * Snapshot writer (--checkpoint).
+ * Snapshots are written by a forked child from its copy-on-write image
+ * of the scheduler, so the tick loop only pays for the fork.
+ */
+typedef struct {
+    char *path;                     /* Snapshot file, replaced atomically */
+    int interval;                   /* Timeframes between snapshots, 0 = on request only */
+    int frames;                     /* Timeframes since the last snapshot started */
+    pid_t writer;                   /* Child writing a snapshot, 0 if none */
+    long written;                   /* Snapshots completed */
+    long failed;                    /* Snapshots whose writer failed */
+} Checkpointer;
+
+/**
+ * One task ID seen while planning a batch of events
+ */
+typedef struct {
+    const char *id;                 /* NULL = empty slot */
+    uint32_t hash;
+    int next;                       /* Index of the next event on this task */
+} EventSlot;
+
 /**
  * Main scheduler structure
  */
@@ -198,18 +809,55 @@ typedef struct {
     int cpu_count;
     int quanta;
     
-    /* Task storage using hash table would be better, but using array for simplicity */
+    /* Task storage, grown by doubling; lookups by ID go through the interned ID index */
     Task **all_tasks;
     int task_count;
     int task_capacity;
     
-    /* Cgroup storage */
+    /*
+     * Dense columns parallel to all_tasks (slot = Task.task_index), so
+     * per-tick passes scan bytes instead of chasing Task pointers
+     */
+    uint8_t *task_states;           /* TaskState of each slot */
+    IdEntry **task_entries;         /* Interned task_id of each slot */
+    uint8_t *task_reported;         /* List each slot was last reported in (delta ticks) */
+    
+    /*
+     * Task list version: list_epoch is bumped whenever a task is added,
+     * removed or moves between the runnable and blocked lists, so ticks
+     * at the same version list the same IDs in the same order
+     */
+    uint64_t list_serial;           /* Unique per scheduler in the process */
+    uint64_t list_epoch;
+    
+    /* Interned task/cgroup ID index */
+    IdTable *ids;
+    
+    /* Cgroup storage, grown by doubling */
     Cgroup **cgroups;
     int cgroup_count;
-    int cgroup_capacity;
+    int cgroup_capacity;            /* Slots in cgroups and expired_cgroups */
+    TimerWheel period_wheel;        /* Period expiry of every cgroup */
+    Cgroup **expired_cgroups;       /* Scratch: periods expiring this tick */
+    int expired_count;
+    Cgroup *planned_cgroups;        /* Cgroups holding planned runtime this tick */
+    
+    /* Slab pools for task and cgroup records */
+    TaskPools task_pools;
+    Pool cgroup_pool;
     
-    /* Global min-heap for runnable tasks */
-    MinHeap *runnable_heap;
+    /* Global run queue of RUNNABLE tasks (running tasks are not in it) */
+    RunQueue runqueue;
+    uint64_t next_task_seq;
+    
+    /* Largest runnable vruntime; recomputed lazily once its holder leaves */
+    vruntime_t max_vruntime;
+    bool max_vruntime_stale;
+    
+    /* Per-CPU run queue mode: RUNNABLE tasks live in cpu_queues[].rq */
+    bool per_cpu_queues;
+    int balance_interval;           /* Ticks between load balancing (0 = idle stealing only) */
+    int tick_count;
     
     /* Current virtual time */
     int current_vtime;
@@ -217,8 +865,73 @@ typedef struct {
     /* Statistics for metadata */
     int preemptions;
     int migrations;
+    int throttles;                  /* Since the last tick */
+    int unthrottles;
+    bool collect_meta;              /* Fill runnable/blocked task lists */
+    bool report_latency;            /* Report wake-up latency in the metadata */
+    
+    /* Selection policy */
+    SchedPolicy policy;
+    
+    /* CPU capacities (cpu_queues[].capacity) differ: place by utilization */
+    bool asym_capacity;
+    int max_capacity;
+    
+    /* Hot-path instrumentation, NULL unless enabled */
+    SchedStats *stats;
+    
+    /* Snapshot writer, NULL unless enabled */
+    Checkpointer *checkpoint;
+    
+    /* Delta ticks (scheduler_set_delta): what the peer was last sent */
+    int delta_interval;             /* Ticks per full keyframe, 0 = every tick is full */
+    int delta_ticks;                /* Ticks since the last keyframe */
+    IdEntry **sent_schedule;        /* Task per CPU in the last tick, NULL = idle (pinned) */
+    IdEntry **dropped_tasks;        /* Reported tasks removed since the last tick (pinned) */
+    int dropped_count;
+    int dropped_capacity;
+    uint64_t reported_epoch;        /* list_epoch task_reported matches (0 = none) */
+    
+    /* Parallel tick (per-CPU mode): local picks are made on these threads */
+    WorkPool *tick_pool;
+    bool quota_planned;             /* A quota reservation was made this tick */
+    
+    /* Scratch for scheduler_process_events, grown by doubling */
+    EventSlot *batch_slots;         /* Task ID -> next event on it in the batch */
+    uint8_t *batch_skip;            /* Events superseded later in the batch */
+    int batch_capacity;             /* Events the scratch covers (slots hold twice that) */
 } Scheduler;
 
+/**
+ * Builds one configured scheduler per connection in multi-tenant mode;
+ * called on the worker thread that serves the connection
+ */
+typedef Scheduler *(*TenantFactory)(void *arg);
+
+/**
+ * Multi-tenant server settings (--listen)
+ */
+typedef struct {
+    const char *socket_path;        /* Listening socket */
+    int workers;                    /* Worker threads, 0 = one per usable CPU */
+    UdsFraming framing;
+    WireProtocol protocol;
+    bool include_meta;
+    int cpu_count;                  /* Announced in binary handshakes */
+    TenantFactory create_scheduler;
+    void *factory_arg;
+} TenantConfig;
+
+/**
+ * Totals over every connection a multi-tenant server served
+ */
+typedef struct {
+    long connections;
+    long frames;                    /* Timeframes answered */
+    long rejected;                  /* Events the schedulers rejected */
+    long errors;                    /* Undecodable messages, failed handshakes */
+} TenantTotals;
+
 /* ============================================================================
  * Function Declarations
  * ============================================================================ */
@@ -230,9 +943,44 @@ static inline int nice_to_weight(int nice) {
     return sched_prio_to_weight[nice - NICE_MIN];
 }
 
-/* vruntime delta calculation */
-static inline double calc_vruntime_delta(double runtime, int weight) {
-    return runtime * ((double)NICE_0_WEIGHT / (double)weight);
+/**
+ * Whether a utilization fits a CPU capacity with the kernel's 20% margin
+ * (fits_capacity(): util below 80% of the capacity)
+ */
+static inline bool util_fits_capacity(int util, int capacity) {
+    return (int64_t)util * 1280 < (int64_t)capacity * 1024;
+}
+
+/* (a * mul) >> shift without a 128-bit intermediate, as in the kernel */
+static inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, unsigned int shift) {
+    uint32_t ah = (uint32_t)(a >> 32);
+    uint32_t al = (uint32_t)a;
+    uint64_t ret = ((uint64_t)al * mul) >> shift;
+    if (ah) {
+        ret += ((uint64_t)ah * mul) << (32 - shift);
+    }
+    return ret;
+}
+
+/* Kernel __calc_delta(delta_exec, NICE_0_WEIGHT, weight) from a cached 2^32 / weight */
+static inline uint64_t calc_vruntime_delta_fixed(uint64_t delta_exec, uint32_t inv_weight) {
+    uint64_t fact = (uint64_t)NICE_0_WEIGHT * inv_weight;
+    unsigned int shift = WMULT_SHIFT;
+    while (fact >> 32) {
+        fact >>= 1;
+        shift--;
+    }
+    return mul_u64_u32_shr(delta_exec, (uint32_t)fact, shift);
+}
+
+/* vruntime advance for `runtime` quanta at a cached inverse weight */
+static inline vruntime_t vruntime_delta(double runtime, inv_weight_t inv_weight) {
+#ifdef ALFS_FIXED_VRUNTIME
+    return (vruntime_t)calc_vruntime_delta_fixed((uint64_t)(runtime * (double)VRUNTIME_QUANTUM),
+                                                 inv_weight);
+#else
+    return runtime * inv_weight;
+#endif
 }
 
 #endif /* ALFS_H */
@@ -0,0 +1,109 @@
+/**
+ * ALFS - Binary Wire Protocol Interface
+ *
+ * Length-framed messages (UDS_FRAME_LENGTH, whose prefix stays big-endian);
+ * integers inside a message are little-endian.
+ * Every message starts with a one-byte type.
+ *
+ *   HELLO      u8 type=1, u8 version, u16 cpu_count
+ *              Sent by the scheduler after connecting; the peer answers
+ *              with a HELLO of the same version (cpu_count ignored).
+ *
+ *   TIMEFRAME  u8 type=2, u8 reserved, u16 define_count,
+ *              i32 vtime, u32 event_count,
+ *              define_count x { u32 handle, u16 length, bytes[length] },
+ *              event_count  x 36-byte event record,
+ *              u16 cpu ID per cpuMask entry, in event order
+ *
+ *   TICK       u8 type=3, u8 flags (bit 0: meta, bit 1: latency,
+ *              bit 2: delta), u16 cpu_count, i32 vtime,
+ *              u32 handle per CPU (0 = idle), or for a delta
+ *              u32 changed_count, changed_count x { u32 cpu, u32 handle };
+ *              with meta: i32 preemptions, migrations, throttles,
+ *              unthrottles, u32 runnable_count, u32 blocked_count,
+ *              for a delta also u32 removed_count,
+ *              with latency also u32 wakeups, u32 wakeup_latency,
+ *              then the runnable, blocked (and removed) handles
+ *
+ * Event record: u8 action (EventAction), u8 flags (BINARY_HAS_*),
+ * u16 cpu_mask_count, u32 task, u32 cgroup, u32 new_cgroup handles
+ * (0 = none; the third is the parent for CGROUP_CREATE), i32 nice, cpu_shares, cpu_quota_us, cpu_period_us,
+ * burst_duration.
+ *
+ * A handle names one ID string for the whole connection: it is defined
+ * once, in the first timeframe that uses it, and never redefined.
+ */
+
+#ifndef BINARY_CODEC_H
+#define BINARY_CODEC_H
+
+#include "alfs.h"
+
+#define BINARY_VERSION 1
+#define BINARY_MSG_HELLO 1
+#define BINARY_MSG_TIMEFRAME 2
+#define BINARY_MSG_TICK 3
+
+#define BINARY_HELLO_SIZE 4
+#define BINARY_FRAME_HEADER_SIZE 12
+#define BINARY_EVENT_SIZE 36
+#define BINARY_TICK_HEADER_SIZE 8
+#define BINARY_MAX_HANDLE (1u << 24)
+
+/* Event record flags */
+#define BINARY_HAS_NICE       0x01
+#define BINARY_HAS_CPU_SHARES 0x02
+#define BINARY_HAS_CPU_QUOTA  0x04
+#define BINARY_HAS_CPU_PERIOD 0x08
+#define BINARY_HAS_CPU_MASK   0x10
+
+#define BINARY_TICK_META    0x01
+#define BINARY_TICK_LATENCY 0x02
+#define BINARY_TICK_DELTA   0x04
+
+/**
+ * Send the scheduler's HELLO to the peer
+ * @param codec Binary codec
+ * @param conn Connection (length framing)
+ * @param cpu_count CPU count announced to the peer
+ * @return 0 on success, -1 if the send failed
+ */
+int binary_send_hello(Codec *codec, UdsConn *conn, int cpu_count);
+
+/**
+ * Check the peer's answer to the HELLO
+ * @param codec Binary codec
+ * @param message Received message (NULL if none arrived)
+ * @param length Message length
+ * @return 0 if the peer speaks this version, -1 otherwise
+ */
+int binary_check_hello(Codec *codec, const char *message, size_t length);
+
+/**
+ * Decode a TIMEFRAME message into an existing TimeFrame
+ * Records new handle definitions, then resolves every handle to its ID.
+ * @param codec Binary codec (owns the handle table)
+ * @param message Message payload
+ * @param length Payload length
+ * @param tf TimeFrame to fill (previous contents are discarded)
+ * @return 0 on success, -1 on a malformed message (tf is left empty)
+ */
+int binary_decode_timeframe(Codec *codec, const char *message, size_t length, TimeFrame *tf);
+
+/**
+ * Encode a tick as a TICK message
+ * Task IDs are written as the handles their tasks were created with.
+ * @param tick SchedulerTick to encode
+ * @param include_meta Whether to include metadata
+ * @param out Buffer to fill (previous contents are discarded)
+ * @return 0 on success, -1 on allocation failure
+ */
+int binary_encode_tick(const SchedulerTick *tick, bool include_meta, OutputBuffer *out);
+
+/**
+ * Free every handle definition
+ * @param handles Table to clear
+ */
+void binary_handles_clear(HandleTable *handles);
+
+#endif /* BINARY_CODEC_H */
@@ -8,7 +8,7 @@
 #include "alfs.h"
 
 /**
- * Create a new cgroup
+ * Create a new cgroup that owns a copy of its ID
  * @param cgroup_id Cgroup identifier
  * @param cpu_shares CPU shares (weight relative to other cgroups)
  * @param cpu_quota_us CPU quota in microseconds per period (-1 for unlimited)
@@ -22,7 +22,19 @@ Cgroup *cgroup_create(const char *cgroup_id, int cpu_shares,
                       const int *cpu_mask, int cpu_mask_count);
 
 /**
- * Destroy a cgroup and free memory
+ * Create a new cgroup from a slab pool
+ * Same as cgroup_create, but cgroup_destroy returns it to the pool and
+ * the ID is borrowed until scheduler_add_cgroup points it at the
+ * interned copy.
+ * @param pool Pool of Cgroup records
+ * @return Pointer to new Cgroup or NULL on failure
+ */
+Cgroup *cgroup_create_pooled(Pool *pool, const char *cgroup_id, int cpu_shares,
+                             int cpu_quota_us, int cpu_period_us,
+                             const int *cpu_mask, int cpu_mask_count);
+
+/**
+ * Destroy a cgroup and free memory (or return it to its pool)
  * @param cgroup Cgroup to destroy
  */
 void cgroup_destroy(Cgroup *cgroup);
@@ -71,4 +83,35 @@ void cgroup_account_runtime(Cgroup *cgroup, double runtime);
  */
 void cgroup_reset_period(Cgroup *cgroup, int vtime);
 
+/**
+ * Recompute the inherited state of a cgroup from its own settings and
+ * its parent: effective shares, CPU mask and quota group. Callers walk
+ * the subtree when a setting changes, parents first.
+ * @param cgroup Target cgroup
+ */
+void cgroup_inherit(Cgroup *cgroup);
+
+/**
+ * Link a new cgroup below a parent and inherit from it
+ * @param cgroup Cgroup with no parent yet
+ * @param parent Parent cgroup
+ * @return 0 on success, -1 if the tree would exceed MAX_CGROUP_DEPTH
+ */
+int cgroup_attach(Cgroup *cgroup, Cgroup *parent);
+
+/**
+ * Unlink a cgroup from its parent; its children are not moved
+ * @param cgroup Target cgroup (a root is left as is)
+ */
+void cgroup_detach(Cgroup *cgroup);
+
+/**
+ * Walk a subtree in pre-order, so every cgroup follows its parent:
+ * for (c = root; c; c = cgroup_next_descendant(root, c))
+ * @param root Subtree root
+ * @param pos Current position
+ * @return The next cgroup, or NULL after the last one
+ */
+Cgroup *cgroup_next_descendant(const Cgroup *root, const Cgroup *pos);
+
 #endif /* CGROUP_H */
@@ -0,0 +1,77 @@
+/**
+ * ALFS - Checkpoint Interface
+ * Binary snapshots of a scheduler, written in the background and
+ * restored with one mapping at startup
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "alfs.h"
+
+/**
+ * Create a snapshot writer
+ * @param path Snapshot file (a temporary beside it is renamed over it)
+ * @param interval Timeframes between snapshots (0 = only on request)
+ * @return Writer, or NULL on failure
+ */
+Checkpointer *checkpoint_create(const char *path, int interval);
+
+/**
+ * Wait for a running writer and free the checkpointer
+ * @param cp Checkpointer (may be NULL)
+ */
+void checkpoint_destroy(Checkpointer *cp);
+
+/**
+ * Ask for a snapshot at the next checkpoint_poll.
+ * Async-signal-safe, for a SIGUSR1 handler.
+ */
+void checkpoint_request(void);
+
+/**
+ * Called once per timeframe between ticks: reaps a finished writer and,
+ * when a snapshot is due or was requested, forks a child that writes
+ * one from its copy of the scheduler. A snapshot stays due while the
+ * previous writer is still running.
+ * @param cp Checkpointer (NULL = checkpoints disabled)
+ * @param sched Scheduler to snapshot
+ */
+void checkpoint_poll(Checkpointer *cp, const Scheduler *sched);
+
+/**
+ * Wait for a running writer, then write a snapshot synchronously
+ * (at shutdown)
+ * @param cp Checkpointer (NULL = checkpoints disabled)
+ * @param sched Scheduler to snapshot
+ * @return 0 on success, -1 on failure
+ */
+int checkpoint_flush(Checkpointer *cp, const Scheduler *sched);
+
+/**
+ * Write a snapshot of the scheduler: tasks, cgroups, run queue classes
+ * with their queue order, per-CPU current tasks and virtual time.
+ * The file is written under a temporary name, synced and renamed, so
+ * readers only ever see a complete snapshot.
+ * @param sched Scheduler (between ticks)
+ * @param path Snapshot file
+ * @return 0 on success, -1 on failure
+ */
+int checkpoint_save(const Scheduler *sched, const char *path);
+
+/**
+ * Restore a snapshot into a freshly configured scheduler.
+ * The scheduler must hold no tasks or cgroups and be configured like
+ * the one that wrote the snapshot (CPU count, capacities, quanta,
+ * policy, per-CPU mode and run queue backend). Ticks after the restore
+ * are identical to the ticks the original would have produced.
+ * @param sched Empty scheduler
+ * @param path Snapshot file
+ * @return 0 on success; -1 if the file is missing (errno ENOENT, the
+ *         scheduler is untouched), corrupt or from another configuration.
+ *         After a failure past the header checks the scheduler may be
+ *         partially restored and should be destroyed.
+ */
+int checkpoint_load(Scheduler *sched, const char *path);
+
+#endif /* CHECKPOINT_H */
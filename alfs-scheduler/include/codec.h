@@ -0,0 +1,83 @@
+/**
+ * ALFS - Wire Codec Interface
+ * Selects the message encoding used on the event socket
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include "alfs.h"
+
+/**
+ * Create a codec for a protocol
+ * @param protocol Wire protocol
+ * @return New codec or NULL on allocation failure
+ */
+Codec *codec_create(WireProtocol protocol);
+
+/**
+ * Destroy a codec and its decoder state
+ * @param codec Codec to destroy
+ */
+void codec_destroy(Codec *codec);
+
+/**
+ * Parse a protocol name from the command line
+ * @param name "json" or "binary"
+ * @param protocol Output protocol
+ * @return 0 on success, -1 if the name is unknown
+ */
+int codec_parse_protocol(const char *name, WireProtocol *protocol);
+
+/**
+ * Message framing a protocol requires
+ * @param protocol Wire protocol
+ * @param requested Framing chosen on the command line
+ * @return UDS_FRAME_LENGTH for binary, otherwise requested
+ */
+UdsFraming codec_framing(WireProtocol protocol, UdsFraming requested);
+
+/**
+ * Negotiate the protocol with the peer, waiting for its reply (no-op for JSON)
+ * @return 0 on success, -1 on failure
+ */
+int codec_handshake(Codec *codec, UdsConn *conn, int cpu_count);
+
+/**
+ * Send the opening message of the handshake without waiting for the reply
+ * @return 1 if the next received message must go to codec_check_greeting,
+ *         0 if the protocol has nothing to negotiate, -1 on failure
+ */
+static inline int codec_greet(Codec *codec, UdsConn *conn, int cpu_count) {
+    if (!codec->greet) {
+        return 0;
+    }
+    return codec->greet(codec, conn, cpu_count) < 0 ? -1 : 1;
+}
+
+/**
+ * Check the peer's reply to codec_greet
+ * @return 0 if the peer accepted, -1 otherwise
+ */
+static inline int codec_check_greeting(Codec *codec, const char *message, size_t length) {
+    return codec->check_greeting(codec, message, length);
+}
+
+/**
+ * Decode one received message into a reusable TimeFrame
+ * @return 0 on success, -1 on malformed input
+ */
+static inline int codec_decode(Codec *codec, const char *message, size_t length, TimeFrame *tf) {
+    return codec->decode(codec, message, length, tf);
+}
+
+/**
+ * Encode a tick into a reusable output buffer
+ * @return 0 on success, -1 on allocation failure
+ */
+static inline int codec_encode(const Codec *codec, const SchedulerTick *tick,
+                               bool include_meta, OutputBuffer *out) {
+    return codec->encode(tick, include_meta, out);
+}
+
+#endif /* CODEC_H */
@@ -0,0 +1,110 @@
+/**
+ * ALFS - CPU Bitmask Helpers
+ * Fixed-size CpuMask operations (one bit per CPU ID below MAX_CPUS).
+ * AND and compare use SSE2 when available, with a portable fallback;
+ * MAX_CPUS must be a multiple of 128.
+ */
+
+#ifndef CPUMASK_H
+#define CPUMASK_H
+
+#include <string.h>
+#include "alfs.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CPUMASK_WORDS (MAX_CPUS / 64)
+#define CPUMASK_VECS  (MAX_CPUS / 128)
+
+_Static_assert(MAX_CPUS % 128 == 0, "CpuMask must be a whole number of SSE2 vectors");
+
+/**
+ * Clear every CPU from a mask
+ */
+static inline void cpumask_clear(CpuMask *mask) {
+    memset(mask, 0, sizeof(*mask));
+}
+
+/**
+ * Set every CPU in a mask
+ */
+static inline void cpumask_fill(CpuMask *mask) {
+    memset(mask, 0xff, sizeof(*mask));
+}
+
+/**
+ * Add a CPU to a mask (out-of-range IDs are ignored)
+ */
+static inline void cpumask_set(CpuMask *mask, int cpu) {
+    if (cpu >= 0 && cpu < MAX_CPUS) {
+        mask->bits[cpu / 64] |= (uint64_t)1 << (cpu % 64);
+    }
+}
+
+/**
+ * Check whether a CPU is in a mask
+ */
+static inline bool cpumask_test(const CpuMask *mask, int cpu) {
+    if (cpu < 0 || cpu >= MAX_CPUS) {
+        return false;
+    }
+    return (mask->bits[cpu / 64] >> (cpu % 64)) & 1u;
+}
+
+/**
+ * dst = a AND b
+ */
+static inline void cpumask_and(CpuMask *dst, const CpuMask *a, const CpuMask *b) {
+#if defined(__SSE2__)
+    for (int i = 0; i < CPUMASK_VECS; i++) {
+        __m128i va = _mm_load_si128((const __m128i *)a->bits + i);
+        __m128i vb = _mm_load_si128((const __m128i *)b->bits + i);
+        _mm_store_si128((__m128i *)dst->bits + i, _mm_and_si128(va, vb));
+    }
+#else
+    for (int i = 0; i < CPUMASK_WORDS; i++) {
+        dst->bits[i] = a->bits[i] & b->bits[i];
+    }
+#endif
+}
+
+/**
+ * Check two masks for equality
+ */
+static inline bool cpumask_equal(const CpuMask *a, const CpuMask *b) {
+#if defined(__SSE2__)
+    for (int i = 0; i < CPUMASK_VECS; i++) {
+        __m128i va = _mm_load_si128((const __m128i *)a->bits + i);
+        __m128i vb = _mm_load_si128((const __m128i *)b->bits + i);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xffff) {
+            return false;
+        }
+    }
+    return true;
+#else
+    for (int i = 0; i < CPUMASK_WORDS; i++) {
+        if (a->bits[i] != b->bits[i]) {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+/**
+ * Build a mask from a CPU ID list; an empty list means every CPU
+ */
+static inline void cpumask_from_list(CpuMask *mask, const int *cpus, int count) {
+    if (!cpus || count <= 0) {
+        cpumask_fill(mask);
+        return;
+    }
+    cpumask_clear(mask);
+    for (int i = 0; i < count; i++) {
+        cpumask_set(mask, cpus[i]);
+    }
+}
+
+#endif /* CPUMASK_H */
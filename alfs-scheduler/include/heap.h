@@ -9,7 +9,66 @@
 #include "alfs.h"
 
 /**
- * Create a new min-heap with given initial capacity
+ * Heap ordering: lower vruntime first, creation order breaks ties.
+ * A total order keeps selection independent of heap layout.
+ */
+static inline bool task_before(const Task *a, const Task *b) {
+    if (a->vruntime != b->vruntime) {
+        return a->vruntime < b->vruntime;
+    }
+    return a->seq < b->seq;
+}
+
+/**
+ * EEVDF ordering among eligible tasks: earlier virtual deadline first,
+ * creation order breaks ties
+ */
+static inline bool deadline_before(const Task *a, const Task *b) {
+    if (a->deadline != b->deadline) {
+        return a->deadline < b->deadline;
+    }
+    return a->seq < b->seq;
+}
+
+/**
+ * Next task of a QueueNode tree in pre-order, or NULL after the last.
+ * A pairing heap is stored as left child / right sibling, whose parent
+ * link is the binary-tree parent, so one walk serves both node backends.
+ */
+static inline Task *task_node_next(const Task *task) {
+    if (task->qnode.left) {
+        return task->qnode.left;
+    }
+    if (task->qnode.right) {
+        return task->qnode.right;
+    }
+    for (const Task *node = task; node->qnode.parent; node = node->qnode.parent) {
+        const Task *parent = node->qnode.parent;
+        if (parent->qnode.left == node && parent->qnode.right) {
+            return parent->qnode.right;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Initialize an embedded min-heap
+ * @param heap Heap to initialize
+ * @param capacity Initial capacity
+ * @param arity Children per node: 2, 4 or 8
+ * @return 0 on success, -1 on bad arguments or allocation failure
+ */
+int heap_init(MinHeap *heap, int capacity, int arity);
+
+/**
+ * Free the storage of an embedded min-heap
+ * Note: Does NOT free the tasks themselves
+ * @param heap Heap to release
+ */
+void heap_release(MinHeap *heap);
+
+/**
+ * Create a new binary min-heap with given initial capacity
  * @param capacity Initial capacity
  * @return Pointer to new MinHeap or NULL on failure
  */
@@ -74,6 +133,13 @@ bool heap_is_empty(MinHeap *heap);
  */
 int heap_size(MinHeap *heap);
 
+/**
+ * Verify heap ordering and stored heap indices
+ * @param heap Heap to check
+ * @return 0 if consistent, -1 otherwise
+ */
+int heap_validate(const MinHeap *heap);
+
 /**
  * Find a task in the heap by task_id
  * @param heap Heap to search
@@ -0,0 +1,71 @@
+/**
+ * ALFS - Interned ID Table Interface
+ * O(1) average lookup from task/cgroup ID strings to their objects
+ */
+
+#ifndef IDTABLE_H
+#define IDTABLE_H
+
+#include "alfs.h"
+
+/**
+ * Create a new ID table
+ * @param capacity_hint Expected number of distinct IDs (0 for default)
+ * @return Pointer to new IdTable or NULL on failure
+ */
+IdTable *idtable_create(int capacity_hint);
+
+/**
+ * Destroy an ID table and every entry still in it
+ * Note: Does NOT free the tasks or cgroups referenced by entries
+ * @param table Table to destroy
+ */
+void idtable_destroy(IdTable *table);
+
+/**
+ * Look up an ID without creating it
+ * @param table Table to search
+ * @param id ID string
+ * @return Entry if interned, NULL otherwise
+ */
+IdEntry *idtable_lookup(const IdTable *table, const char *id);
+
+/**
+ * Intern an ID and take a reference on its entry
+ * @param table Target table
+ * @param id ID string
+ * @return Entry (existing or new), NULL on allocation failure
+ */
+IdEntry *idtable_acquire(IdTable *table, const char *id);
+
+/**
+ * Grow the table ahead of time so `count` IDs fit without rehashing
+ * @param table Target table
+ * @param count Expected number of distinct IDs
+ * @return 0 on success, -1 on allocation failure
+ */
+int idtable_reserve(IdTable *table, int count);
+
+/**
+ * Take another reference on an entry the caller already reaches
+ * through a live holder (task, cgroup or pin)
+ * @param entry Entry to retain (NULL is ignored)
+ */
+void idtable_retain(IdEntry *entry);
+
+/**
+ * Drop a reference taken with idtable_acquire
+ * The entry is removed and freed when its last reference goes away.
+ * @param table Owning table
+ * @param entry Entry to release (NULL is ignored)
+ */
+void idtable_release(IdTable *table, IdEntry *entry);
+
+/**
+ * Get number of interned IDs
+ * @param table Table to check
+ * @return Number of entries
+ */
+int idtable_count(const IdTable *table);
+
+#endif /* IDTABLE_H */
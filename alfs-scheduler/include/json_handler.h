@@ -8,18 +8,47 @@
 #include "alfs.h"
 
 /**
- * Parse a TimeFrame from JSON string
+ * Create an empty TimeFrame to parse into
+ * @return New TimeFrame or NULL on allocation failure
+ */
+TimeFrame *json_timeframe_create(void);
+
+/**
+ * Parse a TimeFrame from JSON string into an existing TimeFrame
+ * Single pass without a DOM; accepts the same input as cJSON_Parse and
+ * fills the same fields. The event and CPU mask buffers are reused.
+ * @param json_str NUL-terminated JSON string
+ * @param tf TimeFrame to fill (previous contents are discarded)
+ * @return 0 on success, -1 on malformed input (tf is left empty)
+ */
+int json_parse_timeframe_into(const char *json_str, TimeFrame *tf);
+
+/**
+ * Parse a TimeFrame from JSON string into a new TimeFrame
  * @param json_str JSON string
  * @return TimeFrame structure or NULL on error
  */
 TimeFrame *json_parse_timeframe(const char *json_str);
 
 /**
- * Free a TimeFrame structure
+ * Free a TimeFrame structure and its buffers
  * @param tf TimeFrame to free
  */
 void json_free_timeframe(TimeFrame *tf);
 
+/**
+ * Serialize a SchedulerTick into a reusable output buffer
+ * Writes the same text cJSON_PrintUnformatted would, without building a
+ * tree; the buffer only reallocates while growing. A delta tick is
+ * marked "delta":true, its schedule is an object from CPU number to the
+ * new task ID, and its metadata lists changes plus "removedTasks".
+ * @param tick SchedulerTick to serialize
+ * @param include_meta Whether to include metadata
+ * @param out Buffer to fill (previous contents are discarded)
+ * @return 0 on success, -1 on allocation failure
+ */
+int json_serialize_tick_into(const SchedulerTick *tick, bool include_meta, OutputBuffer *out);
+
 /**
  * Serialize a SchedulerTick to JSON string
  * @param tick SchedulerTick to serialize
@@ -28,6 +57,54 @@ void json_free_timeframe(TimeFrame *tf);
  */
 char *json_serialize_tick(const SchedulerTick *tick, bool include_meta);
 
+/**
+ * Make room in an output buffer for `extra` more payload bytes (plus the
+ * terminator byte), keeping its contents
+ * @param out Buffer to grow
+ * @param extra Payload bytes about to be appended
+ * @return 0 on success, -1 on allocation failure
+ */
+int json_output_reserve(OutputBuffer *out, size_t extra);
+
+/**
+ * Free an output buffer's storage and leave it empty
+ * @param out Buffer to release
+ */
+void json_output_free(OutputBuffer *out);
+
+/**
+ * Encoded task lists a buffer holds for a tick's list version
+ * Called before encoding the lists; a new version replaces the cached one.
+ * @param out Buffer
+ * @param tick Tick about to be encoded
+ * @param protocol Encoding of the lists
+ * @param length Set to the cached byte count on a hit
+ * @return Cached bytes, or NULL if the lists must be encoded
+ */
+const char *json_output_cached_lists(OutputBuffer *out, const SchedulerTick *tick,
+                                     WireProtocol protocol, size_t *length);
+
+/**
+ * Offer freshly encoded task lists to the buffer's list cache
+ * They are captured the second time their version is encoded; an
+ * allocation failure only leaves them uncached.
+ * @param out Buffer
+ * @param tick Tick whose lists were encoded
+ * @param protocol Encoding of the lists
+ * @param bytes Encoded lists (may point into the buffer's payload)
+ * @param length Byte count
+ */
+void json_output_keep_lists(OutputBuffer *out, const SchedulerTick *tick, WireProtocol protocol,
+                            const char *bytes, size_t length);
+
+/**
+ * Write a string as a quoted JSON string, escaped the way cJSON prints it
+ * @param str NUL-terminated string
+ * @param out Destination (no NUL is written), or NULL to only measure
+ * @return Length of the quoted text
+ */
+size_t json_quote_string(const char *str, char *out);
+
 /**
  * Parse event action string to enum
  * @param action_str Action string
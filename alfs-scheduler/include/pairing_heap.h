@@ -0,0 +1,60 @@
+/**
+ * ALFS - Pairing Heap Interface
+ * Intrusive pairing heap linked through Task.qnode
+ */
+
+#ifndef PAIRING_HEAP_H
+#define PAIRING_HEAP_H
+
+#include "alfs.h"
+
+/**
+ * Initialize an empty pairing heap
+ * @param heap Heap to initialize
+ */
+void pairing_heap_init(PairingHeap *heap);
+
+/**
+ * Insert a task in O(1) by melding it with the root
+ * @param heap Target heap
+ * @param task Task to insert (must not be queued)
+ */
+void pairing_heap_insert(PairingHeap *heap, Task *task);
+
+/**
+ * Extract the minimum task, pairing up its children (amortized O(log n))
+ * @param heap Source heap
+ * @return Minimum task, or NULL if the heap is empty
+ */
+Task *pairing_heap_extract_min(PairingHeap *heap);
+
+/**
+ * Remove a queued task
+ * @param heap Heap holding the task
+ * @param task Task to remove
+ */
+void pairing_heap_remove(PairingHeap *heap, Task *task);
+
+/**
+ * Restore the order after a queued task's vruntime changed
+ * @param heap Heap holding the task
+ * @param task Task that was updated
+ */
+void pairing_heap_update(PairingHeap *heap, Task *task);
+
+/**
+ * A queued task that is cheap to take and sorts late: the most recently
+ * paired child of the root, or the root itself when it is alone
+ * @param heap Heap to look at
+ * @return Task, or NULL if the heap is empty
+ */
+Task *pairing_heap_last(const PairingHeap *heap);
+
+/**
+ * Verify heap order, sibling links, size and queued markers
+ * @param heap Heap to check
+ * @return 0 if consistent, -1 otherwise
+ */
+int pairing_heap_validate(const PairingHeap *heap);
+
+#endif /* PAIRING_HEAP_H */
@@ -0,0 +1,26 @@
+/**
+ * ALFS - Pipelined I/O Interface
+ * Overlaps socket reads/parsing, scheduling and serialization/writes
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "alfs.h"
+
+/**
+ * Serve a connection with three threads joined by SPSC queues:
+ * reader (receive + parse) -> caller (events + tick) -> writer
+ * (serialize + send). Responses leave in input order.
+ * Returns when the peer closes the connection or *running drops to 0.
+ * @param sched Scheduler, only touched by the calling thread
+ * @param conn Connection to serve
+ * @param codec Wire codec (handshake already done)
+ * @param include_meta Include metadata in responses
+ * @param running Cleared by the caller's signal handler to stop
+ * @return 0 on shutdown, -1 if the stages could not be started
+ */
+int pipeline_run(Scheduler *sched, UdsConn *conn, Codec *codec, bool include_meta,
+                 volatile int *running);
+
+#endif /* PIPELINE_H */
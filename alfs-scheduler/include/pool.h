@@ -0,0 +1,40 @@
+/**
+ * ALFS - Slab Pool Interface
+ * Fixed-size object allocation with free-list reuse
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+#include "alfs.h"
+
+/**
+ * Initialize an empty pool (no memory is allocated until the first object)
+ * @param pool Pool to initialize
+ * @param object_size Object size in bytes
+ * @param align Object alignment (a power of two)
+ * @param per_slab Objects carved from each slab
+ */
+void pool_init(Pool *pool, size_t object_size, size_t align, size_t per_slab);
+
+/**
+ * Free every slab; objects still handed out become invalid
+ * @param pool Pool to destroy
+ */
+void pool_destroy(Pool *pool);
+
+/**
+ * Take a zeroed object, growing the pool by one slab if none is free
+ * @param pool Pool to allocate from
+ * @return Object or NULL on allocation failure
+ */
+void *pool_alloc(Pool *pool);
+
+/**
+ * Return an object to its pool
+ * @param pool Pool it came from
+ * @param object Object to release (NULL is ignored)
+ */
+void pool_free(Pool *pool, void *object);
+
+#endif /* POOL_H */
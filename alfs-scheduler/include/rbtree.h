@@ -0,0 +1,72 @@
+/**
+ * ALFS - Red-Black Tree Interface
+ * Intrusive RB-tree linked through Task.qnode, leftmost node cached
+ */
+
+#ifndef RBTREE_H
+#define RBTREE_H
+
+#include "alfs.h"
+
+/**
+ * Initialize an empty tree
+ * @param tree Tree to initialize
+ * @param augmented Track each subtree's earliest deadline (for EEVDF)
+ */
+void rbtree_init(RbTree *tree, bool augmented);
+
+/**
+ * Insert a task in task_before() order (O(log n))
+ * @param tree Target tree
+ * @param task Task to insert (must not be queued)
+ */
+void rbtree_insert(RbTree *tree, Task *task);
+
+/**
+ * Remove a queued task (O(log n), O(1) amortized rebalancing)
+ * @param tree Tree holding the task
+ * @param task Task to remove
+ */
+void rbtree_remove(RbTree *tree, Task *task);
+
+/**
+ * Remove and return the leftmost task
+ * @param tree Source tree
+ * @return Minimum task, or NULL if the tree is empty
+ */
+Task *rbtree_extract_min(RbTree *tree);
+
+/**
+ * Restore the order after a queued task's vruntime changed
+ * Nothing moves if the task still sorts between its neighbours.
+ * @param tree Tree holding the task
+ * @param task Task that was updated
+ */
+void rbtree_update(RbTree *tree, Task *task);
+
+/**
+ * Rightmost (latest) task
+ * @param tree Tree to look at
+ * @return Task, or NULL if the tree is empty
+ */
+Task *rbtree_last(const RbTree *tree);
+
+/**
+ * Earliest-deadline task among those with vruntime <= avg_vruntime
+ * (O(log n), augmented trees only)
+ * @param tree Augmented tree
+ * @param avg_vruntime Eligibility bound
+ * @return Task, or NULL if no task is eligible
+ */
+Task *rbtree_pick_eligible(const RbTree *tree, vruntime_t avg_vruntime);
+
+/**
+ * Verify order, parent links, colors, black heights, the cached
+ * leftmost node, size and queued markers, and the deadline minima of
+ * an augmented tree
+ * @param tree Tree to check
+ * @return 0 if consistent, -1 otherwise
+ */
+int rbtree_validate(const RbTree *tree);
+
+#endif /* RBTREE_H */
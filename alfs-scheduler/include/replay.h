@@ -0,0 +1,30 @@
+/**
+ * ALFS - Trace Replay Interface
+ * Drives the scheduler from a memory-mapped trace file instead of a socket
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "alfs.h"
+
+/**
+ * Replay a trace back-to-back and write one tick per timeframe.
+ * JSON traces are JSON-lines, or a JSON array of timeframes like the
+ * tests/ input files; ticks are written one per line. Binary traces are
+ * length-prefixed TIMEFRAME messages; ticks are written length-prefixed.
+ * Messages that fail to decode are counted and skipped.
+ * @param sched Scheduler to drive
+ * @param codec Codec matching the trace format
+ * @param trace_path Trace file to map
+ * @param output_path Output file, or NULL / "-" for stdout
+ * @param include_meta Include metadata in ticks
+ * @param running Cleared by the caller's signal handler to stop early
+ * @param stats Filled with the run's totals (may be NULL)
+ * @return 0 on success, -1 if a file could not be opened or written
+ */
+int replay_run(Scheduler *sched, Codec *codec, const char *trace_path,
+               const char *output_path, bool include_meta,
+               volatile int *running, ReplayStats *stats);
+
+#endif /* REPLAY_H */
@@ -0,0 +1,161 @@
+/**
+ * ALFS - Run Queue Interface
+ * RUNNABLE tasks partitioned into affinity classes, one task queue each
+ */
+
+#ifndef RUNQUEUE_H
+#define RUNQUEUE_H
+
+#include "alfs.h"
+
+/**
+ * Initialize an empty run queue with the build's default backend
+ * @param rq Run queue to initialize
+ */
+void runqueue_init(RunQueue *rq);
+
+/**
+ * Free every class of a run queue
+ * Note: Does NOT free the tasks; their class pointers are left dangling
+ * The queue stays usable with the same backend.
+ * @param rq Run queue to destroy
+ */
+void runqueue_destroy(RunQueue *rq);
+
+/**
+ * Choose the backend of classes created from now on
+ * @param rq Run queue without classes
+ * @param backend Task queue backend
+ * @return 0 on success, -1 if the backend is unknown or classes exist
+ */
+int runqueue_set_backend(RunQueue *rq, QueueBackend backend);
+
+/**
+ * Queue a task in the class matching (mask, task->cgroup)
+ * The task's current class is reused when it still matches, otherwise
+ * it is released and the matching class is looked up or created.
+ * @param rq Target run queue
+ * @param task Task to queue (must not be queued)
+ * @param mask Effective CPU mask of the task
+ * @return 0 on success, -1 on allocation failure
+ */
+int runqueue_enqueue(RunQueue *rq, Task *task, const CpuMask *mask);
+
+/**
+ * Remove a queued task from its class; the task stays bound to it
+ * @param task Task to remove (ignored if not queued)
+ */
+void runqueue_dequeue(Task *task);
+
+/**
+ * Restore queue order and the average vruntime after a queued task's
+ * vruntime (or deadline) changed
+ * @param task Task that was updated (ignored if not queued)
+ * @param old_vruntime vruntime the task was queued with
+ */
+void runqueue_update(Task *task, vruntime_t old_vruntime);
+
+/**
+ * Extract the first task of a class; the task stays bound to it
+ * @param tclass Class to take from
+ * @return First task, or NULL if the class is empty
+ */
+Task *runqueue_take(TaskClass *tclass);
+
+/**
+ * Release a task's class binding, freeing the class when unused
+ * @param task Task to unbind (must not be queued)
+ */
+void runqueue_unbind(Task *task);
+
+/**
+ * Park every class keyed by a cgroup so selection skips them without
+ * touching their tasks; called when it or an ancestor is throttled
+ * @param cgroup Cgroup whose throttle_count became non-zero
+ */
+void runqueue_park_cgroup(Cgroup *cgroup);
+
+/**
+ * Return the parked classes of a cgroup to their run queues
+ * @param cgroup Cgroup whose throttle_count dropped to zero
+ */
+void runqueue_unpark_cgroup(Cgroup *cgroup);
+
+/**
+ * Advance the queue's monotonic min_vruntime to the smallest vruntime of
+ * its class heads and running tasks; it never moves backwards
+ * @param rq Run queue to update
+ * @param running_min Smallest vruntime of this queue's running tasks,
+ *                    VRUNTIME_MAX if none
+ */
+void runqueue_update_min_vruntime(RunQueue *rq, vruntime_t running_min);
+
+/**
+ * Weighted average vruntime of the queued tasks (EEVDF's virtual time):
+ * a task is eligible while its vruntime does not exceed it
+ * @param rq Run queue to check
+ * @return Average, or min_vruntime when the queue is empty
+ */
+static inline vruntime_t runqueue_avg_vruntime(const RunQueue *rq) {
+    if (rq->avg_load <= 0) {
+        return rq->min_vruntime;
+    }
+    return rq->min_vruntime + (vruntime_t)(rq->avg_sum / (double)rq->avg_load);
+}
+
+/**
+ * Get the number of queued tasks that are not parked
+ * @param rq Run queue to check
+ * @return Schedulable queued tasks
+ */
+static inline int runqueue_load(const RunQueue *rq) {
+    return rq->nr_queued - rq->nr_parked;
+}
+
+/* ============================================================================
+ * Checkpoint Restore
+ *
+ * A restored run queue is rebuilt class by class in its saved order, so
+ * class positions, parking and each cgroup's class list come back as they
+ * were. The caller restores min_vruntime and avg_sum afterwards.
+ * ============================================================================ */
+
+/**
+ * Append a class to a run queue being restored
+ * Active classes must all come before parked ones, as they are kept.
+ * @param rq Run queue
+ * @param mask Effective CPU mask of the class
+ * @param cgroup Shared cgroup (NULL for none); not linked to it yet
+ * @param parked Whether the class is parked
+ * @return New class, or NULL on allocation failure or an active class
+ *         after a parked one
+ */
+TaskClass *runqueue_restore_class(RunQueue *rq, const CpuMask *mask, Cgroup *cgroup, bool parked);
+
+/**
+ * Link restored classes into their cgroup's class list, in list order
+ * @param cgroup Cgroup whose list is empty
+ * @param classes Classes keyed by it, first to last
+ * @param count Number of classes
+ */
+void runqueue_restore_cgroup_classes(Cgroup *cgroup, TaskClass **classes, int count);
+
+/**
+ * Bind a restored task to its class and, if it was queued, queue it
+ * with its saved avg_weight (avg_sum is not touched)
+ * @param task Task with no class
+ * @param tclass Restored class
+ * @param queued Whether the task was queued
+ * @return 0 on success, -1 on allocation failure
+ */
+int runqueue_restore_task(Task *task, TaskClass *tclass, bool queued);
+
+/**
+ * Check class queues, task back-pointers, parking, the queued counts
+ * and the average vruntime load
+ * @param rq Run queue to check
+ * @return 0 if consistent, -1 otherwise
+ */
+int runqueue_validate(const RunQueue *rq);
+
+#endif /* RUNQUEUE_H */
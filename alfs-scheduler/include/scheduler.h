@@ -21,6 +21,15 @@ Scheduler *scheduler_init(int cpu_count, int quanta);
  */
 void scheduler_destroy(Scheduler *sched);
 
+/**
+ * Pre-size task storage and the ID index for an expected population
+ * Storage still grows past it on demand; this only saves the regrowth.
+ * @param sched Scheduler
+ * @param tasks Expected number of tasks
+ * @return 0 on success, -1 on bad arguments or allocation failure
+ */
+int scheduler_reserve(Scheduler *sched, int tasks);
+
 /**
  * Process an event
  * @param sched Scheduler
@@ -30,7 +39,37 @@ void scheduler_destroy(Scheduler *sched);
 int scheduler_process_event(Scheduler *sched, const Event *event);
 
 /**
- * Run the scheduler for one tick
+ * Process one timeframe's events in order, skipping the ones a later
+ * event in the batch supersedes (a SETNICE or, outside EEVDF, a
+ * CPU_BURST followed by another of its kind or an EXIT of the same
+ * task). The result is identical to processing every event.
+ * @param sched Scheduler
+ * @param events Events in arrival order
+ * @param count Number of events
+ * @return Number of events that failed, -1 on bad arguments
+ */
+int scheduler_process_events(Scheduler *sched, const Event *events, int count);
+
+/**
+ * Create an empty, reusable tick for a scheduler
+ * @param sched Scheduler the tick will be filled by
+ * @return New tick or NULL on failure
+ */
+SchedulerTick *scheduler_tick_create(Scheduler *sched);
+
+/**
+ * Run the scheduler for one tick, refilling an existing tick in place
+ * The previous contents are released first. Buffers only grow, so once
+ * they fit the task count a tick performs no heap allocation.
+ * @param sched Scheduler
+ * @param vtime Current virtual time
+ * @param tick Tick created for this scheduler
+ * @return 0 on success, -1 on failure (scheduler state is unchanged)
+ */
+int scheduler_tick_into(Scheduler *sched, int vtime, SchedulerTick *tick);
+
+/**
+ * Run the scheduler for one tick into a newly created tick
  * @param sched Scheduler
  * @param vtime Current virtual time
  * @return SchedulerTick with schedule decisions
@@ -38,11 +77,154 @@ int scheduler_process_event(Scheduler *sched, const Event *event);
 SchedulerTick *scheduler_tick(Scheduler *sched, int vtime);
 
 /**
- * Free a scheduler tick
+ * Free a scheduler tick and release the IDs it pins
+ * Must run on the scheduler's thread, before scheduler_destroy.
  * @param tick Tick to free
  */
 void scheduler_tick_free(SchedulerTick *tick);
 
+/**
+ * Enable or disable collection of runnable/blocked task lists per tick
+ * Preemption and migration counts are always reported.
+ * @param sched Scheduler
+ * @param enabled true to fill SchedulerMeta task lists (default)
+ */
+void scheduler_set_metadata(Scheduler *sched, bool enabled);
+
+/**
+ * Choose the data structure behind every affinity class
+ * Selection is identical with every backend; only speed differs.
+ * @param sched Scheduler with no task bound to a run queue yet
+ * @param backend Run queue backend
+ * @return 0 on success, -1 if the backend is unknown or classes exist
+ */
+int scheduler_set_runqueue(Scheduler *sched, QueueBackend backend);
+
+/**
+ * Parse a policy name from the command line
+ * @param name "cfs" or "eevdf"
+ * @param policy Output policy
+ * @return 0 on success, -1 if the name is unknown
+ */
+int scheduler_parse_policy(const char *name, SchedPolicy *policy);
+
+/**
+ * Command-line name of a policy
+ * @param policy Policy
+ * @return Name, or "unknown"
+ */
+const char *scheduler_policy_name(SchedPolicy policy);
+
+/**
+ * Choose how tasks are placed and selected
+ * EEVDF switches every run queue to the rbtree-aug backend, and
+ * scheduler_set_runqueue() then refuses any other.
+ * @param sched Scheduler with no tasks yet
+ * @param policy SCHED_POLICY_CFS (default) or SCHED_POLICY_EEVDF
+ * @return 0 on success, -1 if the policy is unknown or tasks exist
+ */
+int scheduler_set_policy(Scheduler *sched, SchedPolicy policy);
+
+/**
+ * Enable or disable wake-up latency counters in tick metadata
+ * (tasks run for the first time since waking, and the ticks they waited)
+ * @param sched Scheduler
+ * @param enabled true to report them (default: false)
+ */
+void scheduler_set_latency(Scheduler *sched, bool enabled);
+
+/**
+ * Fill ticks as deltas against the previous tick: only CPUs whose task
+ * changed, and (with metadata) only tasks that became runnable, became
+ * blocked or left both lists. Every keyframe_interval-th tick, starting
+ * with the next one, is a full keyframe the peer can resync from.
+ * Every filled tick must reach the peer, in order.
+ * @param sched Scheduler
+ * @param keyframe_interval Ticks per keyframe (0 = off, every tick full)
+ * @return 0 on success, -1 on bad arguments or allocation failure
+ */
+int scheduler_set_delta(Scheduler *sched, int keyframe_interval);
+
+/**
+ * Parse a --capacity list: comma-separated CPU capacities (1-1024), where
+ * `NxC` stands for N CPUs of capacity C, e.g. "4x1024,4x512"
+ * @param spec Capacity list
+ * @param capacity Output, one capacity per CPU
+ * @param cpu_count Number of CPUs the list must cover exactly
+ * @return 0 on success, -1 if malformed or the count differs
+ */
+int scheduler_parse_capacity(const char *spec, int *capacity, int cpu_count);
+
+/**
+ * Declare the relative compute capacity of every CPU (big.LITTLE).
+ * Runtime on a CPU is charged to vruntime and cgroup quota scaled by
+ * capacity / 1024. With differing capacities, per-CPU run queues place
+ * tasks by utilization and move misfit tasks to bigger CPUs.
+ * @param sched Scheduler
+ * @param capacity Capacity of each CPU, 1 to SCHED_CAPACITY_SCALE
+ * @param count Number of entries, must equal the CPU count
+ * @return 0 on success, -1 on bad arguments
+ */
+int scheduler_set_capacity(Scheduler *sched, const int *capacity, int count);
+
+/**
+ * Get a task's PELT utilization, decayed to the current tick
+ * @param sched Scheduler
+ * @param task_id Task ID
+ * @return Utilization (0-1024, capacity-invariant), or -1 if not found
+ */
+int scheduler_get_task_util(Scheduler *sched, const char *task_id);
+
+/**
+ * Switch to per-CPU run queues (each CPU picks from its own queue and
+ * steals from the busiest queue when it has nothing eligible)
+ * Tasks already queued are distributed across CPUs.
+ * @param sched Scheduler
+ * @param balance_interval Ticks between periodic load balancing (0 = idle stealing only)
+ * @return 0 on success, -1 on failure
+ */
+int scheduler_enable_per_cpu(Scheduler *sched, int balance_interval);
+
+/**
+ * Start collecting hot-path statistics (phase timings and counters,
+ * see stats.h); callers report them from sched->stats
+ * Statistics already collected are discarded.
+ * @param sched Scheduler
+ * @param interval_ms Milliseconds between periodic reports (0 = only at exit)
+ * @return 0 on success, -1 on failure or when built with ALFS_NO_STATS
+ */
+int scheduler_enable_stats(Scheduler *sched, int interval_ms);
+
+/**
+ * Write snapshots of the scheduler to `path` (see checkpoint.h); the
+ * tick loop drives them through checkpoint_poll(sched->checkpoint, ...)
+ * @param sched Scheduler
+ * @param path Snapshot file
+ * @param interval Timeframes between snapshots (0 = on request and at exit only)
+ * @return 0 on success, -1 on failure
+ */
+int scheduler_enable_checkpoint(Scheduler *sched, const char *path, int interval);
+
+/**
+ * Make each tick's per-CPU picks on `threads` threads (per-CPU mode).
+ * Every CPU's local choice is made concurrently and then merged in CPU
+ * order, redoing the few that an earlier CPU's steal or quota
+ * reservation invalidated, so the schedule is identical to the serial one.
+ * @param sched Scheduler
+ * @param threads Threads per tick, the caller included (1 = serial)
+ * @return 0 on success, -1 without per-CPU queues or if threads cannot start
+ */
+int scheduler_enable_parallel_tick(Scheduler *sched, int threads);
+
+/**
+ * Check the incrementally maintained run queues against a rebuild
+ * from task states (queue order, indices, class keys and membership).
+ * Called after every event and tick in DEBUG builds.
+ * @param sched Scheduler
+ * @return 0 if consistent, -1 otherwise
+ */
+int scheduler_validate(const Scheduler *sched);
+
 /**
  * Find a task by ID
  * @param sched Scheduler
@@ -76,7 +258,8 @@ int scheduler_add_task(Scheduler *sched, Task *task);
 int scheduler_remove_task(Scheduler *sched, const char *task_id);
 
 /**
- * Add a cgroup to the scheduler
+ * Add a cgroup to the scheduler and arm its period timer
+ * A nested cgroup is attached to its parent (cgroup_attach) beforehand.
  * @param sched Scheduler
  * @param cgroup Cgroup to add
  * @return 0 on success, -1 on failure
@@ -85,9 +268,10 @@ int scheduler_add_cgroup(Scheduler *sched, Cgroup *cgroup);
 
 /**
  * Remove a cgroup from the scheduler
+ * Like rmdir, a cgroup that still has child cgroups is refused.
  * @param sched Scheduler
  * @param cgroup_id Cgroup ID to remove
- * @return 0 on success, -1 if not found
+ * @return 0 on success, -1 if not found or it has children
  */
 int scheduler_remove_cgroup(Scheduler *sched, const char *cgroup_id);
 
@@ -96,13 +280,13 @@ int scheduler_remove_cgroup(Scheduler *sched, const char *cgroup_id);
  * @param sched Scheduler
  * @return Minimum vruntime
  */
-double scheduler_get_min_vruntime(Scheduler *sched);
+vruntime_t scheduler_get_min_vruntime(Scheduler *sched);
 
 /**
  * Get the maximum vruntime across all runnable tasks
  * @param sched Scheduler
  * @return Maximum vruntime
  */
-double scheduler_get_max_vruntime(Scheduler *sched);
+vruntime_t scheduler_get_max_vruntime(Scheduler *sched);
 
 #endif /* SCHEDULER_H */
@@ -0,0 +1,55 @@
+/**
+ * ALFS - Single-Producer/Single-Consumer Queue Interface
+ * Bounded FIFO handing pointers from one thread to exactly one other
+ */
+
+#ifndef SPSC_H
+#define SPSC_H
+
+#include "alfs.h"
+
+/**
+ * Initialize an empty queue
+ * @param queue Queue to initialize
+ * @param capacity Minimum number of slots (rounded up to a power of two)
+ * @return 0 on success, -1 on allocation failure
+ */
+int spsc_init(SpscQueue *queue, size_t capacity);
+
+/**
+ * Free a queue's slots (items still queued are not freed)
+ * @param queue Queue to destroy
+ */
+void spsc_destroy(SpscQueue *queue);
+
+/**
+ * Append an item without blocking (producer only)
+ * @param queue Target queue
+ * @param item Item to append (NULL is a valid item)
+ * @return true if queued, false if the queue is full
+ */
+bool spsc_try_push(SpscQueue *queue, void *item);
+
+/**
+ * Remove the oldest item without blocking (consumer only)
+ * @param queue Source queue
+ * @param item Set to the removed item
+ * @return true if an item was removed, false if the queue is empty
+ */
+bool spsc_try_pop(SpscQueue *queue, void **item);
+
+/**
+ * Append an item, waiting while the queue is full (producer only)
+ * @param queue Target queue
+ * @param item Item to append
+ */
+void spsc_push(SpscQueue *queue, void *item);
+
+/**
+ * Remove the oldest item, waiting while the queue is empty (consumer only)
+ * @param queue Source queue
+ * @return Removed item
+ */
+void *spsc_pop(SpscQueue *queue);
+
+#endif /* SPSC_H */
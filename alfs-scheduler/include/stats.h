@@ -0,0 +1,100 @@
+/**
+ * ALFS - Hot-Path Statistics Interface
+ * Phase timing histograms and event counters, reported as JSON lines.
+ * Building with -DALFS_NO_STATS (make STATS=0) compiles every probe out.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include "alfs.h"
+
+/**
+ * Create zeroed statistics
+ * @param interval_ms Milliseconds between periodic reports (0 = only on request)
+ * @return New statistics or NULL on allocation failure
+ */
+SchedStats *stats_create(int interval_ms);
+
+/**
+ * Free statistics
+ * @param stats Statistics to free (NULL is ignored)
+ */
+void stats_destroy(SchedStats *stats);
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+uint64_t stats_clock_ns(void);
+
+/**
+ * Add one duration to a phase histogram (only the phase's own thread may call)
+ * @param stats Statistics
+ * @param phase Phase the duration belongs to
+ * @param ns Duration in nanoseconds
+ */
+void stats_record(SchedStats *stats, StatPhase phase, uint64_t ns);
+
+/**
+ * Write every phase histogram and counter as one JSON line
+ * @param stats Statistics
+ * @param out Destination stream
+ */
+void stats_report(SchedStats *stats, FILE *out);
+
+/**
+ * Report if the interval has passed since the last report
+ * @param stats Statistics
+ * @param out Destination stream
+ */
+void stats_report_if_due(SchedStats *stats, FILE *out);
+
+/**
+ * Name of a phase as it appears in reports
+ */
+const char *stats_phase_name(StatPhase phase);
+
+/* ============================================================================
+ * Probes
+ * ============================================================================ */
+
+/** Whether the probes below are compiled in */
+#ifdef ALFS_NO_STATS
+#define STATS_COMPILED false
+#else
+#define STATS_COMPILED true
+#endif
+
+/**
+ * Start timing a phase
+ * @return Start timestamp, 0 when stats is NULL
+ */
+static inline uint64_t stats_start(const SchedStats *stats) {
+    return STATS_COMPILED && stats ? stats_clock_ns() : 0;
+}
+
+/**
+ * Record the phase that began at `start` and start the next one
+ * @return Timestamp the next phase starts at
+ */
+static inline uint64_t stats_lap(SchedStats *stats, StatPhase phase, uint64_t start) {
+    if (!STATS_COMPILED || !stats) {
+        return 0;
+    }
+    uint64_t now = stats_clock_ns();
+    stats_record(stats, phase, now - start);
+    return now;
+}
+
+/**
+ * Add to an event counter (scheduler thread only)
+ */
+static inline void stats_count(SchedStats *stats, StatCounter counter, uint64_t n) {
+    if (STATS_COMPILED && stats) {
+        uint64_t value = atomic_load_explicit(&stats->counters[counter], memory_order_relaxed);
+        atomic_store_explicit(&stats->counters[counter], value + n, memory_order_relaxed);
+    }
+}
+
+#endif /* STATS_H */
@@ -8,7 +8,7 @@
 #include "alfs.h"
 
 /**
- * Create a new task
+ * Create a new task that owns copies of its IDs
  * @param task_id Task identifier
  * @param nice Nice value (-20 to +19)
  * @param cgroup_id Initial cgroup ID (NULL for default)
@@ -17,7 +17,33 @@
 Task *task_create(const char *task_id, int nice, const char *cgroup_id);
 
 /**
- * Destroy a task and free memory
+ * Initialize the (empty) pools a scheduler allocates its tasks from
+ * @param pools Pools to initialize
+ */
+void task_pools_init(TaskPools *pools);
+
+/**
+ * Free the pools; every pooled task must already be destroyed
+ * @param pools Pools to destroy
+ */
+void task_pools_destroy(TaskPools *pools);
+
+/**
+ * Create a new task from slab pools
+ * Same as task_create, but the Task comes from pools and goes back to
+ * them in task_destroy, and the IDs are borrowed: they must outlive the
+ * task until scheduler_add_task points it at the interned copies.
+ * @param pools Pools to allocate from
+ * @param task_id Task identifier
+ * @param nice Nice value (-20 to +19)
+ * @param cgroup_id Initial cgroup ID (NULL for default)
+ * @return Pointer to new Task or NULL on failure
+ */
+Task *task_create_pooled(TaskPools *pools, const char *task_id, int nice,
+                         const char *cgroup_id);
+
+/**
+ * Destroy a task and free memory (or return it to its pools)
  * @param task Task to destroy
  */
 void task_destroy(Task *task);
@@ -31,6 +57,21 @@ void task_destroy(Task *task);
  */
 int task_set_affinity(Task *task, const int *cpu_mask, int count);
 
+/**
+ * Recompute the cached task->allowed mask (affinity AND cgroup mask)
+ * Call whenever the affinity, the bound cgroup or its mask changes.
+ * @param task Target task
+ */
+void task_refresh_allowed(Task *task);
+
+/**
+ * Recompute the cached inverse weight (nice weight scaled by the cgroup's
+ * effective shares)
+ * Call whenever the nice value, the bound cgroup or any ancestor's shares change.
+ * @param task Target task
+ */
+void task_refresh_weight(Task *task);
+
 /**
  * Set task's nice value and update weight
  * @param task Target task
@@ -53,6 +94,15 @@ bool task_can_run_on_cpu(const Task *task, int cpu_id);
  */
 void task_update_vruntime(Task *task, double runtime);
 
+/**
+ * Decay a task's utilization to `now` and, if it ran for that period,
+ * add the period at the capacity of the CPU it ran on (PELT)
+ * @param task Task to update
+ * @param now Current tick count
+ * @param capacity Capacity of the CPU it ran on, 0 if it did not run
+ */
+void task_update_util(Task *task, int now, int capacity);
+
 /**
  * Set task state
  * @param task Target task
@@ -0,0 +1,127 @@
+/**
+ * ALFS - Task Queue Interface
+ * One priority-queue API over the run queue backends
+ */
+
+#ifndef TASKQUEUE_H
+#define TASKQUEUE_H
+
+#include "alfs.h"
+
+/**
+ * Initialize an empty queue
+ * @param queue Queue to initialize
+ * @param backend Backend storing the tasks
+ * @return 0 on success, -1 on bad backend or allocation failure
+ */
+int taskqueue_init(TaskQueue *queue, QueueBackend backend);
+
+/**
+ * Free the queue's storage
+ * Note: Does NOT free the tasks; queued tasks are left marked as queued
+ * @param queue Queue to destroy
+ */
+void taskqueue_destroy(TaskQueue *queue);
+
+/**
+ * Parse a backend name from the command line
+ * @param name "heap", "heap4", "heap8", "pairing", "rbtree" or "rbtree-aug"
+ * @param backend Output backend
+ * @return 0 on success, -1 if the name is unknown
+ */
+int taskqueue_parse_backend(const char *name, QueueBackend *backend);
+
+/**
+ * Command-line name of a backend
+ * @param backend Backend
+ * @return Name, or "unknown"
+ */
+const char *taskqueue_backend_name(QueueBackend backend);
+
+/**
+ * Minimum task without removing it (O(1) for every backend)
+ * @return Minimum task, or NULL if the queue is empty
+ */
+static inline Task *taskqueue_peek(const TaskQueue *queue) {
+    return queue->first;
+}
+
+static inline bool taskqueue_is_empty(const TaskQueue *queue) {
+    return queue->first == NULL;
+}
+
+static inline int taskqueue_size(const TaskQueue *queue) {
+    return queue->ops->size(queue);
+}
+
+/**
+ * Insert a task (heap_index becomes >= 0)
+ * @return 0 on success, -1 on allocation failure
+ */
+static inline int taskqueue_insert(TaskQueue *queue, Task *task) {
+    return queue->ops->insert(queue, task);
+}
+
+/**
+ * Remove a queued task (heap_index becomes -1)
+ */
+static inline void taskqueue_remove(TaskQueue *queue, Task *task) {
+    queue->ops->remove(queue, task);
+}
+
+/**
+ * Restore the order after a queued task's vruntime changed
+ */
+static inline void taskqueue_update(TaskQueue *queue, Task *task) {
+    queue->ops->update(queue, task);
+}
+
+/**
+ * Remove and return the minimum task
+ * @return Minimum task, or NULL if the queue is empty
+ */
+static inline Task *taskqueue_extract_min(TaskQueue *queue) {
+    return queue->ops->extract_min(queue);
+}
+
+/**
+ * A queued task that is cheap to remove and sorts late, for migration:
+ * the last array slot of a heap, the rightmost node of the RB-tree
+ * @return Task, or NULL if the queue is empty
+ */
+static inline Task *taskqueue_last(const TaskQueue *queue) {
+    return queue->ops->last(queue);
+}
+
+/**
+ * Whether the backend tracks deadlines (rbtree-aug), as EEVDF needs
+ */
+static inline bool taskqueue_has_deadlines(const TaskQueue *queue) {
+    return queue->ops->pick_eligible != NULL;
+}
+
+/**
+ * Earliest-deadline task with vruntime <= avg_vruntime (EEVDF, O(log n))
+ * Only valid when taskqueue_has_deadlines()
+ * @return Task, or NULL if no queued task is eligible
+ */
+static inline Task *taskqueue_pick_eligible(const TaskQueue *queue, vruntime_t avg_vruntime) {
+    return queue->ops->pick_eligible(queue, avg_vruntime);
+}
+
+/**
+ * Copy every queued task to out[] in no particular order
+ * @param out Array with room for taskqueue_size() tasks
+ * @return Number of tasks copied
+ */
+static inline int taskqueue_collect(const TaskQueue *queue, Task **out) {
+    return queue->ops->collect(queue, out);
+}
+
+/**
+ * Verify the backend's invariants and the cached minimum
+ * @return 0 if consistent, -1 otherwise
+ */
+int taskqueue_validate(const TaskQueue *queue);
+
+#endif /* TASKQUEUE_H */
@@ -0,0 +1,27 @@
+/**
+ * ALFS - Multi-Tenant Server Interface
+ * Many connections, each with its own scheduler, on a pool of epoll workers
+ */
+
+#ifndef TENANT_H
+#define TENANT_H
+
+#include "alfs.h"
+
+/* Upper bound on --listen worker threads */
+#define TENANT_MAX_WORKERS 256
+
+/**
+ * Listen on the configured socket and serve every connection with its
+ * own scheduler until *running is cleared. Each connection is pinned to
+ * the worker with the fewest connections when it is accepted; the worker
+ * builds its scheduler, so that state is allocated and stays on the
+ * worker's CPU.
+ * @param config Server settings
+ * @param running Keep serving while non-zero (cleared by a signal handler)
+ * @param totals Filled with totals over all connections (may be NULL)
+ * @return 0 on a clean shutdown, -1 if the server could not start
+ */
+int tenant_serve(const TenantConfig *config, volatile int *running, TenantTotals *totals);
+
+#endif /* TENANT_H */
@@ -0,0 +1,60 @@
+/**
+ * ALFS - Timer Wheel Interface
+ * Tick-granular timers whose expiry costs only the timers that are due
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "alfs.h"
+
+/**
+ * Called for each expired timer; the timer is already unarmed and may
+ * be re-armed from the callback
+ */
+typedef void (*TimerFn)(TimerNode *node, void *arg);
+
+/**
+ * Empty a wheel and set its current tick
+ * @param wheel Wheel to initialize (armed timers are forgotten)
+ * @param now Current tick
+ */
+void timer_wheel_init(TimerWheel *wheel, long long now);
+
+/**
+ * Arm a timer, moving it if it is already armed
+ * A timer due at or before the current tick fires on the next advance.
+ * @param wheel Wheel
+ * @param node Timer
+ * @param expires Tick at which it fires
+ */
+void timer_wheel_add(TimerWheel *wheel, TimerNode *node, long long expires);
+
+/**
+ * Disarm a timer (unarmed timers are ignored)
+ * @param wheel Wheel
+ * @param node Timer
+ */
+void timer_wheel_del(TimerWheel *wheel, TimerNode *node);
+
+/**
+ * Move to tick `now`, firing every timer that expires by then.
+ * Each slot between the old and new tick is visited once, so a jump of
+ * more than TIMER_WHEEL_SLOTS ticks costs one pass over the wheel. A
+ * `now` before the current tick only moves the wheel back.
+ * @param wheel Wheel
+ * @param now New current tick
+ * @param fn Called for each expired timer
+ * @param arg Passed to fn
+ * @return Number of timers fired
+ */
+int timer_wheel_advance(TimerWheel *wheel, long long now, TimerFn fn, void *arg);
+
+/**
+ * Whether a timer is armed
+ */
+static inline bool timer_armed(const TimerNode *node) {
+    return node->pprev != NULL;
+}
+
+#endif /* TIMERWHEEL_H */
@@ -6,6 +6,7 @@
 #define UDS_H
 
 #include <stddef.h>
+#include "alfs.h"
 
 /**
  * Connect to a Unix Domain Socket
@@ -14,6 +15,13 @@
  */
 int uds_connect(const char *socket_path);
 
+/**
+ * Create a listening Unix Domain Socket, replacing a stale socket file
+ * @param socket_path Path to socket file
+ * @return Listening socket file descriptor on success, -1 on failure
+ */
+int uds_listen(const char *socket_path);
+
 /**
  * Disconnect from Unix Domain Socket
  * @param sock Socket file descriptor
@@ -30,11 +38,70 @@ void uds_disconnect(int sock);
 int uds_receive(int sock, char *buffer, size_t buffer_size);
 
 /**
- * Receive a complete message (reads until newline or connection close)
- * @param sock Socket file descriptor
- * @return Dynamically allocated message string (caller must free), NULL on error
+ * Wrap a connected socket in a buffered connection
+ * @param sock Socket file descriptor (owned by the caller)
+ * @param framing How messages are delimited
+ * @return Connection object, NULL on allocation failure
+ */
+UdsConn *uds_conn_create(int sock, UdsFraming framing);
+
+/**
+ * Make receives return instead of waiting for more bytes
+ * Only reads are affected (sends still block): a polled connection calls
+ * uds_conn_receive when readable and gets NULL with errno == EAGAIN once
+ * the buffered bytes hold no complete message. A partial message stays
+ * buffered for the next call.
+ * @param conn Connection to change
+ * @param nonblocking true for polled receives, false to block (default)
+ */
+void uds_conn_set_nonblocking(UdsConn *conn, bool nonblocking);
+
+/**
+ * Free a buffered connection (does not close its socket)
+ * @param conn Connection to free
+ */
+void uds_conn_destroy(UdsConn *conn);
+
+/**
+ * Receive the next complete message.
+ * Reads in large chunks; bytes past the message stay buffered for the
+ * next call. The returned string points into the connection's buffer
+ * and is only valid until the next receive on the same connection.
+ * @param conn Connection to read from
+ * @param length Set to the message length (may be NULL)
+ * @return NUL-terminated message, or NULL on error / connection closed
+ *         (errno == 0 for a clean close between messages, EAGAIN when a
+ *         non-blocking connection has no complete message yet)
+ */
+char *uds_conn_receive(UdsConn *conn, size_t *length);
+
+/**
+ * Send a message framed for the connection: newline-terminated, or
+ * behind a 4-byte big-endian length in UDS_FRAME_LENGTH mode
+ * @param conn Connection to write to
+ * @param message Message payload
+ * @param length Length of message
+ * @return 0 on success, -1 on error
+ */
+int uds_conn_send(UdsConn *conn, const char *message, size_t length);
+
+/**
+ * Send an OutputBuffer's payload framed for the connection
+ * The frame is built in the buffer's headroom and terminator byte, so the
+ * message leaves in one write; the payload is unchanged afterwards.
+ * @param conn Connection to write to
+ * @param out Buffer filled by json_serialize_tick_into
+ * @return 0 on success, -1 on error
+ */
+int uds_conn_send_output(UdsConn *conn, OutputBuffer *out);
+
+/**
+ * Parse a framing name ("newline", "json" or "length")
+ * @param name Framing name
+ * @param framing Set to the parsed framing
+ * @return 0 on success, -1 for an unknown name
  */
-char *uds_receive_message(int sock);
+int uds_parse_framing(const char *name, UdsFraming *framing);
 
 /**
  * Send a message via UDS
@@ -0,0 +1,41 @@
+/**
+ * ALFS - Fork-Join Work Pool Interface
+ * Splits an index range across the calling thread and a few helpers
+ */
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include "alfs.h"
+
+/**
+ * Start a pool
+ * @param threads Threads working on each job, the caller included (>= 2)
+ * @return New pool or NULL on failure
+ */
+WorkPool *workpool_create(int threads);
+
+/**
+ * Stop and join the helpers, then free the pool
+ * @param pool Pool to destroy (NULL is ignored)
+ */
+void workpool_destroy(WorkPool *pool);
+
+/**
+ * Run fn over [0, count) in contiguous chunks, one per thread, and
+ * return once every chunk is done. Only one thread may submit jobs.
+ * @param pool Pool
+ * @param fn Job; the caller runs the first chunk itself
+ * @param arg Passed to every call of fn
+ * @param count Size of the index range
+ */
+void workpool_run(WorkPool *pool, WorkFn fn, void *arg, int count);
+
+/**
+ * Threads working on each job, the caller included
+ */
+static inline int workpool_threads(const WorkPool *pool) {
+    return pool ? pool->helpers + 1 : 1;
+}
+
+#endif /* WORKPOOL_H */
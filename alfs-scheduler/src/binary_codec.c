@@ -0,0 +1,367 @@
+/**
+ * ALFS - Binary Wire Protocol Implementation
+ *
+ * Decodes fixed-layout TIMEFRAME messages straight into the reusable
+ * TimeFrame and encodes ticks as handle arrays. The message layout is
+ * documented in binary_codec.h.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "binary_codec.h"
+#include "json_handler.h"
+#include "uds.h"
+
+#define HANDLE_MIN_CAPACITY 256
+
+/* ============================================================================
+ * Byte Order Helpers
+ * ============================================================================ */
+
+static inline uint16_t get_u16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int32_t get_i32(const unsigned char *p) {
+    return (int32_t)get_u32(p);
+}
+
+static inline unsigned char *put_u32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+    return p + 4;
+}
+
+/* ============================================================================
+ * Handle Table
+ * ============================================================================ */
+
+/**
+ * Record the ID string a handle stands for
+ * Repeating a definition is harmless; redefining a handle is an error.
+ */
+static int handles_define(HandleTable *handles, uint32_t handle,
+                          const unsigned char *name, size_t length) {
+    if (handle == 0 || handle >= BINARY_MAX_HANDLE) {
+        return -1;
+    }
+
+    if (handle >= handles->capacity) {
+        uint32_t capacity = handles->capacity ? handles->capacity : HANDLE_MIN_CAPACITY;
+        while (capacity <= handle) {
+            capacity *= 2;
+        }
+        char **names = realloc(handles->names, (size_t)capacity * sizeof(char *));
+        if (!names) {
+            return -1;
+        }
+        memset(names + handles->capacity, 0, (size_t)(capacity - handles->capacity) * sizeof(char *));
+        handles->names = names;
+        handles->capacity = capacity;
+    }
+
+    char *existing = handles->names[handle];
+    if (existing) {
+        return strlen(existing) == length && memcmp(existing, name, length) == 0 ? 0 : -1;
+    }
+
+    char *copy = malloc(length + 1);
+    if (!copy) {
+        return -1;
+    }
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+    handles->names[handle] = copy;
+    return 0;
+}
+
+/**
+ * Resolve a handle to its ID (NULL for handle 0)
+ * Definitions are never replaced, so events may point at them for as
+ * long as the codec lives.
+ * @return 0 on success, -1 if the handle was never defined
+ */
+static int handles_resolve(const HandleTable *handles, uint32_t handle, const char **out) {
+    if (handle == 0) {
+        *out = NULL;
+        return 0;
+    }
+    if (handle >= handles->capacity || !handles->names[handle]) {
+        return -1;
+    }
+    *out = handles->names[handle];
+    return 0;
+}
+
+/* ============================================================================
+ * TimeFrame Buffers
+ * ============================================================================ */
+
+static int reserve_frame(TimeFrame *tf, uint32_t events, size_t masks) {
+    if (events > (uint32_t)tf->event_capacity) {
+        Event *grown = realloc(tf->events, (size_t)events * sizeof(Event));
+        if (!grown) {
+            return -1;
+        }
+        tf->events = grown;
+        tf->event_capacity = (int)events;
+    }
+    if (masks > (size_t)tf->cpu_mask_capacity) {
+        int *grown = realloc(tf->cpu_masks, masks * sizeof(int));
+        if (!grown) {
+            return -1;
+        }
+        tf->cpu_masks = grown;
+        tf->cpu_mask_capacity = (int)masks;
+    }
+    return 0;
+}
+
+/**
+ * Fill one Event from its record; masks points at its u16 CPU IDs
+ * @return 1 if stored, 0 if dropped (unknown action), -1 on a bad handle
+ */
+static int decode_event(const HandleTable *handles, const unsigned char *record,
+                        const unsigned char *masks, TimeFrame *tf) {
+    unsigned action = record[0];
+    if (action > EVENT_CPU_BURST) {
+        fprintf(stderr, "Invalid event action: %u\n", action);
+        return 0;
+    }
+
+    Event *event = &tf->events[tf->event_count];
+    memset(&event->nice, 0, sizeof(Event) - offsetof(Event, nice));
+    uint32_t task = get_u32(record + 4);
+    
+    /* The third handle is the parent of a CGROUP_CREATE, else newCgroupId */
+    const char **third = action == EVENT_CGROUP_CREATE ? &event->parent_id : &event->new_cgroup_id;
+    event->new_cgroup_id = NULL;
+    event->parent_id = NULL;
+    if (handles_resolve(handles, task, &event->task_id) < 0 ||
+        handles_resolve(handles, get_u32(record + 8), &event->cgroup_id) < 0 ||
+        handles_resolve(handles, get_u32(record + 12), third) < 0) {
+        return -1;
+    }
+
+    unsigned flags = record[1];
+    event->action = (EventAction)action;
+    event->task_handle = task;
+    event->nice = get_i32(record + 16);
+    event->cpu_shares = get_i32(record + 20);
+    event->cpu_quota_us = get_i32(record + 24);
+    event->cpu_period_us = get_i32(record + 28);
+    event->burst_duration = get_i32(record + 32);
+    event->has_nice = (flags & BINARY_HAS_NICE) != 0;
+    event->has_cpu_shares = (flags & BINARY_HAS_CPU_SHARES) != 0;
+    event->has_cpu_quota = (flags & BINARY_HAS_CPU_QUOTA) != 0;
+    event->has_cpu_period = (flags & BINARY_HAS_CPU_PERIOD) != 0;
+    event->has_cpu_mask = (flags & BINARY_HAS_CPU_MASK) != 0;
+
+    int count = get_u16(record + 2);
+    for (int i = 0; i < count; i++) {
+        tf->cpu_masks[tf->cpu_mask_used++] = get_u16(masks + 2 * i);
+    }
+    event->cpu_mask_count = count;
+
+    tf->event_count++;
+    return 1;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int binary_send_hello(Codec *codec, UdsConn *conn, int cpu_count) {
+    (void)codec;
+
+    unsigned char hello[BINARY_HELLO_SIZE] = {
+        BINARY_MSG_HELLO, BINARY_VERSION,
+        (unsigned char)cpu_count, (unsigned char)(cpu_count >> 8)
+    };
+    return uds_conn_send(conn, (const char *)hello, sizeof(hello)) < 0 ? -1 : 0;
+}
+
+int binary_check_hello(Codec *codec, const char *message, size_t length) {
+    (void)codec;
+
+    const unsigned char *reply = (const unsigned char *)message;
+    if (!reply || length < 2 || reply[0] != BINARY_MSG_HELLO || reply[1] != BINARY_VERSION) {
+        fprintf(stderr, "Binary protocol: peer did not accept version %d\n", BINARY_VERSION);
+        return -1;
+    }
+    return 0;
+}
+
+int binary_decode_timeframe(Codec *codec, const char *message, size_t length, TimeFrame *tf) {
+    if (!codec || !message || !tf) {
+        return -1;
+    }
+
+    tf->vtime = 0;
+    tf->event_count = 0;
+    tf->cpu_mask_used = 0;
+
+    const unsigned char *p = (const unsigned char *)message;
+    const unsigned char *end = p + length;
+    if (length < BINARY_FRAME_HEADER_SIZE || p[0] != BINARY_MSG_TIMEFRAME) {
+        goto malformed;
+    }
+    int define_count = get_u16(p + 2);
+    int32_t vtime = get_i32(p + 4);
+    uint32_t event_count = get_u32(p + 8);
+    p += BINARY_FRAME_HEADER_SIZE;
+
+    /* New handle definitions come first */
+    for (int i = 0; i < define_count; i++) {
+        if (end - p < 6) {
+            goto malformed;
+        }
+        uint32_t handle = get_u32(p);
+        size_t name_length = get_u16(p + 4);
+        p += 6;
+        if ((size_t)(end - p) < name_length ||
+            handles_define(&codec->handles, handle, p, name_length) < 0) {
+            goto malformed;
+        }
+        p += name_length;
+    }
+
+    /* Fixed-size records, then every CPU mask; sizes must add up exactly */
+    if ((size_t)(end - p) / BINARY_EVENT_SIZE < event_count) {
+        goto malformed;
+    }
+    const unsigned char *records = p;
+    const unsigned char *masks = p + (size_t)event_count * BINARY_EVENT_SIZE;
+    size_t mask_total = 0;
+    for (uint32_t i = 0; i < event_count; i++) {
+        mask_total += get_u16(records + (size_t)i * BINARY_EVENT_SIZE + 2);
+    }
+    if ((size_t)(end - masks) != mask_total * 2 ||
+        reserve_frame(tf, event_count, mask_total) < 0) {
+        goto malformed;
+    }
+
+    for (uint32_t i = 0; i < event_count; i++) {
+        const unsigned char *record = records + (size_t)i * BINARY_EVENT_SIZE;
+        if (decode_event(&codec->handles, record, masks, tf) < 0) {
+            goto malformed;
+        }
+        masks += 2 * (size_t)get_u16(record + 2);
+    }
+    tf->vtime = vtime;
+
+    /* Point each event at its run of the shared mask buffer */
+    int offset = 0;
+    for (int i = 0; i < tf->event_count; i++) {
+        Event *event = &tf->events[i];
+        event->cpu_mask = event->cpu_mask_count > 0 ? tf->cpu_masks + offset : NULL;
+        offset += event->cpu_mask_count;
+    }
+    return 0;
+
+malformed:
+    fprintf(stderr, "Malformed binary timeframe\n");
+    tf->event_count = 0;
+    tf->cpu_mask_used = 0;
+    return -1;
+}
+
+int binary_encode_tick(const SchedulerTick *tick, bool include_meta, OutputBuffer *out) {
+    if (!tick || !out) {
+        return -1;
+    }
+
+    const SchedulerMeta *meta = include_meta ? tick->meta : NULL;
+    bool delta = tick->delta;
+    size_t listed = meta ? (size_t)meta->runnable_count + (size_t)meta->blocked_count +
+                           (delta ? (size_t)meta->removed_count : 0) : 0;
+    size_t schedule = delta ? 4 + 8 * (size_t)tick->changed_count : 4 * (size_t)tick->cpu_count;
+    size_t size = BINARY_TICK_HEADER_SIZE + schedule +
+                  (meta ? 24 + (delta ? 4 : 0) + 4 * listed : 0) +
+                  (meta && meta->has_latency ? 8 : 0);
+    out->length = 0;
+    if (json_output_reserve(out, size) < 0) {
+        return -1;
+    }
+
+    unsigned char *p = (unsigned char *)out->data + OUTPUT_HEADROOM;
+    p[0] = BINARY_MSG_TICK;
+    p[1] = (unsigned char)((meta ? BINARY_TICK_META : 0) |
+                           (meta && meta->has_latency ? BINARY_TICK_LATENCY : 0) |
+                           (delta ? BINARY_TICK_DELTA : 0));
+    p[2] = (unsigned char)tick->cpu_count;
+    p[3] = (unsigned char)(tick->cpu_count >> 8);
+    p = put_u32(p + 4, (uint32_t)tick->vtime);
+
+    /* Busy CPUs are pinned in CPU order: a scheduled ID is the next pin's entry */
+    int pin = 0;
+    int next = 0;
+    if (delta) {
+        p = put_u32(p, (uint32_t)tick->changed_count);
+    }
+    for (int i = 0; i < tick->cpu_count; i++) {
+        uint32_t handle = 0;
+        if (pin < tick->pin_count && tick->pins[pin]->str == tick->schedule[i]) {
+            handle = tick->pins[pin++]->handle;
+        }
+        if (!delta) {
+            p = put_u32(p, handle);
+        } else if (next < tick->changed_count && tick->changed_cpus[next] == i) {
+            p = put_u32(p, (uint32_t)i);
+            p = put_u32(p, handle);
+            next++;
+        }
+    }
+
+    if (meta) {
+        p = put_u32(p, (uint32_t)meta->preemptions);
+        p = put_u32(p, (uint32_t)meta->migrations);
+        p = put_u32(p, (uint32_t)meta->throttles);
+        p = put_u32(p, (uint32_t)meta->unthrottles);
+        p = put_u32(p, (uint32_t)meta->runnable_count);
+        p = put_u32(p, (uint32_t)meta->blocked_count);
+        if (delta) {
+            p = put_u32(p, (uint32_t)meta->removed_count);
+        }
+        if (meta->has_latency) {
+            p = put_u32(p, (uint32_t)meta->wakeups);
+            p = put_u32(p, (uint32_t)meta->wakeup_latency);
+        }
+        size_t cached_length;
+        const char *cached = json_output_cached_lists(out, tick, WIRE_BINARY, &cached_length);
+        if (cached && cached_length == 4 * listed) {
+            memcpy(p, cached, cached_length);
+        } else {
+            unsigned char *lists = p;
+            for (size_t i = 0; i < listed; i++) {
+                p = put_u32(p, meta->task_entries ? meta->task_entries[i]->handle : 0);
+            }
+            json_output_keep_lists(out, tick, WIRE_BINARY, (const char *)lists, 4 * listed);
+        }
+    }
+
+    out->length = size;
+    out->data[OUTPUT_HEADROOM + size] = '\0';
+    return 0;
+}
+
+void binary_handles_clear(HandleTable *handles) {
+    if (!handles) {
+        return;
+    }
+    for (uint32_t i = 0; i < handles->capacity; i++) {
+        free(handles->names[i]);
+    }
+    free(handles->names);
+    handles->names = NULL;
+    handles->capacity = 0;
+}
@@ -2,9 +2,32 @@
  * ALFS - Cgroup Management Implementation
  */
 
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include "cgroup.h"
+#include "cpumask.h"
+#include "pool.h"
+
+/**
+ * Fill a zeroed cgroup; the ID string is referenced, not copied
+ */
+static void cgroup_init(Cgroup *cgroup, const char *cgroup_id, int cpu_shares,
+                        int cpu_quota_us, int cpu_period_us,
+                        const int *cpu_mask, int cpu_mask_count) {
+    cgroup->cgroup_id = cgroup_id;
+    
+    cgroup->cpu_shares = cpu_shares > 0 ? cpu_shares : DEFAULT_CPU_SHARES;
+    cgroup->cpu_quota_us = cpu_quota_us;  /* -1 = unlimited */
+    cgroup->cpu_period_us = cpu_period_us > 0 ? cpu_period_us : DEFAULT_CPU_PERIOD_US;
+    
+    cgroup->quota_used = 0.0;
+    cgroup->period_start_vtime = 0;
+    
+    /* An empty list means any CPU */
+    cpumask_from_list(&cgroup->requested_mask, cpu_mask, cpu_mask_count);
+    cgroup_inherit(cgroup);
+}
 
 Cgroup *cgroup_create(const char *cgroup_id, int cpu_shares, 
                       int cpu_quota_us, int cpu_period_us,
@@ -14,39 +37,43 @@ Cgroup *cgroup_create(const char *cgroup_id, int cpu_shares,
     }
     
     Cgroup *cgroup = calloc(1, sizeof(Cgroup));
-    if (!cgroup) {
+    char *copy = malloc(strlen(cgroup_id) + 1);
+    if (!cgroup || !copy) {
+        free(cgroup);
+        free(copy);
         return NULL;
     }
+    strcpy(copy, cgroup_id);
     
-    strncpy(cgroup->cgroup_id, cgroup_id, MAX_CGROUP_ID_LEN - 1);
-    cgroup->cgroup_id[MAX_CGROUP_ID_LEN - 1] = '\0';
-    
-    cgroup->cpu_shares = cpu_shares > 0 ? cpu_shares : DEFAULT_CPU_SHARES;
-    cgroup->cpu_quota_us = cpu_quota_us;  /* -1 = unlimited */
-    cgroup->cpu_period_us = cpu_period_us > 0 ? cpu_period_us : DEFAULT_CPU_PERIOD_US;
-    
-    cgroup->quota_used = 0.0;
-    cgroup->period_start_vtime = 0;
+    cgroup_init(cgroup, copy, cpu_shares, cpu_quota_us, cpu_period_us,
+                cpu_mask, cpu_mask_count);
+    cgroup->id_copy = copy;
+    return cgroup;
+}
+
+Cgroup *cgroup_create_pooled(Pool *pool, const char *cgroup_id, int cpu_shares,
+                             int cpu_quota_us, int cpu_period_us,
+                             const int *cpu_mask, int cpu_mask_count) {
+    if (!pool || !cgroup_id) {
+        return NULL;
+    }
     
-    if (cpu_mask && cpu_mask_count > 0) {
-        cgroup->cpu_mask = malloc(sizeof(int) * cpu_mask_count);
-        if (!cgroup->cpu_mask) {
-            free(cgroup);
-            return NULL;
-        }
-        memcpy(cgroup->cpu_mask, cpu_mask, sizeof(int) * cpu_mask_count);
-        cgroup->cpu_mask_count = cpu_mask_count;
-    } else {
-        cgroup->cpu_mask = NULL;
-        cgroup->cpu_mask_count = 0;
+    Cgroup *cgroup = pool_alloc(pool);
+    if (!cgroup) {
+        return NULL;
     }
     
+    cgroup_init(cgroup, cgroup_id, cpu_shares, cpu_quota_us, cpu_period_us,
+                cpu_mask, cpu_mask_count);
+    cgroup->pool = pool;
     return cgroup;
 }
 
 void cgroup_destroy(Cgroup *cgroup) {
-    if (cgroup) {
-        free(cgroup->cpu_mask);
+    if (cgroup && cgroup->pool) {
+        pool_free(cgroup->pool, cgroup);
+    } else if (cgroup) {
+        free(cgroup->id_copy);
         free(cgroup);
     }
 }
@@ -72,36 +99,16 @@ int cgroup_modify(Cgroup *cgroup, int cpu_shares, int cpu_quota_us,
     }
     
     if (cpu_mask && cpu_mask_count > 0) {
-        free(cgroup->cpu_mask);
-        cgroup->cpu_mask = malloc(sizeof(int) * cpu_mask_count);
-        if (!cgroup->cpu_mask) {
-            cgroup->cpu_mask_count = 0;
-            return -1;
-        }
-        memcpy(cgroup->cpu_mask, cpu_mask, sizeof(int) * cpu_mask_count);
-        cgroup->cpu_mask_count = cpu_mask_count;
+        cpumask_from_list(&cgroup->requested_mask, cpu_mask, cpu_mask_count);
     }
     
+    cgroup_inherit(cgroup);
     return 0;
 }
 
 bool cgroup_allows_cpu(const Cgroup *cgroup, int cpu_id) {
-    if (!cgroup) {
-        return true;  /* No cgroup = all CPUs allowed */
-    }
-    
-    /* No mask means all CPUs allowed */
-    if (cgroup->cpu_mask_count == 0) {
-        return true;
-    }
-    
-    for (int i = 0; i < cgroup->cpu_mask_count; i++) {
-        if (cgroup->cpu_mask[i] == cpu_id) {
-            return true;
-        }
-    }
-    
-    return false;
+    /* No cgroup = all CPUs allowed */
+    return !cgroup || cpumask_test(&cgroup->cpu_mask, cpu_id);
 }
 
 bool cgroup_has_quota(const Cgroup *cgroup, int vtime) {
@@ -132,3 +139,74 @@ void cgroup_reset_period(Cgroup *cgroup, int vtime) {
         cgroup->period_start_vtime = vtime;
     }
 }
+
+/* ============================================================================
+ * Hierarchy
+ * ============================================================================ */
+
+void cgroup_inherit(Cgroup *cgroup) {
+    const Cgroup *parent = cgroup->parent;
+    if (!parent) {
+        cgroup->effective_shares = cgroup->cpu_shares;
+        cgroup->cpu_mask = cgroup->requested_mask;
+        cgroup->quota_group = cgroup->cpu_quota_us >= 0 ? cgroup : NULL;
+        return;
+    }
+
+    long long shares = (long long)cgroup->cpu_shares * parent->effective_shares / DEFAULT_CPU_SHARES;
+    cgroup->effective_shares = shares < 1 ? 1 : (shares > INT_MAX ? INT_MAX : (int)shares);
+    cpumask_and(&cgroup->cpu_mask, &cgroup->requested_mask, &parent->cpu_mask);
+    cgroup->quota_group = cgroup->cpu_quota_us >= 0 ? cgroup : parent->quota_group;
+}
+
+int cgroup_attach(Cgroup *cgroup, Cgroup *parent) {
+    if (!cgroup || !parent || cgroup->parent || parent->depth >= MAX_CGROUP_DEPTH) {
+        return -1;
+    }
+
+    cgroup->parent = parent;
+    cgroup->depth = parent->depth + 1;
+    cgroup->prev_sibling = NULL;
+    cgroup->next_sibling = parent->first_child;
+    if (parent->first_child) {
+        parent->first_child->prev_sibling = cgroup;
+    }
+    parent->first_child = cgroup;
+
+    cgroup->throttle_count = parent->throttle_count + (cgroup->throttled ? 1 : 0);
+    cgroup_inherit(cgroup);
+    return 0;
+}
+
+void cgroup_detach(Cgroup *cgroup) {
+    Cgroup *parent = cgroup ? cgroup->parent : NULL;
+    if (!parent) {
+        return;
+    }
+
+    if (cgroup->prev_sibling) {
+        cgroup->prev_sibling->next_sibling = cgroup->next_sibling;
+    } else {
+        parent->first_child = cgroup->next_sibling;
+    }
+    if (cgroup->next_sibling) {
+        cgroup->next_sibling->prev_sibling = cgroup->prev_sibling;
+    }
+    cgroup->parent = NULL;
+    cgroup->next_sibling = NULL;
+    cgroup->prev_sibling = NULL;
+    cgroup->depth = 0;
+}
+
+Cgroup *cgroup_next_descendant(const Cgroup *root, const Cgroup *pos) {
+    if (pos->first_child) {
+        return pos->first_child;
+    }
+    while (pos != root) {
+        if (pos->next_sibling) {
+            return pos->next_sibling;
+        }
+        pos = pos->parent;
+    }
+    return NULL;
+}
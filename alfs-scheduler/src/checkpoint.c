@@ -0,0 +1,1056 @@
+/**
+ * ALFS - Checkpoint Implementation
+ *
+ * A snapshot is a header followed by fixed-size records in restore
+ * order: CPUs, run queues, interned names, cgroups, tasks and affinity
+ * classes. Pointers are stored as record indices. Every list whose order
+ * the scheduler depends on is stored in that order (tasks, cgroups,
+ * siblings, cgroup members, classes and each class's queue), so the
+ * restored scheduler makes the same decisions as the original.
+ *
+ * Records use the native layout of the build, and the header rejects a
+ * snapshot taken with the other vruntime representation; snapshots are
+ * for restarting the same binary, not an interchange format.
+ *
+ * Loading checks every index and link it follows, so a damaged file can
+ * only be rejected; the ordering invariants of the rebuilt queues are
+ * checked by scheduler_validate in DEBUG builds, like every event.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "checkpoint.h"
+#include "cgroup.h"
+#include "idtable.h"
+#include "runqueue.h"
+#include "scheduler.h"
+#include "task.h"
+#include "taskqueue.h"
+#include "timerwheel.h"
+
+#define SNAPSHOT_MAGIC "ALFSSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_FIXED_VRUNTIME 0x1u    /* Taken with integer vruntime */
+
+#ifdef ALFS_FIXED_VRUNTIME
+#define SNAPSHOT_FLAGS SNAPSHOT_FIXED_VRUNTIME
+#else
+#define SNAPSHOT_FLAGS 0u
+#endif
+
+/* ============================================================================
+ * Snapshot Format
+ * ============================================================================ */
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t size;                  /* Whole file */
+    uint64_t checksum;              /* Of everything after the header */
+
+    /* Configuration the restoring scheduler must match */
+    int32_t cpu_count;
+    int32_t quanta;
+    int32_t policy;
+    int32_t per_cpu_queues;
+    int32_t backend;
+
+    /* Record counts */
+    int32_t name_count;
+    int32_t cgroup_count;
+    int32_t task_count;
+    int32_t class_count;
+
+    /* Scheduler state */
+    int32_t tick_count;
+    int32_t current_vtime;
+    int32_t throttles;
+    int32_t unthrottles;
+    int32_t max_vruntime_stale;
+    uint64_t next_task_seq;
+    vruntime_t max_vruntime;
+    int64_t wheel_now;
+} SnapshotHeader;
+
+typedef struct {
+    int32_t capacity;
+    int32_t current_task;           /* Task index, -1 if idle */
+} CpuRecord;
+
+/* Run queue 0 is the global one, run queue 1 + i belongs to CPU i */
+typedef struct {
+    vruntime_t min_vruntime;
+    double avg_sum;
+    int32_t class_count;
+    int32_t active_count;
+} RunQueueRecord;
+
+/* Followed by `length` bytes of the ID */
+typedef struct {
+    uint32_t length;
+    uint32_t handle;
+    int32_t members;                /* First member task, -1 if none */
+    int32_t reserved;
+} NameRecord;
+
+typedef struct {
+    CpuMask requested_mask;
+    double quota_used;
+    int32_t name;
+    int32_t parent;                 /* Cgroup indices, -1 for none */
+    int32_t first_child;
+    int32_t next_sibling;
+    int32_t first_class;            /* Class index, -1 for none */
+    int32_t cpu_shares;
+    int32_t cpu_quota_us;
+    int32_t cpu_period_us;
+    int32_t throttled;
+    int32_t period_start_vtime;
+} CgroupRecord;
+
+typedef struct {
+    CpuMask affinity;
+    CpuMask allowed;
+    vruntime_t vruntime;
+    vruntime_t deadline;
+    vruntime_t vlag;
+    inv_weight_t inv_weight;
+    uint64_t seq;
+    uint64_t util_sum;
+    int32_t name;
+    int32_t cgroup_name;            /* -1 for no cgroup */
+    int32_t group_next;             /* Next member of cgroup_name, -1 at the end */
+    int32_t tclass;                 /* Bound class, -1 if none */
+    int32_t state;
+    int32_t nice;
+    int32_t weight;
+    int32_t current_cpu;
+    int32_t home_cpu;
+    int32_t burst_remaining;
+    int32_t is_burst;
+    int32_t avg_weight;
+    int32_t wake_tick;
+    int32_t util_avg;
+    int32_t util_tick;
+    int32_t reserved;
+} TaskRecord;
+
+/* Followed by `queued` task indices in queue layout order */
+typedef struct {
+    CpuMask mask;
+    int32_t cgroup;                 /* -1 for none */
+    int32_t cgroup_next;            /* Next class of the cgroup, -1 at the end */
+    int32_t parked;
+    int32_t queued;
+} ClassRecord;
+
+/* Word-wise FNV-1a: one multiply per 8 bytes */
+static uint64_t snapshot_checksum(const unsigned char *data, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3ULL;
+    }
+    for (; i < length; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static const RunQueue *snapshot_runqueue(const Scheduler *sched, int slot) {
+    return slot == 0 ? &sched->runqueue : &sched->cpu_queues[slot - 1].rq;
+}
+
+/* ============================================================================
+ * Writing
+ * ============================================================================ */
+
+typedef struct {
+    unsigned char *data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} SnapshotWriter;
+
+static void put(SnapshotWriter *w, const void *src, size_t n) {
+    if (w->failed) {
+        return;
+    }
+    if (w->length + n > w->capacity) {
+        size_t capacity = w->capacity ? w->capacity : 4096;
+        while (capacity < w->length + n) {
+            capacity *= 2;
+        }
+        unsigned char *data = realloc(w->data, capacity);
+        if (!data) {
+            w->failed = true;
+            return;
+        }
+        w->data = data;
+        w->capacity = capacity;
+    }
+    memcpy(w->data + w->length, src, n);
+    w->length += n;
+}
+
+/**
+ * Interned entries numbered in first-use order, so the same scheduler
+ * always produces the same file
+ */
+typedef struct {
+    const IdEntry **entries;
+    int *slots;                     /* Name index + 1, 0 for an empty slot */
+    uint32_t mask;
+    int count;
+} NameMap;
+
+static int name_map_init(NameMap *map, int max_names) {
+    uint32_t capacity = 16;
+    while (capacity < (uint32_t)max_names * 2) {
+        capacity *= 2;
+    }
+    map->entries = malloc(sizeof(IdEntry *) * (size_t)(max_names > 0 ? max_names : 1));
+    map->slots = calloc(capacity, sizeof(int));
+    map->mask = capacity - 1;
+    map->count = 0;
+    return map->entries && map->slots ? 0 : -1;
+}
+
+static void name_map_release(NameMap *map) {
+    free(map->entries);
+    free(map->slots);
+}
+
+static int name_index(NameMap *map, const IdEntry *entry) {
+    if (!entry) {
+        return -1;
+    }
+    for (uint32_t i = entry->hash & map->mask;; i = (i + 1) & map->mask) {
+        int slot = map->slots[i];
+        if (slot == 0) {
+            map->entries[map->count] = entry;
+            map->slots[i] = ++map->count;
+            return map->count - 1;
+        }
+        if (map->entries[slot - 1] == entry) {
+            return slot - 1;
+        }
+    }
+}
+
+/* Global index of a class: classes are numbered run queue by run queue */
+static int class_index(const Scheduler *sched, const int *class_base, const TaskClass *tclass) {
+    if (!tclass) {
+        return -1;
+    }
+    int slot = 0;
+    if (tclass->rq != &sched->runqueue) {
+        const CPURunQueue *cpu_queue = (const CPURunQueue *)
+            ((const char *)tclass->rq - offsetof(CPURunQueue, rq));
+        slot = (int)(cpu_queue - sched->cpu_queues) + 1;
+    }
+    return class_base[slot] + tclass->rq_index;
+}
+
+static int serialize(const Scheduler *sched, SnapshotWriter *w) {
+    int rq_count = sched->cpu_count + 1;
+    int *class_base = malloc(sizeof(int) * (size_t)(rq_count + 1));
+    IdEntry **cgroup_entries = malloc(sizeof(IdEntry *) * (size_t)(sched->cgroup_count + 1));
+    Task **queued = NULL;
+    NameMap names = {0};
+    int rc = -1;
+    if (!class_base || !cgroup_entries ||
+        name_map_init(&names, sched->task_count * 2 + sched->cgroup_count) < 0) {
+        goto out;
+    }
+
+    int max_queued = 1;
+    class_base[0] = 0;
+    for (int r = 0; r < rq_count; r++) {
+        const RunQueue *rq = snapshot_runqueue(sched, r);
+        class_base[r + 1] = class_base[r] + rq->class_count;
+        if (rq->nr_queued > max_queued) {
+            max_queued = rq->nr_queued;
+        }
+    }
+    queued = malloc(sizeof(Task *) * (size_t)max_queued);
+    if (!queued) {
+        goto out;
+    }
+
+    /* Number the names: task IDs and cgroup IDs in task order, then cgroups */
+    for (int i = 0; i < sched->task_count; i++) {
+        name_index(&names, sched->all_tasks[i]->id_entry);
+        name_index(&names, sched->all_tasks[i]->cgroup_entry);
+    }
+    for (int i = 0; i < sched->cgroup_count; i++) {
+        cgroup_entries[i] = idtable_lookup(sched->ids, sched->cgroups[i]->cgroup_id);
+        if (!cgroup_entries[i]) {
+            goto out;
+        }
+        name_index(&names, cgroup_entries[i]);
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.flags = SNAPSHOT_FLAGS;
+    header.cpu_count = sched->cpu_count;
+    header.quanta = sched->quanta;
+    header.policy = (int32_t)sched->policy;
+    header.per_cpu_queues = sched->per_cpu_queues;
+    header.backend = (int32_t)sched->runqueue.backend;
+    header.name_count = names.count;
+    header.cgroup_count = sched->cgroup_count;
+    header.task_count = sched->task_count;
+    header.class_count = class_base[rq_count];
+    header.tick_count = sched->tick_count;
+    header.current_vtime = sched->current_vtime;
+    header.throttles = sched->throttles;
+    header.unthrottles = sched->unthrottles;
+    header.max_vruntime_stale = sched->max_vruntime_stale;
+    header.next_task_seq = sched->next_task_seq;
+    header.max_vruntime = sched->max_vruntime;
+    header.wheel_now = sched->period_wheel.now;
+    put(w, &header, sizeof(header));
+
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        const CPURunQueue *cpu_queue = &sched->cpu_queues[cpu];
+        CpuRecord rec = {
+            .capacity = cpu_queue->capacity,
+            .current_task = cpu_queue->current_task ? cpu_queue->current_task->task_index : -1,
+        };
+        put(w, &rec, sizeof(rec));
+    }
+
+    for (int r = 0; r < rq_count; r++) {
+        const RunQueue *rq = snapshot_runqueue(sched, r);
+        RunQueueRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.min_vruntime = rq->min_vruntime;
+        rec.avg_sum = rq->avg_sum;
+        rec.class_count = rq->class_count;
+        rec.active_count = rq->active_count;
+        put(w, &rec, sizeof(rec));
+    }
+
+    for (int i = 0; i < names.count; i++) {
+        const IdEntry *entry = names.entries[i];
+        NameRecord rec = {
+            .length = (uint32_t)entry->len,
+            .handle = entry->handle,
+            .members = entry->members ? entry->members->task_index : -1,
+        };
+        put(w, &rec, sizeof(rec));
+        put(w, entry->str, entry->len);
+    }
+
+    for (int i = 0; i < sched->cgroup_count; i++) {
+        const Cgroup *cgroup = sched->cgroups[i];
+        CgroupRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.requested_mask = cgroup->requested_mask;
+        rec.quota_used = cgroup->quota_used;
+        rec.name = name_index(&names, cgroup_entries[i]);
+        rec.parent = cgroup->parent ? cgroup->parent->index : -1;
+        rec.first_child = cgroup->first_child ? cgroup->first_child->index : -1;
+        rec.next_sibling = cgroup->next_sibling ? cgroup->next_sibling->index : -1;
+        rec.first_class = class_index(sched, class_base, cgroup->classes);
+        rec.cpu_shares = cgroup->cpu_shares;
+        rec.cpu_quota_us = cgroup->cpu_quota_us;
+        rec.cpu_period_us = cgroup->cpu_period_us;
+        rec.throttled = cgroup->throttled;
+        rec.period_start_vtime = cgroup->period_start_vtime;
+        put(w, &rec, sizeof(rec));
+    }
+
+    for (int i = 0; i < sched->task_count; i++) {
+        const Task *task = sched->all_tasks[i];
+        TaskRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.affinity = task->affinity;
+        rec.allowed = task->allowed;
+        rec.vruntime = task->vruntime;
+        rec.deadline = task->deadline;
+        rec.vlag = task->vlag;
+        rec.inv_weight = task->inv_weight;
+        rec.seq = task->seq;
+        rec.util_sum = task->util_sum;
+        rec.name = name_index(&names, task->id_entry);
+        rec.cgroup_name = name_index(&names, task->cgroup_entry);
+        rec.group_next = task->group_next ? task->group_next->task_index : -1;
+        rec.tclass = class_index(sched, class_base, task->tclass);
+        rec.state = (int32_t)task->state;
+        rec.nice = task->nice;
+        rec.weight = task->weight;
+        rec.current_cpu = task->current_cpu;
+        rec.home_cpu = task->home_cpu;
+        rec.burst_remaining = task->burst_remaining;
+        rec.is_burst = task->is_burst;
+        rec.avg_weight = task->avg_weight;
+        rec.wake_tick = task->wake_tick;
+        rec.util_avg = task->util_avg;
+        rec.util_tick = task->util_tick;
+        put(w, &rec, sizeof(rec));
+    }
+
+    for (int r = 0; r < rq_count; r++) {
+        const RunQueue *rq = snapshot_runqueue(sched, r);
+        for (int i = 0; i < rq->class_count; i++) {
+            const TaskClass *tclass = rq->classes[i];
+            int count = taskqueue_collect(&tclass->queue, queued);
+            ClassRecord rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.mask = tclass->mask;
+            rec.cgroup = tclass->cgroup ? tclass->cgroup->index : -1;
+            rec.cgroup_next = class_index(sched, class_base, tclass->cgroup_next);
+            rec.parked = tclass->parked;
+            rec.queued = count;
+            put(w, &rec, sizeof(rec));
+            for (int k = 0; k < count; k++) {
+                int32_t index = queued[k]->task_index;
+                put(w, &index, sizeof(index));
+            }
+        }
+    }
+
+    if (!w->failed) {
+        SnapshotHeader *out = (SnapshotHeader *)w->data;
+        uint64_t size = w->length;
+        uint64_t checksum = snapshot_checksum(w->data + sizeof(header), w->length - sizeof(header));
+        memcpy((unsigned char *)out + offsetof(SnapshotHeader, size), &size, sizeof(size));
+        memcpy((unsigned char *)out + offsetof(SnapshotHeader, checksum), &checksum, sizeof(checksum));
+        rc = 0;
+    }
+
+out:
+    name_map_release(&names);
+    free(queued);
+    free(cgroup_entries);
+    free(class_base);
+    return rc;
+}
+
+static int write_file(const char *path, const unsigned char *data, size_t length) {
+    size_t path_len = strlen(path);
+    char *tmp = malloc(path_len + sizeof(".tmp"));
+    if (!tmp) {
+        return -1;
+    }
+    memcpy(tmp, path, path_len);
+    memcpy(tmp + path_len, ".tmp", sizeof(".tmp"));
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        free(tmp);
+        return -1;
+    }
+    int rc = 0;
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = write(fd, data + done, length - done);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            rc = -1;
+            break;
+        }
+        done += (size_t)n;
+    }
+    if (rc == 0 && fsync(fd) < 0) {
+        rc = -1;
+    }
+    if (close(fd) < 0) {
+        rc = -1;
+    }
+    if (rc == 0 && rename(tmp, path) < 0) {
+        rc = -1;
+    }
+    if (rc < 0) {
+        unlink(tmp);
+    }
+    free(tmp);
+    return rc;
+}
+
+int checkpoint_save(const Scheduler *sched, const char *path) {
+    if (!sched || !path) {
+        return -1;
+    }
+
+    SnapshotWriter w = {0};
+    int rc = serialize(sched, &w);
+    if (rc == 0) {
+        rc = write_file(path, w.data, w.length);
+    }
+    free(w.data);
+    return rc;
+}
+
+/* ============================================================================
+ * Restoring
+ * ============================================================================ */
+
+typedef struct {
+    const unsigned char *data;
+    size_t length;
+    size_t offset;
+} SnapshotReader;
+
+static bool take(SnapshotReader *r, void *dst, size_t n) {
+    if (r->length - r->offset < n) {
+        return false;
+    }
+    memcpy(dst, r->data + r->offset, n);
+    r->offset += n;
+    return true;
+}
+
+static bool in_range(int32_t index, int count) {
+    return index >= 0 && index < count;
+}
+
+/* Scratch state of one restore, indexed like the snapshot records */
+typedef struct {
+    IdEntry **names;                /* Each holds one reference until the end */
+    int name_count;
+    int32_t *name_members;
+    CgroupRecord *cgroups;
+    int32_t *task_cgroup;           /* TaskRecord.cgroup_name */
+    int32_t *task_group_next;
+    int32_t *task_class;
+    TaskClass **classes;
+    int32_t *class_cgroup;
+    int32_t *class_next;
+    int *order;                     /* Scratch list of cgroup indices */
+    TaskClass **chain;              /* Scratch list of one cgroup's classes */
+} Restore;
+
+static void restore_release(Scheduler *sched, Restore *st) {
+    for (int i = 0; i < st->name_count; i++) {
+        idtable_release(sched->ids, st->names[i]);
+    }
+    free(st->names);
+    free(st->name_members);
+    free(st->cgroups);
+    free(st->task_cgroup);
+    free(st->task_group_next);
+    free(st->task_class);
+    free(st->classes);
+    free(st->class_cgroup);
+    free(st->class_next);
+    free(st->order);
+    free(st->chain);
+}
+
+static int restore_names(Scheduler *sched, SnapshotReader *r, const SnapshotHeader *h,
+                         Restore *st) {
+    char *buffer = NULL;
+    size_t buffer_size = 0;
+    int rc = 0;
+    for (int i = 0; i < h->name_count && rc == 0; i++) {
+        NameRecord rec;
+        if (!take(r, &rec, sizeof(rec)) || rec.length == 0 || rec.length > r->length - r->offset ||
+            (rec.members != -1 && !in_range(rec.members, h->task_count))) {
+            rc = -1;
+            break;
+        }
+        if (rec.length + 1 > buffer_size) {
+            char *grown = realloc(buffer, rec.length + 1);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            buffer = grown;
+            buffer_size = rec.length + 1;
+        }
+        take(r, buffer, rec.length);
+        buffer[rec.length] = '\0';
+
+        IdEntry *entry = idtable_acquire(sched->ids, buffer);
+        if (!entry || entry->len != rec.length || entry->refs != 1) {
+            if (entry) {
+                idtable_release(sched->ids, entry);
+            }
+            rc = -1;  /* Embedded NUL or a duplicate name */
+            break;
+        }
+        entry->handle = rec.handle;
+        st->names[st->name_count++] = entry;
+        st->name_members[i] = rec.members;
+    }
+    free(buffer);
+    return rc;
+}
+
+static int restore_cgroups(Scheduler *sched, SnapshotReader *r, const SnapshotHeader *h,
+                           Restore *st) {
+    for (int i = 0; i < h->cgroup_count; i++) {
+        CgroupRecord *rec = &st->cgroups[i];
+        if (!take(r, rec, sizeof(*rec)) || !in_range(rec->name, h->name_count) ||
+            (rec->parent != -1 && !in_range(rec->parent, h->cgroup_count)) ||
+            (rec->first_child != -1 && !in_range(rec->first_child, h->cgroup_count)) ||
+            (rec->next_sibling != -1 && !in_range(rec->next_sibling, h->cgroup_count)) ||
+            (rec->first_class != -1 && !in_range(rec->first_class, h->class_count))) {
+            return -1;
+        }
+        Cgroup *cgroup = cgroup_create_pooled(&sched->cgroup_pool, st->names[rec->name]->str,
+                                              rec->cpu_shares, rec->cpu_quota_us,
+                                              rec->cpu_period_us, NULL, 0);
+        if (!cgroup) {
+            return -1;
+        }
+        cgroup->requested_mask = rec->requested_mask;
+        cgroup->quota_used = rec->quota_used;
+        cgroup->throttled = rec->throttled != 0;
+        cgroup->throttle_count = cgroup->throttled ? 1 : 0;
+        cgroup->period_start_vtime = rec->period_start_vtime;
+        cgroup_inherit(cgroup);
+        if (scheduler_add_cgroup(sched, cgroup) < 0) {
+            cgroup_destroy(cgroup);
+            return -1;
+        }
+    }
+
+    /*
+     * Attach top-down so every parent's inherited values are final before
+     * its children copy them. Attaching prepends, so each child list is
+     * attached back to front to keep the sibling order.
+     */
+    int head = 0;
+    int tail = 0;
+    for (int i = 0; i < h->cgroup_count; i++) {
+        if (st->cgroups[i].parent == -1) {
+            st->order[tail++] = i;
+        }
+    }
+    while (head < tail) {
+        int parent = st->order[head++];
+        int first = tail;
+        for (int32_t child = st->cgroups[parent].first_child; child != -1;
+             child = st->cgroups[child].next_sibling) {
+            if (tail == h->cgroup_count || st->cgroups[child].parent != parent) {
+                return -1;
+            }
+            st->order[tail++] = child;
+        }
+        for (int k = tail - 1; k >= first; k--) {
+            if (cgroup_attach(sched->cgroups[st->order[k]], sched->cgroups[parent]) < 0) {
+                return -1;
+            }
+        }
+    }
+    return tail == h->cgroup_count ? 0 : -1;
+}
+
+static int restore_tasks(Scheduler *sched, SnapshotReader *r, const SnapshotHeader *h,
+                         Restore *st) {
+    for (int i = 0; i < h->task_count; i++) {
+        TaskRecord rec;
+        if (!take(r, &rec, sizeof(rec)) || !in_range(rec.name, h->name_count) ||
+            (rec.cgroup_name != -1 && !in_range(rec.cgroup_name, h->name_count)) ||
+            (rec.group_next != -1 && !in_range(rec.group_next, h->task_count)) ||
+            (rec.tclass != -1 && !in_range(rec.tclass, h->class_count)) ||
+            rec.state < TASK_STATE_RUNNABLE || rec.state > TASK_STATE_BLOCKED ||
+            rec.current_cpu < -1 || rec.current_cpu >= h->cpu_count ||
+            rec.home_cpu < -1 || rec.home_cpu >= h->cpu_count) {
+            return -1;
+        }
+        IdEntry *entry = st->names[rec.name];
+        if (entry->task) {
+            return -1;  /* Duplicate task ID */
+        }
+        Task *task = task_create_pooled(&sched->task_pools, entry->str, rec.nice, NULL);
+        if (!task) {
+            return -1;
+        }
+        task->affinity = rec.affinity;
+        task->allowed = rec.allowed;
+        task->vruntime = rec.vruntime;
+        task->deadline = rec.deadline;
+        task->vlag = rec.vlag;
+        task->inv_weight = rec.inv_weight;
+        task->seq = rec.seq;
+        task->util_sum = rec.util_sum;
+        task->state = (TaskState)rec.state;
+        task->weight = rec.weight;
+        task->current_cpu = rec.current_cpu;
+        task->home_cpu = rec.home_cpu;
+        task->burst_remaining = rec.burst_remaining;
+        task->is_burst = rec.is_burst != 0;
+        task->avg_weight = rec.avg_weight;
+        task->wake_tick = rec.wake_tick;
+        task->util_avg = rec.util_avg;
+        task->util_tick = rec.util_tick;
+        task->cgroup_id = "";
+
+        idtable_retain(entry);
+        entry->task = task;
+        task->id_entry = entry;
+        task->task_id = entry->str;
+        task->task_index = i;
+        sched->all_tasks[i] = task;
+        sched->task_states[i] = (uint8_t)task->state;
+        sched->task_entries[i] = entry;
+        sched->task_reported[i] = 0;     /* Not reported to a delta peer yet */
+        sched->task_count++;
+        sched->list_epoch++;
+
+        st->task_cgroup[i] = rec.cgroup_name;
+        st->task_group_next[i] = rec.group_next;
+        st->task_class[i] = rec.tclass;
+    }
+
+    /* Rebuild the membership lists in their saved order */
+    int linked = 0;
+    int members = 0;
+    for (int n = 0; n < st->name_count; n++) {
+        IdEntry *entry = st->names[n];
+        Task *prev = NULL;
+        for (int32_t t = st->name_members[n]; t != -1; t = st->task_group_next[t]) {
+            Task *task = sched->all_tasks[t];
+            if (st->task_cgroup[t] != n || task->cgroup_entry) {
+                return -1;
+            }
+            idtable_retain(entry);
+            task->cgroup_entry = entry;
+            task->cgroup_id = entry->str;
+            task->cgroup = entry->cgroup;
+            task->group_prev = prev;
+            if (prev) {
+                prev->group_next = task;
+            } else {
+                entry->members = task;
+            }
+            prev = task;
+            linked++;
+        }
+    }
+    for (int i = 0; i < h->task_count; i++) {
+        members += st->task_cgroup[i] != -1;
+    }
+    return linked == members ? 0 : -1;
+}
+
+static int restore_classes(Scheduler *sched, SnapshotReader *r, const SnapshotHeader *h,
+                           const RunQueueRecord *rqs, Restore *st) {
+    int g = 0;
+    for (int slot = 0; slot <= h->cpu_count; slot++) {
+        RunQueue *rq = slot == 0 ? &sched->runqueue : &sched->cpu_queues[slot - 1].rq;
+        for (int i = 0; i < rqs[slot].class_count; i++, g++) {
+            ClassRecord rec;
+            if (g >= h->class_count || !take(r, &rec, sizeof(rec)) ||
+                (rec.cgroup != -1 && !in_range(rec.cgroup, h->cgroup_count)) ||
+                (rec.cgroup_next != -1 && !in_range(rec.cgroup_next, h->class_count)) ||
+                rec.queued < 0 || rec.queued > h->task_count) {
+                return -1;
+            }
+            Cgroup *cgroup = rec.cgroup == -1 ? NULL : sched->cgroups[rec.cgroup];
+            TaskClass *tclass = runqueue_restore_class(rq, &rec.mask, cgroup, rec.parked != 0);
+            if (!tclass) {
+                return -1;
+            }
+            st->classes[g] = tclass;
+            st->class_cgroup[g] = rec.cgroup;
+            st->class_next[g] = rec.cgroup_next;
+
+            for (int k = 0; k < rec.queued; k++) {
+                int32_t t;
+                if (!take(r, &t, sizeof(t)) || !in_range(t, h->task_count) ||
+                    st->task_class[t] != g ||
+                    sched->all_tasks[t]->state != TASK_STATE_RUNNABLE ||
+                    runqueue_restore_task(sched->all_tasks[t], tclass, true) < 0) {
+                    return -1;
+                }
+            }
+        }
+        if (rq->active_count != rqs[slot].active_count) {
+            return -1;
+        }
+        rq->min_vruntime = rqs[slot].min_vruntime;
+        rq->avg_sum = rqs[slot].avg_sum;
+    }
+    if (g != h->class_count) {
+        return -1;
+    }
+
+    /* Running tasks stay bound to their class without being queued */
+    for (int i = 0; i < h->task_count; i++) {
+        Task *task = sched->all_tasks[i];
+        if (st->task_class[i] != -1 && !task->tclass &&
+            runqueue_restore_task(task, st->classes[st->task_class[i]], false) < 0) {
+            return -1;
+        }
+    }
+
+    int linked = 0;
+    int grouped = 0;
+    for (int c = 0; c < h->cgroup_count; c++) {
+        int count = 0;
+        for (int32_t k = st->cgroups[c].first_class; k != -1; k = st->class_next[k]) {
+            if (count == h->class_count || st->class_cgroup[k] != c) {
+                return -1;
+            }
+            st->chain[count++] = st->classes[k];
+        }
+        runqueue_restore_cgroup_classes(sched->cgroups[c], st->chain, count);
+        linked += count;
+    }
+    for (int k = 0; k < h->class_count; k++) {
+        if (st->classes[k]->refs == 0) {
+            return -1;
+        }
+        grouped += st->class_cgroup[k] != -1;
+    }
+    return linked == grouped ? 0 : -1;
+}
+
+static int restore(Scheduler *sched, const unsigned char *data, size_t length) {
+    SnapshotReader r = { data, length, 0 };
+    SnapshotHeader h;
+    if (!take(&r, &h, sizeof(h)) || memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) != 0 ||
+        h.version != SNAPSHOT_VERSION || h.flags != SNAPSHOT_FLAGS || h.size != length ||
+        h.checksum != snapshot_checksum(data + sizeof(h), length - sizeof(h))) {
+        return -1;
+    }
+    if (h.cpu_count != sched->cpu_count || h.quanta != sched->quanta ||
+        h.policy != (int32_t)sched->policy || h.per_cpu_queues != sched->per_cpu_queues ||
+        h.backend != (int32_t)sched->runqueue.backend || h.name_count < 0 ||
+        h.cgroup_count < 0 || h.task_count < 0 || h.class_count < 0) {
+        return -1;
+    }
+
+    CpuRecord *cpus = malloc(sizeof(CpuRecord) * (size_t)h.cpu_count);
+    RunQueueRecord *rqs = malloc(sizeof(RunQueueRecord) * (size_t)(h.cpu_count + 1));
+    Restore st;
+    memset(&st, 0, sizeof(st));
+    int rc = -1;
+    if (!cpus || !rqs) {
+        goto out;
+    }
+    for (int cpu = 0; cpu < h.cpu_count; cpu++) {
+        if (!take(&r, &cpus[cpu], sizeof(cpus[cpu])) ||
+            cpus[cpu].capacity != sched->cpu_queues[cpu].capacity ||
+            (cpus[cpu].current_task != -1 && !in_range(cpus[cpu].current_task, h.task_count))) {
+            goto out;
+        }
+    }
+    for (int slot = 0; slot <= h.cpu_count; slot++) {
+        if (!take(&r, &rqs[slot], sizeof(rqs[slot])) || rqs[slot].class_count < 0) {
+            goto out;
+        }
+    }
+
+    /* Every count is covered by the file size, so the scratch space is bounded by it */
+    size_t names = (size_t)h.name_count + 1;
+    size_t cgroups = (size_t)h.cgroup_count + 1;
+    size_t tasks = (size_t)h.task_count + 1;
+    size_t classes = (size_t)h.class_count + 1;
+    if (names > length || cgroups > length || tasks > length || classes > length) {
+        goto out;
+    }
+    st.names = malloc(sizeof(IdEntry *) * names);
+    st.name_members = malloc(sizeof(int32_t) * names);
+    st.cgroups = malloc(sizeof(CgroupRecord) * cgroups);
+    st.order = malloc(sizeof(int) * cgroups);
+    st.task_cgroup = malloc(sizeof(int32_t) * tasks);
+    st.task_group_next = malloc(sizeof(int32_t) * tasks);
+    st.task_class = malloc(sizeof(int32_t) * tasks);
+    st.classes = malloc(sizeof(TaskClass *) * classes);
+    st.class_cgroup = malloc(sizeof(int32_t) * classes);
+    st.class_next = malloc(sizeof(int32_t) * classes);
+    st.chain = malloc(sizeof(TaskClass *) * classes);
+    if (!st.names || !st.name_members || !st.cgroups || !st.order || !st.task_cgroup ||
+        !st.task_group_next || !st.task_class || !st.classes || !st.class_cgroup ||
+        !st.class_next || !st.chain || scheduler_reserve(sched, h.task_count) < 0) {
+        goto out;
+    }
+
+    timer_wheel_init(&sched->period_wheel, h.wheel_now);
+    if (restore_names(sched, &r, &h, &st) < 0 ||
+        restore_cgroups(sched, &r, &h, &st) < 0 ||
+        restore_tasks(sched, &r, &h, &st) < 0 ||
+        restore_classes(sched, &r, &h, rqs, &st) < 0 ||
+        r.offset != r.length) {
+        goto out;
+    }
+
+    for (int cpu = 0; cpu < h.cpu_count; cpu++) {
+        Task *task = cpus[cpu].current_task == -1 ? NULL : sched->all_tasks[cpus[cpu].current_task];
+        if (task && (task->state != TASK_STATE_RUNNING || task->current_cpu != cpu)) {
+            goto out;
+        }
+        sched->cpu_queues[cpu].current_task = task;
+    }
+    sched->next_task_seq = h.next_task_seq;
+    sched->max_vruntime = h.max_vruntime;
+    sched->max_vruntime_stale = h.max_vruntime_stale != 0;
+    sched->tick_count = h.tick_count;
+    sched->current_vtime = h.current_vtime;
+    sched->throttles = h.throttles;
+    sched->unthrottles = h.unthrottles;
+    rc = 0;
+
+out:
+    restore_release(sched, &st);
+    free(cpus);
+    free(rqs);
+#ifdef DEBUG
+    if (rc == 0) {
+        rc = scheduler_validate(sched);
+    }
+#endif
+    return rc;
+}
+
+int checkpoint_load(Scheduler *sched, const char *path) {
+    if (!sched || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(SnapshotHeader) ||
+        sched->task_count != 0 || sched->cgroup_count != 0) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    size_t length = (size_t)st.st_size;
+    void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    int rc = restore(sched, map, length);
+    munmap(map, length);
+    if (rc < 0) {
+        errno = EINVAL;
+    }
+    return rc;
+}
+
+/* ============================================================================
+ * Background Writer
+ * ============================================================================ */
+
+static volatile sig_atomic_t checkpoint_requested;
+
+void checkpoint_request(void) {
+    checkpoint_requested = 1;
+}
+
+Checkpointer *checkpoint_create(const char *path, int interval) {
+    if (!path || interval < 0) {
+        return NULL;
+    }
+
+    Checkpointer *cp = calloc(1, sizeof(Checkpointer));
+    if (!cp) {
+        return NULL;
+    }
+    cp->path = malloc(strlen(path) + 1);
+    if (!cp->path) {
+        free(cp);
+        return NULL;
+    }
+    strcpy(cp->path, path);
+    cp->interval = interval;
+    return cp;
+}
+
+static void reap_writer(Checkpointer *cp, bool wait) {
+    if (!cp->writer) {
+        return;
+    }
+
+    int status = 0;
+    pid_t pid;
+    do {
+        pid = waitpid(cp->writer, &status, wait ? 0 : WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+    if (pid == 0) {
+        return;  /* Still writing */
+    }
+    if (pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        cp->written++;
+    } else {
+        cp->failed++;
+        fprintf(stderr, "Warning: failed to write checkpoint %s\n", cp->path);
+    }
+    cp->writer = 0;
+}
+
+void checkpoint_destroy(Checkpointer *cp) {
+    if (!cp) {
+        return;
+    }
+    reap_writer(cp, true);
+    free(cp->path);
+    free(cp);
+}
+
+void checkpoint_poll(Checkpointer *cp, const Scheduler *sched) {
+    if (!cp) {
+        return;
+    }
+
+    cp->frames++;
+    reap_writer(cp, false);
+    bool due = checkpoint_requested || (cp->interval > 0 && cp->frames >= cp->interval);
+    if (!due || cp->writer) {
+        return;
+    }
+
+    /* The child only touches its copy of the scheduler and leaves with _exit,
+     * so buffered output is never flushed twice */
+    pid_t pid = fork();
+    if (pid == 0) {
+        _exit(checkpoint_save(sched, cp->path) == 0 ? 0 : 1);
+    }
+    if (pid < 0) {
+        cp->failed++;
+        fprintf(stderr, "Warning: cannot fork checkpoint writer: %s\n", strerror(errno));
+        return;
+    }
+    checkpoint_requested = 0;
+    cp->frames = 0;
+    cp->writer = pid;
+}
+
+int checkpoint_flush(Checkpointer *cp, const Scheduler *sched) {
+    if (!cp) {
+        return 0;
+    }
+
+    reap_writer(cp, true);
+    checkpoint_requested = 0;
+    cp->frames = 0;
+    if (checkpoint_save(sched, cp->path) < 0) {
+        cp->failed++;
+        return -1;
+    }
+    cp->written++;
+    return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * ALFS - Wire Codec Implementation
+ *
+ * JSON wraps the streaming parser and the direct-write serializer;
+ * binary lives in binary_codec.c.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "codec.h"
+#include "binary_codec.h"
+#include "json_handler.h"
+#include "uds.h"
+
+/* ============================================================================
+ * JSON Codec
+ * ============================================================================ */
+
+/* Received messages are NUL-terminated, which the parser relies on */
+static int json_decode(Codec *codec, const char *message, size_t length, TimeFrame *tf) {
+    (void)codec;
+    (void)length;
+    return json_parse_timeframe_into(message, tf);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+Codec *codec_create(WireProtocol protocol) {
+    Codec *codec = calloc(1, sizeof(Codec));
+    if (!codec) {
+        return NULL;
+    }
+
+    codec->protocol = protocol;
+    if (protocol == WIRE_BINARY) {
+        codec->name = "binary";
+        codec->greet = binary_send_hello;
+        codec->check_greeting = binary_check_hello;
+        codec->decode = binary_decode_timeframe;
+        codec->encode = binary_encode_tick;
+    } else {
+        codec->name = "json";
+        codec->greet = NULL;
+        codec->check_greeting = NULL;
+        codec->decode = json_decode;
+        codec->encode = json_serialize_tick_into;
+    }
+
+    return codec;
+}
+
+void codec_destroy(Codec *codec) {
+    if (codec) {
+        binary_handles_clear(&codec->handles);
+        free(codec);
+    }
+}
+
+int codec_parse_protocol(const char *name, WireProtocol *protocol) {
+    if (!name || !protocol) {
+        return -1;
+    }
+
+    if (strcmp(name, "json") == 0) {
+        *protocol = WIRE_JSON;
+    } else if (strcmp(name, "binary") == 0) {
+        *protocol = WIRE_BINARY;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+UdsFraming codec_framing(WireProtocol protocol, UdsFraming requested) {
+    return protocol == WIRE_BINARY ? UDS_FRAME_LENGTH : requested;
+}
+
+int codec_handshake(Codec *codec, UdsConn *conn, int cpu_count) {
+    int greeted = codec_greet(codec, conn, cpu_count);
+    if (greeted <= 0) {
+        return greeted;
+    }
+
+    size_t length = 0;
+    const char *reply = uds_conn_receive(conn, &length);
+    return codec_check_greeting(codec, reply, length);
+}
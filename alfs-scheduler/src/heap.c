@@ -7,6 +7,10 @@
  * - O(1) peek
  * - O(log n) update (using heap_index)
  * - O(log n) remove (using heap_index)
+ *
+ * The arity is 2, 4 or 8, so index arithmetic stays shifts. A 4- or 8-ary
+ * heap is half or a third as deep, and a node's children sit in one or
+ * two cache lines of the task array.
  */
 
 #include <stdlib.h>
@@ -17,9 +21,8 @@
  * Helper Functions
  * ============================================================================ */
 
-static inline int parent(int i) { return (i - 1) / 2; }
-static inline int left_child(int i) { return 2 * i + 1; }
-static inline int right_child(int i) { return 2 * i + 2; }
+static inline int parent(const MinHeap *heap, int i) { return (i - 1) >> heap->shift; }
+static inline int first_child(const MinHeap *heap, int i) { return (i << heap->shift) + 1; }
 
 /**
  * Swap two tasks in the heap and update their indices
@@ -37,9 +40,9 @@ static void heap_swap(MinHeap *heap, int i, int j) {
  * Bubble up a task to maintain heap property
  */
 static void heap_bubble_up(MinHeap *heap, int idx) {
-    while (idx > 0 && heap->tasks[parent(idx)]->vruntime > heap->tasks[idx]->vruntime) {
-        heap_swap(heap, idx, parent(idx));
-        idx = parent(idx);
+    while (idx > 0 && task_before(heap->tasks[idx], heap->tasks[parent(heap, idx)])) {
+        heap_swap(heap, idx, parent(heap, idx));
+        idx = parent(heap, idx);
     }
 }
 
@@ -47,21 +50,23 @@ static void heap_bubble_up(MinHeap *heap, int idx) {
  * Bubble down a task to maintain heap property
  */
 static void heap_bubble_down(MinHeap *heap, int idx) {
-    int min_idx = idx;
-    int left = left_child(idx);
-    int right = right_child(idx);
-    
-    if (left < heap->size && heap->tasks[left]->vruntime < heap->tasks[min_idx]->vruntime) {
-        min_idx = left;
-    }
-    
-    if (right < heap->size && heap->tasks[right]->vruntime < heap->tasks[min_idx]->vruntime) {
-        min_idx = right;
-    }
-    
-    if (min_idx != idx) {
+    int arity = 1 << heap->shift;
+    for (;;) {
+        int min_idx = idx;
+        int child = first_child(heap, idx);
+        int end = child + arity < heap->size ? child + arity : heap->size;
+        
+        for (; child < end; child++) {
+            if (task_before(heap->tasks[child], heap->tasks[min_idx])) {
+                min_idx = child;
+            }
+        }
+        
+        if (min_idx == idx) {
+            return;
+        }
         heap_swap(heap, idx, min_idx);
-        heap_bubble_down(heap, min_idx);
+        idx = min_idx;
     }
 }
 
@@ -85,27 +90,50 @@ static int heap_ensure_capacity(MinHeap *heap) {
  * Public Functions
  * ============================================================================ */
 
+int heap_init(MinHeap *heap, int capacity, int arity) {
+    int shift = arity == 2 ? 1 : arity == 4 ? 2 : arity == 8 ? 3 : 0;
+    if (!heap || capacity < 1 || shift == 0) {
+        return -1;
+    }
+    
+    heap->tasks = malloc(sizeof(Task *) * capacity);
+    if (!heap->tasks) {
+        return -1;
+    }
+    
+    heap->size = 0;
+    heap->capacity = capacity;
+    heap->shift = shift;
+    
+    return 0;
+}
+
+void heap_release(MinHeap *heap) {
+    if (heap) {
+        free(heap->tasks);
+        heap->tasks = NULL;
+        heap->size = 0;
+        heap->capacity = 0;
+    }
+}
+
 MinHeap *heap_create(int capacity) {
     MinHeap *heap = malloc(sizeof(MinHeap));
     if (!heap) {
         return NULL;
     }
     
-    heap->tasks = malloc(sizeof(Task *) * capacity);
-    if (!heap->tasks) {
+    if (heap_init(heap, capacity, 2) < 0) {
         free(heap);
         return NULL;
     }
     
-    heap->size = 0;
-    heap->capacity = capacity;
-    
     return heap;
 }
 
 void heap_destroy(MinHeap *heap) {
     if (heap) {
-        free(heap->tasks);
+        heap_release(heap);
         free(heap);
     }
 }
@@ -165,7 +193,7 @@ void heap_update(MinHeap *heap, Task *task) {
     int idx = task->heap_index;
     
     /* Try bubbling up first, then down */
-    if (idx > 0 && heap->tasks[parent(idx)]->vruntime > task->vruntime) {
+    if (idx > 0 && task_before(task, heap->tasks[parent(heap, idx)])) {
         heap_bubble_up(heap, idx);
     } else {
         heap_bubble_down(heap, idx);
@@ -187,7 +215,7 @@ int heap_remove(MinHeap *heap, Task *task) {
         heap->tasks[idx]->heap_index = idx;
         
         /* Restore heap property */
-        if (idx > 0 && heap->tasks[parent(idx)]->vruntime > heap->tasks[idx]->vruntime) {
+        if (idx > 0 && task_before(heap->tasks[idx], heap->tasks[parent(heap, idx)])) {
             heap_bubble_up(heap, idx);
         } else {
             heap_bubble_down(heap, idx);
@@ -205,6 +233,23 @@ int heap_size(MinHeap *heap) {
     return heap ? heap->size : 0;
 }
 
+int heap_validate(const MinHeap *heap) {
+    if (!heap || heap->size < 0 || heap->size > heap->capacity) {
+        return -1;
+    }
+    
+    for (int i = 0; i < heap->size; i++) {
+        if (!heap->tasks[i] || heap->tasks[i]->heap_index != i) {
+            return -1;
+        }
+        if (i > 0 && task_before(heap->tasks[i], heap->tasks[parent(heap, i)])) {
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
 Task *heap_find(MinHeap *heap, const char *task_id) {
     if (!heap || !task_id) {
         return NULL;
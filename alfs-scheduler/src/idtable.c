@@ -0,0 +1,220 @@
+/**
+ * ALFS - Interned ID Table Implementation
+ *
+ * Linear-probing hash table keyed by ID string:
+ * - O(1) average lookup, intern and release
+ * - Full 32-bit hash stored per slot, so strcmp only runs on real matches
+ * - Backward-shift deletion (no tombstones, probe chains stay short)
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "idtable.h"
+#include "json_handler.h"
+
+#define IDTABLE_MIN_CAPACITY 64
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+/**
+ * FNV-1a hash of a NUL-terminated string
+ */
+static uint32_t id_hash(const char *id, size_t *out_len) {
+    uint32_t hash = 2166136261u;
+    const unsigned char *p = (const unsigned char *)id;
+    while (*p) {
+        hash ^= *p++;
+        hash *= 16777619u;
+    }
+    *out_len = (size_t)(p - (const unsigned char *)id);
+    return hash;
+}
+
+/**
+ * Find the slot holding an ID, or the empty slot where it would go
+ */
+static uint32_t idtable_probe(const IdTable *table, const char *id,
+                              uint32_t hash, size_t len) {
+    uint32_t idx = hash & table->mask;
+    while (table->slots[idx].entry) {
+        const IdSlot *slot = &table->slots[idx];
+        if (slot->hash == hash && slot->entry->len == len &&
+            memcmp(slot->entry->str, id, len) == 0) {
+            break;
+        }
+        idx = (idx + 1) & table->mask;
+    }
+    return idx;
+}
+
+/**
+ * Double the slot array once the load factor passes 1/2
+ */
+static int idtable_grow(IdTable *table) {
+    uint32_t old_capacity = table->mask + 1;
+    uint32_t new_capacity = old_capacity * 2;
+    IdSlot *new_slots = calloc(new_capacity, sizeof(IdSlot));
+    if (!new_slots) {
+        return -1;
+    }
+
+    IdSlot *old_slots = table->slots;
+    table->slots = new_slots;
+    table->mask = new_capacity - 1;
+
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_slots[i].entry) {
+            uint32_t idx = old_slots[i].hash & table->mask;
+            while (table->slots[idx].entry) {
+                idx = (idx + 1) & table->mask;
+            }
+            table->slots[idx] = old_slots[i];
+        }
+    }
+
+    free(old_slots);
+    return 0;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+IdTable *idtable_create(int capacity_hint) {
+    IdTable *table = malloc(sizeof(IdTable));
+    if (!table) {
+        return NULL;
+    }
+
+    uint32_t capacity = IDTABLE_MIN_CAPACITY;
+    while (capacity_hint > 0 && capacity < (uint32_t)capacity_hint * 2) {
+        capacity *= 2;
+    }
+
+    table->slots = calloc(capacity, sizeof(IdSlot));
+    if (!table->slots) {
+        free(table);
+        return NULL;
+    }
+
+    table->mask = capacity - 1;
+    table->count = 0;
+
+    return table;
+}
+
+void idtable_destroy(IdTable *table) {
+    if (!table) {
+        return;
+    }
+
+    for (uint32_t i = 0; i <= table->mask; i++) {
+        free(table->slots[i].entry);
+    }
+    free(table->slots);
+    free(table);
+}
+
+IdEntry *idtable_lookup(const IdTable *table, const char *id) {
+    if (!table || !id) {
+        return NULL;
+    }
+
+    size_t len;
+    uint32_t hash = id_hash(id, &len);
+    return table->slots[idtable_probe(table, id, hash, len)].entry;
+}
+
+IdEntry *idtable_acquire(IdTable *table, const char *id) {
+    if (!table || !id) {
+        return NULL;
+    }
+
+    size_t len;
+    uint32_t hash = id_hash(id, &len);
+    uint32_t idx = idtable_probe(table, id, hash, len);
+    if (table->slots[idx].entry) {
+        table->slots[idx].entry->refs++;
+        return table->slots[idx].entry;
+    }
+
+    if ((uint32_t)(table->count + 1) * 2 > table->mask + 1) {
+        if (idtable_grow(table) < 0) {
+            return NULL;
+        }
+        idx = idtable_probe(table, id, hash, len);
+    }
+
+    /* The output form is built once here, not on every tick */
+    size_t json_len = json_quote_string(id, NULL);
+    IdEntry *entry = calloc(1, sizeof(IdEntry) + len + 1 + json_len + 1);
+    if (!entry) {
+        return NULL;
+    }
+    entry->refs = 1;
+    entry->hash = hash;
+    entry->len = len;
+    memcpy(entry->str, id, len + 1);
+    json_quote_string(id, entry->str + len + 1);
+    entry->json = entry->str + len + 1;
+    entry->json_len = json_len;
+
+    table->slots[idx].hash = hash;
+    table->slots[idx].entry = entry;
+    table->count++;
+
+    return entry;
+}
+
+int idtable_reserve(IdTable *table, int count) {
+    if (!table) {
+        return -1;
+    }
+    while ((uint64_t)count * 2 > (uint64_t)table->mask + 1) {
+        if (idtable_grow(table) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void idtable_retain(IdEntry *entry) {
+    if (entry) {
+        entry->refs++;
+    }
+}
+
+void idtable_release(IdTable *table, IdEntry *entry) {
+    if (!table || !entry || --entry->refs > 0) {
+        return;
+    }
+
+    uint32_t idx = entry->hash & table->mask;
+    while (table->slots[idx].entry != entry) {
+        idx = (idx + 1) & table->mask;
+    }
+
+    /* Backward-shift following entries so probe chains have no holes */
+    uint32_t hole = idx;
+    uint32_t next = (hole + 1) & table->mask;
+    while (table->slots[next].entry) {
+        uint32_t home = table->slots[next].hash & table->mask;
+        /* Move if the hole lies cyclically within [home, next) */
+        if (((next - home) & table->mask) >= ((next - hole) & table->mask)) {
+            table->slots[hole] = table->slots[next];
+            hole = next;
+        }
+        next = (next + 1) & table->mask;
+    }
+    table->slots[hole].entry = NULL;
+    table->slots[hole].hash = 0;
+    table->count--;
+
+    free(entry);
+}
+
+int idtable_count(const IdTable *table) {
+    return table ? table->count : 0;
+}
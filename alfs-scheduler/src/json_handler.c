@@ -1,6 +1,6 @@
 /**
  * ALFS - JSON Handler Implementation
- * Uses cJSON library for JSON parsing and generation
+ * Streaming TimeFrame parser and direct-write tick serializer
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -8,8 +8,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 #include "json_handler.h"
-#include "../lib/cJSON/cJSON.h"
 
 /* ============================================================================
  * Action String Mapping
@@ -34,18 +34,53 @@ static const struct {
     {NULL, 0}
 };
 
+/*
+ * Perfect hash of the action names: (len + s[5] + 7 * s[7]) % 16 is
+ * collision-free for the names above (all at least 9 characters long),
+ * so a lookup is one hash and one memcmp.
+ */
+#define ACTION_MIN_LEN 9
+#define ACTION_MAX_LEN 17
+
+static const struct {
+    const char *str;
+    size_t len;
+    EventAction action;
+} action_hash[16] = {
+    [0]  = {"TASK_SET_AFFINITY", 17, EVENT_TASK_SET_AFFINITY},
+    [1]  = {"TASK_CREATE", 11, EVENT_TASK_CREATE},
+    [2]  = {"CGROUP_CREATE", 13, EVENT_CGROUP_CREATE},
+    [3]  = {"CPU_BURST", 9, EVENT_CPU_BURST},
+    [5]  = {"TASK_BLOCK", 10, EVENT_TASK_BLOCK},
+    [6]  = {"TASK_YIELD", 10, EVENT_TASK_YIELD},
+    [7]  = {"TASK_MOVE_CGROUP", 16, EVENT_TASK_MOVE_CGROUP},
+    [8]  = {"CGROUP_MODIFY", 13, EVENT_CGROUP_MODIFY},
+    [9]  = {"CGROUP_DELETE", 13, EVENT_CGROUP_DELETE},
+    [11] = {"TASK_SETNICE", 12, EVENT_TASK_SETNICE},
+    [13] = {"TASK_EXIT", 9, EVENT_TASK_EXIT},
+    [15] = {"TASK_UNBLOCK", 12, EVENT_TASK_UNBLOCK},
+};
+
+/**
+ * Map an action name of known length to its enum
+ */
+static EventAction lookup_action(const char *str, size_t len) {
+    if (len < ACTION_MIN_LEN || len > ACTION_MAX_LEN) {
+        return EVENT_INVALID;
+    }
+    unsigned h = ((unsigned)len + (unsigned char)str[5] + 7u * (unsigned char)str[7]) & 15u;
+    if (action_hash[h].len == len && memcmp(action_hash[h].str, str, len) == 0) {
+        return action_hash[h].action;
+    }
+    return EVENT_INVALID;
+}
+
 EventAction json_parse_action(const char *action_str) {
     if (!action_str) {
         return EVENT_INVALID;
     }
     
-    for (int i = 0; action_map[i].str != NULL; i++) {
-        if (strcmp(action_str, action_map[i].str) == 0) {
-            return action_map[i].action;
-        }
-    }
-    
-    return EVENT_INVALID;
+    return lookup_action(action_str, strlen(action_str));
 }
 
 const char *json_action_to_string(EventAction action) {
@@ -58,264 +93,1214 @@ const char *json_action_to_string(EventAction action) {
 }
 
 /* ============================================================================
- * Helper Functions
+ * Key Name Mapping
  * ============================================================================ */
 
+typedef enum {
+    KEY_UNKNOWN = -1,
+    KEY_VTIME,
+    KEY_EVENTS,
+    KEY_ACTION,
+    KEY_TASK_ID,
+    KEY_CGROUP_ID,
+    KEY_NEW_CGROUP_ID,
+    KEY_PARENT_ID,
+    KEY_NICE,
+    KEY_NEW_NICE,
+    KEY_CPU_MASK,
+    KEY_CPU_SHARES,
+    KEY_CPU_QUOTA,
+    KEY_CPU_PERIOD,
+    KEY_DURATION
+} JsonKey;
+
+/*
+ * Perfect hash of the lowercased key names: (s[3] + 3 * s[len - 1]) % 32.
+ * Keys match case-insensitively, as cJSON_GetObjectItem does.
+ */
+#define KEY_MIN_LEN 4
+#define KEY_MAX_LEN 11
+
+static const struct {
+    const char *str;
+    size_t len;
+    JsonKey key;
+} key_hash[32] = {
+    [7]  = {"events", 6, KEY_EVENTS},
+    [9]  = {"cpuperiodus", 11, KEY_CPU_PERIOD},
+    [10] = {"cpuquotaus", 10, KEY_CPU_QUOTA},
+    [11] = {"duration", 8, KEY_DURATION},
+    [12] = {"cpushares", 9, KEY_CPU_SHARES},
+    [14] = {"cpumask", 7, KEY_CPU_MASK},
+    [15] = {"newcgroupid", 11, KEY_NEW_CGROUP_ID},
+    [17] = {"parentid", 8, KEY_PARENT_ID},
+    [19] = {"action", 6, KEY_ACTION},
+    [20] = {"nice", 4, KEY_NICE},
+    [23] = {"taskid", 6, KEY_TASK_ID},
+    [27] = {"cgroupid", 8, KEY_CGROUP_ID},
+    [28] = {"vtime", 5, KEY_VTIME},
+    [29] = {"newnice", 7, KEY_NEW_NICE},
+};
+
+static inline unsigned char ascii_lower(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c | 0x20) : c;
+}
+
 /**
- * Parse an integer array from cJSON array
+ * Map a decoded key name to its JsonKey
  */
-static int *parse_int_array(cJSON *array, int *out_count) {
-    if (!array || !cJSON_IsArray(array)) {
-        *out_count = 0;
-        return NULL;
+static JsonKey lookup_key(const char *str, size_t len) {
+    if (len < KEY_MIN_LEN || len > KEY_MAX_LEN) {
+        return KEY_UNKNOWN;
     }
-    
-    int count = cJSON_GetArraySize(array);
-    if (count == 0) {
-        *out_count = 0;
-        return NULL;
+    const unsigned char *s = (const unsigned char *)str;
+    unsigned h = (ascii_lower(s[3]) + 3u * ascii_lower(s[len - 1])) & 31u;
+    if (key_hash[h].len != len) {
+        return KEY_UNKNOWN;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (ascii_lower(s[i]) != (unsigned char)key_hash[h].str[i]) {
+            return KEY_UNKNOWN;
+        }
+    }
+    return key_hash[h].key;
+}
+
+/* ============================================================================
+ * Streaming Reader
+ *
+ * One pass over the NUL-terminated input, no DOM. It accepts exactly what
+ * cJSON_Parse accepts and reads fields with cJSON's lookup rules:
+ * - keys match case-insensitively and the first matching member wins
+ * - numbers become ints with cJSON's valueint saturation
+ * - strings are unescaped like cJSON (including its \u handling) and
+ *   stored like strncpy(dst, value, size - 1)
+ * - text after the root value is ignored
+ * ============================================================================ */
+
+#define JSON_NESTING_LIMIT 1000     /* CJSON_NESTING_LIMIT */
+#define JSON_KEY_BUF 16             /* Longer keys never match */
+#define JSON_ACTION_BUF 32          /* Longer actions never match */
+
+typedef struct {
+    const unsigned char *p;
+    const unsigned char *start;
+    int depth;
+} JsonReader;
+
+/* Bytes 1..32 are whitespace to cJSON */
+static inline void skip_ws(JsonReader *r) {
+    while (*r->p != '\0' && *r->p <= 32) {
+        r->p++;
+    }
+}
+
+static inline bool is_number_start(unsigned char c) {
+    return c == '-' || (c >= '0' && c <= '9');
+}
+
+static inline bool is_number_char(unsigned char c) {
+    return (c >= '0' && c <= '9') || c == '+' || c == '-' || c == 'e' || c == 'E' || c == '.';
+}
+
+/**
+ * Parse 4 hex digits; any invalid digit yields 0 (cJSON's parse_hex4)
+ */
+static unsigned parse_hex4(const unsigned char *s) {
+    unsigned h = 0;
+    for (int i = 0; i < 4; i++) {
+        unsigned char c = s[i];
+        h <<= 4;
+        if (c >= '0' && c <= '9') {
+            h |= (unsigned)(c - '0');
+        } else if (c >= 'A' && c <= 'F') {
+            h |= (unsigned)(c - 'A' + 10);
+        } else if (c >= 'a' && c <= 'f') {
+            h |= (unsigned)(c - 'a' + 10);
+        } else {
+            return 0;
+        }
+    }
+    return h;
+}
+
+/**
+ * Output of a string decode: bytes up to the first NUL are kept (a C
+ * string view), at most cap - 1 of them are stored
+ */
+typedef struct {
+    char *out;
+    size_t cap;
+    size_t len;                     /* C-string length, may exceed cap - 1 */
+    bool terminated;                /* A decoded NUL ended the C string */
+} StringSink;
+
+static inline void sink_put(StringSink *sink, unsigned char c) {
+    if (sink->terminated) {
+        return;
+    }
+    if (c == '\0') {
+        sink->terminated = true;
+        return;
+    }
+    if (sink->len + 1 < sink->cap) {
+        sink->out[sink->len] = (char)c;
+    }
+    sink->len++;
+}
+
+/**
+ * Decode a \uXXXX (or surrogate pair) sequence at s, bounded by end
+ * @return Bytes consumed, 0 if invalid
+ */
+static int decode_utf16(const unsigned char *s, const unsigned char *end, StringSink *sink) {
+    if (end - s < 6) {
+        return 0;
+    }
+    unsigned long codepoint = parse_hex4(s + 2);
+    int consumed = 6;
+    if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+        return 0;
+    }
+    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+        const unsigned char *second = s + 6;
+        if (end - second < 6 || second[0] != '\\' || second[1] != 'u') {
+            return 0;
+        }
+        unsigned long low = parse_hex4(second + 2);
+        if (low < 0xDC00 || low > 0xDFFF) {
+            return 0;
+        }
+        codepoint = 0x10000 + (((codepoint & 0x3FF) << 10) | (low & 0x3FF));
+        consumed = 12;
     }
     
-    int *result = malloc(sizeof(int) * count);
-    if (!result) {
-        *out_count = 0;
-        return NULL;
+    if (codepoint < 0x80) {
+        sink_put(sink, (unsigned char)codepoint);
+    } else if (codepoint < 0x800) {
+        sink_put(sink, (unsigned char)(0xC0 | (codepoint >> 6)));
+        sink_put(sink, (unsigned char)(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        sink_put(sink, (unsigned char)(0xE0 | (codepoint >> 12)));
+        sink_put(sink, (unsigned char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        sink_put(sink, (unsigned char)(0x80 | (codepoint & 0x3F)));
+    } else {
+        sink_put(sink, (unsigned char)(0xF0 | (codepoint >> 18)));
+        sink_put(sink, (unsigned char)(0x80 | ((codepoint >> 12) & 0x3F)));
+        sink_put(sink, (unsigned char)(0x80 | ((codepoint >> 6) & 0x3F)));
+        sink_put(sink, (unsigned char)(0x80 | (codepoint & 0x3F)));
+    }
+    return consumed;
+}
+
+/**
+ * Find the end of the string literal at r->p and step past it
+ * The closing quote is the first one not preceded by a backslash.
+ * @return 1 if the literal has escapes, 0 if not, -1 if malformed
+ */
+static int scan_string(JsonReader *r, const unsigned char **begin, const unsigned char **end) {
+    if (*r->p != '"') {
+        return -1;
     }
     
-    int idx = 0;
-    cJSON *item;
-    cJSON_ArrayForEach(item, array) {
-        if (cJSON_IsNumber(item)) {
-            result[idx++] = item->valueint;
+    const unsigned char *s = r->p + 1;
+    int escaped = 0;
+    for (;;) {
+        while (*s != '"' && *s != '\\' && *s != '\0') {
+            s++;
+        }
+        if (*s == '"') {
+            break;
+        }
+        if (*s == '\0' || s[1] == '\0') {
+            return -1;
+        }
+        escaped = 1;
+        s += 2;
+    }
+    *begin = r->p + 1;
+    *end = s;
+    r->p = s + 1;
+    return escaped;
+}
+
+/**
+ * Decode a scanned string literal [begin, end) into out (cap bytes,
+ * NUL-terminated; cap 0 only validates)
+ * @return C-string length (never more than end - begin), -1 if malformed
+ */
+static long decode_string(const unsigned char *begin, const unsigned char *end, int escaped,
+                          char *out, size_t cap) {
+    /* Fast path: no escapes, the literal is the value */
+    if (!escaped) {
+        size_t len = (size_t)(end - begin);
+        if (cap > 0) {
+            size_t n = len < cap - 1 ? len : cap - 1;
+            memcpy(out, begin, n);
+            out[n] = '\0';
         }
+        return (long)len;
     }
     
-    *out_count = idx;
-    return result;
+    StringSink sink = {out, cap, 0, false};
+    const unsigned char *s = begin;
+    while (s < end) {
+        if (*s != '\\') {
+            sink_put(&sink, *s++);
+            continue;
+        }
+        int consumed = 2;
+        switch (s[1]) {
+            case 'b': sink_put(&sink, '\b'); break;
+            case 'f': sink_put(&sink, '\f'); break;
+            case 'n': sink_put(&sink, '\n'); break;
+            case 'r': sink_put(&sink, '\r'); break;
+            case 't': sink_put(&sink, '\t'); break;
+            case '"':
+            case '\\':
+            case '/':
+                sink_put(&sink, s[1]);
+                break;
+            case 'u':
+                consumed = decode_utf16(s, end, &sink);
+                if (consumed == 0) {
+                    return -1;
+                }
+                break;
+            default:
+                return -1;
+        }
+        s += consumed;
+    }
+    if (cap > 0) {
+        out[sink.len < cap - 1 ? sink.len : cap - 1] = '\0';
+    }
+    return (long)sink.len;
 }
 
 /**
- * Parse a single event from cJSON object
+ * Read the string at r->p into out (cap bytes, NUL-terminated; cap 0
+ * only validates) and return its C-string length, -1 if malformed
  */
-static Event *parse_event(cJSON *event_json) {
-    if (!event_json) {
-        return NULL;
+static long read_string(JsonReader *r, char *out, size_t cap) {
+    const unsigned char *begin;
+    const unsigned char *end;
+    int escaped = scan_string(r, &begin, &end);
+    if (escaped < 0) {
+        return -1;
+    }
+    return decode_string(begin, end, escaped, out, cap);
+}
+
+/**
+ * Read the number at r->p as cJSON's valueint
+ * cJSON takes the longest run of number characters and converts its
+ * valid prefix with strtod; plain short integers skip strtod.
+ */
+static int read_number(JsonReader *r, int *value) {
+    const unsigned char *s = r->p;
+    const unsigned char *q = s;
+    while (is_number_char(*q)) {
+        q++;
     }
+    size_t run = (size_t)(q - s);
     
-    Event *event = calloc(1, sizeof(Event));
-    if (!event) {
-        return NULL;
+    /* Fast path: -?[0-9]{1,9} cannot overflow an int */
+    const unsigned char *d = s + (*s == '-');
+    size_t digits = 0;
+    int magnitude = 0;
+    while (d + digits < q && d[digits] >= '0' && d[digits] <= '9' && digits < 9) {
+        magnitude = magnitude * 10 + (d[digits] - '0');
+        digits++;
+    }
+    if (digits > 0 && d + digits == q) {
+        *value = *s == '-' ? -magnitude : magnitude;
+        r->p = q;
+        return 0;
     }
     
-    /* Parse and validate action */
-    cJSON *action = cJSON_GetObjectItem(event_json, "action");
-    if (!action || !cJSON_IsString(action)) {
-        fprintf(stderr, "Invalid event: missing string field 'action'\n");
-        free(event);
-        return NULL;
+    char stack[64];
+    char *copy = run < sizeof(stack) ? stack : malloc(run + 1);
+    if (!copy) {
+        return -1;
     }
-    event->action = json_parse_action(action->valuestring);
-    if (event->action == EVENT_INVALID) {
-        fprintf(stderr, "Invalid event action: %s\n", action->valuestring);
-        free(event);
-        return NULL;
+    memcpy(copy, s, run);
+    copy[run] = '\0';
+    char *after = NULL;
+    double number = strtod(copy, &after);
+    size_t consumed = (size_t)(after - copy);
+    if (copy != stack) {
+        free(copy);
+    }
+    if (consumed == 0) {
+        return -1;
     }
     
-    /* Parse taskId */
-    cJSON *task_id = cJSON_GetObjectItem(event_json, "taskId");
-    if (task_id && cJSON_IsString(task_id)) {
-        strncpy(event->task_id, task_id->valuestring, MAX_TASK_ID_LEN - 1);
+    if (number >= INT_MAX) {
+        *value = INT_MAX;
+    } else if (number <= (double)INT_MIN) {
+        *value = INT_MIN;
+    } else {
+        *value = (int)number;
+    }
+    r->p = s + consumed;
+    return 0;
+}
+
+static int skip_value(JsonReader *r);
+
+/**
+ * Enter the object or array opened at r->p
+ * @return 1 if it has members, 0 if empty (and already closed), -1 on error
+ */
+static int container_open(JsonReader *r, unsigned char close) {
+    if (r->depth >= JSON_NESTING_LIMIT) {
+        return -1;
+    }
+    r->depth++;
+    r->p++;
+    skip_ws(r);
+    if (*r->p == close) {
+        r->p++;
+        r->depth--;
+        return 0;
+    }
+    return *r->p == '\0' ? -1 : 1;
+}
+
+/**
+ * Step past the separator after a member
+ * @return 1 if another member follows, 0 at the closing bracket, -1 on error
+ */
+static int container_next(JsonReader *r, unsigned char close) {
+    skip_ws(r);
+    if (*r->p == ',') {
+        r->p++;
+        skip_ws(r);
+        return 1;
+    }
+    if (*r->p == close) {
+        r->p++;
+        r->depth--;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Read a member name and its colon, leaving r->p at the value
+ * @return Matched key, KEY_UNKNOWN otherwise; -2 on error
+ */
+static int read_key(JsonReader *r) {
+    const unsigned char *at = r->p;
+    const unsigned char *begin;
+    const unsigned char *end;
+    int escaped = scan_string(r, &begin, &end);
+    if (escaped < 0) {
+        return -2;
     }
     
-    /* Parse cgroupId */
-    cJSON *cgroup_id = cJSON_GetObjectItem(event_json, "cgroupId");
-    if (cgroup_id && cJSON_IsString(cgroup_id)) {
-        strncpy(event->cgroup_id, cgroup_id->valuestring, MAX_CGROUP_ID_LEN - 1);
+    /* Plain names are matched in place; escaped ones are decoded first */
+    JsonKey key;
+    if (!escaped) {
+        key = lookup_key((const char *)begin, (size_t)(end - begin));
+    } else {
+        char name[JSON_KEY_BUF];
+        r->p = at;
+        long len = read_string(r, name, sizeof(name));
+        if (len < 0) {
+            return -2;
+        }
+        key = len < JSON_KEY_BUF ? lookup_key(name, (size_t)len) : KEY_UNKNOWN;
     }
     
-    /* Parse newCgroupId */
-    cJSON *new_cgroup_id = cJSON_GetObjectItem(event_json, "newCgroupId");
-    if (new_cgroup_id && cJSON_IsString(new_cgroup_id)) {
-        strncpy(event->new_cgroup_id, new_cgroup_id->valuestring, MAX_CGROUP_ID_LEN - 1);
+    skip_ws(r);
+    if (*r->p != ':') {
+        return -2;
+    }
+    r->p++;
+    skip_ws(r);
+    return (int)key;
+}
+
+/**
+ * Validate and skip any value
+ */
+static int skip_value(JsonReader *r) {
+    unsigned char c = *r->p;
+    if (c == 'n' && strncmp((const char *)r->p, "null", 4) == 0) {
+        r->p += 4;
+        return 0;
+    }
+    if (c == 'f' && strncmp((const char *)r->p, "false", 5) == 0) {
+        r->p += 5;
+        return 0;
+    }
+    if (c == 't' && strncmp((const char *)r->p, "true", 4) == 0) {
+        r->p += 4;
+        return 0;
+    }
+    if (c == '"') {
+        return read_string(r, NULL, 0) < 0 ? -1 : 0;
+    }
+    if (is_number_start(c)) {
+        int ignored;
+        return read_number(r, &ignored);
+    }
+    if (c == '[') {
+        int more = container_open(r, ']');
+        while (more > 0) {
+            if (skip_value(r) < 0) {
+                return -1;
+            }
+            more = container_next(r, ']');
+        }
+        return more;
+    }
+    if (c == '{') {
+        int more = container_open(r, '}');
+        while (more > 0) {
+            if (read_key(r) == -2 || skip_value(r) < 0) {
+                return -1;
+            }
+            more = container_next(r, '}');
+        }
+        return more;
+    }
+    return -1;
+}
+
+/**
+ * Read a number member value, or skip a value of any other type
+ * @return 1 if a number was read, 0 if skipped, -1 on error
+ */
+static int read_int_member(JsonReader *r, int *value) {
+    if (is_number_start(*r->p)) {
+        return read_number(r, value) < 0 ? -1 : 1;
+    }
+    return skip_value(r) < 0 ? -1 : 0;
+}
+
+/* ============================================================================
+ * TimeFrame Assembly
+ * ============================================================================ */
+
+static const char *rebase_id(const char *id, const char *old_text, char *new_text) {
+    return id ? new_text + (id - old_text) : NULL;
+}
+
+/**
+ * Make room for `length` more bytes in the TimeFrame's ID store
+ * Events (the one being filled included) point into the store, so a
+ * grown copy is rebased before the old one is freed.
+ */
+static int reserve_id_text(TimeFrame *tf, size_t length) {
+    size_t needed = tf->id_text_used + length;
+    if (needed <= tf->id_text_capacity) {
+        return 0;
     }
     
-    /* Parse nice */
-    cJSON *nice = cJSON_GetObjectItem(event_json, "nice");
-    if (nice && cJSON_IsNumber(nice)) {
-        event->nice = nice->valueint;
-        event->has_nice = true;
+    size_t capacity = tf->id_text_capacity ? tf->id_text_capacity * 2 : 1024;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    char *text = malloc(capacity);
+    if (!text) {
+        return -1;
+    }
+    if (tf->id_text_used > 0) {
+        memcpy(text, tf->id_text, tf->id_text_used);
+    }
+    for (int i = 0; i <= tf->event_count && i < tf->event_capacity; i++) {
+        Event *event = &tf->events[i];
+        event->task_id = rebase_id(event->task_id, tf->id_text, text);
+        event->cgroup_id = rebase_id(event->cgroup_id, tf->id_text, text);
+        event->new_cgroup_id = rebase_id(event->new_cgroup_id, tf->id_text, text);
+        event->parent_id = rebase_id(event->parent_id, tf->id_text, text);
+    }
+    free(tf->id_text);
+    tf->id_text = text;
+    tf->id_text_capacity = capacity;
+    return 0;
+}
+
+/**
+ * Read a string member value into the TimeFrame's ID store, or skip
+ * another type. A decoded ID is never longer than its literal, so the
+ * literal's size is all that has to be reserved.
+ */
+static int read_id_member(JsonReader *r, TimeFrame *tf, const char **out) {
+    if (*r->p != '"') {
+        return skip_value(r);
     }
     
-    /* Parse newNice */
-    cJSON *new_nice = cJSON_GetObjectItem(event_json, "newNice");
-    if (new_nice && cJSON_IsNumber(new_nice)) {
-        event->nice = new_nice->valueint;
-        event->has_nice = true;
+    const unsigned char *begin;
+    const unsigned char *end;
+    int escaped = scan_string(r, &begin, &end);
+    size_t span = (size_t)(end - begin);
+    if (escaped < 0 || reserve_id_text(tf, span + 1) < 0) {
+        return -1;
+    }
+    char *text = tf->id_text + tf->id_text_used;
+    long length = decode_string(begin, end, escaped, text, span + 1);
+    if (length < 0) {
+        return -1;
+    }
+    tf->id_text_used += (size_t)length + 1;
+    *out = text;
+    return 0;
+}
+
+/**
+ * Append one CPU ID to the TimeFrame's mask store
+ */
+static int push_cpu_mask(TimeFrame *tf, int cpu) {
+    if (tf->cpu_mask_used == tf->cpu_mask_capacity) {
+        int capacity = tf->cpu_mask_capacity ? tf->cpu_mask_capacity * 2 : 64;
+        int *masks = realloc(tf->cpu_masks, (size_t)capacity * sizeof(int));
+        if (!masks) {
+            return -1;
+        }
+        tf->cpu_masks = masks;
+        tf->cpu_mask_capacity = capacity;
     }
+    tf->cpu_masks[tf->cpu_mask_used++] = cpu;
+    return 0;
+}
+
+/**
+ * Read the cpuMask array: numeric items are kept, others skipped
+ */
+static int read_cpu_mask(JsonReader *r, TimeFrame *tf, Event *event) {
+    int more = container_open(r, ']');
+    while (more > 0) {
+        int cpu;
+        int got = read_int_member(r, &cpu);
+        if (got < 0 || (got > 0 && push_cpu_mask(tf, cpu) < 0)) {
+            return -1;
+        }
+        event->cpu_mask_count += got;
+        more = container_next(r, ']');
+    }
+    return more;
+}
+
+/**
+ * Parse one event object into the next free slot of tf->events
+ * Events without a valid string action are dropped, as before.
+ */
+static int read_event(JsonReader *r, TimeFrame *tf) {
+    if (tf->event_count == tf->event_capacity) {
+        int capacity = tf->event_capacity ? tf->event_capacity * 2 : 16;
+        Event *events = realloc(tf->events, (size_t)capacity * sizeof(Event));
+        if (!events) {
+            return -1;
+        }
+        tf->events = events;
+        tf->event_capacity = capacity;
+    }
+    
+    Event *event = &tf->events[tf->event_count];
+    event->action = EVENT_INVALID;
+    event->task_id = NULL;
+    event->cgroup_id = NULL;
+    event->new_cgroup_id = NULL;
+    event->parent_id = NULL;
+    memset(&event->nice, 0, sizeof(Event) - offsetof(Event, nice));
     
-    /* Parse cpuMask */
-    cJSON *cpu_mask = cJSON_GetObjectItem(event_json, "cpuMask");
-    if (cpu_mask && cJSON_IsArray(cpu_mask)) {
-        event->cpu_mask = parse_int_array(cpu_mask, &event->cpu_mask_count);
-        event->has_cpu_mask = true;
+    int mask_start = tf->cpu_mask_used;
+    size_t id_start = tf->id_text_used;
+    char action[JSON_ACTION_BUF];
+    long action_len = -1;           /* -1: no string action */
+    int new_nice = 0;
+    bool has_new_nice = false;
+    unsigned seen = 0;
+    
+    int more = container_open(r, '}');
+    while (more > 0) {
+        int key = read_key(r);
+        if (key == -2) {
+            return -1;
+        }
+        
+        int rc = 0;
+        if (key == KEY_UNKNOWN || (seen & (1u << key))) {
+            rc = skip_value(r);
+        } else {
+            seen |= 1u << key;
+            switch ((JsonKey)key) {
+                case KEY_ACTION:
+                    if (*r->p == '"') {
+                        action_len = read_string(r, action, sizeof(action));
+                        rc = action_len < 0 ? -1 : 0;
+                    } else {
+                        rc = skip_value(r);
+                    }
+                    break;
+                case KEY_TASK_ID:
+                    rc = read_id_member(r, tf, &event->task_id);
+                    break;
+                case KEY_CGROUP_ID:
+                    rc = read_id_member(r, tf, &event->cgroup_id);
+                    break;
+                case KEY_NEW_CGROUP_ID:
+                    rc = read_id_member(r, tf, &event->new_cgroup_id);
+                    break;
+                case KEY_PARENT_ID:
+                    rc = read_id_member(r, tf, &event->parent_id);
+                    break;
+                case KEY_NICE:
+                    rc = read_int_member(r, &event->nice);
+                    event->has_nice = rc > 0;
+                    break;
+                case KEY_NEW_NICE:
+                    rc = read_int_member(r, &new_nice);
+                    has_new_nice = rc > 0;
+                    break;
+                case KEY_CPU_MASK:
+                    if (*r->p == '[') {
+                        event->has_cpu_mask = true;
+                        rc = read_cpu_mask(r, tf, event);
+                    } else {
+                        rc = skip_value(r);
+                    }
+                    break;
+                case KEY_CPU_SHARES:
+                    rc = read_int_member(r, &event->cpu_shares);
+                    event->has_cpu_shares = rc > 0;
+                    break;
+                case KEY_CPU_QUOTA:
+                    /* Any value sets the quota; null means unlimited */
+                    event->has_cpu_quota = true;
+                    if (strncmp((const char *)r->p, "null", 4) == 0) {
+                        event->cpu_quota_us = -1;
+                        r->p += 4;
+                    } else {
+                        rc = read_int_member(r, &event->cpu_quota_us);
+                    }
+                    break;
+                case KEY_CPU_PERIOD:
+                    rc = read_int_member(r, &event->cpu_period_us);
+                    event->has_cpu_period = rc > 0;
+                    break;
+                case KEY_DURATION:
+                    rc = read_int_member(r, &event->burst_duration);
+                    break;
+                default:
+                    rc = skip_value(r);
+                    break;
+            }
+        }
+        if (rc < 0) {
+            return -1;
+        }
+        more = container_next(r, '}');
+    }
+    if (more < 0) {
+        return -1;
     }
     
-    /* Parse cpuShares */
-    cJSON *cpu_shares = cJSON_GetObjectItem(event_json, "cpuShares");
-    if (cpu_shares && cJSON_IsNumber(cpu_shares)) {
-        event->cpu_shares = cpu_shares->valueint;
-        event->has_cpu_shares = true;
+    /* newNice overrides nice wherever it appears */
+    if (has_new_nice) {
+        event->nice = new_nice;
+        event->has_nice = true;
     }
     
-    /* Parse cpuQuotaUs */
-    cJSON *cpu_quota = cJSON_GetObjectItem(event_json, "cpuQuotaUs");
-    if (cpu_quota) {
-        if (cJSON_IsNumber(cpu_quota)) {
-            event->cpu_quota_us = cpu_quota->valueint;
-        } else if (cJSON_IsNull(cpu_quota)) {
-            event->cpu_quota_us = -1;  /* Null means unlimited */
+    if (action_len < 0) {
+        fprintf(stderr, "Invalid event: missing string field 'action'\n");
+    } else {
+        event->action = action_len < JSON_ACTION_BUF ?
+                        lookup_action(action, (size_t)action_len) : EVENT_INVALID;
+        if (event->action == EVENT_INVALID) {
+            fprintf(stderr, "Invalid event action: %s\n", action);
         }
-        event->has_cpu_quota = true;
     }
-    
-    /* Parse cpuPeriodUs */
-    cJSON *cpu_period = cJSON_GetObjectItem(event_json, "cpuPeriodUs");
-    if (cpu_period && cJSON_IsNumber(cpu_period)) {
-        event->cpu_period_us = cpu_period->valueint;
-        event->has_cpu_period = true;
+    if (event->action == EVENT_INVALID) {
+        tf->cpu_mask_used = mask_start;
+        tf->id_text_used = id_start;
+        return 0;
     }
     
-    /* Parse duration (for CPU_BURST) */
-    cJSON *duration = cJSON_GetObjectItem(event_json, "duration");
-    if (duration && cJSON_IsNumber(duration)) {
-        event->burst_duration = duration->valueint;
+    tf->event_count++;
+    return 0;
+}
+
+/**
+ * Parse the events array; items that are not objects are dropped
+ */
+static int read_events(JsonReader *r, TimeFrame *tf) {
+    int more = container_open(r, ']');
+    while (more > 0) {
+        int rc;
+        if (*r->p == '{') {
+            rc = read_event(r, tf);
+        } else {
+            fprintf(stderr, "Invalid event: missing string field 'action'\n");
+            rc = skip_value(r);
+        }
+        if (rc < 0) {
+            return -1;
+        }
+        more = container_next(r, ']');
+    }
+    return more;
+}
+
+/**
+ * Parse the root value; a root that is not an object yields no events
+ */
+static int read_timeframe(JsonReader *r, TimeFrame *tf) {
+    /* cJSON skips a leading UTF-8 byte order mark */
+    if (strncmp((const char *)r->p, "\xEF\xBB\xBF", 3) == 0 && r->p[3] != '\0') {
+        r->p += 3;
+    }
+    skip_ws(r);
+    if (*r->p != '{') {
+        return skip_value(r);
     }
     
-    return event;
+    unsigned seen = 0;
+    int more = container_open(r, '}');
+    while (more > 0) {
+        int key = read_key(r);
+        if (key == -2) {
+            return -1;
+        }
+        
+        int rc;
+        bool first = key >= 0 && !(seen & (1u << key));
+        if (first) {
+            seen |= 1u << key;
+        }
+        if (first && key == KEY_VTIME) {
+            rc = read_int_member(r, &tf->vtime);
+        } else if (first && key == KEY_EVENTS && *r->p == '[') {
+            rc = read_events(r, tf);
+        } else {
+            rc = skip_value(r);
+        }
+        if (rc < 0) {
+            return -1;
+        }
+        more = container_next(r, '}');
+    }
+    return more;
 }
 
 /* ============================================================================
- * Public Functions
+ * Tick Serialization
+ *
+ * The output schema is fixed, so ticks are written straight into an
+ * OutputBuffer instead of through a cJSON tree. The text is byte-for-byte
+ * what cJSON_PrintUnformatted produced: integers print as %d and strings
+ * use cJSON's escapes. Interned task IDs carry their quoted form already.
  * ============================================================================ */
 
-TimeFrame *json_parse_timeframe(const char *json_str) {
-    if (!json_str) {
-        return NULL;
+#define OUTPUT_MIN_CAPACITY 4096
+#define INT_TEXT_MAX 11             /* "-2147483648" */
+
+int json_output_reserve(OutputBuffer *out, size_t extra) {
+    size_t needed = OUTPUT_HEADROOM + out->length + extra + 1;
+    if (needed <= out->capacity) {
+        return 0;
     }
     
-    cJSON *root = cJSON_Parse(json_str);
-    if (!root) {
-        fprintf(stderr, "JSON parse error: %s\n", cJSON_GetErrorPtr());
-        return NULL;
+    size_t capacity = out->capacity ? out->capacity : OUTPUT_MIN_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2;
     }
+    char *data = realloc(out->data, capacity);
+    if (!data) {
+        return -1;
+    }
+    out->data = data;
+    out->capacity = capacity;
+    return 0;
+}
+
+static inline void output_put(OutputBuffer *out, const char *text, size_t length) {
+    memcpy(out->data + OUTPUT_HEADROOM + out->length, text, length);
+    out->length += length;
+}
+
+/**
+ * Append fixed text, then an integer
+ */
+static int output_put_field(OutputBuffer *out, const char *text, size_t length, int value) {
+    if (json_output_reserve(out, length + INT_TEXT_MAX) < 0) {
+        return -1;
+    }
+    output_put(out, text, length);
     
-    TimeFrame *tf = calloc(1, sizeof(TimeFrame));
-    if (!tf) {
-        cJSON_Delete(root);
-        return NULL;
+    char digits[INT_TEXT_MAX];
+    unsigned magnitude = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    size_t n = 0;
+    do {
+        digits[INT_TEXT_MAX - ++n] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        digits[INT_TEXT_MAX - ++n] = '-';
+    }
+    output_put(out, digits + INT_TEXT_MAX - n, n);
+    return 0;
+}
+
+/**
+ * The tick's next schedule pin if it is `id`'s entry (busy CPUs are
+ * pinned in CPU order, idle ones are not)
+ */
+static const IdEntry *next_pin(const SchedulerTick *tick, int *pin, const char *id) {
+    if (*pin < tick->pin_count && tick->pins[*pin]->str == id) {
+        return tick->pins[(*pin)++];
+    }
+    return NULL;
+}
+
+/**
+ * Append one ID, preceded by a comma unless it starts the array
+ * An ID with an interned entry is copied in its prebuilt quoted form;
+ * anything else (the "idle" placeholder) is quoted here.
+ */
+static int output_put_id(OutputBuffer *out, const IdEntry *entry, const char *id, bool first) {
+    if (!id) {
+        id = "idle";                /* An unset schedule slot */
+    }
+    size_t length = entry ? entry->json_len : json_quote_string(id, NULL);
+    if (json_output_reserve(out, length + 1) < 0) {
+        return -1;
+    }
+    
+    if (!first) {
+        output_put(out, ",", 1);
+    }
+    if (entry) {
+        output_put(out, entry->json, length);
+    } else {
+        json_quote_string(id, out->data + OUTPUT_HEADROOM + out->length);
+        out->length += length;
+    }
+    return 0;
+}
+
+/**
+ * Append `name` and a JSON array of IDs
+ * @param entries Entry of each ID, or NULL to quote every ID here
+ */
+static int output_put_ids(OutputBuffer *out, const char *name, size_t name_length,
+                          const char *const *ids, IdEntry *const *entries, int count) {
+    if (json_output_reserve(out, name_length + 2) < 0) {
+        return -1;
+    }
+    output_put(out, name, name_length);
+    output_put(out, "[", 1);
+    for (int i = 0; i < count; i++) {
+        if (output_put_id(out, entries ? entries[i] : NULL, ids[i], i == 0) < 0) {
+            return -1;
+        }
+    }
+    output_put(out, "]", 1);
+    return 0;
+}
+
+#define OUTPUT_TEXT(s) s, sizeof(s) - 1
+
+/**
+ * Append a full tick's schedule array
+ */
+static int output_put_schedule(OutputBuffer *out, const SchedulerTick *tick, int *pin) {
+    if (json_output_reserve(out, sizeof(",\"schedule\":[")) < 0) {
+        return -1;
+    }
+    output_put(out, OUTPUT_TEXT(",\"schedule\":["));
+    for (int cpu = 0; cpu < tick->cpu_count; cpu++) {
+        const char *id = tick->schedule[cpu];
+        if (output_put_id(out, next_pin(tick, pin, id), id, cpu == 0) < 0) {
+            return -1;
+        }
+    }
+    output_put(out, "]", 1);
+    return 0;
+}
+
+/**
+ * Append the runnable and blocked lists, copied from the buffer's list
+ * cache when it holds them already
+ */
+static int output_put_lists(OutputBuffer *out, const SchedulerTick *tick, const SchedulerMeta *meta) {
+    size_t cached_length;
+    const char *cached = json_output_cached_lists(out, tick, WIRE_JSON, &cached_length);
+    if (cached) {
+        if (json_output_reserve(out, cached_length) < 0) {
+            return -1;
+        }
+        output_put(out, cached, cached_length);
+        return 0;
     }
     
-    /* Parse vtime */
-    cJSON *vtime = cJSON_GetObjectItem(root, "vtime");
-    if (vtime && cJSON_IsNumber(vtime)) {
-        tf->vtime = vtime->valueint;
+    size_t start = out->length;
+    if (output_put_ids(out, OUTPUT_TEXT(",\"runnableTasks\":"), meta->runnable_tasks,
+                       meta->task_entries, meta->runnable_count) < 0 ||
+        output_put_ids(out, OUTPUT_TEXT(",\"blockedTasks\":"), meta->blocked_tasks,
+                       meta->task_entries ? meta->task_entries + meta->runnable_count : NULL,
+                       meta->blocked_count) < 0) {
+        return -1;
     }
+    json_output_keep_lists(out, tick, WIRE_JSON, out->data + OUTPUT_HEADROOM + start, out->length - start);
+    return 0;
+}
+
+/**
+ * Append a delta tick's schedule: an object from CPU number to task ID
+ * holding only the changed CPUs
+ */
+static int output_put_changes(OutputBuffer *out, const SchedulerTick *tick, int *pin) {
+    if (json_output_reserve(out, sizeof(",\"schedule\":{")) < 0) {
+        return -1;
+    }
+    output_put(out, OUTPUT_TEXT(",\"schedule\":{"));
     
-    /* Parse events array */
-    cJSON *events = cJSON_GetObjectItem(root, "events");
-    if (events && cJSON_IsArray(events)) {
-        int event_count = cJSON_GetArraySize(events);
-        tf->events = malloc(sizeof(Event *) * event_count);
-        if (!tf->events) {
-            free(tf);
-            cJSON_Delete(root);
-            return NULL;
+    int next = 0;
+    for (int cpu = 0; cpu < tick->cpu_count; cpu++) {
+        const IdEntry *entry = next_pin(tick, pin, tick->schedule[cpu]);
+        if (next == tick->changed_count || tick->changed_cpus[next] != cpu) {
+            continue;               /* Unchanged (its pin is stepped over) */
         }
-        
-        tf->event_count = 0;
-        cJSON *event_json;
-        cJSON_ArrayForEach(event_json, events) {
-            Event *event = parse_event(event_json);
-            if (event) {
-                tf->events[tf->event_count++] = event;
-            }
+        if ((next == 0 ? output_put_field(out, OUTPUT_TEXT("\""), cpu)
+                       : output_put_field(out, OUTPUT_TEXT(",\""), cpu)) < 0 ||
+            json_output_reserve(out, 2) < 0) {
+            return -1;
+        }
+        output_put(out, OUTPUT_TEXT("\":"));
+        if (output_put_id(out, entry, tick->schedule[cpu], true) < 0) {
+            return -1;
         }
+        next++;
+    }
+    
+    if (json_output_reserve(out, 1) < 0) {
+        return -1;
+    }
+    output_put(out, "}", 1);
+    return 0;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+TimeFrame *json_timeframe_create(void) {
+    return calloc(1, sizeof(TimeFrame));
+}
+
+int json_parse_timeframe_into(const char *json_str, TimeFrame *tf) {
+    if (!json_str || !tf) {
+        return -1;
     }
     
-    cJSON_Delete(root);
+    tf->vtime = 0;
+    tf->event_count = 0;
+    tf->cpu_mask_used = 0;
+    tf->id_text_used = 0;
+    
+    JsonReader reader = {(const unsigned char *)json_str, (const unsigned char *)json_str, 0};
+    if (read_timeframe(&reader, tf) < 0) {
+        fprintf(stderr, "JSON parse error at offset %ld\n", (long)(reader.p - reader.start));
+        tf->vtime = 0;
+        tf->event_count = 0;
+        tf->cpu_mask_used = 0;
+        tf->id_text_used = 0;
+        return -1;
+    }
+    
+    /* Masks were appended in event order; point each event at its run */
+    int offset = 0;
+    for (int i = 0; i < tf->event_count; i++) {
+        Event *event = &tf->events[i];
+        event->cpu_mask = event->cpu_mask_count > 0 ? tf->cpu_masks + offset : NULL;
+        offset += event->cpu_mask_count;
+    }
+    
+    return 0;
+}
+
+TimeFrame *json_parse_timeframe(const char *json_str) {
+    TimeFrame *tf = json_timeframe_create();
+    if (tf && json_parse_timeframe_into(json_str, tf) < 0) {
+        json_free_timeframe(tf);
+        return NULL;
+    }
     return tf;
 }
 
 void json_free_timeframe(TimeFrame *tf) {
     if (tf) {
-        if (tf->events) {
-            for (int i = 0; i < tf->event_count; i++) {
-                if (tf->events[i]) {
-                    free(tf->events[i]->cpu_mask);
-                    free(tf->events[i]);
-                }
-            }
-            free(tf->events);
-        }
+        free(tf->events);
+        free(tf->cpu_masks);
+        free(tf->id_text);
         free(tf);
     }
 }
 
-char *json_serialize_tick(const SchedulerTick *tick, bool include_meta) {
-    if (!tick) {
-        return NULL;
+int json_serialize_tick_into(const SchedulerTick *tick, bool include_meta, OutputBuffer *out) {
+    if (!tick || !out) {
+        return -1;
     }
     
-    cJSON *root = cJSON_CreateObject();
-    if (!root) {
-        return NULL;
+    out->length = 0;
+    int pin = 0;
+    if (output_put_field(out, OUTPUT_TEXT("{\"vtime\":"), tick->vtime) < 0) {
+        return -1;
+    }
+    if (tick->delta) {
+        if (json_output_reserve(out, sizeof(",\"delta\":true")) < 0) {
+            return -1;
+        }
+        output_put(out, OUTPUT_TEXT(",\"delta\":true"));
+        if (output_put_changes(out, tick, &pin) < 0) {
+            return -1;
+        }
+    } else if (output_put_schedule(out, tick, &pin) < 0) {
+        return -1;
     }
     
-    /* Add vtime */
-    cJSON_AddNumberToObject(root, "vtime", tick->vtime);
+    /* Add metadata if requested and available */
+    const SchedulerMeta *meta = tick->meta;
+    if (include_meta && meta) {
+        if (output_put_field(out, OUTPUT_TEXT(",\"meta\":{\"preemptions\":"), meta->preemptions) < 0 ||
+            output_put_field(out, OUTPUT_TEXT(",\"migrations\":"), meta->migrations) < 0 ||
+            output_put_field(out, OUTPUT_TEXT(",\"throttles\":"), meta->throttles) < 0 ||
+            output_put_field(out, OUTPUT_TEXT(",\"unthrottles\":"), meta->unthrottles) < 0 ||
+            (meta->has_latency &&
+             (output_put_field(out, OUTPUT_TEXT(",\"wakeups\":"), meta->wakeups) < 0 ||
+              output_put_field(out, OUTPUT_TEXT(",\"wakeupLatency\":"), meta->wakeup_latency) < 0)) ||
+            output_put_lists(out, tick, meta) < 0 ||
+            (tick->delta &&
+             output_put_ids(out, OUTPUT_TEXT(",\"removedTasks\":"), meta->removed_tasks,
+                            meta->task_entries + meta->runnable_count + meta->blocked_count,
+                            meta->removed_count) < 0) ||
+            json_output_reserve(out, 1) < 0) {
+            return -1;
+        }
+        output_put(out, "}", 1);
+    }
     
-    /* Add schedule array */
-    cJSON *schedule = cJSON_CreateArray();
-    if (!schedule) {
-        cJSON_Delete(root);
+    if (json_output_reserve(out, 1) < 0) {
+        return -1;
+    }
+    output_put(out, "}", 1);
+    out->data[OUTPUT_HEADROOM + out->length] = '\0';
+    return 0;
+}
+
+char *json_serialize_tick(const SchedulerTick *tick, bool include_meta) {
+    OutputBuffer out = {0};
+    if (json_serialize_tick_into(tick, include_meta, &out) < 0) {
+        free(out.data);
         return NULL;
     }
     
-    for (int i = 0; i < tick->cpu_count; i++) {
-        const char *task_id = tick->schedule[i] ? tick->schedule[i] : "idle";
-        cJSON_AddItemToArray(schedule, cJSON_CreateString(task_id));
+    /* Hand back a plain string: drop the headroom */
+    memmove(out.data, out.data + OUTPUT_HEADROOM, out.length + 1);
+    return out.data;
+}
+
+void json_output_free(OutputBuffer *out) {
+    if (out) {
+        free(out->data);
+        free(out->lists);
+        memset(out, 0, sizeof(*out));
     }
-    cJSON_AddItemToObject(root, "schedule", schedule);
-    
-    /* Add metadata if requested and available */
-    if (include_meta && tick->meta) {
-        cJSON *meta = cJSON_CreateObject();
-        if (meta) {
-            cJSON_AddNumberToObject(meta, "preemptions", tick->meta->preemptions);
-            cJSON_AddNumberToObject(meta, "migrations", tick->meta->migrations);
-            
-            /* Add runnable tasks */
-            cJSON *runnable = cJSON_CreateArray();
-            for (int i = 0; i < tick->meta->runnable_count; i++) {
-                cJSON_AddItemToArray(runnable, 
-                    cJSON_CreateString(tick->meta->runnable_tasks[i]));
+}
+
+const char *json_output_cached_lists(OutputBuffer *out, const SchedulerTick *tick,
+                                     WireProtocol protocol, size_t *length) {
+    if (tick->list_serial == 0) {
+        return NULL;                /* Change lists, or lists built by hand */
+    }
+    if (out->lists_serial != tick->list_serial || out->lists_epoch != tick->list_epoch ||
+        out->lists_protocol != protocol) {
+        out->lists_serial = tick->list_serial;
+        out->lists_epoch = tick->list_epoch;
+        out->lists_protocol = protocol;
+        out->lists_seen = false;
+        out->lists_ready = false;
+        return NULL;
+    }
+    if (!out->lists_ready) {
+        return NULL;
+    }
+    *length = out->lists_length;
+    return out->lists ? out->lists : "";
+}
+
+void json_output_keep_lists(OutputBuffer *out, const SchedulerTick *tick, WireProtocol protocol,
+                            const char *bytes, size_t length) {
+    if (tick->list_serial == 0 || out->lists_serial != tick->list_serial ||
+        out->lists_epoch != tick->list_epoch || out->lists_protocol != protocol || out->lists_ready) {
+        return;
+    }
+    if (!out->lists_seen) {
+        out->lists_seen = true;     /* Capture only if the version comes back */
+        return;
+    }
+    if (length > 0) {               /* No tasks: nothing to copy, lists may be NULL */
+        if (out->lists_capacity < length) {
+            char *lists = realloc(out->lists, length);
+            if (!lists) {
+                return;             /* Encode again next time */
+            }
+            out->lists = lists;
+            out->lists_capacity = length;
+        }
+        memcpy(out->lists, bytes, length);
+    }
+    out->lists_length = length;
+    out->lists_ready = true;
+}
+
+size_t json_quote_string(const char *str, char *out) {
+    static const char hex[] = "0123456789abcdef";
+    size_t n = 0;
+    if (out) {
+        out[n] = '"';
+    }
+    n++;
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        char escape = 0;
+        switch (*p) {
+            case '"':  escape = '"'; break;
+            case '\\': escape = '\\'; break;
+            case '\b': escape = 'b'; break;
+            case '\f': escape = 'f'; break;
+            case '\n': escape = 'n'; break;
+            case '\r': escape = 'r'; break;
+            case '\t': escape = 't'; break;
+            default: break;
+        }
+        if (escape) {
+            if (out) {
+                out[n] = '\\';
+                out[n + 1] = escape;
             }
-            cJSON_AddItemToObject(meta, "runnableTasks", runnable);
-            
-            /* Add blocked tasks */
-            cJSON *blocked = cJSON_CreateArray();
-            for (int i = 0; i < tick->meta->blocked_count; i++) {
-                cJSON_AddItemToArray(blocked, 
-                    cJSON_CreateString(tick->meta->blocked_tasks[i]));
+            n += 2;
+        } else if (*p < 32) {
+            if (out) {
+                memcpy(out + n, "\\u00", 4);
+                out[n + 4] = hex[*p >> 4];
+                out[n + 5] = hex[*p & 15];
             }
-            cJSON_AddItemToObject(meta, "blockedTasks", blocked);
-            
-            cJSON_AddItemToObject(root, "meta", meta);
+            n += 6;
+        } else {
+            if (out) {
+                out[n] = (char)*p;
+            }
+            n++;
         }
     }
-    
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-    
-    return json_str;
+    if (out) {
+        out[n] = '"';
+    }
+    return n + 1;
 }
+
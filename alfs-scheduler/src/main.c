@@ -7,6 +7,14 @@
  *   -c, --cpus <num>      Number of CPUs (default: 4)
  *   -q, --quanta <num>    Time quantum (default: 1)
  *   -m, --metadata        Include metadata in output
+ *   -f, --framing <mode>  Message framing: newline, json or length
+ *   -w, --protocol <name> Wire protocol: json or binary
+ *   -P, --pipeline        Overlap I/O, scheduling and output on 3 threads
+ *   -r, --replay <file>   Replay a trace file instead of using the socket
+ *   -o, --output <file>   Tick output file for --replay (default: stdout)
+ *   -R, --runqueue <name> Run queue backend: heap, heap4, heap8, pairing, rbtree
+ *   -k, --checkpoint <file> Write scheduler snapshots to <file>
+ *   -x, --restore <file>  Start from a snapshot
  *   -h, --help            Show help message
  */
 
@@ -24,16 +32,64 @@
 #include "scheduler.h"
 #include "uds.h"
 #include "json_handler.h"
+#include "codec.h"
+#include "pipeline.h"
+#include "replay.h"
+#include "taskqueue.h"
+#include "stats.h"
+#include "tenant.h"
+#include "checkpoint.h"
 
 /* Global flag for graceful shutdown */
 static volatile int running = 1;
 
+/**
+ * Everything needed to build a configured scheduler, so --listen can
+ * make one per connection
+ */
+typedef struct {
+    int cpu_count;
+    int quanta;
+    bool include_metadata;
+    bool per_cpu;
+    int balance_interval;
+    QueueBackend backend;
+    SchedPolicy policy;
+    bool report_latency;
+    const int *capacity;            /* NULL = uniform */
+    int stats_interval;             /* -1 = no statistics */
+    int tick_threads;               /* Threads per tick (per-CPU mode), 1 = serial */
+    int expected_tasks;             /* Storage to reserve up front, 0 = grow on demand */
+    const char *checkpoint_path;    /* NULL = no snapshots */
+    int checkpoint_interval;        /* Timeframes between snapshots, 0 = SIGUSR1 and exit only */
+    int delta_interval;             /* Ticks per keyframe of delta output, 0 = full ticks */
+} SchedulerOptions;
+
 /* Command line options */
 static struct option long_options[] = {
     {"socket",   required_argument, 0, 's'},
     {"cpus",     required_argument, 0, 'c'},
     {"quanta",   required_argument, 0, 'q'},
     {"metadata", no_argument,       0, 'm'},
+    {"framing",  required_argument, 0, 'f'},
+    {"protocol", required_argument, 0, 'w'},
+    {"pipeline", no_argument,       0, 'P'},
+    {"replay",   required_argument, 0, 'r'},
+    {"output",   required_argument, 0, 'o'},
+    {"per-cpu",  no_argument,       0, 'p'},
+    {"balance-interval", required_argument, 0, 'b'},
+    {"runqueue", required_argument, 0, 'R'},
+    {"policy",   required_argument, 0, 'S'},
+    {"latency",  no_argument,       0, 'L'},
+    {"capacity", required_argument, 0, 'C'},
+    {"stats-interval", required_argument, 0, 'T'},
+    {"listen",   required_argument, 0, 'l'},
+    {"tick-threads", required_argument, 0, 'j'},
+    {"expected-tasks", required_argument, 0, 'e'},
+    {"checkpoint", required_argument, 0, 'k'},
+    {"checkpoint-interval", required_argument, 0, 'K'},
+    {"restore",  required_argument, 0, 'x'},
+    {"delta",    required_argument, 0, 'D'},
     {"help",     no_argument,       0, 'h'},
     {0, 0, 0, 0}
 };
@@ -46,6 +102,14 @@ static void signal_handler(int sig) {
     running = 0;
 }
 
+/**
+ * SIGUSR1: write a snapshot after the current timeframe
+ */
+static void checkpoint_signal_handler(int sig) {
+    (void)sig;
+    checkpoint_request();
+}
+
 /**
  * Print usage information
  */
@@ -57,9 +121,181 @@ static void print_usage(const char *program_name) {
     fprintf(stderr, "  -c, --cpus <num>      Number of CPUs (default: 4)\n");
     fprintf(stderr, "  -q, --quanta <num>    Time quantum (default: 1)\n");
     fprintf(stderr, "  -m, --metadata        Include metadata in output\n");
+    fprintf(stderr, "  -f, --framing <mode>  Message framing: newline (default), json\n");
+    fprintf(stderr, "                        (object boundaries) or length (4-byte prefix)\n");
+    fprintf(stderr, "  -w, --protocol <name> Wire protocol: json (default) or binary\n");
+    fprintf(stderr, "                        (handle-based records, implies length framing)\n");
+    fprintf(stderr, "  -P, --pipeline        Read/parse, schedule and serialize/write on\n");
+    fprintf(stderr, "                        separate threads\n");
+    fprintf(stderr, "  -r, --replay <file>   Replay a JSON-lines (or binary) trace from a\n");
+    fprintf(stderr, "                        memory-mapped file, no socket\n");
+    fprintf(stderr, "  -o, --output <file>   Where --replay writes ticks (default: stdout)\n");
+    fprintf(stderr, "  -p, --per-cpu         Use per-CPU run queues with work stealing\n");
+    fprintf(stderr, "  -b, --balance-interval <num>\n");
+    fprintf(stderr, "                        Ticks between load balancing in per-CPU mode\n");
+    fprintf(stderr, "                        (default: 4, 0 = idle stealing only)\n");
+    fprintf(stderr, "  -R, --runqueue <name> Run queue backend: heap, heap4, heap8, pairing,\n");
+    fprintf(stderr, "                        rbtree or rbtree-aug (default: %s)\n",
+            taskqueue_backend_name(ALFS_RUNQUEUE_DEFAULT));
+    fprintf(stderr, "  -S, --policy <name>   Selection policy: cfs (default) or eevdf\n");
+    fprintf(stderr, "                        (earliest eligible deadline, uses rbtree-aug)\n");
+    fprintf(stderr, "  -L, --latency         Report wake-up latency in the metadata\n");
+    fprintf(stderr, "  -C, --capacity <list> Per-CPU capacity (1-1024), e.g. 4x1024,4x512\n");
+    fprintf(stderr, "                        (default: all 1024)\n");
+    fprintf(stderr, "  -T, --stats-interval <ms>\n");
+    fprintf(stderr, "                        Print hot-path timing histograms and counters\n");
+    fprintf(stderr, "                        to stderr every <ms> and at exit (0 = at exit)\n");
+    fprintf(stderr, "  -l, --listen <workers>\n");
+    fprintf(stderr, "                        Listen on the socket path and give every\n");
+    fprintf(stderr, "                        connection its own scheduler, served by <workers>\n");
+    fprintf(stderr, "                        epoll threads (0 = one per usable CPU)\n");
+    fprintf(stderr, "  -j, --tick-threads <num>\n");
+    fprintf(stderr, "                        Make each tick's per-CPU picks on <num> threads\n");
+    fprintf(stderr, "                        (--per-cpu only, same schedule; default: 1)\n");
+    fprintf(stderr, "  -e, --expected-tasks <num>\n");
+    fprintf(stderr, "                        Pre-size task storage and the ID table for\n");
+    fprintf(stderr, "                        <num> tasks (storage still grows past it)\n");
+    fprintf(stderr, "  -k, --checkpoint <file>\n");
+    fprintf(stderr, "                        Snapshot the scheduler to <file> from a forked\n");
+    fprintf(stderr, "                        child on SIGUSR1, every --checkpoint-interval\n");
+    fprintf(stderr, "                        timeframes and at exit\n");
+    fprintf(stderr, "  -K, --checkpoint-interval <num>\n");
+    fprintf(stderr, "                        Timeframes between snapshots (default: 0 =\n");
+    fprintf(stderr, "                        on SIGUSR1 and at exit only)\n");
+    fprintf(stderr, "  -x, --restore <file>  Start from a snapshot taken with the same\n");
+    fprintf(stderr, "                        configuration (a missing file starts empty)\n");
+    fprintf(stderr, "  -D, --delta <num>     Send only changed CPUs and task lists, with a\n");
+    fprintf(stderr, "                        full keyframe every <num> ticks\n");
     fprintf(stderr, "  -h, --help            Show this help message\n");
 }
 
+/**
+ * Build a scheduler from the command line options
+ * @return Configured scheduler, or NULL on failure
+ */
+static Scheduler *create_scheduler(void *arg) {
+    const SchedulerOptions *options = arg;
+    Scheduler *sched = scheduler_init(options->cpu_count, options->quanta);
+    if (!sched) {
+        return NULL;
+    }
+    scheduler_set_metadata(sched, options->include_metadata);
+    scheduler_set_policy(sched, options->policy);
+    scheduler_set_runqueue(sched, options->backend);
+    scheduler_set_latency(sched, options->report_latency);
+    if (options->capacity) {
+        scheduler_set_capacity(sched, options->capacity, options->cpu_count);
+    }
+    if ((options->stats_interval >= 0 &&
+         scheduler_enable_stats(sched, options->stats_interval) < 0) ||
+        (options->per_cpu && scheduler_enable_per_cpu(sched, options->balance_interval) < 0) ||
+        (options->tick_threads > 1 &&
+         scheduler_enable_parallel_tick(sched, options->tick_threads) < 0) ||
+        (options->expected_tasks > 0 &&
+         scheduler_reserve(sched, options->expected_tasks) < 0) ||
+        (options->checkpoint_path &&
+         scheduler_enable_checkpoint(sched, options->checkpoint_path,
+                                     options->checkpoint_interval) < 0) ||
+        (options->delta_interval > 0 && scheduler_set_delta(sched, options->delta_interval) < 0)) {
+        scheduler_destroy(sched);
+        return NULL;
+    }
+    return sched;
+}
+
+/**
+ * Load a snapshot into a freshly created scheduler
+ * @return 0 on success or when there is no snapshot yet, -1 on failure
+ */
+static int restore_scheduler(Scheduler *sched, const char *path) {
+    uint64_t start = stats_clock_ns();
+    if (checkpoint_load(sched, path) < 0) {
+        if (errno == ENOENT) {
+            fprintf(stderr, "Note: no snapshot at %s, starting empty\n", path);
+            return 0;
+        }
+        fprintf(stderr, "Error: Cannot restore %s (corrupt, or another configuration)\n", path);
+        return -1;
+    }
+    fprintf(stderr, "Restored %d tasks, %d cgroups at vtime %d from %s in %.2f ms\n",
+            sched->task_count, sched->cgroup_count, sched->current_vtime, path,
+            (stats_clock_ns() - start) / 1e6);
+    return 0;
+}
+
+/**
+ * Write the final snapshot at shutdown and report the snapshot count
+ */
+static void finish_checkpoint(Scheduler *sched) {
+    Checkpointer *cp = sched->checkpoint;
+    if (!cp) {
+        return;
+    }
+    if (checkpoint_flush(cp, sched) < 0) {
+        fprintf(stderr, "Error: Failed to write checkpoint %s\n", cp->path);
+    }
+    fprintf(stderr, "Checkpoints: %ld written to %s", cp->written, cp->path);
+    if (cp->failed) {
+        fprintf(stderr, ", %ld failed", cp->failed);
+    }
+    fprintf(stderr, "\n");
+}
+
+/**
+ * Serve many connections, one scheduler each, and report totals
+ * @return Process exit status
+ */
+static int run_listen(TenantConfig *config) {
+    TenantTotals totals;
+    fprintf(stderr, "Listening on %s...\n", config->socket_path);
+    if (tenant_serve(config, &running, &totals) < 0) {
+        fprintf(stderr, "Error: Failed to start the multi-tenant server\n");
+        return 1;
+    }
+    
+    fprintf(stderr, "\nServed %ld connections, %ld timeframes\n", totals.connections, totals.frames);
+    if (totals.errors || totals.rejected) {
+        fprintf(stderr, "  %ld failed messages or handshakes, %ld rejected events\n",
+                totals.errors, totals.rejected);
+    }
+    fprintf(stderr, "ALFS Scheduler terminated.\n");
+    return 0;
+}
+
+/**
+ * Replay a trace file and report throughput
+ * @return Process exit status
+ */
+static int run_replay(Scheduler *sched, WireProtocol protocol, const char *replay_path,
+                      const char *output_path, bool include_metadata) {
+    Codec *codec = codec_create(protocol);
+    ReplayStats stats;
+    int rc = codec ? replay_run(sched, codec, replay_path, output_path, include_metadata,
+                                &running, &stats) : -1;
+    
+    if (rc == 0) {
+        double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+        fprintf(stderr, "Replayed %ld timeframes (%ld events, %.1f MB) in %.3f s\n",
+                stats.frames, stats.events, stats.input_bytes / (1024.0 * 1024.0), stats.seconds);
+        fprintf(stderr, "  %.0f ticks/s, %.0f events/s, %.1f MB/s in, %.1f MB/s out\n",
+                stats.frames / seconds, stats.events / seconds,
+                stats.input_bytes / (1024.0 * 1024.0) / seconds,
+                stats.output_bytes / (1024.0 * 1024.0) / seconds);
+        if (stats.errors || stats.rejected) {
+            fprintf(stderr, "  %ld undecodable messages, %ld rejected events\n",
+                    stats.errors, stats.rejected);
+        }
+    } else {
+        fprintf(stderr, "Error: Replay failed\n");
+    }
+    stats_report(sched->stats, stderr);
+    finish_checkpoint(sched);
+    
+    codec_destroy(codec);
+    scheduler_destroy(sched);
+    return rc == 0 ? 0 : 1;
+}
+
 /**
  * Main entry point
  */
@@ -69,12 +305,34 @@ int main(int argc, char *argv[]) {
     int cpu_count = 4;
     int quanta = 1;
     bool include_metadata = false;
+    bool per_cpu = false;
+    int balance_interval = 4;
+    UdsFraming framing = UDS_FRAME_NEWLINE;
+    const char *framing_name = "newline";
+    WireProtocol protocol = WIRE_JSON;
+    bool pipeline = false;
+    const char *replay_path = NULL;
+    const char *output_path = NULL;
+    QueueBackend backend = ALFS_RUNQUEUE_DEFAULT;
+    bool backend_given = false;
+    SchedPolicy policy = SCHED_POLICY_CFS;
+    bool report_latency = false;
+    const char *capacity_spec = NULL;
+    int capacity[MAX_CPUS];
+    int stats_interval = -1;
+    int listen_workers = -1;
+    int tick_threads = 1;
+    int expected_tasks = 0;
+    const char *checkpoint_path = NULL;
+    int checkpoint_interval = 0;
+    const char *restore_path = NULL;
+    int delta_interval = 0;
     
     /* Parse command line arguments */
     int opt;
     int option_index = 0;
     
-    while ((opt = getopt_long(argc, argv, "s:c:q:mh", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "s:c:q:mf:w:Pr:o:pb:R:S:LC:T:l:j:e:k:K:x:D:h", long_options, &option_index)) != -1) {
         switch (opt) {
             case 's':
                 socket_path = optarg;
@@ -96,6 +354,109 @@ int main(int argc, char *argv[]) {
             case 'm':
                 include_metadata = true;
                 break;
+            case 'f':
+                if (uds_parse_framing(optarg, &framing) < 0) {
+                    fprintf(stderr, "Error: Invalid framing (must be newline, json or length)\n");
+                    return 1;
+                }
+                framing_name = optarg;
+                break;
+            case 'w':
+                if (codec_parse_protocol(optarg, &protocol) < 0) {
+                    fprintf(stderr, "Error: Invalid protocol (must be json or binary)\n");
+                    return 1;
+                }
+                break;
+            case 'P':
+                pipeline = true;
+                break;
+            case 'r':
+                replay_path = optarg;
+                break;
+            case 'o':
+                output_path = optarg;
+                break;
+            case 'p':
+                per_cpu = true;
+                break;
+            case 'b':
+                balance_interval = atoi(optarg);
+                if (balance_interval < 0) {
+                    fprintf(stderr, "Error: Invalid balance interval (must be >= 0)\n");
+                    return 1;
+                }
+                break;
+            case 'R':
+                if (taskqueue_parse_backend(optarg, &backend) < 0) {
+                    fprintf(stderr, "Error: Invalid run queue (must be heap, heap4, heap8, pairing, rbtree or rbtree-aug)\n");
+                    return 1;
+                }
+                backend_given = true;
+                break;
+            case 'S':
+                if (scheduler_parse_policy(optarg, &policy) < 0) {
+                    fprintf(stderr, "Error: Invalid policy (must be cfs or eevdf)\n");
+                    return 1;
+                }
+                break;
+            case 'L':
+                report_latency = true;
+                break;
+            case 'C':
+                capacity_spec = optarg;
+                break;
+            case 'T':
+                stats_interval = atoi(optarg);
+                if (stats_interval < 0) {
+                    fprintf(stderr, "Error: Invalid stats interval (must be >= 0 ms)\n");
+                    return 1;
+                }
+                if (!STATS_COMPILED) {
+                    fprintf(stderr, "Error: Built without statistics (ALFS_NO_STATS)\n");
+                    return 1;
+                }
+                break;
+            case 'l':
+                listen_workers = atoi(optarg);
+                if (listen_workers < 0 || listen_workers > TENANT_MAX_WORKERS) {
+                    fprintf(stderr, "Error: Invalid worker count (must be 0-%d)\n", TENANT_MAX_WORKERS);
+                    return 1;
+                }
+                break;
+            case 'j':
+                tick_threads = atoi(optarg);
+                if (tick_threads <= 0 || tick_threads > MAX_CPUS) {
+                    fprintf(stderr, "Error: Invalid tick thread count (must be 1-%d)\n", MAX_CPUS);
+                    return 1;
+                }
+                break;
+            case 'e':
+                expected_tasks = atoi(optarg);
+                if (expected_tasks < 0) {
+                    fprintf(stderr, "Error: Invalid expected task count (must be >= 0)\n");
+                    return 1;
+                }
+                break;
+            case 'k':
+                checkpoint_path = optarg;
+                break;
+            case 'K':
+                checkpoint_interval = atoi(optarg);
+                if (checkpoint_interval < 0) {
+                    fprintf(stderr, "Error: Invalid checkpoint interval (must be >= 0)\n");
+                    return 1;
+                }
+                break;
+            case 'x':
+                restore_path = optarg;
+                break;
+            case 'D':
+                delta_interval = atoi(optarg);
+                if (delta_interval <= 0) {
+                    fprintf(stderr, "Error: Invalid keyframe interval (must be >= 1)\n");
+                    return 1;
+                }
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -105,23 +466,152 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    /* EEVDF selects through the deadline-augmented tree */
+    if (policy == SCHED_POLICY_EEVDF) {
+        if (backend_given && backend != QUEUE_RBTREE_AUG) {
+            fprintf(stderr, "Error: --policy=eevdf needs the rbtree-aug run queue\n");
+            return 1;
+        }
+        backend = QUEUE_RBTREE_AUG;
+    }
+    
+    /* The capacity list must cover every CPU */
+    if (capacity_spec && scheduler_parse_capacity(capacity_spec, capacity, cpu_count) < 0) {
+        fprintf(stderr, "Error: Invalid capacity list (need %d values of 1-1024, e.g. 2x1024,2x512)\n",
+                cpu_count);
+        return 1;
+    }
+    
+    if (listen_workers >= 0 && replay_path) {
+        fprintf(stderr, "Error: --listen and --replay cannot be combined\n");
+        return 1;
+    }
+    
+    /* Snapshots hold one scheduler; --listen runs one per connection */
+    if (listen_workers >= 0 && (checkpoint_path || restore_path)) {
+        fprintf(stderr, "Error: --checkpoint and --restore cannot be combined with --listen\n");
+        return 1;
+    }
+    
+    /* Only per-CPU queues make the CPUs' picks independent */
+    if (tick_threads > 1 && !per_cpu) {
+        fprintf(stderr, "Error: --tick-threads needs --per-cpu\n");
+        return 1;
+    }
+    
+    /* The binary protocol is always length-framed */
+    if (codec_framing(protocol, framing) != framing) {
+        framing = codec_framing(protocol, framing);
+        framing_name = "length";
+        fprintf(stderr, "Note: binary protocol uses length framing\n");
+    }
+    
     /* Set up signal handlers */
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
+    if (checkpoint_path) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = checkpoint_signal_handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, NULL);
+    }
     
     /* Print configuration */
     fprintf(stderr, "ALFS Scheduler Starting...\n");
-    fprintf(stderr, "  Socket: %s\n", socket_path);
+    if (replay_path) {
+        fprintf(stderr, "  Replay: %s -> %s\n", replay_path, output_path ? output_path : "stdout");
+    } else if (listen_workers >= 0) {
+        fprintf(stderr, "  Listen: %s\n", socket_path);
+    } else {
+        fprintf(stderr, "  Socket: %s\n", socket_path);
+    }
     fprintf(stderr, "  CPUs: %d\n", cpu_count);
     fprintf(stderr, "  Quanta: %d\n", quanta);
     fprintf(stderr, "  Metadata: %s\n", include_metadata ? "enabled" : "disabled");
+    fprintf(stderr, "  Framing: %s\n", framing_name);
+    fprintf(stderr, "  Protocol: %s\n", protocol == WIRE_BINARY ? "binary" : "json");
+    if (listen_workers > 0) {
+        fprintf(stderr, "  I/O: multi-tenant (%d epoll workers)\n", listen_workers);
+    } else if (listen_workers == 0) {
+        fprintf(stderr, "  I/O: multi-tenant (one epoll worker per CPU)\n");
+    } else {
+        fprintf(stderr, "  I/O: %s\n", pipeline && !replay_path ? "pipelined (3 threads)" : "sequential");
+    }
+    if (pipeline && (replay_path || listen_workers >= 0)) {
+        fprintf(stderr, "  Note: --pipeline does not apply to --%s\n", replay_path ? "replay" : "listen");
+    } else if (pipeline && sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        fprintf(stderr, "  Note: one CPU online, pipeline stages cannot overlap\n");
+    }
+    if (per_cpu) {
+        fprintf(stderr, "  Run queues: per-CPU (balance every %d ticks)\n", balance_interval);
+        if (tick_threads > 1 && listen_workers >= 0) {
+            fprintf(stderr, "  Note: --tick-threads does not apply to --listen\n");
+            tick_threads = 1;
+        } else if (tick_threads > 1) {
+            fprintf(stderr, "  Tick threads: %d\n", tick_threads < cpu_count ? tick_threads : cpu_count);
+            if (sysconf(_SC_NPROCESSORS_ONLN) < tick_threads) {
+                fprintf(stderr, "  Note: fewer CPUs online than tick threads, picks cannot all overlap\n");
+            }
+        }
+    } else {
+        fprintf(stderr, "  Run queues: global\n");
+    }
+    fprintf(stderr, "  Run queue backend: %s\n", taskqueue_backend_name(backend));
+    fprintf(stderr, "  Policy: %s\n", scheduler_policy_name(policy));
+    fprintf(stderr, "  CPU capacity: %s\n", capacity_spec ? capacity_spec : "uniform");
+    if (stats_interval > 0) {
+        fprintf(stderr, "  Stats: every %d ms\n", stats_interval);
+    } else if (stats_interval == 0) {
+        fprintf(stderr, "  Stats: at exit\n");
+    }
+    if (expected_tasks > 0) {
+        fprintf(stderr, "  Expected tasks: %d\n", expected_tasks);
+    }
+    if (checkpoint_path && checkpoint_interval > 0) {
+        fprintf(stderr, "  Checkpoint: %s (every %d timeframes, SIGUSR1, exit)\n",
+                checkpoint_path, checkpoint_interval);
+    } else if (checkpoint_path) {
+        fprintf(stderr, "  Checkpoint: %s (SIGUSR1, exit)\n", checkpoint_path);
+    }
+    if (restore_path) {
+        fprintf(stderr, "  Restore: %s\n", restore_path);
+    }
+    if (delta_interval > 0) {
+        fprintf(stderr, "  Output: deltas (keyframe every %d ticks)\n", delta_interval);
+    }
+    
+    SchedulerOptions options = {
+        cpu_count, quanta, include_metadata, per_cpu, balance_interval, backend, policy,
+        report_latency, capacity_spec ? capacity : NULL, stats_interval, tick_threads,
+        expected_tasks, checkpoint_path, checkpoint_interval, delta_interval
+    };
+    
+    /* Multi-tenant mode builds a scheduler per connection */
+    if (listen_workers >= 0) {
+        TenantConfig config = {
+            socket_path, listen_workers, framing, protocol, include_metadata, cpu_count,
+            create_scheduler, &options
+        };
+        return run_listen(&config);
+    }
     
     /* Initialize scheduler */
-    Scheduler *sched = scheduler_init(cpu_count, quanta);
+    Scheduler *sched = create_scheduler(&options);
     if (!sched) {
         fprintf(stderr, "Error: Failed to initialize scheduler\n");
         return 1;
     }
+    if (restore_path && restore_scheduler(sched, restore_path) < 0) {
+        scheduler_destroy(sched);
+        return 1;
+    }
+    
+    /* Offline replay needs no socket */
+    if (replay_path) {
+        return run_replay(sched, protocol, replay_path, output_path, include_metadata);
+    }
     
     /* Connect to UDS */
     fprintf(stderr, "Connecting to socket: %s\n", socket_path);
@@ -131,13 +621,45 @@ int main(int argc, char *argv[]) {
         scheduler_destroy(sched);
         return 1;
     }
+    UdsConn *conn = uds_conn_create(sock, framing);
+    Codec *codec = codec_create(protocol);
+    if (!conn || !codec) {
+        fprintf(stderr, "Error: Failed to allocate connection buffer\n");
+        codec_destroy(codec);
+        uds_conn_destroy(conn);
+        uds_disconnect(sock);
+        scheduler_destroy(sched);
+        return 1;
+    }
+    if (codec_handshake(codec, conn, cpu_count) < 0) {
+        fprintf(stderr, "Error: Protocol handshake failed\n");
+        codec_destroy(codec);
+        uds_conn_destroy(conn);
+        uds_disconnect(sock);
+        scheduler_destroy(sched);
+        return 1;
+    }
     
     fprintf(stderr, "Connected. Waiting for events...\n");
     
+    /* Pipelined mode runs the same loop split across stage threads */
+    if (pipeline && pipeline_run(sched, conn, codec, include_metadata, &running) < 0) {
+        fprintf(stderr, "Error: Failed to start pipeline threads\n");
+    }
+    
+    /* One TimeFrame, tick and output buffer are refilled every frame */
+    OutputBuffer output = {0};
+    TimeFrame *tf = pipeline ? NULL : json_timeframe_create();
+    SchedulerTick *tick = pipeline ? NULL : scheduler_tick_create(sched);
+    if (!pipeline && (!tf || !tick)) {
+        fprintf(stderr, "Error: Failed to allocate frame buffers\n");
+    }
+    
     /* Main event loop */
-    while (running) {
-        /* Receive TimeFrame from tester */
-        char *input = uds_receive_message(sock);
+    while (tf && tick && running) {
+        /* Receive TimeFrame from tester (valid until the next receive) */
+        size_t length = 0;
+        char *input = uds_conn_receive(conn, &length);
         if (!input) {
             if (errno == 0) {
                 fprintf(stderr, "Connection closed by peer\n");
@@ -148,49 +670,49 @@ int main(int argc, char *argv[]) {
         }
         
         /* Parse TimeFrame */
-        TimeFrame *tf = json_parse_timeframe(input);
-        if (!tf) {
+        uint64_t phase_start = stats_start(sched->stats);
+        if (codec_decode(codec, input, length, tf) < 0) {
             fprintf(stderr, "Error: Failed to parse TimeFrame\n");
-            free(input);
             continue;
         }
+        stats_lap(sched->stats, STAT_PARSE, phase_start);
         
         /* Process all events in this TimeFrame */
-        for (int i = 0; i < tf->event_count; i++) {
-            if (scheduler_process_event(sched, tf->events[i]) < 0) {
-                fprintf(stderr, "Warning: Failed to process event %d at vtime %d\n", 
-                        i, tf->vtime);
-            }
+        int failed = scheduler_process_events(sched, tf->events, tf->event_count);
+        if (failed > 0) {
+            fprintf(stderr, "Warning: Failed to process %d of %d events at vtime %d\n",
+                    failed, tf->event_count, tf->vtime);
         }
         
         /* Run scheduler for this tick */
-        SchedulerTick *tick = scheduler_tick(sched, tf->vtime);
-        if (!tick) {
+        if (scheduler_tick_into(sched, tf->vtime, tick) < 0) {
             fprintf(stderr, "Error: Failed to generate scheduler tick\n");
-            json_free_timeframe(tf);
-            free(input);
             continue;
         }
         
         /* Serialize and send response */
-        char *output = json_serialize_tick(tick, include_metadata);
-        if (output) {
-            if (uds_send_message(sock, output) < 0) {
+        phase_start = stats_start(sched->stats);
+        if (codec_encode(codec, tick, include_metadata, &output) == 0) {
+            stats_lap(sched->stats, STAT_SERIALIZE, phase_start);
+            if (uds_conn_send_output(conn, &output) < 0) {
                 fprintf(stderr, "Error: Failed to send response\n");
             }
-            free(output);
         } else {
             fprintf(stderr, "Error: Failed to serialize scheduler tick\n");
         }
-        
-        /* Cleanup */
-        scheduler_tick_free(tick);
-        json_free_timeframe(tf);
-        free(input);
+        stats_report_if_due(sched->stats, stderr);
+        checkpoint_poll(sched->checkpoint, sched);
     }
     
     /* Cleanup */
+    json_output_free(&output);
+    scheduler_tick_free(tick);
+    json_free_timeframe(tf);
     fprintf(stderr, "\nShutting down...\n");
+    stats_report(sched->stats, stderr);
+    finish_checkpoint(sched);
+    codec_destroy(codec);
+    uds_conn_destroy(conn);
     uds_disconnect(sock);
     scheduler_destroy(sched);
     
@@ -0,0 +1,182 @@
+/**
+ * ALFS - Pairing Heap Implementation
+ *
+ * Each node keeps its first child (qnode.left), its next sibling
+ * (qnode.right) and the node before it (qnode.parent): the previous
+ * sibling, or the parent for a first child. That back link lets any
+ * task be cut out in O(1) without searching its sibling list.
+ * - O(1) insert (meld with the root)
+ * - Amortized O(log n) extract-min (two-pass pairing)
+ * - O(1) peek
+ * - Amortized O(log n) remove and update (cut, pair the children, meld)
+ */
+
+#include <stddef.h>
+#include "pairing_heap.h"
+#include "heap.h"
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+/**
+ * Meld two detached roots; the loser becomes the winner's first child
+ */
+static Task *meld(Task *a, Task *b) {
+    if (!a) {
+        return b;
+    }
+    if (!b) {
+        return a;
+    }
+    if (task_before(b, a)) {
+        Task *temp = a;
+        a = b;
+        b = temp;
+    }
+
+    b->qnode.parent = a;
+    b->qnode.right = a->qnode.left;
+    if (a->qnode.left) {
+        a->qnode.left->qnode.parent = b;
+    }
+    a->qnode.left = b;
+    return a;
+}
+
+/**
+ * Meld a sibling list into one tree: adjacent pairs left to right, then
+ * the pair results right to left
+ */
+static Task *merge_pairs(Task *first) {
+    Task *stack = NULL;
+
+    /* First pass: results are stacked through their (now unused) sibling links */
+    while (first) {
+        Task *a = first;
+        Task *b = a->qnode.right;
+        first = b ? b->qnode.right : NULL;
+
+        a->qnode.right = NULL;
+        a->qnode.parent = NULL;
+        if (b) {
+            b->qnode.right = NULL;
+            b->qnode.parent = NULL;
+            a = meld(a, b);
+        }
+        a->qnode.right = stack;
+        stack = a;
+    }
+
+    /* Second pass: the last pair first */
+    Task *root = NULL;
+    while (stack) {
+        Task *next = stack->qnode.right;
+        stack->qnode.right = NULL;
+        root = meld(root, stack);
+        stack = next;
+    }
+    return root;
+}
+
+/**
+ * Unlink a non-root task (with its subtree) from its sibling list
+ */
+static void cut(Task *task) {
+    Task *prev = task->qnode.parent;
+    if (prev->qnode.left == task) {
+        prev->qnode.left = task->qnode.right;
+    } else {
+        prev->qnode.right = task->qnode.right;
+    }
+    if (task->qnode.right) {
+        task->qnode.right->qnode.parent = prev;
+    }
+    task->qnode.parent = NULL;
+    task->qnode.right = NULL;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void pairing_heap_init(PairingHeap *heap) {
+    heap->root = NULL;
+    heap->size = 0;
+}
+
+void pairing_heap_insert(PairingHeap *heap, Task *task) {
+    task->qnode.left = NULL;
+    task->qnode.right = NULL;
+    task->qnode.parent = NULL;
+    task->heap_index = 0;
+    heap->root = meld(heap->root, task);
+    heap->size++;
+}
+
+Task *pairing_heap_extract_min(PairingHeap *heap) {
+    Task *min_task = heap->root;
+    if (!min_task) {
+        return NULL;
+    }
+
+    heap->root = merge_pairs(min_task->qnode.left);
+    heap->size--;
+    min_task->qnode.left = NULL;
+    min_task->heap_index = -1;
+    return min_task;
+}
+
+void pairing_heap_remove(PairingHeap *heap, Task *task) {
+    if (task == heap->root) {
+        pairing_heap_extract_min(heap);
+        return;
+    }
+
+    cut(task);
+    heap->root = meld(heap->root, merge_pairs(task->qnode.left));
+    heap->size--;
+    task->qnode.left = NULL;
+    task->heap_index = -1;
+}
+
+void pairing_heap_update(PairingHeap *heap, Task *task) {
+    /* The key may have moved either way, so its children may now outrank it */
+    pairing_heap_remove(heap, task);
+    pairing_heap_insert(heap, task);
+}
+
+Task *pairing_heap_last(const PairingHeap *heap) {
+    if (!heap->root) {
+        return NULL;
+    }
+    return heap->root->qnode.left ? heap->root->qnode.left : heap->root;
+}
+
+int pairing_heap_validate(const PairingHeap *heap) {
+    if (heap->size < 0 || (heap->size == 0) != (heap->root == NULL)) {
+        return -1;
+    }
+    if (!heap->root) {
+        return 0;
+    }
+    if (heap->root->qnode.parent || heap->root->qnode.right) {
+        return -1;
+    }
+
+    int count = 0;
+    for (const Task *node = heap->root; node; node = task_node_next(node)) {
+        if (node->heap_index != 0 || ++count > heap->size) {
+            return -1;
+        }
+        const Task *prev = node;
+        for (const Task *child = node->qnode.left; child; child = child->qnode.right) {
+            if (child->qnode.parent != prev || task_before(child, node)) {
+                return -1;
+            }
+            prev = child;
+        }
+    }
+
+    return count == heap->size ? 0 : -1;
+}
@@ -0,0 +1,235 @@
+/**
+ * ALFS - Pipelined I/O Implementation
+ *
+ * Stage threads:
+ * - Reader: uds_conn_receive + codec_decode, pushes TimeFrames
+ * - Scheduler (calling thread): applies events and runs the tick
+ * - Writer: codec_encode + uds_conn_send_output, hands the tick back
+ *
+ * Each queue has one producer and one consumer and is FIFO, so output
+ * order matches input order. NULL flows down both queues as the end of
+ * stream marker. Only the scheduler stage touches the Scheduler, including
+ * the ID references a tick pins: sent ticks return through the spare
+ * queue and are released and refilled by scheduler_tick_into. Processed
+ * TimeFrames return to the reader the same way.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include "pipeline.h"
+#include "spsc.h"
+#include "scheduler.h"
+#include "uds.h"
+#include "json_handler.h"
+#include "codec.h"
+#include "stats.h"
+#include "checkpoint.h"
+
+#define PIPELINE_QUEUE_DEPTH 64
+
+/* Ticks (or TimeFrames) in flight: queued, being consumed and being filled */
+#define PIPELINE_MAX_TICKS (PIPELINE_QUEUE_DEPTH + 2)
+
+typedef struct {
+    UdsConn *conn;
+    Codec *codec;                   /* Decoder state is only touched by the reader */
+    bool include_meta;
+    SchedStats *stats;              /* Each stage records its own phases */
+    SpscQueue frames;               /* Reader -> scheduler: TimeFrame * */
+    SpscQueue ticks;                /* Scheduler -> writer: SchedulerTick * */
+    SpscQueue spare;                /* Writer -> scheduler: sent ticks to reuse */
+    SpscQueue spare_frames;         /* Scheduler -> reader: TimeFrames to reuse */
+} Pipeline;
+
+/* ============================================================================
+ * Stage Threads
+ * ============================================================================ */
+
+/**
+ * Receive and parse timeframes until the connection closes
+ */
+static void *pipeline_reader(void *arg) {
+    Pipeline *pipeline = arg;
+    TimeFrame *held = NULL;         /* Frame kept after a parse error */
+    
+    while (1) {
+        size_t length = 0;
+        char *input = uds_conn_receive(pipeline->conn, &length);
+        if (!input) {
+            if (errno == 0) {
+                fprintf(stderr, "Connection closed by peer\n");
+            } else {
+                fprintf(stderr, "Error receiving message: %s\n", strerror(errno));
+            }
+            break;
+        }
+        
+        /* Reuse a processed frame; a new one is only made while scheduling lags */
+        void *spare = NULL;
+        if (!held) {
+            held = spsc_try_pop(&pipeline->spare_frames, &spare) ? spare : json_timeframe_create();
+        }
+        uint64_t start = stats_start(pipeline->stats);
+        if (!held || codec_decode(pipeline->codec, input, length, held) < 0) {
+            fprintf(stderr, "Error: Failed to parse TimeFrame\n");
+            continue;
+        }
+        stats_lap(pipeline->stats, STAT_PARSE, start);
+        spsc_push(&pipeline->frames, held);
+        held = NULL;
+    }
+    
+    json_free_timeframe(held);
+    spsc_push(&pipeline->frames, NULL);
+    return NULL;
+}
+
+/**
+ * Serialize and send ticks until the end marker arrives, then return each
+ * one for reuse (it can never block: spare holds every tick ever made)
+ */
+static void *pipeline_writer(void *arg) {
+    Pipeline *pipeline = arg;
+    OutputBuffer output = {0};
+    SchedulerTick *tick;
+    
+    while ((tick = spsc_pop(&pipeline->ticks)) != NULL) {
+        uint64_t start = stats_start(pipeline->stats);
+        if (codec_encode(pipeline->codec, tick, pipeline->include_meta, &output) == 0) {
+            stats_lap(pipeline->stats, STAT_SERIALIZE, start);
+            if (uds_conn_send_output(pipeline->conn, &output) < 0) {
+                fprintf(stderr, "Error: Failed to send response\n");
+            }
+        } else {
+            fprintf(stderr, "Error: Failed to serialize scheduler tick\n");
+        }
+        spsc_push(&pipeline->spare, tick);
+    }
+    
+    json_output_free(&output);
+    return NULL;
+}
+
+/**
+ * Stop the reader and discard what it already queued, up to its end marker
+ */
+static void pipeline_drain_reader(Pipeline *pipeline) {
+    shutdown(pipeline->conn->sock, SHUT_RD);
+    TimeFrame *tf;
+    while ((tf = spsc_pop(&pipeline->frames)) != NULL) {
+        json_free_timeframe(tf);
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int pipeline_run(Scheduler *sched, UdsConn *conn, Codec *codec, bool include_meta,
+                 volatile int *running) {
+    if (!sched || !conn || !codec || !running) {
+        return -1;
+    }
+    
+    Pipeline pipeline;
+    pipeline.conn = conn;
+    pipeline.codec = codec;
+    pipeline.include_meta = include_meta;
+    pipeline.stats = sched->stats;
+    if (spsc_init(&pipeline.frames, PIPELINE_QUEUE_DEPTH) < 0) {
+        return -1;
+    }
+    if (spsc_init(&pipeline.ticks, PIPELINE_QUEUE_DEPTH) < 0) {
+        spsc_destroy(&pipeline.frames);
+        return -1;
+    }
+    if (spsc_init(&pipeline.spare, PIPELINE_MAX_TICKS) < 0) {
+        spsc_destroy(&pipeline.ticks);
+        spsc_destroy(&pipeline.frames);
+        return -1;
+    }
+    if (spsc_init(&pipeline.spare_frames, PIPELINE_MAX_TICKS) < 0) {
+        spsc_destroy(&pipeline.spare);
+        spsc_destroy(&pipeline.ticks);
+        spsc_destroy(&pipeline.frames);
+        return -1;
+    }
+    
+    /* Stage threads leave signal handling to the calling thread */
+    sigset_t blocked, previous;
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    
+    pthread_t reader, writer;
+    bool reader_started = pthread_create(&reader, NULL, pipeline_reader, &pipeline) == 0;
+    bool writer_started = reader_started &&
+                          pthread_create(&writer, NULL, pipeline_writer, &pipeline) == 0;
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    
+    if (!writer_started) {
+        if (reader_started) {
+            pipeline_drain_reader(&pipeline);
+            pthread_join(reader, NULL);
+        }
+        spsc_destroy(&pipeline.spare_frames);
+        spsc_destroy(&pipeline.spare);
+        spsc_destroy(&pipeline.ticks);
+        spsc_destroy(&pipeline.frames);
+        return -1;
+    }
+    
+    /* Scheduling stage: the only code on the critical path */
+    TimeFrame *tf;
+    while ((tf = spsc_pop(&pipeline.frames)) != NULL) {
+        int failed = scheduler_process_events(sched, tf->events, tf->event_count);
+        if (failed > 0) {
+            fprintf(stderr, "Warning: Failed to process %d of %d events at vtime %d\n",
+                    failed, tf->event_count, tf->vtime);
+        }
+        
+        /* Reuse a sent tick; a new one is only made while the writer lags */
+        void *spare = NULL;
+        SchedulerTick *tick = spsc_try_pop(&pipeline.spare, &spare) ?
+                              spare : scheduler_tick_create(sched);
+        if (tick && scheduler_tick_into(sched, tf->vtime, tick) == 0) {
+            spsc_push(&pipeline.ticks, tick);
+        } else {
+            fprintf(stderr, "Error: Failed to generate scheduler tick\n");
+            scheduler_tick_free(tick);
+        }
+        spsc_push(&pipeline.spare_frames, tf);
+        stats_report_if_due(sched->stats, stderr);
+        checkpoint_poll(sched->checkpoint, sched);
+        
+        /* Signalled: stop reading, the writer still flushes what is queued */
+        if (!*running) {
+            pipeline_drain_reader(&pipeline);
+            break;
+        }
+    }
+    
+    spsc_push(&pipeline.ticks, NULL);
+    pthread_join(writer, NULL);
+    pthread_join(reader, NULL);
+    
+    /* Every tick and frame is back in a spare queue once the stages exited */
+    void *spare;
+    while (spsc_try_pop(&pipeline.spare, &spare)) {
+        scheduler_tick_free(spare);
+    }
+    while (spsc_try_pop(&pipeline.spare_frames, &spare)) {
+        json_free_timeframe(spare);
+    }
+    
+    spsc_destroy(&pipeline.spare_frames);
+    spsc_destroy(&pipeline.spare);
+    spsc_destroy(&pipeline.ticks);
+    spsc_destroy(&pipeline.frames);
+    return 0;
+}
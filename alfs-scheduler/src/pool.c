@@ -0,0 +1,88 @@
+/**
+ * ALFS - Slab Pool Implementation
+ *
+ * Each slab is one aligned allocation: a header padded to the slot
+ * alignment, then per_slab slots. A new slab's slots are pushed onto the
+ * free list in reverse so allocation walks it in address order; freed
+ * slots go back on top, so the most recently released (cache-warm) slot
+ * is reused first.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include "pool.h"
+
+static inline size_t round_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+void pool_init(Pool *pool, size_t object_size, size_t align, size_t per_slab) {
+    if (align < sizeof(void *)) {
+        align = sizeof(void *);
+    }
+    memset(pool, 0, sizeof(*pool));
+    pool->align = align;
+    pool->object_size = round_up(object_size > sizeof(void *) ? object_size : sizeof(void *), align);
+    pool->per_slab = per_slab > 0 ? per_slab : 1;
+}
+
+void pool_destroy(Pool *pool) {
+    if (!pool) {
+        return;
+    }
+    PoolSlab *slab = pool->slabs;
+    while (slab) {
+        PoolSlab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->live = 0;
+    pool->slab_count = 0;
+}
+
+/**
+ * Allocate one slab and put all of its slots on the free list
+ */
+static int pool_grow(Pool *pool) {
+    size_t header = round_up(sizeof(PoolSlab), pool->align);
+    size_t bytes = round_up(header + pool->object_size * pool->per_slab, pool->align);
+    PoolSlab *slab = aligned_alloc(pool->align, bytes);
+    if (!slab) {
+        return -1;
+    }
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->slab_count++;
+
+    char *slots = (char *)slab + header;
+    for (size_t i = pool->per_slab; i-- > 0;) {
+        void *slot = slots + i * pool->object_size;
+        *(void **)slot = pool->free_list;
+        pool->free_list = slot;
+    }
+    return 0;
+}
+
+void *pool_alloc(Pool *pool) {
+    if (!pool->free_list && pool_grow(pool) < 0) {
+        return NULL;
+    }
+    void *object = pool->free_list;
+    pool->free_list = *(void **)object;
+    pool->live++;
+    memset(object, 0, pool->object_size);
+    return object;
+}
+
+void pool_free(Pool *pool, void *object) {
+    if (!object) {
+        return;
+    }
+    *(void **)object = pool->free_list;
+    pool->free_list = object;
+    pool->live--;
+}
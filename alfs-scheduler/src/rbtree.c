@@ -0,0 +1,459 @@
+/**
+ * ALFS - Red-Black Tree Implementation
+ *
+ * The structure CFS uses for its timeline: tasks are nodes themselves
+ * (no allocation on insert), ordered by task_before(), with the leftmost
+ * node cached so picking the next task is O(1).
+ * - O(log n) insert, at most two rotations
+ * - O(log n) remove, at most three rotations
+ * - O(1) peek (cached leftmost)
+ * - O(1) update when the task keeps its place, O(log n) otherwise
+ *
+ * Missing children are NULL and count as black.
+ *
+ * An augmented tree (the EEVDF run queue) also keeps, in every node, the
+ * task with the earliest virtual deadline in that node's subtree. Links
+ * are recomputed bottom-up after each splice and locally in rotations,
+ * so they stay exact at O(log n) per change, and picking the earliest
+ * eligible deadline is a single root-to-leaf walk.
+ */
+
+#include <stddef.h>
+#include "rbtree.h"
+#include "heap.h"
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+static inline bool is_red(const Task *task) {
+    return task && task->qnode.red;
+}
+
+static Task *subtree_min(Task *task) {
+    while (task->qnode.left) {
+        task = task->qnode.left;
+    }
+    return task;
+}
+
+/**
+ * In-order successor, or NULL for the rightmost task
+ */
+static Task *successor(const Task *task) {
+    if (task->qnode.right) {
+        return subtree_min(task->qnode.right);
+    }
+    while (task->qnode.parent && task->qnode.parent->qnode.right == task) {
+        task = task->qnode.parent;
+    }
+    return task->qnode.parent;
+}
+
+/**
+ * In-order predecessor, or NULL for the leftmost task
+ */
+static Task *predecessor(const Task *task) {
+    if (task->qnode.left) {
+        Task *node = task->qnode.left;
+        while (node->qnode.right) {
+            node = node->qnode.right;
+        }
+        return node;
+    }
+    while (task->qnode.parent && task->qnode.parent->qnode.left == task) {
+        task = task->qnode.parent;
+    }
+    return task->qnode.parent;
+}
+
+/**
+ * Which of two subtree minima has the earlier deadline (either may be NULL)
+ */
+static inline Task *earlier_deadline(Task *a, Task *b) {
+    if (!a) {
+        return b;
+    }
+    if (!b) {
+        return a;
+    }
+    return deadline_before(b, a) ? b : a;
+}
+
+/**
+ * Recompute a node's subtree minimum from itself and its children
+ */
+static inline Task *subtree_min_deadline(Task *task) {
+    Task *min_task = task;
+    if (task->qnode.left) {
+        min_task = earlier_deadline(min_task, task->qnode.left->qnode.min_deadline);
+    }
+    if (task->qnode.right) {
+        min_task = earlier_deadline(min_task, task->qnode.right->qnode.min_deadline);
+    }
+    return min_task;
+}
+
+/**
+ * Recompute the deadline minima from a node up to the root
+ */
+static void augment_path(const RbTree *tree, Task *task) {
+    if (!tree->augmented) {
+        return;
+    }
+    for (; task; task = task->qnode.parent) {
+        task->qnode.min_deadline = subtree_min_deadline(task);
+    }
+}
+
+/**
+ * After x rotated below y: y now spans x's old subtree, x lost a child
+ */
+static inline void augment_rotate(const RbTree *tree, Task *x, Task *y) {
+    if (tree->augmented) {
+        y->qnode.min_deadline = x->qnode.min_deadline;
+        x->qnode.min_deadline = subtree_min_deadline(x);
+    }
+}
+
+/**
+ * Point the link that referenced old (a child of parent, or the root) at new
+ */
+static void replace_child(RbTree *tree, Task *parent, Task *old, Task *new) {
+    if (!parent) {
+        tree->root = new;
+    } else if (parent->qnode.left == old) {
+        parent->qnode.left = new;
+    } else {
+        parent->qnode.right = new;
+    }
+}
+
+static void rotate_left(RbTree *tree, Task *x) {
+    Task *y = x->qnode.right;
+    x->qnode.right = y->qnode.left;
+    if (y->qnode.left) {
+        y->qnode.left->qnode.parent = x;
+    }
+    y->qnode.parent = x->qnode.parent;
+    replace_child(tree, x->qnode.parent, x, y);
+    y->qnode.left = x;
+    x->qnode.parent = y;
+    augment_rotate(tree, x, y);
+}
+
+static void rotate_right(RbTree *tree, Task *x) {
+    Task *y = x->qnode.left;
+    x->qnode.left = y->qnode.right;
+    if (y->qnode.right) {
+        y->qnode.right->qnode.parent = x;
+    }
+    y->qnode.parent = x->qnode.parent;
+    replace_child(tree, x->qnode.parent, x, y);
+    y->qnode.right = x;
+    x->qnode.parent = y;
+    augment_rotate(tree, x, y);
+}
+
+/**
+ * Restore the red-black properties after inserting red node z
+ */
+static void insert_fixup(RbTree *tree, Task *z) {
+    Task *parent;
+    while (is_red(parent = z->qnode.parent)) {
+        /* A red parent is never the root, so the grandparent exists */
+        Task *grand = parent->qnode.parent;
+        if (parent == grand->qnode.left) {
+            Task *uncle = grand->qnode.right;
+            if (is_red(uncle)) {
+                parent->qnode.red = false;
+                uncle->qnode.red = false;
+                grand->qnode.red = true;
+                z = grand;
+                continue;
+            }
+            if (z == parent->qnode.right) {
+                rotate_left(tree, parent);
+                z = parent;
+                parent = z->qnode.parent;
+            }
+            parent->qnode.red = false;
+            grand->qnode.red = true;
+            rotate_right(tree, grand);
+        } else {
+            Task *uncle = grand->qnode.left;
+            if (is_red(uncle)) {
+                parent->qnode.red = false;
+                uncle->qnode.red = false;
+                grand->qnode.red = true;
+                z = grand;
+                continue;
+            }
+            if (z == parent->qnode.left) {
+                rotate_right(tree, parent);
+                z = parent;
+                parent = z->qnode.parent;
+            }
+            parent->qnode.red = false;
+            grand->qnode.red = true;
+            rotate_left(tree, grand);
+        }
+    }
+    tree->root->qnode.red = false;
+}
+
+/**
+ * Restore the red-black properties after removing a black node whose
+ * place x (possibly NULL) now takes under parent
+ */
+static void remove_fixup(RbTree *tree, Task *x, Task *parent) {
+    while (x != tree->root && !is_red(x)) {
+        /* x is one black short, so its sibling subtree is never empty */
+        if (x == parent->qnode.left) {
+            Task *sibling = parent->qnode.right;
+            if (is_red(sibling)) {
+                sibling->qnode.red = false;
+                parent->qnode.red = true;
+                rotate_left(tree, parent);
+                sibling = parent->qnode.right;
+            }
+            if (!is_red(sibling->qnode.left) && !is_red(sibling->qnode.right)) {
+                sibling->qnode.red = true;
+                x = parent;
+                parent = x->qnode.parent;
+                continue;
+            }
+            if (!is_red(sibling->qnode.right)) {
+                sibling->qnode.left->qnode.red = false;
+                sibling->qnode.red = true;
+                rotate_right(tree, sibling);
+                sibling = parent->qnode.right;
+            }
+            sibling->qnode.red = parent->qnode.red;
+            parent->qnode.red = false;
+            sibling->qnode.right->qnode.red = false;
+            rotate_left(tree, parent);
+        } else {
+            Task *sibling = parent->qnode.left;
+            if (is_red(sibling)) {
+                sibling->qnode.red = false;
+                parent->qnode.red = true;
+                rotate_right(tree, parent);
+                sibling = parent->qnode.left;
+            }
+            if (!is_red(sibling->qnode.left) && !is_red(sibling->qnode.right)) {
+                sibling->qnode.red = true;
+                x = parent;
+                parent = x->qnode.parent;
+                continue;
+            }
+            if (!is_red(sibling->qnode.left)) {
+                sibling->qnode.right->qnode.red = false;
+                sibling->qnode.red = true;
+                rotate_left(tree, sibling);
+                sibling = parent->qnode.left;
+            }
+            sibling->qnode.red = parent->qnode.red;
+            parent->qnode.red = false;
+            sibling->qnode.left->qnode.red = false;
+            rotate_right(tree, parent);
+        }
+        x = tree->root;
+    }
+    if (x) {
+        x->qnode.red = false;
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void rbtree_init(RbTree *tree, bool augmented) {
+    tree->root = NULL;
+    tree->leftmost = NULL;
+    tree->size = 0;
+    tree->augmented = augmented;
+}
+
+void rbtree_insert(RbTree *tree, Task *task) {
+    Task *parent = NULL;
+    Task **link = &tree->root;
+    bool leftmost = true;
+
+    while (*link) {
+        parent = *link;
+        if (task_before(task, parent)) {
+            link = &parent->qnode.left;
+        } else {
+            link = &parent->qnode.right;
+            leftmost = false;
+        }
+    }
+
+    task->qnode.left = NULL;
+    task->qnode.right = NULL;
+    task->qnode.parent = parent;
+    task->qnode.red = true;
+    task->qnode.min_deadline = task;
+    task->heap_index = 0;
+    *link = task;
+    if (leftmost) {
+        tree->leftmost = task;
+    }
+
+    augment_path(tree, parent);
+    insert_fixup(tree, task);
+    tree->size++;
+}
+
+void rbtree_remove(RbTree *tree, Task *task) {
+    if (tree->leftmost == task) {
+        tree->leftmost = successor(task);
+    }
+
+    Task *x;
+    Task *x_parent;
+    bool removed_red;
+
+    if (!task->qnode.left || !task->qnode.right) {
+        /* At most one child: it takes the task's place */
+        x = task->qnode.left ? task->qnode.left : task->qnode.right;
+        x_parent = task->qnode.parent;
+        removed_red = task->qnode.red;
+        replace_child(tree, x_parent, task, x);
+        if (x) {
+            x->qnode.parent = x_parent;
+        }
+    } else {
+        /* Two children: the successor moves into the task's place */
+        Task *next = subtree_min(task->qnode.right);
+        removed_red = next->qnode.red;
+        x = next->qnode.right;
+        if (next->qnode.parent == task) {
+            x_parent = next;
+        } else {
+            x_parent = next->qnode.parent;
+            x_parent->qnode.left = x;
+            if (x) {
+                x->qnode.parent = x_parent;
+            }
+            next->qnode.right = task->qnode.right;
+            next->qnode.right->qnode.parent = next;
+        }
+        replace_child(tree, task->qnode.parent, task, next);
+        next->qnode.parent = task->qnode.parent;
+        next->qnode.left = task->qnode.left;
+        next->qnode.left->qnode.parent = next;
+        next->qnode.red = task->qnode.red;
+    }
+
+    /* Every node whose subtree changed is on the path up from x_parent */
+    augment_path(tree, x_parent);
+    if (!removed_red) {
+        remove_fixup(tree, x, x_parent);
+    }
+
+    task->qnode.left = NULL;
+    task->qnode.right = NULL;
+    task->qnode.parent = NULL;
+    task->qnode.min_deadline = NULL;
+    task->heap_index = -1;
+    tree->size--;
+}
+
+Task *rbtree_extract_min(RbTree *tree) {
+    Task *min_task = tree->leftmost;
+    if (min_task) {
+        rbtree_remove(tree, min_task);
+    }
+    return min_task;
+}
+
+void rbtree_update(RbTree *tree, Task *task) {
+    const Task *prev = predecessor(task);
+    const Task *next = successor(task);
+    if ((!prev || task_before(prev, task)) && (!next || task_before(task, next))) {
+        /* In place, but the deadline may have moved */
+        augment_path(tree, task);
+        return;
+    }
+    rbtree_remove(tree, task);
+    rbtree_insert(tree, task);
+}
+
+Task *rbtree_last(const RbTree *tree) {
+    Task *task = tree->root;
+    while (task && task->qnode.right) {
+        task = task->qnode.right;
+    }
+    return task;
+}
+
+Task *rbtree_pick_eligible(const RbTree *tree, vruntime_t avg_vruntime) {
+    Task *best = NULL;
+    Task *node = tree->root;
+    while (node) {
+        if (node->vruntime > avg_vruntime) {
+            /* Ineligible, and so is everything to its right */
+            node = node->qnode.left;
+            continue;
+        }
+        /* Eligible, and so is everything to its left */
+        best = earlier_deadline(best, node);
+        if (node->qnode.left) {
+            best = earlier_deadline(best, node->qnode.left->qnode.min_deadline);
+        }
+        node = node->qnode.right;
+    }
+    return best;
+}
+
+int rbtree_validate(const RbTree *tree) {
+    if (tree->size < 0 || (tree->size == 0) != (tree->root == NULL)) {
+        return -1;
+    }
+    if (!tree->root) {
+        return tree->leftmost ? -1 : 0;
+    }
+    if (tree->root->qnode.parent || tree->root->qnode.red ||
+        tree->leftmost != subtree_min(tree->root)) {
+        return -1;
+    }
+
+    /* Black height along the leftmost path; every NULL link must match it */
+    int black_height = 0;
+    for (const Task *node = tree->root; node; node = node->qnode.left) {
+        black_height += !node->qnode.red;
+    }
+
+    int count = 0;
+    const Task *prev = NULL;
+    for (const Task *node = tree->leftmost; node; node = successor(node)) {
+        if (node->heap_index != 0 || ++count > tree->size ||
+            (prev && !task_before(prev, node))) {
+            return -1;
+        }
+        const Task *left = node->qnode.left;
+        const Task *right = node->qnode.right;
+        if ((left && left->qnode.parent != node) || (right && right->qnode.parent != node) ||
+            (node->qnode.red && (is_red(left) || is_red(right)))) {
+            return -1;
+        }
+        if (tree->augmented && node->qnode.min_deadline != subtree_min_deadline((Task *)node)) {
+            return -1;
+        }
+        if (!left || !right) {
+            int blacks = 0;
+            for (const Task *up = node; up; up = up->qnode.parent) {
+                blacks += !up->qnode.red;
+            }
+            if (blacks != black_height) {
+                return -1;
+            }
+        }
+        prev = node;
+    }
+
+    return count == tree->size ? 0 : -1;
+}
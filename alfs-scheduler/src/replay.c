@@ -0,0 +1,306 @@
+/**
+ * ALFS - Trace Replay Implementation
+ *
+ * The trace is mapped read-only and split into messages in place. Binary
+ * frames are decoded straight from the mapping; JSON messages are copied
+ * into one reusable NUL-terminated buffer first, because the parser stops
+ * at the terminator and a mapped line has none. Ticks go through a large
+ * stdio buffer, so the output costs one write() per megabyte.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "replay.h"
+#include "codec.h"
+#include "json_handler.h"
+#include "scheduler.h"
+#include "stats.h"
+#include "checkpoint.h"
+
+#define REPLAY_OUTPUT_BUFFER (1024 * 1024)
+#define REPLAY_LENGTH_HEADER 4              /* Big-endian, as on the socket */
+
+_Static_assert(OUTPUT_HEADROOM >= REPLAY_LENGTH_HEADER, "output headroom must fit a length header");
+
+typedef struct {
+    const char *data;               /* Mapped trace */
+    size_t size;
+    size_t pos;                     /* Start of the next message */
+    bool binary;                    /* Length-prefixed binary frames */
+    bool array;                     /* JSON array of timeframes, not JSON-lines */
+    char *copy;                     /* NUL-terminated copy of a JSON message */
+    size_t copy_capacity;
+} Trace;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* ============================================================================
+ * Trace Splitting
+ * ============================================================================ */
+
+/**
+ * Length of the JSON object starting at data (to its closing brace, or
+ * the end of the trace if it never closes)
+ */
+static size_t json_object_length(const char *data, size_t size) {
+    int depth = 0;
+    bool in_string = false;
+    bool escaped = false;
+    for (size_t i = 0; i < size; i++) {
+        char c = data[i];
+        if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                in_string = false;
+            }
+        } else if (c == '"') {
+            in_string = true;
+        } else if (c == '{') {
+            depth++;
+        } else if (c == '}' && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return size;
+}
+
+static const char *trace_copy(Trace *trace, const char *start, size_t length) {
+    if (length + 1 > trace->copy_capacity) {
+        size_t capacity = trace->copy_capacity ? trace->copy_capacity : 4096;
+        while (capacity < length + 1) {
+            capacity *= 2;
+        }
+        char *grown = realloc(trace->copy, capacity);
+        if (!grown) {
+            return NULL;
+        }
+        trace->copy = grown;
+        trace->copy_capacity = capacity;
+    }
+    memcpy(trace->copy, start, length);
+    trace->copy[length] = '\0';
+    return trace->copy;
+}
+
+/**
+ * Find the next message
+ * @return 1 if found, 0 at the end of the trace, -1 on a truncated
+ *         binary frame or allocation failure
+ */
+static int trace_next(Trace *trace, const char **message, size_t *length) {
+    const char *data = trace->data;
+    size_t size = trace->size;
+
+    if (trace->binary) {
+        if (trace->pos == size) {
+            return 0;
+        }
+        if (size - trace->pos < REPLAY_LENGTH_HEADER) {
+            return -1;
+        }
+        const unsigned char *header = (const unsigned char *)data + trace->pos;
+        size_t payload = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) |
+                         ((size_t)header[2] << 8) | (size_t)header[3];
+        if (payload > size - trace->pos - REPLAY_LENGTH_HEADER) {
+            return -1;
+        }
+        *message = data + trace->pos + REPLAY_LENGTH_HEADER;
+        *length = payload;
+        trace->pos += REPLAY_LENGTH_HEADER + payload;
+        return 1;
+    }
+
+    /* Skip blank lines, and the brackets and commas around array elements */
+    size_t pos = trace->pos;
+    while (pos < size && (isspace((unsigned char)data[pos]) ||
+                          (trace->array && (data[pos] == ',' || data[pos] == '[' || data[pos] == ']')))) {
+        pos++;
+    }
+    if (pos == size) {
+        trace->pos = size;
+        return 0;
+    }
+
+    /* An array element is one object; anything else runs to the end of its line */
+    size_t count;
+    if (trace->array && data[pos] == '{') {
+        count = json_object_length(data + pos, size - pos);
+    } else {
+        const char *newline = memchr(data + pos, '\n', size - pos);
+        count = newline ? (size_t)(newline - (data + pos)) : size - pos;
+    }
+    trace->pos = pos + count;
+
+    *message = trace_copy(trace, data + pos, count);
+    *length = count;
+    return *message ? 1 : -1;
+}
+
+/* ============================================================================
+ * Output
+ * ============================================================================ */
+
+/**
+ * Append one encoded tick: length-prefixed for binary, a line for JSON
+ */
+static int write_tick(FILE *out, bool binary, OutputBuffer *buf, size_t *written) {
+    char *start = buf->data + OUTPUT_HEADROOM;
+    size_t length = buf->length;
+    if (binary) {
+        start -= REPLAY_LENGTH_HEADER;
+        start[0] = (char)(length >> 24);
+        start[1] = (char)(length >> 16);
+        start[2] = (char)(length >> 8);
+        start[3] = (char)length;
+        length += REPLAY_LENGTH_HEADER;
+    } else {
+        start[length++] = '\n';     /* Overwrites the terminator */
+    }
+    *written += length;
+    return fwrite(start, 1, length, out) == length ? 0 : -1;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int replay_run(Scheduler *sched, Codec *codec, const char *trace_path,
+               const char *output_path, bool include_meta,
+               volatile int *running, ReplayStats *stats) {
+    if (!sched || !codec || !trace_path || !running) {
+        return -1;
+    }
+
+    ReplayStats totals;
+    memset(&totals, 0, sizeof(totals));
+
+    int fd = open(trace_path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open trace %s: %s\n", trace_path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        fprintf(stderr, "Error: Cannot stat trace %s: %s\n", trace_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    Trace trace;
+    memset(&trace, 0, sizeof(trace));
+    trace.size = (size_t)st.st_size;
+    trace.binary = codec->protocol == WIRE_BINARY;
+    if (trace.size > 0) {
+        void *map = mmap(NULL, trace.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "Error: Cannot map trace %s: %s\n", trace_path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        posix_madvise(map, trace.size, POSIX_MADV_SEQUENTIAL);
+        trace.data = map;
+    }
+    close(fd);
+    totals.input_bytes = trace.size;
+
+    /* A leading '[' means an array of timeframes rather than JSON-lines */
+    for (size_t i = 0; !trace.binary && i < trace.size; i++) {
+        if (!isspace((unsigned char)trace.data[i])) {
+            trace.array = trace.data[i] == '[';
+            break;
+        }
+    }
+
+    bool to_stdout = !output_path || strcmp(output_path, "-") == 0;
+    FILE *out = to_stdout ? stdout : fopen(output_path, "w");
+    if (!out) {
+        fprintf(stderr, "Error: Cannot open output %s: %s\n", output_path, strerror(errno));
+        if (trace.data) {
+            munmap((void *)trace.data, trace.size);
+        }
+        return -1;
+    }
+    setvbuf(out, NULL, _IOFBF, REPLAY_OUTPUT_BUFFER);
+
+    TimeFrame *tf = json_timeframe_create();
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    OutputBuffer output = {0};
+    int rc = tf && tick ? 0 : -1;
+
+    double start = now_seconds();
+    while (rc == 0 && *running) {
+        const char *message;
+        size_t length;
+        int found = trace_next(&trace, &message, &length);
+        if (found == 0) {
+            break;
+        }
+        if (found < 0) {
+            fprintf(stderr, "Error: Truncated frame at byte %zu of the trace\n", trace.pos);
+            totals.errors++;
+            break;
+        }
+
+        uint64_t phase_start = stats_start(sched->stats);
+        if (codec_decode(codec, message, length, tf) < 0) {
+            totals.errors++;
+            continue;
+        }
+        stats_lap(sched->stats, STAT_PARSE, phase_start);
+        totals.rejected += scheduler_process_events(sched, tf->events, tf->event_count);
+        totals.events += tf->event_count;
+        totals.frames++;
+
+        if (scheduler_tick_into(sched, tf->vtime, tick) < 0) {
+            rc = -1;
+        } else {
+            phase_start = stats_start(sched->stats);
+            rc = codec_encode(codec, tick, include_meta, &output) < 0 ? -1 : 0;
+            stats_lap(sched->stats, STAT_SERIALIZE, phase_start);
+        }
+        if (rc < 0 || write_tick(out, trace.binary, &output, &totals.output_bytes) < 0) {
+            fprintf(stderr, "Error: Failed to write tick for vtime %d\n", tf->vtime);
+            rc = -1;
+        }
+        stats_report_if_due(sched->stats, stderr);
+        checkpoint_poll(sched->checkpoint, sched);
+    }
+    if (fflush(out) != 0) {
+        fprintf(stderr, "Error: Failed to write output: %s\n", strerror(errno));
+        rc = -1;
+    }
+    totals.seconds = now_seconds() - start;
+
+    if (!to_stdout && fclose(out) != 0) {
+        rc = -1;
+    }
+    json_output_free(&output);
+    scheduler_tick_free(tick);
+    json_free_timeframe(tf);
+    free(trace.copy);
+    if (trace.data) {
+        munmap((void *)trace.data, trace.size);
+    }
+
+    if (stats) {
+        *stats = totals;
+    }
+    return rc;
+}
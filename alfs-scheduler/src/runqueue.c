@@ -0,0 +1,441 @@
+/**
+ * ALFS - Run Queue Implementation
+ *
+ * RUNNABLE tasks are grouped by (effective CPU mask, cgroup):
+ * - Every member of a class is eligible on the same CPUs and is
+ *   throttled together, so selection only compares class heads
+ * - Ineligible tasks are skipped with their class and never moved
+ * - A task stays bound to its class while running, so requeueing it
+ *   next tick needs no class lookup
+ * - Classes of a throttled cgroup, or of one below a throttled
+ *   ancestor, are parked behind the active ones, so selection never
+ *   even looks at them until the quota refills
+ * - The weighted average vruntime of all queued tasks is kept as a sum
+ *   of weight x (vruntime - min_vruntime), as the kernel's avg_vruntime
+ *   does, so EEVDF eligibility never scans the queue
+ */
+
+#include <stdlib.h>
+#include <float.h>
+#include "runqueue.h"
+#include "taskqueue.h"
+#include "cpumask.h"
+
+#define RUNQUEUE_MIN_CLASSES 4
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+/**
+ * Swap two classes in the class array and update their indices
+ */
+static void runqueue_swap(RunQueue *rq, int i, int j) {
+    TaskClass *temp = rq->classes[i];
+    rq->classes[i] = rq->classes[j];
+    rq->classes[j] = temp;
+
+    rq->classes[i]->rq_index = i;
+    rq->classes[j]->rq_index = j;
+}
+
+/**
+ * Count a task that just joined a class queue in the average vruntime
+ */
+static inline void avg_add(RunQueue *rq, Task *task) {
+    task->avg_weight = task->weight;
+    rq->avg_sum += (double)(task->vruntime - rq->min_vruntime) * task->avg_weight;
+    rq->avg_load += task->avg_weight;
+}
+
+/**
+ * Drop a task that left its class queue from the average vruntime
+ */
+static inline void avg_sub(RunQueue *rq, const Task *task) {
+    rq->avg_load -= task->avg_weight;
+    if (rq->avg_load == 0) {
+        rq->avg_sum = 0.0;          /* Shed accumulated rounding */
+    } else {
+        rq->avg_sum -= (double)(task->vruntime - rq->min_vruntime) * task->avg_weight;
+    }
+}
+
+/**
+ * Move an active class into the parked region
+ */
+static void runqueue_park_class(TaskClass *tclass) {
+    RunQueue *rq = tclass->rq;
+    if (tclass->parked) {
+        return;
+    }
+    runqueue_swap(rq, tclass->rq_index, --rq->active_count);
+    tclass->parked = true;
+    rq->nr_parked += taskqueue_size(&tclass->queue);
+}
+
+/**
+ * Move a parked class back into the active region
+ */
+static void runqueue_unpark_class(TaskClass *tclass) {
+    RunQueue *rq = tclass->rq;
+    if (!tclass->parked) {
+        return;
+    }
+    runqueue_swap(rq, tclass->rq_index, rq->active_count++);
+    tclass->parked = false;
+    rq->nr_parked -= taskqueue_size(&tclass->queue);
+}
+
+/**
+ * Find the class for a key, creating it if missing
+ */
+static TaskClass *runqueue_get_class(RunQueue *rq, const CpuMask *mask,
+                                     Cgroup *cgroup) {
+    for (int i = 0; i < rq->class_count; i++) {
+        TaskClass *tclass = rq->classes[i];
+        if (tclass->cgroup == cgroup && cpumask_equal(&tclass->mask, mask)) {
+            return tclass;
+        }
+    }
+
+    if (rq->class_count >= rq->class_capacity) {
+        int new_capacity = rq->class_capacity ? rq->class_capacity * 2 : RUNQUEUE_MIN_CLASSES;
+        TaskClass **new_classes = realloc(rq->classes, sizeof(TaskClass *) * new_capacity);
+        if (!new_classes) {
+            return NULL;
+        }
+        rq->classes = new_classes;
+        rq->class_capacity = new_capacity;
+    }
+
+    TaskClass *tclass = calloc(1, sizeof(TaskClass));
+    if (!tclass) {
+        return NULL;
+    }
+    if (taskqueue_init(&tclass->queue, rq->backend) < 0) {
+        free(tclass);
+        return NULL;
+    }
+    tclass->mask = *mask;
+    tclass->cgroup = cgroup;
+    tclass->rq = rq;
+
+    /* Append as parked, then activate unless the cgroup is throttled */
+    tclass->rq_index = rq->class_count;
+    tclass->parked = true;
+    rq->classes[rq->class_count++] = tclass;
+    if (!cgroup || cgroup->throttle_count == 0) {
+        runqueue_unpark_class(tclass);
+    }
+
+    if (cgroup) {
+        tclass->cgroup_next = cgroup->classes;
+        if (cgroup->classes) {
+            cgroup->classes->cgroup_prev = tclass;
+        }
+        cgroup->classes = tclass;
+    }
+
+    return tclass;
+}
+
+/**
+ * Unlink a class from its run queue and cgroup, then free it
+ */
+static void runqueue_free_class(TaskClass *tclass) {
+    RunQueue *rq = tclass->rq;
+    runqueue_park_class(tclass);
+    runqueue_swap(rq, tclass->rq_index, rq->class_count - 1);
+    rq->classes[--rq->class_count] = NULL;
+
+    Cgroup *cgroup = tclass->cgroup;
+    if (cgroup) {
+        if (tclass->cgroup_prev) {
+            tclass->cgroup_prev->cgroup_next = tclass->cgroup_next;
+        } else {
+            cgroup->classes = tclass->cgroup_next;
+        }
+        if (tclass->cgroup_next) {
+            tclass->cgroup_next->cgroup_prev = tclass->cgroup_prev;
+        }
+    }
+
+    taskqueue_destroy(&tclass->queue);
+    free(tclass);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void runqueue_init(RunQueue *rq) {
+    rq->classes = NULL;
+    rq->class_count = 0;
+    rq->active_count = 0;
+    rq->class_capacity = 0;
+    rq->nr_queued = 0;
+    rq->nr_parked = 0;
+    rq->min_vruntime = 0;
+    rq->avg_sum = 0.0;
+    rq->avg_load = 0;
+    rq->backend = ALFS_RUNQUEUE_DEFAULT;
+}
+
+void runqueue_destroy(RunQueue *rq) {
+    if (!rq) {
+        return;
+    }
+
+    for (int i = 0; i < rq->class_count; i++) {
+        taskqueue_destroy(&rq->classes[i]->queue);
+        free(rq->classes[i]);
+    }
+    free(rq->classes);
+    QueueBackend backend = rq->backend;
+    runqueue_init(rq);
+    rq->backend = backend;
+}
+
+int runqueue_set_backend(RunQueue *rq, QueueBackend backend) {
+    if (!rq || (int)backend < 0 || backend >= QUEUE_BACKEND_COUNT || rq->class_count > 0) {
+        return -1;
+    }
+    rq->backend = backend;
+    return 0;
+}
+
+int runqueue_enqueue(RunQueue *rq, Task *task, const CpuMask *mask) {
+    if (!rq || !task || task->heap_index >= 0) {
+        return -1;
+    }
+
+    TaskClass *tclass = task->tclass;
+    if (!tclass || tclass->rq != rq || tclass->cgroup != task->cgroup ||
+        !cpumask_equal(&tclass->mask, mask)) {
+        runqueue_unbind(task);
+        tclass = runqueue_get_class(rq, mask, task->cgroup);
+        if (!tclass) {
+            return -1;
+        }
+        tclass->refs++;
+        task->tclass = tclass;
+    }
+
+    if (taskqueue_insert(&tclass->queue, task) < 0) {
+        return -1;
+    }
+    avg_add(rq, task);
+    rq->nr_queued++;
+    if (tclass->parked) {
+        rq->nr_parked++;
+    }
+    return 0;
+}
+
+void runqueue_dequeue(Task *task) {
+    if (!task || task->heap_index < 0 || !task->tclass) {
+        return;
+    }
+
+    TaskClass *tclass = task->tclass;
+    taskqueue_remove(&tclass->queue, task);
+    avg_sub(tclass->rq, task);
+    tclass->rq->nr_queued--;
+    if (tclass->parked) {
+        tclass->rq->nr_parked--;
+    }
+}
+
+void runqueue_update(Task *task, vruntime_t old_vruntime) {
+    if (task && task->heap_index >= 0 && task->tclass) {
+        task->tclass->rq->avg_sum += (double)(task->vruntime - old_vruntime) * task->avg_weight;
+        taskqueue_update(&task->tclass->queue, task);
+    }
+}
+
+Task *runqueue_take(TaskClass *tclass) {
+    if (!tclass) {
+        return NULL;
+    }
+
+    Task *task = taskqueue_extract_min(&tclass->queue);
+    if (task) {
+        avg_sub(tclass->rq, task);
+        tclass->rq->nr_queued--;
+        if (tclass->parked) {
+            tclass->rq->nr_parked--;
+        }
+    }
+    return task;
+}
+
+void runqueue_unbind(Task *task) {
+    if (!task || !task->tclass) {
+        return;
+    }
+
+    TaskClass *tclass = task->tclass;
+    task->tclass = NULL;
+    if (--tclass->refs == 0) {
+        runqueue_free_class(tclass);
+    }
+}
+
+void runqueue_update_min_vruntime(RunQueue *rq, vruntime_t running_min) {
+    if (!rq) {
+        return;
+    }
+
+    /* Parked tasks still count: they are runnable, only throttled */
+    vruntime_t min_vr = running_min;
+    for (int i = 0; i < rq->class_count; i++) {
+        const Task *head = taskqueue_peek(&rq->classes[i]->queue);
+        if (head && head->vruntime < min_vr) {
+            min_vr = head->vruntime;
+        }
+    }
+
+    /* An empty queue keeps its floor for tasks that arrive later */
+    if (min_vr != VRUNTIME_MAX && min_vr > rq->min_vruntime) {
+        /* Keys are relative to the floor: rebase the average's sum */
+        rq->avg_sum -= (double)(min_vr - rq->min_vruntime) * (double)rq->avg_load;
+        rq->min_vruntime = min_vr;
+    }
+}
+
+void runqueue_park_cgroup(Cgroup *cgroup) {
+    if (!cgroup) {
+        return;
+    }
+
+    for (TaskClass *tclass = cgroup->classes; tclass; tclass = tclass->cgroup_next) {
+        runqueue_park_class(tclass);
+    }
+}
+
+void runqueue_unpark_cgroup(Cgroup *cgroup) {
+    if (!cgroup) {
+        return;
+    }
+
+    for (TaskClass *tclass = cgroup->classes; tclass; tclass = tclass->cgroup_next) {
+        runqueue_unpark_class(tclass);
+    }
+}
+
+TaskClass *runqueue_restore_class(RunQueue *rq, const CpuMask *mask, Cgroup *cgroup, bool parked) {
+    if (!rq || !mask || (!parked && rq->active_count != rq->class_count)) {
+        return NULL;
+    }
+
+    if (rq->class_count >= rq->class_capacity) {
+        int new_capacity = rq->class_capacity ? rq->class_capacity * 2 : RUNQUEUE_MIN_CLASSES;
+        TaskClass **new_classes = realloc(rq->classes, sizeof(TaskClass *) * new_capacity);
+        if (!new_classes) {
+            return NULL;
+        }
+        rq->classes = new_classes;
+        rq->class_capacity = new_capacity;
+    }
+
+    TaskClass *tclass = calloc(1, sizeof(TaskClass));
+    if (!tclass) {
+        return NULL;
+    }
+    if (taskqueue_init(&tclass->queue, rq->backend) < 0) {
+        free(tclass);
+        return NULL;
+    }
+    tclass->mask = *mask;
+    tclass->cgroup = cgroup;
+    tclass->rq = rq;
+    tclass->rq_index = rq->class_count;
+    tclass->parked = parked;
+    rq->classes[rq->class_count++] = tclass;
+    if (!parked) {
+        rq->active_count++;
+    }
+    return tclass;
+}
+
+void runqueue_restore_cgroup_classes(Cgroup *cgroup, TaskClass **classes, int count) {
+    TaskClass *next = NULL;
+    for (int i = count - 1; i >= 0; i--) {
+        classes[i]->cgroup_prev = NULL;
+        classes[i]->cgroup_next = next;
+        if (next) {
+            next->cgroup_prev = classes[i];
+        }
+        next = classes[i];
+    }
+    cgroup->classes = next;
+}
+
+int runqueue_restore_task(Task *task, TaskClass *tclass, bool queued) {
+    if (!task || !tclass || task->tclass) {
+        return -1;
+    }
+
+    task->tclass = tclass;
+    tclass->refs++;
+    if (!queued) {
+        return 0;
+    }
+    if (taskqueue_insert(&tclass->queue, task) < 0) {
+        return -1;
+    }
+    RunQueue *rq = tclass->rq;
+    rq->avg_load += task->avg_weight;
+    rq->nr_queued++;
+    if (tclass->parked) {
+        rq->nr_parked++;
+    }
+    return 0;
+}
+
+int runqueue_validate(const RunQueue *rq) {
+    if (!rq || rq->active_count < 0 || rq->active_count > rq->class_count || rq->nr_queued < 0) {
+        return -1;
+    }
+
+    Task **members = malloc(sizeof(Task *) * (size_t)(rq->nr_queued > 0 ? rq->nr_queued : 1));
+    if (!members) {
+        return -1;
+    }
+
+    int queued = 0;
+    int parked = 0;
+    int64_t load = 0;
+    int rc = 0;
+    for (int i = 0; i < rq->class_count && rc == 0; i++) {
+        const TaskClass *tclass = rq->classes[i];
+        int size = taskqueue_size(&tclass->queue);
+        if (tclass->rq != rq || tclass->rq_index != i || tclass->refs < size ||
+            tclass->queue.ops->backend != rq->backend ||
+            taskqueue_validate(&tclass->queue) < 0 || queued + size > rq->nr_queued) {
+            rc = -1;
+            break;
+        }
+        /* Parked exactly when past the active region and the cgroup is throttled */
+        if (tclass->parked != (i >= rq->active_count) ||
+            tclass->parked != (tclass->cgroup && tclass->cgroup->throttle_count > 0)) {
+            rc = -1;
+            break;
+        }
+        int n = taskqueue_collect(&tclass->queue, members);
+        for (int j = 0; j < n; j++) {
+            if (members[j]->tclass != tclass) {
+                rc = -1;
+            }
+            load += members[j]->avg_weight;
+        }
+        queued += size;
+        if (tclass->parked) {
+            parked += size;
+        }
+    }
+    free(members);
+
+    return rc == 0 && queued == rq->nr_queued && parked == rq->nr_parked &&
+           load == rq->avg_load ? 0 : -1;
+}
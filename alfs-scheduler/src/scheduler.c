@@ -2,7 +2,10 @@
  * ALFS - Scheduler Core Implementation
  * 
  * This implements the CFS (Completely Fair Scheduler) algorithm
- * using a Min-Heap instead of Red-Black Tree for O(log n) operations.
+ * using a Min-Heap instead of Red-Black Tree for O(log n) operations,
+ * and optionally EEVDF selection (--policy=eevdf) over an augmented
+ * RB-tree. CPUs may declare different capacities (big.LITTLE), which
+ * scale runtime accounting and drive utilization-based placement.
  */
 
 #define _POSIX_C_SOURCE 200809L
@@ -11,530 +14,1487 @@
 #include <stdlib.h>
 #include <string.h>
 #include <float.h>
+#include <stdatomic.h>
 #include "scheduler.h"
 #include "heap.h"
+#include "taskqueue.h"
 #include "task.h"
 #include "cgroup.h"
+#include "idtable.h"
+#include "runqueue.h"
+#include "cpumask.h"
+#include "pool.h"
+#include "stats.h"
+#include "workpool.h"
+#include "timerwheel.h"
+#include "checkpoint.h"
+
+#define TASK_MIN_CAPACITY 64        /* Initial task slots; storage doubles from here */
+#define CGROUP_MIN_CAPACITY 16      /* Initial cgroup slots */
 
 /* ============================================================================
  * Internal Helper Functions
  * ============================================================================ */
 
 /**
- * Check if a task can run on a specific CPU considering both
- * task affinity and cgroup CPU mask
+ * Attach a task to the membership list of a cgroup ID.
+ * The cgroup itself may not exist yet; it is bound when created.
+ * task->cgroup_id then points at the interned ID.
  */
-static bool can_task_run_on_cpu(Scheduler *sched, Task *task, int cpu_id) {
-    /* Check task affinity */
-    if (!task_can_run_on_cpu(task, cpu_id)) {
-        return false;
+static int task_join_cgroup(Scheduler *sched, Task *task, const char *cgroup_id) {
+    task->cgroup = NULL;
+    task->cgroup_entry = NULL;
+    
+    /* An empty cgroup ID means "no cgroup" */
+    if (cgroup_id[0] == '\0') {
+        task->cgroup_id = "";
+        task_refresh_allowed(task);
+        task_refresh_weight(task);
+        return 0;
     }
     
-    /* Check cgroup CPU mask */
-    if (task->cgroup_id[0] != '\0') {
-        Cgroup *cgroup = scheduler_find_cgroup(sched, task->cgroup_id);
-        if (cgroup && !cgroup_allows_cpu(cgroup, cpu_id)) {
-            return false;
-        }
+    IdEntry *entry = idtable_acquire(sched->ids, cgroup_id);
+    if (!entry) {
+        task->cgroup_id = "";
+        return -1;
     }
+    task->cgroup_id = entry->str;
     
-    return true;
+    task->group_prev = NULL;
+    task->group_next = entry->members;
+    if (entry->members) {
+        entry->members->group_prev = task;
+    }
+    entry->members = task;
+    
+    task->cgroup_entry = entry;
+    task->cgroup = entry->cgroup;
+    task_refresh_allowed(task);
+    task_refresh_weight(task);
+    return 0;
 }
 
 /**
- * Get the minimum vruntime across all runnable tasks
+ * Detach a task from its cgroup ID membership list
  */
-static double get_min_vruntime(Scheduler *sched) {
-    double min_vr = DBL_MAX;
+static void task_leave_cgroup(Scheduler *sched, Task *task) {
+    IdEntry *entry = task->cgroup_entry;
+    if (!entry) {
+        return;
+    }
     
-    for (int i = 0; i < sched->task_count; i++) {
-        Task *task = sched->all_tasks[i];
-        if (task->state == TASK_STATE_RUNNABLE || task->state == TASK_STATE_RUNNING) {
-            if (task->vruntime < min_vr) {
-                min_vr = task->vruntime;
-            }
-        }
+    if (task->group_prev) {
+        task->group_prev->group_next = task->group_next;
+    } else {
+        entry->members = task->group_next;
     }
+    if (task->group_next) {
+        task->group_next->group_prev = task->group_prev;
+    }
+    task->group_next = NULL;
+    task->group_prev = NULL;
+    task->cgroup_entry = NULL;
+    task->cgroup = NULL;
+    task->cgroup_id = "";           /* The entry may go away below */
+    task_refresh_allowed(task);
+    task_refresh_weight(task);
     
-    return min_vr == DBL_MAX ? 0.0 : min_vr;
+    idtable_release(sched->ids, entry);
 }
 
 /**
- * Get the maximum vruntime across all runnable tasks
+ * Get the min_vruntime floor: that of the shared run queue, or in
+ * per-CPU mode the lowest floor of any CPU
  */
-static double get_max_vruntime(Scheduler *sched) {
-    double max_vr = 0.0;
+static vruntime_t get_min_vruntime(Scheduler *sched) {
+    if (!sched->per_cpu_queues) {
+        return sched->runqueue.min_vruntime;
+    }
     
-    for (int i = 0; i < sched->task_count; i++) {
-        Task *task = sched->all_tasks[i];
-        if (task->state == TASK_STATE_RUNNABLE || task->state == TASK_STATE_RUNNING) {
-            if (task->vruntime > max_vr) {
-                max_vr = task->vruntime;
-            }
+    vruntime_t min_vr = sched->cpu_queues[0].rq.min_vruntime;
+    for (int cpu = 1; cpu < sched->cpu_count; cpu++) {
+        if (sched->cpu_queues[cpu].rq.min_vruntime < min_vr) {
+            min_vr = sched->cpu_queues[cpu].rq.min_vruntime;
         }
     }
-    
-    return max_vr;
+    return min_vr;
 }
 
 /**
- * Get task weight adjusted by cgroup shares.
+ * Advance the min_vruntime of every run queue from its class heads and
+ * the tasks running on its CPUs. Called once the tick's picks are made
+ * and whenever a task leaves the run queues.
  */
-static int get_effective_task_weight(Scheduler *sched, Task *task) {
-    long long weight = task->weight;
-    if (task->cgroup_id[0] != '\0') {
-        Cgroup *cgroup = scheduler_find_cgroup(sched, task->cgroup_id);
-        if (cgroup && cgroup->cpu_shares > 0) {
-            weight = (weight * cgroup->cpu_shares) / DEFAULT_CPU_SHARES;
+static void update_min_vruntime(Scheduler *sched) {
+    if (sched->per_cpu_queues) {
+        for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+            Task *current = sched->cpu_queues[cpu].current_task;
+            runqueue_update_min_vruntime(&sched->cpu_queues[cpu].rq,
+                                         current ? current->vruntime : VRUNTIME_MAX);
         }
+        return;
     }
-    if (weight < 1) {
-        weight = 1;
+    
+    vruntime_t running_min = VRUNTIME_MAX;
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        Task *current = sched->cpu_queues[cpu].current_task;
+        if (current && current->vruntime < running_min) {
+            running_min = current->vruntime;
+        }
     }
-    return (int)weight;
+    runqueue_update_min_vruntime(&sched->runqueue, running_min);
 }
 
 /**
- * Rebuild runnable heap from current task states.
+ * Change a registered task's state, keeping the state column in step
  */
-static void rebuild_runnable_heap(Scheduler *sched) {
-    sched->runnable_heap->size = 0;
-    for (int i = 0; i < sched->task_count; i++) {
-        Task *task = sched->all_tasks[i];
-        task->heap_index = -1;
-        if (task->state == TASK_STATE_RUNNABLE) {
-            heap_insert(sched->runnable_heap, task);
-        }
+static inline bool state_is_runnable(uint8_t state) {
+    return state == TASK_STATE_RUNNABLE || state == TASK_STATE_RUNNING;
+}
+
+/* Metadata list a task was last reported in (task_reported column) */
+enum {
+    TASK_LISTED_NONE,
+    TASK_LISTED_RUNNABLE,
+    TASK_LISTED_BLOCKED
+};
+
+static inline uint8_t task_listing(uint8_t state) {
+    return state_is_runnable(state) ? TASK_LISTED_RUNNABLE :
+           state == TASK_STATE_BLOCKED ? TASK_LISTED_BLOCKED : TASK_LISTED_NONE;
+}
+
+static inline void set_task_state(Scheduler *sched, Task *task, TaskState state) {
+    /* Running and runnable share a list: only other moves change the lists */
+    if (task_listing((uint8_t)task->state) != task_listing((uint8_t)state)) {
+        sched->list_epoch++;
     }
+    task->state = state;
+    sched->task_states[task->task_index] = (uint8_t)state;
 }
 
 /**
- * Reset cgroup periods when their accounting window expires.
+ * Keep a removed task's ID for the next delta tick's removed list.
+ * If the list cannot grow, the next tick becomes a keyframe instead.
  */
-static void refresh_cgroup_periods(Scheduler *sched, int vtime) {
-    long long tick_us = (long long)sched->quanta * 1000LL;
-    if (tick_us <= 0) {
-        tick_us = 1000LL;
-    }
-    
-    for (int i = 0; i < sched->cgroup_count; i++) {
-        Cgroup *cgroup = sched->cgroups[i];
-        if (!cgroup || cgroup->cpu_period_us <= 0) {
-            continue;
-        }
-        
-        if (vtime < cgroup->period_start_vtime) {
-            cgroup_reset_period(cgroup, vtime);
-            continue;
-        }
-        
-        long long elapsed_ticks = (long long)vtime - (long long)cgroup->period_start_vtime;
-        long long elapsed_us = elapsed_ticks * tick_us;
-        if (elapsed_us >= (long long)cgroup->cpu_period_us) {
-            cgroup_reset_period(cgroup, vtime);
+static void drop_reported_task(Scheduler *sched, IdEntry *entry) {
+    if (sched->dropped_count == sched->dropped_capacity) {
+        int capacity = sched->dropped_capacity ? sched->dropped_capacity * 2 : 16;
+        IdEntry **dropped = realloc(sched->dropped_tasks, (size_t)capacity * sizeof(IdEntry *));
+        if (!dropped) {
+            sched->delta_ticks = 0;
+            return;
         }
+        sched->dropped_tasks = dropped;
+        sched->dropped_capacity = capacity;
     }
+    idtable_retain(entry);
+    sched->dropped_tasks[sched->dropped_count++] = entry;
 }
 
 /**
- * Pick best runnable task for a CPU by repeatedly extracting heap minimum.
- * Non-eligible tasks are reinserted back into heap.
+ * Get the maximum vruntime across all runnable tasks.
+ * Only rescans the tasks when the previous maximum's holder has left.
  */
-static double get_planned_runtime_for_cgroup(Cgroup **planned_cgroups,
-                                             double *planned_runtime_us,
-                                             int planned_count,
-                                             Cgroup *target) {
-    for (int i = 0; i < planned_count; i++) {
-        if (planned_cgroups[i] == target) {
-            return planned_runtime_us[i];
+static vruntime_t get_max_vruntime(Scheduler *sched) {
+    if (!sched->max_vruntime_stale) {
+        return sched->max_vruntime;
+    }
+    
+    /* Filter on the state column; only runnable tasks are dereferenced */
+    vruntime_t max_vr = 0;
+    const uint8_t *states = sched->task_states;
+    for (int i = 0; i < sched->task_count; i++) {
+        if (state_is_runnable(states[i]) && sched->all_tasks[i]->vruntime > max_vr) {
+            max_vr = sched->all_tasks[i]->vruntime;
         }
     }
-    return 0.0;
+    
+    sched->max_vruntime = max_vr;
+    sched->max_vruntime_stale = false;
+    return max_vr;
 }
 
-static void add_planned_runtime_for_cgroup(Cgroup **planned_cgroups,
-                                           double *planned_runtime_us,
-                                           int *planned_count,
-                                           Cgroup *target,
-                                           double delta_us) {
-    for (int i = 0; i < *planned_count; i++) {
-        if (planned_cgroups[i] == target) {
-            planned_runtime_us[i] += delta_us;
-            return;
-        }
-    }
-    if (*planned_count < MAX_CGROUPS) {
-        planned_cgroups[*planned_count] = target;
-        planned_runtime_us[*planned_count] = delta_us;
-        (*planned_count)++;
+/**
+ * Account a runnable task's (possibly raised) vruntime in the running maximum
+ */
+static void track_max_vruntime(Scheduler *sched, const Task *task) {
+    if (task->vruntime > sched->max_vruntime) {
+        sched->max_vruntime = task->vruntime;
     }
 }
 
-static Task *pick_task_for_cpu(Scheduler *sched,
-                               int cpu,
-                               Cgroup **planned_cgroups,
-                               double *planned_runtime_us,
-                               int *planned_count,
-                               double tick_runtime_us) {
-    Task *deferred[MAX_TASKS];
-    int deferred_count = 0;
-    Task *selected = NULL;
-    
-    while (!heap_is_empty(sched->runnable_heap)) {
-        Task *candidate = heap_extract_min(sched->runnable_heap);
-        if (!candidate) {
-            break;
-        }
-        
-        if (!can_task_run_on_cpu(sched, candidate, cpu)) {
-            deferred[deferred_count++] = candidate;
-            continue;
-        }
-        
-        if (candidate->cgroup_id[0] != '\0') {
-            Cgroup *cgroup = scheduler_find_cgroup(sched, candidate->cgroup_id);
-            if (cgroup && !cgroup_has_quota(cgroup, sched->current_vtime)) {
-                deferred[deferred_count++] = candidate;
-                continue;
-            }
-            if (cgroup && cgroup->cpu_quota_us >= 0) {
-                double planned = get_planned_runtime_for_cgroup(planned_cgroups,
-                                                                planned_runtime_us,
-                                                                *planned_count,
-                                                                cgroup);
-                double projected = cgroup->quota_used + planned + tick_runtime_us;
-                if (projected > (double)cgroup->cpu_quota_us) {
-                    deferred[deferred_count++] = candidate;
-                    continue;
-                }
-            }
-        }
-        
-        selected = candidate;
-        break;
-    }
-    
-    for (int i = 0; i < deferred_count; i++) {
-        heap_insert(sched->runnable_heap, deferred[i]);
-    }
-    
-    if (selected && selected->cgroup_id[0] != '\0') {
-        Cgroup *cgroup = scheduler_find_cgroup(sched, selected->cgroup_id);
-        if (cgroup && cgroup->cpu_quota_us >= 0) {
-            add_planned_runtime_for_cgroup(planned_cgroups,
-                                           planned_runtime_us,
-                                           planned_count,
-                                           cgroup,
-                                           tick_runtime_us);
-        }
+/**
+ * Note that a task stopped being runnable; if it may have held the
+ * maximum, the next query rescans
+ */
+static void untrack_max_vruntime(Scheduler *sched, const Task *task) {
+    if (task->vruntime >= sched->max_vruntime) {
+        sched->max_vruntime_stale = true;
     }
-    
-    return selected;
 }
 
-/* ============================================================================
- * Public Functions - Initialization
- * ============================================================================ */
-
-Scheduler *scheduler_init(int cpu_count, int quanta) {
-    Scheduler *sched = calloc(1, sizeof(Scheduler));
-    if (!sched) {
-        return NULL;
+/**
+ * Make room for at least `needed` tasks: all_tasks and its parallel
+ * columns double together, so adds stay amortized O(1)
+ */
+static int reserve_task_storage(Scheduler *sched, int needed) {
+    if (needed <= sched->task_capacity) {
+        return 0;
     }
-    
-    sched->cpu_count = cpu_count;
-    sched->quanta = quanta > 0 ? quanta : 1;
-    sched->current_vtime = 0;
-    
-    /* Initialize CPU queues */
-    sched->cpu_queues = calloc(cpu_count, sizeof(CPURunQueue));
-    if (!sched->cpu_queues) {
-        free(sched);
-        return NULL;
+    int capacity = sched->task_capacity ? sched->task_capacity : TASK_MIN_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2;
     }
     
-    for (int i = 0; i < cpu_count; i++) {
-        sched->cpu_queues[i].cpu_id = i;
-        sched->cpu_queues[i].current_task = NULL;
-        sched->cpu_queues[i].min_vruntime = 0.0;
+    /* A column that did grow keeps its extra room if a later one fails */
+    Task **tasks = realloc(sched->all_tasks, (size_t)capacity * sizeof(Task *));
+    if (!tasks) {
+        return -1;
     }
-    
-    /* Initialize task storage */
-    sched->task_capacity = MAX_TASKS;
-    sched->all_tasks = calloc(sched->task_capacity, sizeof(Task *));
-    if (!sched->all_tasks) {
-        free(sched->cpu_queues);
-        free(sched);
-        return NULL;
+    sched->all_tasks = tasks;
+    uint8_t *states = realloc(sched->task_states, (size_t)capacity * sizeof(uint8_t));
+    if (!states) {
+        return -1;
     }
-    sched->task_count = 0;
-    
-    /* Initialize cgroup storage */
-    sched->cgroup_capacity = MAX_CGROUPS;
-    sched->cgroups = calloc(sched->cgroup_capacity, sizeof(Cgroup *));
-    if (!sched->cgroups) {
-        free(sched->all_tasks);
-        free(sched->cpu_queues);
-        free(sched);
-        return NULL;
+    sched->task_states = states;
+    IdEntry **entries = realloc(sched->task_entries, (size_t)capacity * sizeof(IdEntry *));
+    if (!entries) {
+        return -1;
     }
-    sched->cgroup_count = 0;
-    
-    /* Initialize runnable heap */
-    sched->runnable_heap = heap_create(MAX_TASKS);
-    if (!sched->runnable_heap) {
-        free(sched->cgroups);
-        free(sched->all_tasks);
-        free(sched->cpu_queues);
-        free(sched);
-        return NULL;
+    sched->task_entries = entries;
+    uint8_t *reported = realloc(sched->task_reported, (size_t)capacity * sizeof(uint8_t));
+    if (!reported) {
+        return -1;
     }
-    
-    return sched;
+    sched->task_reported = reported;
+    sched->task_capacity = capacity;
+    return 0;
 }
 
-void scheduler_destroy(Scheduler *sched) {
-    if (!sched) {
-        return;
+/**
+ * Make room for at least `needed` cgroups (and as many expiring periods)
+ */
+static int reserve_cgroup_storage(Scheduler *sched, int needed) {
+    if (needed <= sched->cgroup_capacity) {
+        return 0;
     }
-    
-    /* Free all tasks */
-    for (int i = 0; i < sched->task_count; i++) {
-        task_destroy(sched->all_tasks[i]);
+    int capacity = sched->cgroup_capacity ? sched->cgroup_capacity : CGROUP_MIN_CAPACITY;
+    while (capacity < needed) {
+        capacity *= 2;
     }
-    free(sched->all_tasks);
     
-    /* Free all cgroups */
-    for (int i = 0; i < sched->cgroup_count; i++) {
-        cgroup_destroy(sched->cgroups[i]);
+    Cgroup **cgroups = realloc(sched->cgroups, (size_t)capacity * sizeof(Cgroup *));
+    if (!cgroups) {
+        return -1;
     }
-    free(sched->cgroups);
-    
-    /* Free heap */
-    heap_destroy(sched->runnable_heap);
-    
-    /* Free CPU queues */
-    free(sched->cpu_queues);
-    
-    free(sched);
+    sched->cgroups = cgroups;
+    Cgroup **expired = realloc(sched->expired_cgroups, (size_t)capacity * sizeof(Cgroup *));
+    if (!expired) {
+        return -1;
+    }
+    sched->expired_cgroups = expired;
+    sched->cgroup_capacity = capacity;
+    return 0;
 }
 
 /* ============================================================================
- * Public Functions - Task Management
+ * EEVDF Helpers
+ *
+ * Each task requests a slice (the quanta, shorter during a CPU burst) and
+ * has a virtual deadline one weighted slice past its vruntime. A task is
+ * eligible while its vruntime is at most the weighted average of its run
+ * queue; the eligible task with the earliest deadline runs. Blocking
+ * saves the task's lag behind that average and waking restores it, so
+ * sleeping neither earns nor forfeits service.
  * ============================================================================ */
 
-Task *scheduler_find_task(Scheduler *sched, const char *task_id) {
-    if (!sched || !task_id) {
-        return NULL;
+static inline bool policy_is_eevdf(const Scheduler *sched) {
+    return sched->policy == SCHED_POLICY_EEVDF;
+}
+
+/**
+ * Slice a task requests, in quanta
+ */
+static inline double eevdf_slice(const Scheduler *sched, const Task *task) {
+    double slice = (double)sched->quanta;
+    return task->is_burst ? slice / (double)(1 << EEVDF_BURST_SLICE_SHIFT) : slice;
+}
+
+static inline void eevdf_set_deadline(const Scheduler *sched, Task *task) {
+    task->deadline = task->vruntime + vruntime_delta(eevdf_slice(sched, task), task->inv_weight);
+}
+
+/**
+ * Run queue a task belongs to: that of its class, else its home queue
+ */
+static RunQueue *task_runqueue(Scheduler *sched, const Task *task) {
+    if (task->tclass) {
+        return task->tclass->rq;
     }
-    
-    for (int i = 0; i < sched->task_count; i++) {
-        if (strcmp(sched->all_tasks[i]->task_id, task_id) == 0) {
-            return sched->all_tasks[i];
-        }
+    if (sched->per_cpu_queues && task->home_cpu >= 0) {
+        return &sched->cpu_queues[task->home_cpu].rq;
     }
-    
-    return NULL;
+    return &sched->runqueue;
 }
 
-int scheduler_add_task(Scheduler *sched, Task *task) {
-    if (!sched || !task) {
-        return -1;
-    }
-    
-    if (sched->task_count >= sched->task_capacity) {
-        return -1;  /* Full */
+/**
+ * Weighted average vruntime over every run queue, where a new task
+ * (zero lag) is placed
+ */
+static vruntime_t get_avg_vruntime(Scheduler *sched) {
+    if (!sched->per_cpu_queues) {
+        return runqueue_avg_vruntime(&sched->runqueue);
     }
     
-    sched->all_tasks[sched->task_count++] = task;
-    
-    /* Add to runnable heap if task is runnable */
-    if (task->state == TASK_STATE_RUNNABLE) {
-        heap_insert(sched->runnable_heap, task);
+    vruntime_t base = get_min_vruntime(sched);
+    double sum = 0.0;
+    int64_t load = 0;
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        const RunQueue *rq = &sched->cpu_queues[cpu].rq;
+        sum += rq->avg_sum + (double)(rq->min_vruntime - base) * (double)rq->avg_load;
+        load += rq->avg_load;
     }
-    
-    return 0;
+    return load > 0 ? base + (vruntime_t)(sum / (double)load) : base;
 }
 
-int scheduler_remove_task(Scheduler *sched, const char *task_id) {
-    if (!sched || !task_id) {
-        return -1;
-    }
-    
-    for (int i = 0; i < sched->task_count; i++) {
-        if (strcmp(sched->all_tasks[i]->task_id, task_id) == 0) {
-            Task *task = sched->all_tasks[i];
-            
-            /* Remove from heap if present */
-            if (task->heap_index >= 0) {
-                heap_remove(sched->runnable_heap, task);
-            }
-            
-            /* Remove from CPU queue if running */
-            for (int j = 0; j < sched->cpu_count; j++) {
-                if (sched->cpu_queues[j].current_task == task) {
-                    sched->cpu_queues[j].current_task = NULL;
-                }
-            }
-            
-            /* Remove from task array */
-            task_destroy(task);
-            sched->all_tasks[i] = sched->all_tasks[sched->task_count - 1];
-            sched->all_tasks[sched->task_count - 1] = NULL;
-            sched->task_count--;
-            
-            return 0;
-        }
+/**
+ * Save how far a task trails its run queue's average, bounded by two
+ * slices either way so a long sleep or a yield cannot bank service
+ */
+static void eevdf_save_lag(Scheduler *sched, Task *task) {
+    vruntime_t limit = vruntime_delta(2.0 * (double)sched->quanta, task->inv_weight);
+    vruntime_t lag = runqueue_avg_vruntime(task_runqueue(sched, task)) - task->vruntime;
+    if (lag > limit) {
+        lag = limit;
+    } else if (lag < -limit) {
+        lag = -limit;
     }
-    
-    return -1;
+    task->vlag = lag;
 }
 
 /* ============================================================================
- * Public Functions - Cgroup Management
+ * Capacity Helpers
+ *
+ * A CPU of capacity c does c/1024 of the fastest core's work per tick, so
+ * a task is charged vruntime and cgroup quota for the work it got done.
+ * Utilization is tracked per task (PELT) in the same capacity-invariant
+ * units; in per-CPU mode it decides where tasks are placed. A task is a
+ * misfit on a CPU whose capacity it does not fit while a bigger CPU exists.
  * ============================================================================ */
 
-Cgroup *scheduler_find_cgroup(Scheduler *sched, const char *cgroup_id) {
-    if (!sched || !cgroup_id) {
-        return NULL;
-    }
-    
-    for (int i = 0; i < sched->cgroup_count; i++) {
-        if (strcmp(sched->cgroups[i]->cgroup_id, cgroup_id) == 0) {
-            return sched->cgroups[i];
-        }
-    }
-    
-    return NULL;
+static inline int cpu_capacity(const Scheduler *sched, int cpu) {
+    return sched->cpu_queues[cpu].capacity;
 }
 
-int scheduler_add_cgroup(Scheduler *sched, Cgroup *cgroup) {
-    if (!sched || !cgroup) {
-        return -1;
-    }
-    
-    if (sched->cgroup_count >= sched->cgroup_capacity) {
-        return -1;  /* Full */
-    }
-    
-    sched->cgroups[sched->cgroup_count++] = cgroup;
-    return 0;
+/**
+ * Work done in `runtime` on a CPU, in fastest-core units
+ */
+static inline double capacity_scale(double runtime, int capacity) {
+    return runtime * (double)capacity / (double)SCHED_CAPACITY_SCALE;
 }
 
-int scheduler_remove_cgroup(Scheduler *sched, const char *cgroup_id) {
-    if (!sched || !cgroup_id) {
-        return -1;
-    }
-    
-    for (int i = 0; i < sched->cgroup_count; i++) {
-        if (strcmp(sched->cgroups[i]->cgroup_id, cgroup_id) == 0) {
-            for (int t = 0; t < sched->task_count; t++) {
-                Task *task = sched->all_tasks[t];
-                if (strcmp(task->cgroup_id, cgroup_id) == 0) {
-                    strncpy(task->cgroup_id, "0", MAX_CGROUP_ID_LEN - 1);
-                    task->cgroup_id[MAX_CGROUP_ID_LEN - 1] = '\0';
-                }
-            }
+/**
+ * Utilization of a task, decayed to the current tick
+ */
+static int task_util(Scheduler *sched, Task *task) {
+    task_update_util(task, sched->tick_count, 0);
+    return task->util_avg;
+}
 
-            cgroup_destroy(sched->cgroups[i]);
-            sched->cgroups[i] = sched->cgroups[sched->cgroup_count - 1];
-            sched->cgroups[sched->cgroup_count - 1] = NULL;
-            sched->cgroup_count--;
-            return 0;
+static inline bool task_misfit(const Scheduler *sched, int util, int cpu) {
+    int capacity = cpu_capacity(sched, cpu);
+    return capacity < sched->max_capacity && !util_fits_capacity(util, capacity);
+}
+
+/**
+ * Runnable tasks homed on a CPU, counting the one running there
+ */
+static inline int cpu_load(const Scheduler *sched, int cpu) {
+    return runqueue_load(&sched->cpu_queues[cpu].rq) + (sched->cpu_queues[cpu].current_task != NULL);
+}
+
+/**
+ * Choose a CPU for a task of utilization `util` on asymmetric CPUs:
+ * the least loaded CPU it fits (the smaller one on ties, leaving big
+ * cores to heavy tasks), or if it fits none, the biggest allowed CPU
+ */
+static int select_capacity_cpu(const Scheduler *sched, const CpuMask *mask, int util) {
+    int best_cpu = -1;
+    bool best_fits = false;
+    int best_load = 0;
+    int best_capacity = 0;
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        if (!cpumask_test(mask, cpu)) {
+            continue;
+        }
+        int capacity = cpu_capacity(sched, cpu);
+        bool fits = !task_misfit(sched, util, cpu);
+        int load = cpu_load(sched, cpu);
+        bool better;
+        if (best_cpu < 0 || fits != best_fits) {
+            better = best_cpu < 0 || fits;
+        } else if (fits) {
+            better = load < best_load || (load == best_load && capacity < best_capacity);
+        } else {
+            better = capacity > best_capacity || (capacity == best_capacity && load < best_load);
+        }
+        if (better) {
+            best_cpu = cpu;
+            best_fits = fits;
+            best_load = load;
+            best_capacity = capacity;
         }
     }
-    
-    return -1;
+    return best_cpu >= 0 ? best_cpu : 0;
 }
 
 /* ============================================================================
- * Public Functions - Event Processing
+ * Run Queue Helpers
+ *
+ * In the default mode every RUNNABLE task lives in sched->runqueue.
+ * In per-CPU mode it lives in the run queue of its home CPU instead.
  * ============================================================================ */
 
-int scheduler_process_event(Scheduler *sched, const Event *event) {
-    if (!sched || !event) {
+/**
+ * Choose a home CPU for a task: keep the current one if still allowed,
+ * otherwise the least loaded CPU the task may run on.
+ */
+static int select_home_cpu(Scheduler *sched, Task *task, const CpuMask *mask) {
+    if (task->home_cpu >= 0 && task->home_cpu < sched->cpu_count &&
+        cpumask_test(mask, task->home_cpu)) {
+        return task->home_cpu;
+    }
+    if (sched->asym_capacity) {
+        return select_capacity_cpu(sched, mask, task_util(sched, task));
+    }
+    
+    int best_cpu = -1;
+    int best_load = 0;
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        if (!cpumask_test(mask, cpu)) {
+            continue;
+        }
+        int load = runqueue_load(&sched->cpu_queues[cpu].rq);
+        if (best_cpu < 0 || load < best_load) {
+            best_cpu = cpu;
+            best_load = load;
+        }
+    }
+    
+    /* No allowed CPU: park on CPU 0, it will simply never be picked */
+    return best_cpu >= 0 ? best_cpu : 0;
+}
+
+/**
+ * Queue a RUNNABLE task in the class matching its current CPU mask and cgroup
+ */
+static int enqueue_task(Scheduler *sched, Task *task) {
+    RunQueue *rq = &sched->runqueue;
+    if (sched->per_cpu_queues) {
+        task->home_cpu = select_home_cpu(sched, task, &task->allowed);
+        rq = &sched->cpu_queues[task->home_cpu].rq;
+    }
+    return runqueue_enqueue(rq, task, &task->allowed);
+}
+
+/**
+ * Take a task off the run queues entirely (block/exit)
+ */
+static void dequeue_task(Task *task) {
+    runqueue_dequeue(task);
+    runqueue_unbind(task);
+}
+
+/**
+ * Re-file a task after its affinity, cgroup or cgroup mask changed.
+ * Queued tasks move to the matching class (and, in per-CPU mode, to an
+ * allowed CPU); a running task drops its class and rebinds next tick.
+ */
+static void refresh_task_class(Scheduler *sched, Task *task) {
+    task_refresh_allowed(task);
+    task_refresh_weight(task);
+    if (task->heap_index >= 0) {
+        runqueue_dequeue(task);
+        enqueue_task(sched, task);
+    } else {
+        runqueue_unbind(task);
+    }
+}
+
+/**
+ * Move up to `count` of the latest-vruntime queued tasks of a class to
+ * another CPU's run queue. The class may be freed by the last move.
+ */
+static void migrate_class_tasks(Scheduler *sched, TaskClass *tclass, int count, int dst_cpu) {
+    for (int i = 0; i < count; i++) {
+        Task *task = taskqueue_last(&tclass->queue);
+        runqueue_dequeue(task);
+        task->home_cpu = dst_cpu;
+        enqueue_task(sched, task);
+    }
+}
+
+/**
+ * Even out per-CPU queue lengths by moving tasks from the longest queue
+ * to the shortest one. Only classes allowed on the target CPU are moved.
+ */
+static void balance_cpu_queues(Scheduler *sched) {
+    for (int round = 0; round < sched->cpu_count; round++) {
+        int busiest = 0;
+        int idlest = 0;
+        for (int cpu = 1; cpu < sched->cpu_count; cpu++) {
+            int load = runqueue_load(&sched->cpu_queues[cpu].rq);
+            if (load > runqueue_load(&sched->cpu_queues[busiest].rq)) {
+                busiest = cpu;
+            }
+            if (load < runqueue_load(&sched->cpu_queues[idlest].rq)) {
+                idlest = cpu;
+            }
+        }
+        
+        RunQueue *src = &sched->cpu_queues[busiest].rq;
+        RunQueue *dst = &sched->cpu_queues[idlest].rq;
+        int moved = 0;
+        
+        /* Walk active classes from the back so a freed class never hides an unvisited one */
+        for (int c = src->active_count - 1; c >= 0; c--) {
+            int gap = runqueue_load(src) - runqueue_load(dst);
+            if (gap <= 1) {
+                break;
+            }
+            TaskClass *tclass = src->classes[c];
+            if (!cpumask_test(&tclass->mask, idlest)) {
+                continue;
+            }
+            /* Never push a task down to a core it does not fit */
+            if (sched->asym_capacity &&
+                task_misfit(sched, task_util(sched, taskqueue_last(&tclass->queue)), idlest)) {
+                continue;
+            }
+            int size = taskqueue_size(&tclass->queue);
+            int count = size < gap / 2 ? size : gap / 2;
+            migrate_class_tasks(sched, tclass, count, idlest);
+            moved += count;
+        }
+        
+        if (moved == 0) {
+            break;
+        }
+    }
+}
+
+/**
+ * Move a queued task to another CPU's run queue
+ */
+static void migrate_task(Scheduler *sched, Task *task, int dst_cpu) {
+    runqueue_dequeue(task);
+    task->home_cpu = dst_cpu;
+    enqueue_task(sched, task);
+}
+
+/**
+ * Find a queued task of `cpu` that may move to `dst_cpu` and fits it.
+ * Only the latest task of each class is considered, as in balancing.
+ */
+static Task *find_fitting_task(Scheduler *sched, int cpu, int dst_cpu) {
+    RunQueue *rq = &sched->cpu_queues[cpu].rq;
+    for (int c = rq->active_count - 1; c >= 0; c--) {
+        TaskClass *tclass = rq->classes[c];
+        if (!cpumask_test(&tclass->mask, dst_cpu)) {
+            continue;
+        }
+        Task *task = taskqueue_last(&tclass->queue);
+        if (!task_misfit(sched, task_util(sched, task), dst_cpu)) {
+            return task;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Up-migrate misfit tasks. A task that just ran on a CPU too small for
+ * its utilization moves to the CPU select_capacity_cpu() prefers if that
+ * one is less loaded; otherwise it trades places with a queued task there
+ * that fits the smaller CPU, so light tasks end up on little cores.
+ * Runs after the tick's running tasks are requeued, before any pick.
+ */
+static void balance_misfit_tasks(Scheduler *sched) {
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        Task *task = sched->cpu_queues[cpu].previous_task;
+        if (!task || task->state != TASK_STATE_RUNNABLE || task->heap_index < 0 ||
+            task->home_cpu != cpu || !task_misfit(sched, task->util_avg, cpu)) {
+            continue;
+        }
+        
+        int dst = select_capacity_cpu(sched, &task->allowed, task->util_avg);
+        if (cpu_capacity(sched, dst) <= cpu_capacity(sched, cpu)) {
+            continue;
+        }
+        if (cpu_load(sched, dst) < cpu_load(sched, cpu)) {
+            migrate_task(sched, task, dst);
+            continue;
+        }
+        Task *light = find_fitting_task(sched, dst, cpu);
+        if (light) {
+            migrate_task(sched, task, dst);
+            migrate_task(sched, light, cpu);
+        }
+    }
+}
+
+/**
+ * Order two tasks the way the runnable heap does (qsort comparator)
+ */
+static int compare_task_order(const void *a, const void *b) {
+    const Task *ta = *(Task * const *)a;
+    const Task *tb = *(Task * const *)b;
+    if (task_before(ta, tb)) {
+        return -1;
+    }
+    return task_before(tb, ta) ? 1 : 0;
+}
+
+#ifdef DEBUG
+#define SCHED_DEBUG_VALIDATE(sched)                                         \
+    do {                                                                    \
+        if (scheduler_validate(sched) < 0) {                                \
+            fprintf(stderr, "ALFS: run queue invariant violated at %s:%d\n", \
+                    __FILE__, __LINE__);                                    \
+            abort();                                                        \
+        }                                                                   \
+    } while (0)
+#else
+#define SCHED_DEBUG_VALIDATE(sched) ((void)0)
+#endif
+
+/**
+ * Next cgroup with a quota above this one, skipping unlimited levels
+ */
+static inline Cgroup *next_quota_group(const Cgroup *cgroup) {
+    return cgroup->parent ? cgroup->parent->quota_group : NULL;
+}
+
+/**
+ * Throttle a cgroup whose quota ran out, or unthrottle one whose quota
+ * was refilled. Its whole subtree shares the throttle: a class is parked
+ * while any cgroup on its path to the root is throttled.
+ */
+static void update_cgroup_throttle(Scheduler *sched, Cgroup *cgroup) {
+    bool has_quota = cgroup_has_quota(cgroup, sched->current_vtime);
+    if (has_quota != cgroup->throttled) {
+        return;
+    }
+    
+    cgroup->throttled = !has_quota;
+    if (cgroup->throttled) {
+        sched->throttles++;
+        for (Cgroup *c = cgroup; c; c = cgroup_next_descendant(cgroup, c)) {
+            if (c->throttle_count++ == 0) {
+                runqueue_park_cgroup(c);
+            }
+        }
+    } else {
+        sched->unthrottles++;
+        for (Cgroup *c = cgroup; c; c = cgroup_next_descendant(cgroup, c)) {
+            if (--c->throttle_count == 0) {
+                runqueue_unpark_cgroup(c);
+            }
+        }
+    }
+}
+
+/**
+ * Ticks in a cgroup's period: it expires once the elapsed ticks times
+ * the tick length reach cpu_period_us
+ */
+static long long period_ticks(const Scheduler *sched, const Cgroup *cgroup) {
+    long long tick_us = (long long)sched->quanta * 1000LL;
+    if (tick_us <= 0) {
+        tick_us = 1000LL;
+    }
+    long long ticks = ((long long)cgroup->cpu_period_us + tick_us - 1) / tick_us;
+    return ticks > 0 ? ticks : 1;
+}
+
+/**
+ * Arm a cgroup's period timer for the end of its current period.
+ * Unlimited cgroups are timed too, so a quota set later starts on the
+ * same period boundaries it would have had all along.
+ */
+static void arm_period_timer(Scheduler *sched, Cgroup *cgroup) {
+    if (cgroup->cpu_period_us > 0) {
+        timer_wheel_add(&sched->period_wheel, &cgroup->period_timer,
+                        (long long)cgroup->period_start_vtime + period_ticks(sched, cgroup));
+    } else {
+        timer_wheel_del(&sched->period_wheel, &cgroup->period_timer);
+    }
+}
+
+static void collect_expired_cgroup(TimerNode *node, void *arg) {
+    Scheduler *sched = arg;
+    Cgroup *cgroup = (Cgroup *)((char *)node - offsetof(Cgroup, period_timer));
+    sched->expired_cgroups[sched->expired_count++] = cgroup;
+}
+
+static int compare_cgroup_index(const void *a, const void *b) {
+    const Cgroup *x = *(const Cgroup *const *)a;
+    const Cgroup *y = *(const Cgroup *const *)b;
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+/**
+ * Reset cgroup periods when their accounting window expires.
+ * Only the timers due by `vtime` are visited. They are handled in
+ * cgroup order, so classes unpark in the same order whatever the wheel
+ * layout. If time moves back, every period that began later restarts
+ * now, which needs one full scan.
+ */
+static void refresh_cgroup_periods(Scheduler *sched, int vtime) {
+    bool rewind = vtime < sched->period_wheel.now;
+    sched->expired_count = 0;
+    timer_wheel_advance(&sched->period_wheel, vtime, collect_expired_cgroup, sched);
+    if (sched->expired_count > 1) {
+        qsort(sched->expired_cgroups, (size_t)sched->expired_count, sizeof(Cgroup *),
+              compare_cgroup_index);
+    }
+    for (int i = 0; i < sched->expired_count; i++) {
+        Cgroup *cgroup = sched->expired_cgroups[i];
+        cgroup_reset_period(cgroup, vtime);
+        update_cgroup_throttle(sched, cgroup);
+        arm_period_timer(sched, cgroup);
+    }
+    if (!rewind) {
+        return;
+    }
+    
+    for (int i = 0; i < sched->cgroup_count; i++) {
+        Cgroup *cgroup = sched->cgroups[i];
+        if (vtime < cgroup->period_start_vtime) {
+            cgroup_reset_period(cgroup, vtime);
+            update_cgroup_throttle(sched, cgroup);
+            arm_period_timer(sched, cgroup);
+        }
+    }
+}
+
+/**
+ * Check whether a cgroup can take one more tick of runtime on some CPU,
+ * including runtime already planned on other CPUs this tick, at every
+ * level of the tree that has a quota.
+ * Throttled cgroups are parked and never reach this check.
+ */
+static bool cgroup_can_run_tick(const Cgroup *cgroup, double tick_runtime_us) {
+    for (const Cgroup *level = cgroup ? cgroup->quota_group : NULL; level;
+         level = next_quota_group(level)) {
+        double projected = level->quota_used + level->planned_runtime_us + tick_runtime_us;
+        if (projected > (double)level->cpu_quota_us) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Reserve one tick of runtime at every level with a quota
+ */
+static void plan_cgroup_runtime(Scheduler *sched, Cgroup *cgroup, double tick_runtime_us) {
+    for (Cgroup *level = cgroup->quota_group; level; level = next_quota_group(level)) {
+        level->planned_runtime_us += tick_runtime_us;
+        if (!level->planned) {
+            level->planned = true;
+            level->planned_next = sched->planned_cgroups;
+            sched->planned_cgroups = level;
+        }
+    }
+    sched->quota_planned = true;
+}
+
+/**
+ * Drop this tick's reservations; only cgroups that made one are visited
+ */
+static void clear_planned_runtime(Scheduler *sched) {
+    for (Cgroup *cgroup = sched->planned_cgroups; cgroup; cgroup = cgroup->planned_next) {
+        cgroup->planned_runtime_us = 0.0;
+        cgroup->planned = false;
+    }
+    sched->planned_cgroups = NULL;
+    sched->quota_planned = false;
+}
+
+static inline bool class_can_run(const TaskClass *tclass, int cpu, double tick_runtime_us) {
+    return !taskqueue_is_empty(&tclass->queue) && cpumask_test(&tclass->mask, cpu) &&
+           cgroup_can_run_tick(tclass->cgroup, tick_runtime_us);
+}
+
+/**
+ * Whether stealing a task to `cpu` would move it down to a core it
+ * does not fit, from a bigger home core that can still run it
+ */
+static bool steal_demotes(Scheduler *sched, Task *task, int cpu) {
+    return sched->asym_capacity && task->home_cpu >= 0 &&
+           cpu_capacity(sched, task->home_cpu) > cpu_capacity(sched, cpu) &&
+           task_misfit(sched, task_util(sched, task), cpu);
+}
+
+static inline bool class_has_quota(const TaskClass *tclass) {
+    return tclass->cgroup && tclass->cgroup->quota_group;
+}
+
+/**
+ * Choose the best runnable task of a run queue for a CPU without
+ * changing any state, so the local choices of a parallel tick can be
+ * made concurrently.
+ * Each class is eligible or not as a whole, so only class heads are
+ * compared and ineligible tasks are never extracted. Under EEVDF each
+ * class offers its earliest eligible deadline instead; if no class has
+ * an eligible task, the minimum vruntime runs so no CPU idles needlessly.
+ * A stealing CPU skips classes whose pick would not fit it (steal_demotes).
+ */
+static void choose_from_runqueue(Scheduler *sched, const RunQueue *rq, int cpu,
+                                 double tick_runtime_us, bool steal, PickChoice *choice) {
+    TaskClass *best = NULL;
+    Task *candidate = NULL;
+    int deferred = 0;
+    bool quota = false;
+    
+    if (policy_is_eevdf(sched)) {
+        vruntime_t avg_vruntime = runqueue_avg_vruntime(rq);
+        for (int i = 0; i < rq->active_count; i++) {
+            TaskClass *tclass = rq->classes[i];
+            quota |= class_has_quota(tclass);
+            if (!class_can_run(tclass, cpu, tick_runtime_us)) {
+                continue;
+            }
+            Task *task = taskqueue_pick_eligible(&tclass->queue, avg_vruntime);
+            if (task && steal && steal_demotes(sched, task, cpu)) {
+                continue;
+            }
+            if (task && (!candidate || deadline_before(task, candidate))) {
+                best = tclass;
+                candidate = task;
+            }
+        }
+    }
+    
+    if (!best) {
+        for (int i = 0; i < rq->active_count; i++) {
+            TaskClass *tclass = rq->classes[i];
+            quota |= class_has_quota(tclass);
+            if (!class_can_run(tclass, cpu, tick_runtime_us) ||
+                (steal && steal_demotes(sched, taskqueue_peek(&tclass->queue), cpu))) {
+                deferred += !taskqueue_is_empty(&tclass->queue);
+                continue;
+            }
+            if (!best || task_before(taskqueue_peek(&tclass->queue), taskqueue_peek(&best->queue))) {
+                best = tclass;
+            }
+        }
+    }
+    
+    choice->tclass = best;
+    choice->task = candidate;
+    choice->deferred = deferred;
+    choice->quota = quota;
+}
+
+/**
+ * Take the chosen task off its run queue and reserve its cgroup's quota
+ * @return The task, NULL if nothing was eligible
+ */
+static Task *commit_choice(Scheduler *sched, const PickChoice *choice, double tick_runtime_us) {
+    stats_count(sched->stats, STAT_PICK_DEFERRED, (uint64_t)choice->deferred);
+    TaskClass *best = choice->tclass;
+    if (!best) {
+        return NULL;
+    }
+    
+    Task *selected = choice->task;
+    if (selected) {
+        runqueue_dequeue(selected);
+    } else {
+        selected = runqueue_take(best);
+    }
+    if (class_has_quota(best)) {
+        plan_cgroup_runtime(sched, best->cgroup, tick_runtime_us);
+    }
+    stats_count(sched->stats, STAT_QUEUE_EXTRACT, 1);
+    return selected;
+}
+
+static Task *pick_from_runqueue(Scheduler *sched, RunQueue *rq, int cpu, double tick_runtime_us,
+                                bool steal) {
+    PickChoice choice;
+    choose_from_runqueue(sched, rq, cpu, tick_runtime_us, steal, &choice);
+    return commit_choice(sched, &choice, tick_runtime_us);
+}
+
+/**
+ * Steal for a CPU whose local queue has nothing eligible, searching the
+ * busiest queues first
+ */
+static Task *steal_task_for_cpu(Scheduler *sched, int cpu, double tick_runtime_us) {
+    bool tried[MAX_CPUS] = {false};
+    tried[cpu] = true;
+    for (;;) {
+        int victim = -1;
+        for (int i = 0; i < sched->cpu_count; i++) {
+            if (!tried[i] && runqueue_load(&sched->cpu_queues[i].rq) > 0 &&
+                (victim < 0 ||
+                 runqueue_load(&sched->cpu_queues[i].rq) > runqueue_load(&sched->cpu_queues[victim].rq))) {
+                victim = i;
+            }
+        }
+        if (victim < 0) {
+            return NULL;
+        }
+        tried[victim] = true;
+        stats_count(sched->stats, STAT_STEAL_ATTEMPT, 1);
+        
+        Task *selected = pick_from_runqueue(sched, &sched->cpu_queues[victim].rq, cpu,
+                                            tick_runtime_us, true);
+        if (selected) {
+            stats_count(sched->stats, STAT_STEAL, 1);
+            selected->home_cpu = cpu;
+            sched->cpu_queues[victim].spec_stale = true;
+            return selected;
+        }
+    }
+}
+
+static Task *pick_task_for_cpu(Scheduler *sched, int cpu, double tick_runtime_us) {
+    if (!sched->per_cpu_queues) {
+        return pick_from_runqueue(sched, &sched->runqueue, cpu, tick_runtime_us, false);
+    }
+    
+    Task *selected = pick_from_runqueue(sched, &sched->cpu_queues[cpu].rq, cpu, tick_runtime_us, false);
+    return selected ? selected : steal_task_for_cpu(sched, cpu, tick_runtime_us);
+}
+
+/* ============================================================================
+ * Parallel Tick
+ *
+ * In per-CPU mode a CPU's local pick only reads its own run queue and
+ * the quota reservations of cgroups, so every CPU's local choice is made
+ * concurrently on the tick pool. The merge then walks the CPUs in order,
+ * as the serial loop does, and commits each choice unless an earlier
+ * CPU could have changed it: a steal took from its queue, or a quota
+ * reservation was made while the choice considered a quota-limited
+ * class. Those CPUs, and CPUs that must steal, are picked serially, so
+ * the schedule is exactly the serial one.
+ * ============================================================================ */
+
+static inline double cpu_tick_runtime(const Scheduler *sched, int cpu, double tick_runtime_us) {
+    return capacity_scale(tick_runtime_us, cpu_capacity(sched, cpu));
+}
+
+typedef struct {
+    Scheduler *sched;
+    double tick_runtime_us;
+} SpeculateJob;
+
+static void speculate_picks(void *arg, int begin, int end) {
+    SpeculateJob *job = arg;
+    Scheduler *sched = job->sched;
+    for (int cpu = begin; cpu < end; cpu++) {
+        CPURunQueue *cq = &sched->cpu_queues[cpu];
+        choose_from_runqueue(sched, &cq->rq, cpu, cpu_tick_runtime(sched, cpu, job->tick_runtime_us),
+                             false, &cq->spec);
+        cq->spec_stale = false;
+    }
+}
+
+/**
+ * Commit a CPU's speculative choice, or redo the pick if it is out of date
+ */
+static Task *merge_pick_for_cpu(Scheduler *sched, int cpu, double tick_runtime_us) {
+    CPURunQueue *cq = &sched->cpu_queues[cpu];
+    if (cq->spec_stale || (cq->spec.quota && sched->quota_planned)) {
+        stats_count(sched->stats, STAT_PICK_RETRY, 1);
+        return pick_task_for_cpu(sched, cpu, tick_runtime_us);
+    }
+    Task *selected = commit_choice(sched, &cq->spec, tick_runtime_us);
+    return selected ? selected : steal_task_for_cpu(sched, cpu, tick_runtime_us);
+}
+
+/* ============================================================================
+ * Public Functions - Initialization
+ * ============================================================================ */
+
+/* Source of list_serial: schedulers may be created on several threads */
+static atomic_uint_fast64_t next_list_serial;
+
+Scheduler *scheduler_init(int cpu_count, int quanta) {
+    Scheduler *sched = calloc(1, sizeof(Scheduler));
+    if (!sched) {
+        return NULL;
+    }
+    
+    sched->cpu_count = cpu_count;
+    sched->quanta = quanta > 0 ? quanta : 1;
+    sched->current_vtime = 0;
+    sched->collect_meta = true;
+    sched->policy = SCHED_POLICY_CFS;
+    sched->list_serial = atomic_fetch_add_explicit(&next_list_serial, 1, memory_order_relaxed) + 1;
+    sched->list_epoch = 1;
+    
+    /* Initialize CPU queues */
+    sched->cpu_queues = calloc(cpu_count, sizeof(CPURunQueue));
+    if (!sched->cpu_queues) {
+        free(sched);
+        return NULL;
+    }
+    
+    for (int i = 0; i < cpu_count; i++) {
+        sched->cpu_queues[i].cpu_id = i;
+        sched->cpu_queues[i].current_task = NULL;
+        sched->cpu_queues[i].capacity = SCHED_CAPACITY_SCALE;
+    }
+    sched->max_capacity = SCHED_CAPACITY_SCALE;
+    
+    /* Task and cgroup storage start small and grow on demand */
+    sched->task_count = 0;
+    sched->cgroup_count = 0;
+    sched->ids = idtable_create(0);
+    if (!sched->ids || reserve_task_storage(sched, TASK_MIN_CAPACITY) < 0 ||
+        reserve_cgroup_storage(sched, CGROUP_MIN_CAPACITY) < 0) {
+        free(sched->cgroups);
+        free(sched->expired_cgroups);
+        idtable_destroy(sched->ids);
+        free(sched->task_entries);
+        free(sched->task_reported);
+        free(sched->task_states);
+        free(sched->all_tasks);
+        free(sched->cpu_queues);
+        free(sched);
+        return NULL;
+    }
+    
+    /* Slab pools grow on first use */
+    task_pools_init(&sched->task_pools);
+    pool_init(&sched->cgroup_pool, sizeof(Cgroup), _Alignof(Cgroup), CGROUP_POOL_SLAB);
+    
+    /* Initialize run queues (per-CPU ones stay empty unless enabled) */
+    runqueue_init(&sched->runqueue);
+    for (int i = 0; i < cpu_count; i++) {
+        runqueue_init(&sched->cpu_queues[i].rq);
+    }
+    
+    return sched;
+}
+
+void scheduler_destroy(Scheduler *sched) {
+    if (!sched) {
+        return;
+    }
+    
+    /* Free all tasks */
+    for (int i = 0; i < sched->task_count; i++) {
+        task_destroy(sched->all_tasks[i]);
+    }
+    free(sched->all_tasks);
+    free(sched->task_states);
+    free(sched->task_entries);
+    free(sched->task_reported);
+    
+    /* Free all cgroups */
+    for (int i = 0; i < sched->cgroup_count; i++) {
+        cgroup_destroy(sched->cgroups[i]);
+    }
+    free(sched->cgroups);
+    free(sched->expired_cgroups);
+    
+    /* Release the slabs behind them */
+    task_pools_destroy(&sched->task_pools);
+    pool_destroy(&sched->cgroup_pool);
+    
+    /* Free run queues */
+    runqueue_destroy(&sched->runqueue);
+    for (int i = 0; i < sched->cpu_count; i++) {
+        runqueue_destroy(&sched->cpu_queues[i].rq);
+    }
+    
+    /* Free ID index (ticks pinning entries must already be freed) */
+    idtable_destroy(sched->ids);
+    free(sched->sent_schedule);
+    free(sched->dropped_tasks);
+    
+    /* Free CPU queues */
+    free(sched->cpu_queues);
+    
+    stats_destroy(sched->stats);
+    checkpoint_destroy(sched->checkpoint);
+    workpool_destroy(sched->tick_pool);
+    free(sched->batch_slots);
+    free(sched->batch_skip);
+    free(sched);
+}
+
+int scheduler_reserve(Scheduler *sched, int tasks) {
+    if (!sched || tasks < 0) {
+        return -1;
+    }
+    return reserve_task_storage(sched, tasks) < 0 ||
+           idtable_reserve(sched->ids, tasks + sched->cgroup_count) < 0 ? -1 : 0;
+}
+
+/* ============================================================================
+ * Public Functions - Task Management
+ * ============================================================================ */
+
+Task *scheduler_find_task(Scheduler *sched, const char *task_id) {
+    if (!sched || !task_id) {
+        return NULL;
+    }
+    
+    IdEntry *entry = idtable_lookup(sched->ids, task_id);
+    return entry ? entry->task : NULL;
+}
+
+int scheduler_add_task(Scheduler *sched, Task *task) {
+    if (!sched || !task) {
+        return -1;
+    }
+    
+    if (reserve_task_storage(sched, sched->task_count + 1) < 0) {
+        return -1;
+    }
+    
+    IdEntry *entry = idtable_acquire(sched->ids, task->task_id);
+    if (!entry) {
+        return -1;
+    }
+    if (entry->task) {
+        idtable_release(sched->ids, entry);
+        return -1;  /* Duplicate task ID */
+    }
+    
+    /* From here on the task refers to the interned IDs only */
+    const char *task_id = task->task_id;
+    const char *cgroup_id = task->cgroup_id;
+    if (task_join_cgroup(sched, task, cgroup_id) < 0) {
+        task->cgroup_id = cgroup_id;
+        idtable_release(sched->ids, entry);
+        return -1;
+    }
+    entry->task = task;
+    task->id_entry = entry;
+    task->task_id = entry->str;
+    
+    task->seq = sched->next_task_seq++;
+    task->task_index = sched->task_count;
+    sched->all_tasks[task->task_index] = task;
+    sched->task_states[task->task_index] = (uint8_t)task->state;
+    sched->task_entries[task->task_index] = entry;
+    sched->task_reported[task->task_index] = TASK_LISTED_NONE;
+    sched->task_count++;
+    sched->list_epoch++;
+    
+    /* Queue the task if it is runnable */
+    if (task->state == TASK_STATE_RUNNABLE) {
+        if (enqueue_task(sched, task) < 0) {
+            sched->all_tasks[--sched->task_count] = NULL;
+            sched->task_entries[sched->task_count] = NULL;
+            task_leave_cgroup(sched, task);
+            entry->task = NULL;
+            task->id_entry = NULL;
+            task->task_id = task_id;
+            task->cgroup_id = cgroup_id;
+            idtable_release(sched->ids, entry);
+            return -1;
+        }
+        track_max_vruntime(sched, task);
+    }
+    
+    return 0;
+}
+
+int scheduler_remove_task(Scheduler *sched, const char *task_id) {
+    if (!sched || !task_id) {
+        return -1;
+    }
+    
+    IdEntry *entry = idtable_lookup(sched->ids, task_id);
+    if (!entry || !entry->task) {
+        return -1;
+    }
+    Task *task = entry->task;
+    
+    /* Remove from run queue if present */
+    dequeue_task(task);
+    untrack_max_vruntime(sched, task);
+    
+    /* Remove from CPU queue if running */
+    for (int j = 0; j < sched->cpu_count; j++) {
+        if (sched->cpu_queues[j].current_task == task) {
+            sched->cpu_queues[j].current_task = NULL;
+        }
+    }
+    update_min_vruntime(sched);
+    
+    /* A peer sent deltas still lists the task until the next tick */
+    int i = task->task_index;
+    if (sched->task_reported[i] != TASK_LISTED_NONE) {
+        drop_reported_task(sched, entry);
+    }
+    
+    /* Remove from task array (last task takes over the slot) */
+    int last = sched->task_count - 1;
+    Task *moved = sched->all_tasks[last];
+    sched->all_tasks[i] = moved;
+    sched->task_states[i] = sched->task_states[last];
+    sched->task_entries[i] = sched->task_entries[last];
+    sched->task_reported[i] = sched->task_reported[last];
+    moved->task_index = i;
+    sched->all_tasks[last] = NULL;
+    sched->task_entries[last] = NULL;
+    sched->task_count--;
+    sched->list_epoch++;
+    
+    /* Drop index entries */
+    task_leave_cgroup(sched, task);
+    entry->task = NULL;
+    task->id_entry = NULL;
+    idtable_release(sched->ids, entry);
+    task_destroy(task);
+    
+    return 0;
+}
+
+/* ============================================================================
+ * Public Functions - Cgroup Management
+ * ============================================================================ */
+
+Cgroup *scheduler_find_cgroup(Scheduler *sched, const char *cgroup_id) {
+    if (!sched || !cgroup_id) {
+        return NULL;
+    }
+    
+    IdEntry *entry = idtable_lookup(sched->ids, cgroup_id);
+    return entry ? entry->cgroup : NULL;
+}
+
+int scheduler_add_cgroup(Scheduler *sched, Cgroup *cgroup) {
+    if (!sched || !cgroup) {
+        return -1;
+    }
+    
+    if (reserve_cgroup_storage(sched, sched->cgroup_count + 1) < 0) {
+        return -1;
+    }
+    
+    IdEntry *entry = idtable_acquire(sched->ids, cgroup->cgroup_id);
+    if (!entry) {
         return -1;
     }
+    if (entry->cgroup) {
+        idtable_release(sched->ids, entry);
+        return -1;  /* Duplicate cgroup ID */
+    }
+    entry->cgroup = cgroup;
+    cgroup->cgroup_id = entry->str;
+    
+    /* Bind tasks that already named this cgroup */
+    for (Task *task = entry->members; task; task = task->group_next) {
+        task->cgroup = cgroup;
+        refresh_task_class(sched, task);
+    }
+    
+    cgroup->index = sched->cgroup_count;
+    sched->cgroups[sched->cgroup_count++] = cgroup;
+    arm_period_timer(sched, cgroup);
+    return 0;
+}
+
+int scheduler_remove_cgroup(Scheduler *sched, const char *cgroup_id) {
+    if (!sched || !cgroup_id) {
+        return -1;
+    }
+    
+    IdEntry *entry = idtable_lookup(sched->ids, cgroup_id);
+    if (!entry || !entry->cgroup || entry->cgroup->first_child) {
+        return -1;
+    }
+    Cgroup *cgroup = entry->cgroup;
+    
+    /* Hold the entry while members move away from it */
+    entry->refs++;
+    entry->cgroup = NULL;
+    for (Task *task = entry->members; task; task = task->group_next) {
+        task->cgroup = NULL;
+        refresh_task_class(sched, task);
+    }
+    
+    /* Members fall back to the default cgroup */
+    if (strcmp(cgroup_id, "0") != 0) {
+        while (entry->members) {
+            Task *task = entry->members;
+            task_leave_cgroup(sched, task);
+            task_join_cgroup(sched, task, "0");
+            refresh_task_class(sched, task);
+        }
+    }
     
+    /* Swap the last cgroup into the freed slot */
+    Cgroup *last = sched->cgroups[--sched->cgroup_count];
+    sched->cgroups[cgroup->index] = last;
+    last->index = cgroup->index;
+    sched->cgroups[sched->cgroup_count] = NULL;
+    timer_wheel_del(&sched->period_wheel, &cgroup->period_timer);
+    cgroup_detach(cgroup);
+    cgroup_destroy(cgroup);
+    idtable_release(sched->ids, entry);
+    idtable_release(sched->ids, entry);
+    
+    return 0;
+}
+
+/* ============================================================================
+ * Public Functions - Event Processing
+ * ============================================================================ */
+
+/**
+ * An event's ID, with a missing one read as "" like an empty string
+ */
+static inline const char *event_id(const char *id) {
+    return id ? id : "";
+}
+
+/**
+ * Apply one event to the scheduler state
+ */
+static int apply_event(Scheduler *sched, const Event *event) {
     switch (event->action) {
         case EVENT_TASK_CREATE: {
             /* Set initial vruntime to max of current runnable tasks */
-            double max_vr = get_max_vruntime(sched);
+            vruntime_t max_vr = get_max_vruntime(sched);
             
             int nice = event->has_nice ? event->nice : 0;
-            Task *task = task_create(event->task_id, nice, 
-                                     event->cgroup_id[0] ? event->cgroup_id : NULL);
+            const char *cgroup_id = event->cgroup_id && event->cgroup_id[0] ? event->cgroup_id : NULL;
+            Task *task = task_create_pooled(&sched->task_pools, event_id(event->task_id), nice,
+                                            cgroup_id);
             if (!task) {
                 return -1;
             }
             
-            /* New tasks start at max vruntime to prevent starvation of existing tasks */
+            /*
+             * New tasks start at max vruntime to prevent starvation of
+             * existing tasks; under EEVDF they join at the average with
+             * zero lag instead
+             */
             task->vruntime = max_vr;
+            if (policy_is_eevdf(sched)) {
+                task->vruntime = get_avg_vruntime(sched);
+                eevdf_set_deadline(sched, task);
+            }
+            task->wake_tick = sched->tick_count;
             if (event->has_cpu_mask) {
                 task_set_affinity(task, event->cpu_mask, event->cpu_mask_count);
             }
             
-            scheduler_add_task(sched, task);
+            if (scheduler_add_task(sched, task) < 0) {
+                task_destroy(task);
+                return -1;
+            }
+            
+            /* Binary peers name the task by handle in replies */
+            if (event->task_handle && task->id_entry->handle == 0) {
+                task->id_entry->handle = event->task_handle;
+            }
             break;
         }
         
         case EVENT_TASK_EXIT: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task) {
-                task->state = TASK_STATE_EXITED;
-                scheduler_remove_task(sched, event->task_id);
+                set_task_state(sched, task, TASK_STATE_EXITED);
+                scheduler_remove_task(sched, event_id(event->task_id));
             }
             break;
         }
         
         case EVENT_TASK_BLOCK: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task) {
-                task->state = TASK_STATE_BLOCKED;
-                /* Remove from runnable heap */
-                if (task->heap_index >= 0) {
-                    heap_remove(sched->runnable_heap, task);
+                if (policy_is_eevdf(sched)) {
+                    eevdf_save_lag(sched, task);
                 }
+                set_task_state(sched, task, TASK_STATE_BLOCKED);
+                task->wake_tick = -1;
+                /* Remove from run queue */
+                dequeue_task(task);
+                untrack_max_vruntime(sched, task);
                 /* Clear from current CPU */
                 if (task->current_cpu >= 0) {
                     sched->cpu_queues[task->current_cpu].current_task = NULL;
                     task->current_cpu = -1;
                 }
+                update_min_vruntime(sched);
             }
             break;
         }
         
         case EVENT_TASK_UNBLOCK: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task && task->state == TASK_STATE_BLOCKED) {
-                task->state = TASK_STATE_RUNNABLE;
+                set_task_state(sched, task, TASK_STATE_RUNNABLE);
                 
                 /* Set vruntime to min of (current vruntime, min_vruntime - small bonus) */
                 /* This gives blocked tasks a slight priority boost */
-                double min_vr = get_min_vruntime(sched);
-                if (task->vruntime < min_vr - 1.0) {
-                    task->vruntime = min_vr - 1.0;  /* Small latency bonus */
+                vruntime_t min_vr;
+                if (sched->per_cpu_queues) {
+                    /* Place against the queue the task is about to join */
+                    if (sched->asym_capacity) {
+                        task->home_cpu = -1;  /* Re-placed by utilization */
+                    }
+                    task->home_cpu = select_home_cpu(sched, task, &task->allowed);
+                    min_vr = sched->cpu_queues[task->home_cpu].rq.min_vruntime;
+                } else {
+                    min_vr = get_min_vruntime(sched);
+                }
+                if (policy_is_eevdf(sched)) {
+                    /*
+                     * Rejoin as far behind the average as it left. Negative
+                     * lag is worked off while asleep (as the kernel's delayed
+                     * dequeue does): the task keeps its vruntime until the
+                     * average passes it.
+                     */
+                    RunQueue *rq = sched->per_cpu_queues ?
+                        &sched->cpu_queues[task->home_cpu].rq : &sched->runqueue;
+                    vruntime_t avg_vruntime = runqueue_avg_vruntime(rq);
+                    if (task->vlag >= 0) {
+                        task->vruntime = avg_vruntime - task->vlag;
+                    } else if (task->vruntime < avg_vruntime) {
+                        task->vruntime = avg_vruntime;
+                    }
+                    eevdf_set_deadline(sched, task);
+                } else if (task->vruntime < min_vr - VRUNTIME_QUANTUM) {
+                    task->vruntime = min_vr - VRUNTIME_QUANTUM;  /* Small latency bonus */
                 }
                 
-                heap_insert(sched->runnable_heap, task);
+                task->wake_tick = sched->tick_count;
+                enqueue_task(sched, task);
+                track_max_vruntime(sched, task);
             }
             break;
         }
         
         case EVENT_TASK_YIELD: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task) {
                 /* Set vruntime to max to give other tasks a chance */
+                vruntime_t old_vruntime = task->vruntime;
                 task->vruntime = get_max_vruntime(sched);
-                if (task->heap_index >= 0) {
-                    heap_update(sched->runnable_heap, task);
+                if (policy_is_eevdf(sched)) {
+                    eevdf_set_deadline(sched, task);
                 }
+                runqueue_update(task, old_vruntime);
             }
             break;
         }
         
         case EVENT_TASK_SETNICE: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task) {
                 task_set_nice(task, event->nice);
                 /* Heap position may need to change if weight affects scheduling */
@@ -543,9 +1503,10 @@ int scheduler_process_event(Scheduler *sched, const Event *event) {
         }
         
         case EVENT_TASK_SET_AFFINITY: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task) {
                 task_set_affinity(task, event->cpu_mask, event->cpu_mask_count);
+                refresh_task_class(sched, task);
             }
             break;
         }
@@ -555,17 +1516,34 @@ int scheduler_process_event(Scheduler *sched, const Event *event) {
             int quota = event->has_cpu_quota ? event->cpu_quota_us : UNLIMITED_QUOTA;
             int period = event->has_cpu_period ? event->cpu_period_us : DEFAULT_CPU_PERIOD_US;
             
-            Cgroup *cgroup = cgroup_create(event->cgroup_id, shares, quota, period,
-                                           event->cpu_mask, event->cpu_mask_count);
-            if (cgroup) {
-                cgroup->period_start_vtime = sched->current_vtime;
-                scheduler_add_cgroup(sched, cgroup);
+            /* A nested cgroup's parent must already exist, as with mkdir */
+            Cgroup *parent = NULL;
+            if (event->parent_id && event->parent_id[0] != '\0') {
+                parent = scheduler_find_cgroup(sched, event->parent_id);
+                if (!parent) {
+                    return -1;
+                }
+            }
+            
+            Cgroup *cgroup = cgroup_create_pooled(&sched->cgroup_pool, event_id(event->cgroup_id),
+                                                  shares, quota, period,
+                                                  event->cpu_mask, event->cpu_mask_count);
+            if (!cgroup) {
+                return -1;
+            }
+            cgroup->period_start_vtime = sched->current_vtime;
+            if ((parent && cgroup_attach(cgroup, parent) < 0) ||
+                scheduler_add_cgroup(sched, cgroup) < 0) {
+                cgroup_detach(cgroup);
+                cgroup_destroy(cgroup);
+                return -1;
             }
+            update_cgroup_throttle(sched, cgroup);
             break;
         }
         
         case EVENT_CGROUP_MODIFY: {
-            Cgroup *cgroup = scheduler_find_cgroup(sched, event->cgroup_id);
+            Cgroup *cgroup = scheduler_find_cgroup(sched, event_id(event->cgroup_id));
             if (cgroup) {
                 int shares = event->has_cpu_shares ? event->cpu_shares : -1;
                 int quota = event->has_cpu_quota ? event->cpu_quota_us : -2;
@@ -576,33 +1554,65 @@ int scheduler_process_event(Scheduler *sched, const Event *event) {
                               event->cpu_mask_count) < 0) {
                     return -1;
                 }
-
+                
+                /* Descendants inherit shares, mask and quota group, parents first */
+                bool inherited = event->has_cpu_shares || event->has_cpu_mask || event->has_cpu_quota;
+                if (inherited) {
+                    for (Cgroup *c = cgroup_next_descendant(cgroup, cgroup); c;
+                         c = cgroup_next_descendant(cgroup, c)) {
+                        cgroup_inherit(c);
+                    }
+                }
+                
                 if (event->has_cpu_period && event->cpu_period_us > 0) {
                     cgroup_reset_period(cgroup, sched->current_vtime);
+                    arm_period_timer(sched, cgroup);
+                }
+                update_cgroup_throttle(sched, cgroup);
+                
+                if (event->has_cpu_mask || event->has_cpu_shares) {
+                    for (Cgroup *c = cgroup; c; c = cgroup_next_descendant(cgroup, c)) {
+                        IdEntry *entry = idtable_lookup(sched->ids, c->cgroup_id);
+                        for (Task *task = entry->members; task; task = task->group_next) {
+                            if (event->has_cpu_mask) {
+                                refresh_task_class(sched, task);
+                            } else {
+                                task_refresh_weight(task);
+                            }
+                        }
+                    }
                 }
             }
             break;
         }
         
         case EVENT_CGROUP_DELETE: {
-            scheduler_remove_cgroup(sched, event->cgroup_id);
+            scheduler_remove_cgroup(sched, event_id(event->cgroup_id));
             break;
         }
         
         case EVENT_TASK_MOVE_CGROUP: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task) {
-                strncpy(task->cgroup_id, event->new_cgroup_id, MAX_CGROUP_ID_LEN - 1);
-                task->cgroup_id[MAX_CGROUP_ID_LEN - 1] = '\0';
+                task_leave_cgroup(sched, task);
+                if (task_join_cgroup(sched, task, event_id(event->new_cgroup_id)) < 0) {
+                    return -1;
+                }
+                refresh_task_class(sched, task);
             }
             break;
         }
         
         case EVENT_CPU_BURST: {
-            Task *task = scheduler_find_task(sched, event->task_id);
+            Task *task = scheduler_find_task(sched, event_id(event->task_id));
             if (task) {
                 task->is_burst = true;
                 task->burst_remaining = event->burst_duration;
+                if (policy_is_eevdf(sched)) {
+                    /* The shorter slice pulls the deadline in right away */
+                    eevdf_set_deadline(sched, task);
+                    runqueue_update(task, task->vruntime);
+                }
             }
             break;
         }
@@ -611,71 +1621,521 @@ int scheduler_process_event(Scheduler *sched, const Event *event) {
             return -1;
     }
     
+    SCHED_DEBUG_VALIDATE(sched);
+    return 0;
+}
+
+/**
+ * Apply one event, timed under its action's phase
+ */
+static int process_event(Scheduler *sched, const Event *event) {
+    uint64_t start = stats_start(sched->stats);
+    int rc = apply_event(sched, event);
+    if (event->action > EVENT_INVALID && event->action < EVENT_ACTION_COUNT) {
+        stats_lap(sched->stats, (StatPhase)(STAT_EVENT + event->action), start);
+    }
+    return rc;
+}
+
+int scheduler_process_event(Scheduler *sched, const Event *event) {
+    if (!sched || !event) {
+        return -1;
+    }
+    
+    return process_event(sched, event);
+}
+
+/* ============================================================================
+ * Batched Event Processing
+ *
+ * An event may be skipped only if applying it could not change anything
+ * the rest of the batch or the next tick observes:
+ * - SETNICE only rewrites the task's weight, which nothing reads until
+ *   the task's own next event or re-enqueue (queue averages and load use
+ *   the weight captured at enqueue). A later SETNICE or EXIT of the task
+ *   overwrites or discards it.
+ * - CPU_BURST only sets the task's burst fields, except under EEVDF where
+ *   it also moves the task in its queue, so it is kept there.
+ * Cgroup events and MOVE_CGROUP re-enqueue or reweight other tasks, so
+ * nothing is skipped across them. Both skippable events always succeed,
+ * so skipping never changes the failure count.
+ *
+ * Collapsing anything else would change the result: BLOCK then UNBLOCK
+ * places the task again and moves it to the back of its class, and an
+ * affinity or cgroup change re-files the task's class.
+ * ============================================================================ */
+
+#define BATCH_MIN_CAPACITY 64
+
+static bool is_cgroup_event(EventAction action) {
+    return action == EVENT_CGROUP_CREATE || action == EVENT_CGROUP_MODIFY ||
+           action == EVENT_CGROUP_DELETE || action == EVENT_TASK_MOVE_CGROUP;
+}
+
+/**
+ * Whether an event can be superseded by a later event on its task
+ */
+static bool is_supersedable(const Scheduler *sched, EventAction action) {
+    return action == EVENT_TASK_SETNICE ||
+           (action == EVENT_CPU_BURST && !policy_is_eevdf(sched));
+}
+
+/**
+ * Grow the batch scratch to cover `count` events
+ */
+static int reserve_batch(Scheduler *sched, int count) {
+    if (count <= sched->batch_capacity) {
+        return 0;
+    }
+    int capacity = sched->batch_capacity ? sched->batch_capacity : BATCH_MIN_CAPACITY;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    
+    EventSlot *slots = realloc(sched->batch_slots, 2 * (size_t)capacity * sizeof(EventSlot));
+    if (!slots) {
+        return -1;
+    }
+    sched->batch_slots = slots;
+    uint8_t *skip = realloc(sched->batch_skip, (size_t)capacity);
+    if (!skip) {
+        return -1;
+    }
+    sched->batch_skip = skip;
+    sched->batch_capacity = capacity;
+    return 0;
+}
+
+/**
+ * FNV-1a hash of a task ID, as the ID index uses
+ */
+static uint32_t batch_hash(const char *id) {
+    uint32_t hash = 2166136261u;
+    while (*id) {
+        hash ^= (unsigned char)*id++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Mark the events a later event in the batch supersedes.
+ * Walks the batch backwards, remembering the next event on each task and
+ * the next cgroup event.
+ * @return Number of events marked, -1 if the scratch could not grow
+ */
+static int plan_batch(Scheduler *sched, const Event *events, int count) {
+    if (reserve_batch(sched, count) < 0) {
+        return -1;
+    }
+    
+    /* Power-of-two table at most half full */
+    uint32_t mask = 1;
+    while (mask < 2 * (uint32_t)count) {
+        mask <<= 1;
+    }
+    mask--;
+    EventSlot *slots = sched->batch_slots;
+    memset(slots, 0, ((size_t)mask + 1) * sizeof(EventSlot));
+    memset(sched->batch_skip, 0, (size_t)count);
+    
+    int barrier = count;
+    int marked = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        EventAction action = events[i].action;
+        if (is_cgroup_event(action)) {
+            barrier = i;
+            continue;
+        }
+        if (action <= EVENT_INVALID || action >= EVENT_ACTION_COUNT) {
+            continue;
+        }
+        
+        const char *id = event_id(events[i].task_id);
+        uint32_t hash = batch_hash(id);
+        uint32_t idx = hash & mask;
+        while (slots[idx].id && (slots[idx].hash != hash || strcmp(slots[idx].id, id) != 0)) {
+            idx = (idx + 1) & mask;
+        }
+        
+        EventSlot *slot = &slots[idx];
+        if (slot->id && slot->next < barrier && is_supersedable(sched, action)) {
+            EventAction later = events[slot->next].action;
+            if (later == action || later == EVENT_TASK_EXIT) {
+                sched->batch_skip[i] = 1;
+                marked++;
+            }
+        }
+        slot->id = id;
+        slot->hash = hash;
+        slot->next = i;
+    }
+    return marked;
+}
+
+int scheduler_process_events(Scheduler *sched, const Event *events, int count) {
+    if (!sched || (!events && count > 0) || count < 0) {
+        return -1;
+    }
+    
+    /* Plan only when something could be superseded */
+    int marked = 0;
+    for (int i = 0; i + 1 < count; i++) {
+        if (is_supersedable(sched, events[i].action)) {
+            marked = plan_batch(sched, events, count);
+            break;
+        }
+    }
+    
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        if (marked > 0 && sched->batch_skip[i]) {
+            continue;
+        }
+        if (process_event(sched, &events[i]) < 0) {
+            failed++;
+        }
+    }
+    if (marked > 0) {
+        stats_count(sched->stats, STAT_EVENT_COALESCED, (uint64_t)marked);
+    }
+    return failed;
+}
+
+/* ============================================================================
+ * Tick Output Helpers
+ *
+ * A tick lists interned IDs instead of copies and pins each listed entry,
+ * so the strings outlive tasks that exit before the tick is consumed.
+ * ============================================================================ */
+
+#define TICK_MIN_CAPACITY 64
+
+/**
+ * Round a buffer capacity up (doubling) until it holds `needed` slots
+ */
+static int tick_capacity(int capacity, int needed) {
+    if (capacity <= 0) {
+        capacity = TICK_MIN_CAPACITY;
+    }
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/**
+ * Make room for every CPU plus `listed` metadata task IDs
+ * Listed IDs already in the tick are kept (the lists may be reused).
+ */
+static int tick_reserve(SchedulerTick *tick, int listed) {
+    if (tick->pin_capacity < tick->cpu_count) {
+        int capacity = tick_capacity(tick->pin_capacity, tick->cpu_count);
+        IdEntry **pins = realloc(tick->pins, (size_t)capacity * sizeof(IdEntry *));
+        if (!pins) {
+            return -1;
+        }
+        tick->pins = pins;
+        tick->pin_capacity = capacity;
+    }
+    
+    SchedulerMeta *meta = tick->meta;
+    if (meta->task_capacity < listed) {
+        int capacity = tick_capacity(meta->task_capacity, listed);
+        size_t blocked = meta->runnable_tasks ? (size_t)(meta->blocked_tasks - meta->runnable_tasks) : 0;
+        const char **ids = realloc(meta->runnable_tasks, (size_t)capacity * sizeof(char *));
+        if (!ids) {
+            return -1;
+        }
+        meta->runnable_tasks = ids;
+        meta->blocked_tasks = ids + blocked;
+        IdEntry **entries = realloc(meta->task_entries, (size_t)capacity * sizeof(IdEntry *));
+        if (!entries) {
+            return -1;
+        }
+        meta->task_entries = entries;
+        meta->task_capacity = capacity;
+    }
     return 0;
 }
 
+/**
+ * Drop the references held by a tick's schedule and empty it
+ * The task lists stay until tick_release_lists, so they can be reused.
+ */
+static void tick_reset(SchedulerTick *tick) {
+    for (int i = 0; i < tick->pin_count; i++) {
+        idtable_release(tick->ids, tick->pins[i]);
+    }
+    tick->pin_count = 0;
+    tick->delta = false;
+    tick->changed_count = 0;
+}
+
+/**
+ * Drop the references held by a tick's task lists and empty them
+ */
+static void tick_release_lists(SchedulerTick *tick) {
+    SchedulerMeta *meta = tick->meta;
+    int listed = meta->runnable_count + meta->blocked_count + meta->removed_count;
+    for (int i = 0; i < listed; i++) {
+        idtable_release(tick->ids, meta->task_entries[i]);
+    }
+    meta->runnable_count = 0;
+    meta->blocked_count = 0;
+    meta->removed_count = 0;
+    tick->list_serial = 0;
+    tick->list_epoch = 0;
+}
+
+/**
+ * Whether a tick already holds the scheduler's current full task lists
+ */
+static bool tick_lists_current(const Scheduler *sched, const SchedulerTick *tick) {
+    return tick->list_serial == sched->list_serial && tick->list_epoch == sched->list_epoch;
+}
+
+/**
+ * Reference a busy CPU's task ID from the tick's next schedule pin
+ */
+static const char *tick_pin(SchedulerTick *tick, IdEntry *entry) {
+    idtable_retain(entry);
+    tick->pins[tick->pin_count++] = entry;
+    return entry->str;
+}
+
+/**
+ * Reference a task's interned ID from task list slot `slot` of a tick
+ */
+static const char *tick_list(SchedulerTick *tick, int slot, IdEntry *entry) {
+    idtable_retain(entry);
+    tick->meta->task_entries[slot] = entry;
+    return entry->str;
+}
+
+/**
+ * Fill the tick's runnable and blocked task lists (after tick_release_lists)
+ */
+static void collect_task_lists(Scheduler *sched, SchedulerTick *tick) {
+    /*
+     * Count runnable and blocked tasks, then partition their IDs, in two
+     * linear passes over the state and ID columns (the counting loop is
+     * branch-free so the compiler can vectorize it)
+     */
+    const uint8_t *states = sched->task_states;
+    int task_count = sched->task_count;
+    int runnable_count = 0;
+    int blocked_count = 0;
+    for (int i = 0; i < task_count; i++) {
+        runnable_count += state_is_runnable(states[i]);
+        blocked_count += states[i] == TASK_STATE_BLOCKED;
+    }
+    
+    /* Both lists share one buffer: runnable IDs first, then blocked */
+    tick->meta->blocked_tasks = tick->meta->runnable_tasks + runnable_count;
+    
+    int ri = 0, bi = 0;
+    IdEntry **entries = sched->task_entries;
+    for (int i = 0; i < task_count; i++) {
+        if (state_is_runnable(states[i])) {
+            tick->meta->runnable_tasks[ri] = tick_list(tick, ri, entries[i]);
+            ri++;
+        } else if (states[i] == TASK_STATE_BLOCKED) {
+            tick->meta->blocked_tasks[bi] = tick_list(tick, runnable_count + bi, entries[i]);
+            bi++;
+        }
+    }
+    tick->meta->runnable_count = runnable_count;
+    tick->meta->blocked_count = blocked_count;
+    tick->list_serial = sched->list_serial;
+    tick->list_epoch = sched->list_epoch;
+}
+
+/* ============================================================================
+ * Delta Ticks
+ *
+ * The scheduler remembers what the peer was last sent: each CPU's task
+ * (sent_schedule) and the list each task was reported in (the
+ * task_reported column). A delta tick lists only the differences; tasks
+ * that were reported and then removed are kept pinned in dropped_tasks
+ * until the next tick names them. A keyframe is a full tick that resets
+ * what was sent. While the list version is the one last reported, no
+ * task can have changed list and both passes are skipped.
+ * ============================================================================ */
+
+/**
+ * Record the CPUs whose task differs from the one last sent
+ */
+static void track_schedule(Scheduler *sched, SchedulerTick *tick) {
+    /* One schedule pin per busy CPU, in CPU order */
+    int pin = 0;
+    for (int cpu = 0; cpu < tick->cpu_count; cpu++) {
+        IdEntry *entry = NULL;
+        if (pin < tick->pin_count && tick->pins[pin]->str == tick->schedule[cpu]) {
+            entry = tick->pins[pin++];
+        }
+        if (entry == sched->sent_schedule[cpu]) {
+            continue;
+        }
+        if (entry) {
+            idtable_retain(entry);
+        }
+        idtable_release(sched->ids, sched->sent_schedule[cpu]);
+        sched->sent_schedule[cpu] = entry;
+        tick->changed_cpus[tick->changed_count++] = cpu;
+    }
+}
+
+/**
+ * Note every task's list as reported by a keyframe
+ */
+static void sync_reported(Scheduler *sched) {
+    const uint8_t *states = sched->task_states;
+    uint8_t *reported = sched->task_reported;
+    for (int i = 0; i < sched->task_count; i++) {
+        reported[i] = task_listing(states[i]);
+    }
+    for (int i = 0; i < sched->dropped_count; i++) {
+        idtable_release(sched->ids, sched->dropped_tasks[i]);
+    }
+    sched->dropped_count = 0;
+    sched->reported_epoch = sched->list_epoch;
+}
+
+/**
+ * Fill a delta tick's lists with the tasks whose listing changed
+ * The removed list takes over the references held by dropped_tasks.
+ */
+static void collect_task_changes(Scheduler *sched, SchedulerTick *tick) {
+    const uint8_t *states = sched->task_states;
+    uint8_t *reported = sched->task_reported;
+    int task_count = sched->task_count;
+    int runnable_count = 0;
+    int blocked_count = 0;
+    int removed_count = sched->dropped_count;
+    for (int i = 0; i < task_count; i++) {
+        uint8_t listing = task_listing(states[i]);
+        if (listing != reported[i]) {
+            runnable_count += listing == TASK_LISTED_RUNNABLE;
+            blocked_count += listing == TASK_LISTED_BLOCKED;
+            removed_count += listing == TASK_LISTED_NONE;
+        }
+    }
+    
+    SchedulerMeta *meta = tick->meta;
+    meta->blocked_tasks = meta->runnable_tasks + runnable_count;
+    meta->removed_tasks = meta->blocked_tasks + blocked_count;
+    
+    int ri = 0, bi = 0, xi = 0;
+    IdEntry **removed_entries = meta->task_entries + runnable_count + blocked_count;
+    for (; xi < sched->dropped_count; xi++) {
+        removed_entries[xi] = sched->dropped_tasks[xi];
+        meta->removed_tasks[xi] = removed_entries[xi]->str;
+    }
+    sched->dropped_count = 0;
+    
+    IdEntry **entries = sched->task_entries;
+    for (int i = 0; i < task_count; i++) {
+        uint8_t listing = task_listing(states[i]);
+        if (listing == reported[i]) {
+            continue;
+        }
+        reported[i] = listing;
+        if (listing == TASK_LISTED_RUNNABLE) {
+            meta->runnable_tasks[ri] = tick_list(tick, ri, entries[i]);
+            ri++;
+        } else if (listing == TASK_LISTED_BLOCKED) {
+            meta->blocked_tasks[bi] = tick_list(tick, runnable_count + bi, entries[i]);
+            bi++;
+        } else {
+            meta->removed_tasks[xi] = tick_list(tick, runnable_count + blocked_count + xi, entries[i]);
+            xi++;
+        }
+    }
+    meta->runnable_count = runnable_count;
+    meta->blocked_count = blocked_count;
+    meta->removed_count = removed_count;
+    sched->reported_epoch = sched->list_epoch;
+}
+
 /* ============================================================================
  * Public Functions - Scheduling
  * ============================================================================ */
 
-SchedulerTick *scheduler_tick(Scheduler *sched, int vtime) {
+SchedulerTick *scheduler_tick_create(Scheduler *sched) {
     if (!sched) {
         return NULL;
     }
     
-    sched->current_vtime = vtime;
-    sched->preemptions = 0;
-    sched->migrations = 0;
-    refresh_cgroup_periods(sched, vtime);
-    
-    /* Allocate result */
     SchedulerTick *tick = calloc(1, sizeof(SchedulerTick));
     if (!tick) {
         return NULL;
     }
     
-    tick->vtime = vtime;
     tick->cpu_count = sched->cpu_count;
+    tick->ids = sched->ids;
     tick->schedule = calloc(sched->cpu_count, sizeof(char *));
-    if (!tick->schedule) {
-        free(tick);
+    tick->changed_cpus = calloc(sched->cpu_count, sizeof(int));
+    tick->meta = calloc(1, sizeof(SchedulerMeta));
+    if (!tick->schedule || !tick->changed_cpus || !tick->meta) {
+        scheduler_tick_free(tick);
         return NULL;
     }
     
-    /* Allocate metadata */
-    tick->meta = calloc(1, sizeof(SchedulerMeta));
-    if (!tick->meta) {
-        free(tick->schedule);
-        free(tick);
-        return NULL;
+    return tick;
+}
+
+int scheduler_tick_into(Scheduler *sched, int vtime, SchedulerTick *tick) {
+    if (!sched || !tick || tick->ids != sched->ids) {
+        return -1;
     }
     
-    /* Track previous task assignment for preemption accounting */
-    Task **previous_tasks = calloc(sched->cpu_count, sizeof(Task *));
-    bool *assigned = calloc(sched->task_count, sizeof(bool));
-    if (!previous_tasks || !assigned) {
-        free(previous_tasks);
-        free(assigned);
-        scheduler_tick_free(tick);
-        return NULL;
+    /*
+     * Size the buffers before touching scheduler state: in steady state
+     * they already fit and the tick allocates nothing.
+     */
+    uint64_t tick_start = stats_start(sched->stats);
+    tick_reset(tick);
+    if (tick_reserve(tick, sched->collect_meta ? sched->task_count + sched->dropped_count : 0) < 0) {
+        return -1;
     }
+    uint64_t phase_start = tick_start;
+    
+    bool eevdf = policy_is_eevdf(sched);
+    int wakeups = 0;
+    int wakeup_latency = 0;
+    sched->current_vtime = vtime;
+    sched->preemptions = 0;
+    sched->migrations = 0;
+    refresh_cgroup_periods(sched, vtime);
+    tick->vtime = vtime;
     
-    /* Update vruntime/quota for currently running tasks and return them to runnable state */
+    /*
+     * Update vruntime/quota for currently running tasks and return them to
+     * their run queue class. Every other runnable task is already queued,
+     * so the per-tick queue work is bounded by the CPU count. A cgroup
+     * that runs out of quota here is throttled (its classes parked).
+     */
     for (int i = 0; i < sched->cpu_count; i++) {
         Task *current = sched->cpu_queues[i].current_task;
-        previous_tasks[i] = current;
+        sched->cpu_queues[i].previous_task = current;
         if (current && current->state == TASK_STATE_RUNNING) {
-            if (!current->is_burst) {
-                int effective_weight = get_effective_task_weight(sched, current);
-                current->vruntime += calc_vruntime_delta((double)sched->quanta, effective_weight);
+            /* Charge the work done at this CPU's capacity */
+            int capacity = cpu_capacity(sched, i);
+            double runtime = capacity_scale((double)sched->quanta, capacity);
+            task_update_util(current, sched->tick_count, capacity);
+            
+            /* EEVDF charges bursts too: their short slices buy latency, not time */
+            if (!current->is_burst || eevdf) {
+                current->vruntime += vruntime_delta(runtime, current->inv_weight);
+                track_max_vruntime(sched, current);
             }
             
-            if (current->cgroup_id[0] != '\0') {
-                Cgroup *cgroup = scheduler_find_cgroup(sched, current->cgroup_id);
-                if (cgroup) {
-                    double runtime_us = (double)sched->quanta * 1000.0;
-                    cgroup_account_runtime(cgroup, runtime_us);
-                }
+            /* Usage counts against every quota up the tree */
+            for (Cgroup *level = current->cgroup ? current->cgroup->quota_group : NULL; level;
+                 level = next_quota_group(level)) {
+                cgroup_account_runtime(level, runtime * 1000.0);
+                update_cgroup_throttle(sched, level);
             }
             
             /* Handle burst countdown */
@@ -686,48 +2146,64 @@ SchedulerTick *scheduler_tick(Scheduler *sched, int vtime) {
                 }
             }
             
-            current->state = TASK_STATE_RUNNABLE;
+            /* The quantum used up the slice: request the next one */
+            if (eevdf) {
+                eevdf_set_deadline(sched, current);
+            }
+            
+            set_task_state(sched, current, TASK_STATE_RUNNABLE);
+            if (sched->per_cpu_queues) {
+                /* Stay on the CPU it just ran on while that is still allowed */
+                current->home_cpu = i;
+            }
+            enqueue_task(sched, current);
+            stats_count(sched->stats, STAT_QUEUE_REINSERT, 1);
         }
         
         /* Reassigned below */
         sched->cpu_queues[i].current_task = NULL;
     }
+    phase_start = stats_lap(sched->stats, STAT_TICK_REQUEUE, phase_start);
+    
+    sched->tick_count++;
+    if (sched->per_cpu_queues && sched->balance_interval > 0 &&
+        sched->tick_count % sched->balance_interval == 0) {
+        balance_cpu_queues(sched);
+        if (sched->asym_capacity) {
+            balance_misfit_tasks(sched);
+        }
+        phase_start = stats_lap(sched->stats, STAT_TICK_BALANCE, phase_start);
+    }
     
-    rebuild_runnable_heap(sched);
+    SCHED_DEBUG_VALIDATE(sched);
     
-    /* Track quota usage already committed for this tick (multi-CPU safety) */
-    Cgroup *planned_cgroups[MAX_CGROUPS] = {0};
-    double planned_runtime_us[MAX_CGROUPS] = {0.0};
-    int planned_count = 0;
+    /*
+     * Track quota usage already committed for this tick (multi-CPU
+     * safety); the reservations are dropped after the picks
+     */
     double tick_runtime_us = (double)sched->quanta * 1000.0;
     if (tick_runtime_us < 0.0) {
         tick_runtime_us = 0.0;
     }
     
-    /* Schedule each CPU using heap minimum selection */
+    /* Parallel tick: every CPU's local choice first, merged in CPU order below */
+    bool merge = sched->tick_pool && sched->per_cpu_queues;
+    if (merge) {
+        SpeculateJob job = {sched, tick_runtime_us};
+        workpool_run(sched->tick_pool, speculate_picks, &job, sched->cpu_count);
+    }
+    
+    /* Schedule each CPU from the heads of its eligible affinity classes */
     for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
-        Task *previous = previous_tasks[cpu];
-        Task *best = pick_task_for_cpu(sched,
-                                       cpu,
-                                       planned_cgroups,
-                                       planned_runtime_us,
-                                       &planned_count,
-                                       tick_runtime_us);
+        Task *previous = sched->cpu_queues[cpu].previous_task;
+        double cpu_runtime = cpu_tick_runtime(sched, cpu, tick_runtime_us);
+        Task *best = merge ? merge_pick_for_cpu(sched, cpu, cpu_runtime)
+                           : pick_task_for_cpu(sched, cpu, cpu_runtime);
         
         if (best) {
-            for (int i = 0; i < sched->task_count; i++) {
-                if (sched->all_tasks[i] == best) {
-                    assigned[i] = true;
-                    break;
-                }
-            }
-            
             /* Check for preemption */
             if (previous && previous != best) {
                 sched->preemptions++;
-                if (previous->state == TASK_STATE_RUNNING) {
-                    previous->state = TASK_STATE_RUNNABLE;
-                }
             }
             
             /* Check for migration */
@@ -735,59 +2211,91 @@ SchedulerTick *scheduler_tick(Scheduler *sched, int vtime) {
                 sched->migrations++;
             }
             
+            /* First run since waking: the wait started the tick after it woke */
+            if (best->wake_tick >= 0) {
+                wakeups++;
+                wakeup_latency += sched->tick_count - 1 - best->wake_tick;
+                best->wake_tick = -1;
+            }
+            
             /* Assign task to CPU */
             best->current_cpu = cpu;
-            best->state = TASK_STATE_RUNNING;
+            set_task_state(sched, best, TASK_STATE_RUNNING);
             sched->cpu_queues[cpu].current_task = best;
-            tick->schedule[cpu] = strdup(best->task_id);
+            tick->schedule[cpu] = tick_pin(tick, best->id_entry);
         } else {
             /* CPU is idle */
-            tick->schedule[cpu] = strdup("idle");
+            tick->schedule[cpu] = "idle";
+            stats_count(sched->stats, STAT_IDLE, 1);
         }
     }
+    clear_planned_runtime(sched);
     
-    /* Runnable tasks left out this tick are no longer assigned to a CPU */
-    for (int i = 0; i < sched->task_count; i++) {
-        Task *task = sched->all_tasks[i];
-        if (!assigned[i] && task->state == TASK_STATE_RUNNABLE) {
-            task->current_cpu = -1;
+    /*
+     * Previously running tasks left out this tick are no longer assigned to
+     * a CPU. Every other runnable task already has current_cpu == -1.
+     */
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        Task *previous = sched->cpu_queues[cpu].previous_task;
+        if (previous && previous->state == TASK_STATE_RUNNABLE) {
+            previous->current_cpu = -1;
         }
+        sched->cpu_queues[cpu].previous_task = NULL;
     }
     
-    free(previous_tasks);
-    free(assigned);
+    update_min_vruntime(sched);
+    SCHED_DEBUG_VALIDATE(sched);
+    phase_start = stats_lap(sched->stats, STAT_TICK_PICK, phase_start);
     
     /* Fill metadata */
     tick->meta->preemptions = sched->preemptions;
     tick->meta->migrations = sched->migrations;
+    tick->meta->throttles = sched->throttles;
+    tick->meta->unthrottles = sched->unthrottles;
+    tick->meta->has_latency = sched->report_latency;
+    tick->meta->wakeups = wakeups;
+    tick->meta->wakeup_latency = wakeup_latency;
+    sched->throttles = 0;
+    sched->unthrottles = 0;
     
-    /* Count runnable and blocked tasks */
-    int runnable_count = 0;
-    int blocked_count = 0;
-    for (int i = 0; i < sched->task_count; i++) {
-        if (sched->all_tasks[i]->state == TASK_STATE_RUNNABLE ||
-            sched->all_tasks[i]->state == TASK_STATE_RUNNING) {
-            runnable_count++;
-        } else if (sched->all_tasks[i]->state == TASK_STATE_BLOCKED) {
-            blocked_count++;
+    /*
+     * Full lists at an unchanged list version are the ones the tick holds
+     * already (events that move no task between lists keep the version)
+     */
+    bool full_lists = sched->collect_meta;
+    if (sched->delta_interval > 0) {
+        tick->delta = sched->delta_ticks > 0;
+        sched->delta_ticks = (sched->delta_ticks + 1) % sched->delta_interval;
+        track_schedule(sched, tick);
+        if (sched->collect_meta && tick->delta) {
+            full_lists = false;
+            tick_release_lists(tick);
+            if (sched->reported_epoch != sched->list_epoch) {
+                collect_task_changes(sched, tick);
+            }
         }
     }
-    
-    tick->meta->runnable_tasks = calloc(runnable_count + 1, sizeof(char *));
-    tick->meta->blocked_tasks = calloc(blocked_count + 1, sizeof(char *));
-    
-    int ri = 0, bi = 0;
-    for (int i = 0; i < sched->task_count; i++) {
-        if (sched->all_tasks[i]->state == TASK_STATE_RUNNABLE ||
-            sched->all_tasks[i]->state == TASK_STATE_RUNNING) {
-            tick->meta->runnable_tasks[ri++] = strdup(sched->all_tasks[i]->task_id);
-        } else if (sched->all_tasks[i]->state == TASK_STATE_BLOCKED) {
-            tick->meta->blocked_tasks[bi++] = strdup(sched->all_tasks[i]->task_id);
-        }
+    if (full_lists && !tick_lists_current(sched, tick)) {
+        tick_release_lists(tick);
+        collect_task_lists(sched, tick);
+    } else if (!sched->collect_meta) {
+        tick_release_lists(tick);
+    }
+    if (full_lists && sched->delta_interval > 0 && sched->reported_epoch != sched->list_epoch) {
+        sync_reported(sched);
     }
-    tick->meta->runnable_count = runnable_count;
-    tick->meta->blocked_count = blocked_count;
     
+    stats_lap(sched->stats, STAT_TICK_META, phase_start);
+    stats_lap(sched->stats, STAT_TICK, tick_start);
+    return 0;
+}
+
+SchedulerTick *scheduler_tick(Scheduler *sched, int vtime) {
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    if (tick && scheduler_tick_into(sched, vtime, tick) < 0) {
+        scheduler_tick_free(tick);
+        return NULL;
+    }
     return tick;
 }
 
@@ -796,34 +2304,445 @@ void scheduler_tick_free(SchedulerTick *tick) {
         return;
     }
     
-    if (tick->schedule) {
-        for (int i = 0; i < tick->cpu_count; i++) {
-            free(tick->schedule[i]);
+    for (int i = 0; i < tick->pin_count; i++) {
+        idtable_release(tick->ids, tick->pins[i]);
+    }
+    free(tick->pins);
+    free(tick->schedule);
+    free(tick->changed_cpus);
+    if (tick->meta) {
+        tick_release_lists(tick);
+        free(tick->meta->runnable_tasks);
+        free(tick->meta->task_entries);
+        free(tick->meta);
+    }
+    free(tick);
+}
+
+void scheduler_set_metadata(Scheduler *sched, bool enabled) {
+    if (sched) {
+        sched->collect_meta = enabled;
+    }
+}
+
+int scheduler_set_runqueue(Scheduler *sched, QueueBackend backend) {
+    if (!sched || (int)backend < 0 || backend >= QUEUE_BACKEND_COUNT) {
+        return -1;
+    }
+    
+    /* EEVDF picks through the deadline augmentation */
+    if (policy_is_eevdf(sched) && backend != QUEUE_RBTREE_AUG) {
+        return -1;
+    }
+    
+    /* Classes keep the backend they were created with, so switch only while none exist */
+    if (sched->runqueue.class_count > 0) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        if (sched->cpu_queues[cpu].rq.class_count > 0) {
+            return -1;
         }
-        free(tick->schedule);
     }
     
-    if (tick->meta) {
-        for (int i = 0; i < tick->meta->runnable_count; i++) {
-            free(tick->meta->runnable_tasks[i]);
+    runqueue_set_backend(&sched->runqueue, backend);
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        runqueue_set_backend(&sched->cpu_queues[cpu].rq, backend);
+    }
+    return 0;
+}
+
+static const char *const policy_names[SCHED_POLICY_COUNT] = {
+    [SCHED_POLICY_CFS] = "cfs",
+    [SCHED_POLICY_EEVDF] = "eevdf",
+};
+
+int scheduler_parse_policy(const char *name, SchedPolicy *policy) {
+    if (!name || !policy) {
+        return -1;
+    }
+    
+    for (int i = 0; i < SCHED_POLICY_COUNT; i++) {
+        if (strcmp(name, policy_names[i]) == 0) {
+            *policy = (SchedPolicy)i;
+            return 0;
         }
-        free(tick->meta->runnable_tasks);
-        
-        for (int i = 0; i < tick->meta->blocked_count; i++) {
-            free(tick->meta->blocked_tasks[i]);
+    }
+    return -1;
+}
+
+const char *scheduler_policy_name(SchedPolicy policy) {
+    if ((int)policy < 0 || policy >= SCHED_POLICY_COUNT) {
+        return "unknown";
+    }
+    return policy_names[policy];
+}
+
+int scheduler_set_policy(Scheduler *sched, SchedPolicy policy) {
+    if (!sched || (int)policy < 0 || policy >= SCHED_POLICY_COUNT) {
+        return -1;
+    }
+    
+    /* Tasks placed under one policy carry no deadlines/lag for the other */
+    if (sched->task_count > 0) {
+        return -1;
+    }
+    
+    SchedPolicy previous = sched->policy;
+    sched->policy = SCHED_POLICY_CFS;
+    if (policy == SCHED_POLICY_EEVDF && scheduler_set_runqueue(sched, QUEUE_RBTREE_AUG) < 0) {
+        sched->policy = previous;
+        return -1;
+    }
+    sched->policy = policy;
+    return 0;
+}
+
+void scheduler_set_latency(Scheduler *sched, bool enabled) {
+    if (sched) {
+        sched->report_latency = enabled;
+    }
+}
+
+int scheduler_set_delta(Scheduler *sched, int keyframe_interval) {
+    if (!sched || keyframe_interval < 0) {
+        return -1;
+    }
+    if (!sched->sent_schedule) {
+        sched->sent_schedule = calloc(sched->cpu_count, sizeof(IdEntry *));
+        if (!sched->sent_schedule) {
+            return -1;
         }
-        free(tick->meta->blocked_tasks);
-        
-        free(tick->meta);
     }
     
-    free(tick);
+    /* Forget what was sent: the next tick is a keyframe */
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        idtable_release(sched->ids, sched->sent_schedule[cpu]);
+        sched->sent_schedule[cpu] = NULL;
+    }
+    for (int i = 0; i < sched->dropped_count; i++) {
+        idtable_release(sched->ids, sched->dropped_tasks[i]);
+    }
+    sched->dropped_count = 0;
+    memset(sched->task_reported, TASK_LISTED_NONE, (size_t)sched->task_count);
+    sched->reported_epoch = 0;
+    
+    sched->delta_interval = keyframe_interval;
+    sched->delta_ticks = 0;
+    return 0;
+}
+
+int scheduler_parse_capacity(const char *spec, int *capacity, int cpu_count) {
+    if (!spec || !capacity || cpu_count <= 0) {
+        return -1;
+    }
+    
+    int n = 0;
+    const char *p = spec;
+    for (;;) {
+        char *end;
+        long count = 1;
+        long value = strtol(p, &end, 10);
+        if (end == p) {
+            return -1;
+        }
+        if (*end == 'x') {
+            count = value;
+            p = end + 1;
+            value = strtol(p, &end, 10);
+            if (end == p) {
+                return -1;
+            }
+        }
+        if (count < 1 || count > cpu_count - n || value < 1 || value > SCHED_CAPACITY_SCALE) {
+            return -1;
+        }
+        for (long i = 0; i < count; i++) {
+            capacity[n++] = (int)value;
+        }
+        if (*end == '\0') {
+            break;
+        }
+        if (*end != ',') {
+            return -1;
+        }
+        p = end + 1;
+    }
+    return n == cpu_count ? 0 : -1;
+}
+
+int scheduler_set_capacity(Scheduler *sched, const int *capacity, int count) {
+    if (!sched || !capacity || count != sched->cpu_count) {
+        return -1;
+    }
+    for (int cpu = 0; cpu < count; cpu++) {
+        if (capacity[cpu] < 1 || capacity[cpu] > SCHED_CAPACITY_SCALE) {
+            return -1;
+        }
+    }
+    
+    sched->max_capacity = 0;
+    sched->asym_capacity = false;
+    for (int cpu = 0; cpu < count; cpu++) {
+        sched->cpu_queues[cpu].capacity = capacity[cpu];
+        if (capacity[cpu] > sched->max_capacity) {
+            sched->max_capacity = capacity[cpu];
+        }
+        if (capacity[cpu] != capacity[0]) {
+            sched->asym_capacity = true;
+        }
+    }
+    return 0;
+}
+
+int scheduler_get_task_util(Scheduler *sched, const char *task_id) {
+    Task *task = scheduler_find_task(sched, task_id);
+    return task ? task_util(sched, task) : -1;
+}
+
+int scheduler_enable_per_cpu(Scheduler *sched, int balance_interval) {
+    if (!sched || balance_interval < 0) {
+        return -1;
+    }
+    
+    sched->balance_interval = balance_interval;
+    if (sched->per_cpu_queues) {
+        return 0;
+    }
+    
+    /* Distribute anything already queued on the global run queue */
+    sched->per_cpu_queues = true;
+    for (int cpu = 0; cpu < sched->cpu_count; cpu++) {
+        sched->cpu_queues[cpu].rq.min_vruntime = sched->runqueue.min_vruntime;
+    }
+    while (sched->runqueue.nr_queued > 0) {
+        for (int i = 0; i < sched->runqueue.class_count; i++) {
+            TaskClass *tclass = sched->runqueue.classes[i];
+            if (!taskqueue_is_empty(&tclass->queue)) {
+                if (enqueue_task(sched, runqueue_take(tclass)) < 0) {
+                    return -1;
+                }
+                break;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+int scheduler_enable_stats(Scheduler *sched, int interval_ms) {
+    if (!sched || !STATS_COMPILED || interval_ms < 0) {
+        return -1;
+    }
+    
+    SchedStats *stats = stats_create(interval_ms);
+    if (!stats) {
+        return -1;
+    }
+    stats_destroy(sched->stats);
+    sched->stats = stats;
+    return 0;
+}
+
+int scheduler_enable_checkpoint(Scheduler *sched, const char *path, int interval) {
+    if (!sched || !path || interval < 0) {
+        return -1;
+    }
+    
+    Checkpointer *cp = checkpoint_create(path, interval);
+    if (!cp) {
+        return -1;
+    }
+    checkpoint_destroy(sched->checkpoint);
+    sched->checkpoint = cp;
+    return 0;
+}
+
+int scheduler_enable_parallel_tick(Scheduler *sched, int threads) {
+    if (!sched || threads < 1 || (threads > 1 && !sched->per_cpu_queues)) {
+        return -1;
+    }
+    
+    /* More threads than CPUs would only split the picks into empty chunks */
+    if (threads > sched->cpu_count) {
+        threads = sched->cpu_count;
+    }
+    if (threads == workpool_threads(sched->tick_pool)) {
+        return 0;
+    }
+    
+    WorkPool *pool = NULL;
+    if (threads > 1 && !(pool = workpool_create(threads))) {
+        return -1;
+    }
+    workpool_destroy(sched->tick_pool);
+    sched->tick_pool = pool;
+    return 0;
+}
+
+/**
+ * Check one run queue and copy its queued tasks to out[].
+ * Every task must sit in the class its current mask and cgroup map to,
+ * and on its home CPU when cpu >= 0.
+ */
+static int validate_runqueue(const RunQueue *rq, int cpu, Task **out, int *n, int limit) {
+    if (runqueue_validate(rq) < 0 || *n + rq->nr_queued > limit) {
+        return -1;
+    }
+    
+    for (int c = 0; c < rq->class_count; c++) {
+        const TaskClass *tclass = rq->classes[c];
+        int count = taskqueue_collect(&tclass->queue, out + *n);
+        for (int i = 0; i < count; i++) {
+            Task *task = out[*n + i];
+            CpuMask mask = task->affinity;
+            if (task->cgroup) {
+                cpumask_and(&mask, &mask, &task->cgroup->cpu_mask);
+            }
+            /* The cached allowed mask must match a fresh recomputation */
+            if (task->cgroup != tclass->cgroup || !cpumask_equal(&mask, &task->allowed) ||
+                !cpumask_equal(&mask, &tclass->mask) ||
+                (cpu >= 0 && task->home_cpu != cpu)) {
+                return -1;
+            }
+        }
+        *n += count;
+    }
+    return 0;
+}
+
+int scheduler_validate(const Scheduler *sched) {
+    if (!sched) {
+        return -1;
+    }
+    
+    /* The dense columns mirror their tasks */
+    for (int i = 0; i < sched->task_count; i++) {
+        const Task *task = sched->all_tasks[i];
+        if (task->task_index != i || sched->task_states[i] != (uint8_t)task->state ||
+            sched->task_entries[i] != task->id_entry) {
+            return -1;
+        }
+    }
+    
+    /*
+     * A cgroup is throttled exactly when out of quota, and its classes are
+     * parked exactly when it or an ancestor is throttled. Inherited state
+     * matches the parent, and every cgroup's period is timed.
+     */
+    int timed = 0;
+    for (int i = 0; i < sched->cgroup_count; i++) {
+        const Cgroup *cgroup = sched->cgroups[i];
+        const Cgroup *parent = cgroup->parent;
+        if (cgroup->throttled == cgroup_has_quota(cgroup, sched->current_vtime)) {
+            return -1;
+        }
+        int throttle_count = (cgroup->throttled ? 1 : 0) + (parent ? parent->throttle_count : 0);
+        if (cgroup->index != i || cgroup->throttle_count != throttle_count || cgroup->planned ||
+            cgroup->depth != (parent ? parent->depth + 1 : 0)) {
+            return -1;
+        }
+        if (parent) {
+            const Cgroup *child = parent->first_child;
+            while (child && child != cgroup) {
+                child = child->next_sibling;
+            }
+            if (!child) {
+                return -1;
+            }
+        }
+        Cgroup expected = *cgroup;
+        cgroup_inherit(&expected);
+        const Cgroup *quota_group = cgroup->cpu_quota_us >= 0 ? cgroup
+                                                              : (parent ? parent->quota_group : NULL);
+        if (expected.effective_shares != cgroup->effective_shares ||
+            quota_group != cgroup->quota_group ||
+            !cpumask_equal(&expected.cpu_mask, &cgroup->cpu_mask)) {
+            return -1;
+        }
+        if (timer_armed(&cgroup->period_timer) != (cgroup->cpu_period_us > 0)) {
+            return -1;
+        }
+        timed += timer_armed(&cgroup->period_timer);
+        for (const TaskClass *tclass = cgroup->classes; tclass; tclass = tclass->cgroup_next) {
+            if (tclass->cgroup != cgroup || tclass->parked != (cgroup->throttle_count > 0)) {
+                return -1;
+            }
+        }
+    }
+    if (timed != sched->period_wheel.armed || sched->planned_cgroups) {
+        return -1;
+    }
+    
+    /* Unless marked stale, the running maximum is exact */
+    if (!sched->max_vruntime_stale) {
+        vruntime_t max_vr = 0;
+        for (int i = 0; i < sched->task_count; i++) {
+            const Task *task = sched->all_tasks[i];
+            if ((task->state == TASK_STATE_RUNNABLE || task->state == TASK_STATE_RUNNING) &&
+                task->vruntime > max_vr) {
+                max_vr = task->vruntime;
+            }
+        }
+        if (max_vr != sched->max_vruntime) {
+            return -1;
+        }
+    }
+    
+    /* From-scratch rebuild: every RUNNABLE task, sorted in heap order */
+    int expected_count = 0;
+    for (int i = 0; i < sched->task_count; i++) {
+        if (sched->all_tasks[i]->state == TASK_STATE_RUNNABLE) {
+            expected_count++;
+        }
+    }
+    
+    Task **expected = malloc(sizeof(Task *) * (expected_count + 1));
+    Task **actual = malloc(sizeof(Task *) * (expected_count + 1));
+    if (!expected || !actual) {
+        free(expected);
+        free(actual);
+        return -1;
+    }
+    
+    int n = 0;
+    for (int i = 0; i < sched->task_count; i++) {
+        if (sched->all_tasks[i]->state == TASK_STATE_RUNNABLE) {
+            expected[n++] = sched->all_tasks[i];
+        }
+    }
+    
+    /* Queued tasks across whichever run queues are in use */
+    int result = 0;
+    n = 0;
+    if (validate_runqueue(&sched->runqueue, -1, actual, &n, expected_count) < 0 ||
+        (sched->per_cpu_queues && sched->runqueue.nr_queued != 0)) {
+        result = -1;
+    }
+    for (int cpu = 0; result == 0 && cpu < sched->cpu_count; cpu++) {
+        if (validate_runqueue(&sched->cpu_queues[cpu].rq, cpu, actual, &n, expected_count) < 0) {
+            result = -1;
+        }
+    }
+    
+    if (result == 0 && n != expected_count) {
+        result = -1;
+    }
+    if (result == 0) {
+        qsort(expected, expected_count, sizeof(Task *), compare_task_order);
+        qsort(actual, expected_count, sizeof(Task *), compare_task_order);
+        result = memcmp(expected, actual, sizeof(Task *) * expected_count) == 0 ? 0 : -1;
+    }
+    
+    free(expected);
+    free(actual);
+    return result;
 }
 
-double scheduler_get_min_vruntime(Scheduler *sched) {
+vruntime_t scheduler_get_min_vruntime(Scheduler *sched) {
     return get_min_vruntime(sched);
 }
 
-double scheduler_get_max_vruntime(Scheduler *sched) {
+vruntime_t scheduler_get_max_vruntime(Scheduler *sched) {
     return get_max_vruntime(sched);
 }
@@ -0,0 +1,157 @@
+/**
+ * ALFS - Single-Producer/Single-Consumer Queue Implementation
+ *
+ * Lock-free on the fast path: the producer owns tail, the consumer owns
+ * head, and each side only reads the other's index. A side that finds
+ * the queue full/empty spins briefly, then sleeps on a condvar; the
+ * other side only takes the mutex when someone is actually asleep.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include "spsc.h"
+
+#define SPSC_SPIN_LIMIT 256
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+/**
+ * Append without waking a sleeper
+ */
+static bool spsc_put(SpscQueue *queue, void *item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+    if (tail - head == queue->capacity) {
+        return false;
+    }
+    queue->slots[tail & (queue->capacity - 1)] = item;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Remove without waking a sleeper
+ */
+static bool spsc_take(SpscQueue *queue, void **item) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+    if (head == tail) {
+        return false;
+    }
+    *item = queue->slots[head & (queue->capacity - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Wake the other side if it went to sleep.
+ * The fence pairs with the one in spsc_sleep: either the sleeper sees
+ * our index update, or we see its sleepers increment.
+ */
+static void spsc_wake(SpscQueue *queue) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->sleepers, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&queue->lock);
+        pthread_cond_broadcast(&queue->wake);
+        pthread_mutex_unlock(&queue->lock);
+    }
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int spsc_init(SpscQueue *queue, size_t capacity) {
+    size_t slots = 2;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    
+    queue->slots = calloc(slots, sizeof(void *));
+    if (!queue->slots) {
+        return -1;
+    }
+    queue->capacity = slots;
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    atomic_init(&queue->sleepers, 0);
+    
+    if (pthread_mutex_init(&queue->lock, NULL) != 0) {
+        free(queue->slots);
+        return -1;
+    }
+    if (pthread_cond_init(&queue->wake, NULL) != 0) {
+        pthread_mutex_destroy(&queue->lock);
+        free(queue->slots);
+        return -1;
+    }
+    return 0;
+}
+
+void spsc_destroy(SpscQueue *queue) {
+    if (!queue) {
+        return;
+    }
+    
+    pthread_cond_destroy(&queue->wake);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+bool spsc_try_push(SpscQueue *queue, void *item) {
+    if (!spsc_put(queue, item)) {
+        return false;
+    }
+    spsc_wake(queue);
+    return true;
+}
+
+bool spsc_try_pop(SpscQueue *queue, void **item) {
+    if (!spsc_take(queue, item)) {
+        return false;
+    }
+    spsc_wake(queue);
+    return true;
+}
+
+void spsc_push(SpscQueue *queue, void *item) {
+    for (int spin = 0; spin < SPSC_SPIN_LIMIT; spin++) {
+        if (spsc_try_push(queue, item)) {
+            return;
+        }
+    }
+    
+    pthread_mutex_lock(&queue->lock);
+    atomic_fetch_add(&queue->sleepers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!spsc_put(queue, item)) {
+        pthread_cond_wait(&queue->wake, &queue->lock);
+    }
+    atomic_fetch_sub(&queue->sleepers, 1);
+    pthread_mutex_unlock(&queue->lock);
+    spsc_wake(queue);
+}
+
+void *spsc_pop(SpscQueue *queue) {
+    void *item = NULL;
+    for (int spin = 0; spin < SPSC_SPIN_LIMIT; spin++) {
+        if (spsc_try_pop(queue, &item)) {
+            return item;
+        }
+    }
+    
+    pthread_mutex_lock(&queue->lock);
+    atomic_fetch_add(&queue->sleepers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while (!spsc_take(queue, &item)) {
+        pthread_cond_wait(&queue->wake, &queue->lock);
+    }
+    atomic_fetch_sub(&queue->sleepers, 1);
+    pthread_mutex_unlock(&queue->lock);
+    spsc_wake(queue);
+    return item;
+}
@@ -0,0 +1,196 @@
+/**
+ * ALFS - Hot-Path Statistics Implementation
+ *
+ * Durations go into log2 nanosecond buckets, so recording is a clock
+ * read, a count-leading-zeros and a few stores. Histograms are
+ * cumulative since start; percentiles in a report are bucket upper
+ * bounds (never above the largest duration seen).
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <time.h>
+#include "stats.h"
+
+/* Phase names in reports; events use their wire action names */
+static const char *const phase_names[STAT_PHASE_COUNT] = {
+    [STAT_PARSE] = "parse",
+    [STAT_EVENT + EVENT_TASK_CREATE] = "TASK_CREATE",
+    [STAT_EVENT + EVENT_TASK_EXIT] = "TASK_EXIT",
+    [STAT_EVENT + EVENT_TASK_BLOCK] = "TASK_BLOCK",
+    [STAT_EVENT + EVENT_TASK_UNBLOCK] = "TASK_UNBLOCK",
+    [STAT_EVENT + EVENT_TASK_YIELD] = "TASK_YIELD",
+    [STAT_EVENT + EVENT_TASK_SETNICE] = "TASK_SETNICE",
+    [STAT_EVENT + EVENT_TASK_SET_AFFINITY] = "TASK_SET_AFFINITY",
+    [STAT_EVENT + EVENT_CGROUP_CREATE] = "CGROUP_CREATE",
+    [STAT_EVENT + EVENT_CGROUP_MODIFY] = "CGROUP_MODIFY",
+    [STAT_EVENT + EVENT_CGROUP_DELETE] = "CGROUP_DELETE",
+    [STAT_EVENT + EVENT_TASK_MOVE_CGROUP] = "TASK_MOVE_CGROUP",
+    [STAT_EVENT + EVENT_CPU_BURST] = "CPU_BURST",
+    [STAT_TICK] = "tick",
+    [STAT_TICK_REQUEUE] = "tick.requeue",
+    [STAT_TICK_BALANCE] = "tick.balance",
+    [STAT_TICK_PICK] = "tick.pick",
+    [STAT_TICK_META] = "tick.meta",
+    [STAT_SERIALIZE] = "serialize",
+};
+
+static const char *const counter_names[STAT_COUNTER_COUNT] = {
+    [STAT_QUEUE_EXTRACT] = "queueExtract",
+    [STAT_QUEUE_REINSERT] = "queueReinsert",
+    [STAT_PICK_DEFERRED] = "pickDeferred",
+    [STAT_STEAL_ATTEMPT] = "stealAttempts",
+    [STAT_STEAL] = "steals",
+    [STAT_IDLE] = "idleCpus",
+    [STAT_PICK_RETRY] = "pickRetries",
+    [STAT_EVENT_COALESCED] = "eventsCoalesced",
+};
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+static inline uint64_t load(_Atomic uint64_t *value) {
+    return atomic_load_explicit(value, memory_order_relaxed);
+}
+
+/* Single-writer update: no locked read-modify-write needed */
+static inline void store(_Atomic uint64_t *value, uint64_t v) {
+    atomic_store_explicit(value, v, memory_order_relaxed);
+}
+
+static inline int bucket_of(uint64_t ns) {
+    int bucket = ns > 1 ? 63 - __builtin_clzll(ns) : 0;
+    return bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1;
+}
+
+/**
+ * Upper bound of the bucket holding the q-quantile of a histogram
+ */
+static uint64_t histogram_quantile(const uint64_t *buckets, uint64_t count, uint64_t max_ns,
+                                   double q) {
+    uint64_t rank = (uint64_t)((double)count * q);
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            uint64_t bound = (uint64_t)1 << (i + 1);
+            return bound < max_ns ? bound : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+SchedStats *stats_create(int interval_ms) {
+    if (interval_ms < 0) {
+        return NULL;
+    }
+    SchedStats *stats = calloc(1, sizeof(SchedStats));
+    if (!stats) {
+        return NULL;
+    }
+    stats->start_ns = stats_clock_ns();
+    stats->interval_ns = (uint64_t)interval_ms * 1000000ULL;
+    stats->next_report_ns = stats->start_ns + stats->interval_ns;
+    return stats;
+}
+
+void stats_destroy(SchedStats *stats) {
+    free(stats);
+}
+
+uint64_t stats_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+void stats_record(SchedStats *stats, StatPhase phase, uint64_t ns) {
+    StatHistogram *hist = &stats->phases[phase];
+    store(&hist->count, load(&hist->count) + 1);
+    store(&hist->total_ns, load(&hist->total_ns) + ns);
+    if (ns > load(&hist->max_ns)) {
+        store(&hist->max_ns, ns);
+    }
+    int bucket = bucket_of(ns);
+    store(&hist->buckets[bucket], load(&hist->buckets[bucket]) + 1);
+}
+
+const char *stats_phase_name(StatPhase phase) {
+    if ((int)phase < 0 || phase >= STAT_PHASE_COUNT) {
+        return "unknown";
+    }
+    return phase_names[phase];
+}
+
+void stats_report(SchedStats *stats, FILE *out) {
+    if (!stats || !out) {
+        return;
+    }
+
+    /* Keep the line whole when several schedulers report (--listen) */
+    flockfile(out);
+    uint64_t now = stats_clock_ns();
+    fprintf(out, "{\"stats\":{\"uptimeMs\":%llu,\"phases\":{",
+            (unsigned long long)((now - stats->start_ns) / 1000000ULL));
+
+    /* Phases that never ran are left out */
+    bool first = true;
+    for (int p = 0; p < STAT_PHASE_COUNT; p++) {
+        StatHistogram *hist = &stats->phases[p];
+        uint64_t buckets[STATS_BUCKETS];
+        uint64_t count = 0;
+        int last = 0;
+        for (int i = 0; i < STATS_BUCKETS; i++) {
+            buckets[i] = load(&hist->buckets[i]);
+            count += buckets[i];
+            if (buckets[i]) {
+                last = i;
+            }
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        uint64_t total = load(&hist->total_ns);
+        uint64_t max_ns = load(&hist->max_ns);
+        fprintf(out, "%s\"%s\":{\"count\":%llu,\"totalNs\":%llu,\"avgNs\":%llu,"
+                "\"p50Ns\":%llu,\"p99Ns\":%llu,\"p999Ns\":%llu,\"maxNs\":%llu,\"log2Ns\":[",
+                first ? "" : ",", phase_names[p], (unsigned long long)count,
+                (unsigned long long)total, (unsigned long long)(total / count),
+                (unsigned long long)histogram_quantile(buckets, count, max_ns, 0.50),
+                (unsigned long long)histogram_quantile(buckets, count, max_ns, 0.99),
+                (unsigned long long)histogram_quantile(buckets, count, max_ns, 0.999),
+                (unsigned long long)max_ns);
+        for (int i = 0; i <= last; i++) {
+            fprintf(out, "%s%llu", i ? "," : "", (unsigned long long)buckets[i]);
+        }
+        fputs("]}", out);
+        first = false;
+    }
+
+    fputs("},\"counters\":{", out);
+    for (int c = 0; c < STAT_COUNTER_COUNT; c++) {
+        fprintf(out, "%s\"%s\":%llu", c ? "," : "", counter_names[c],
+                (unsigned long long)load(&stats->counters[c]));
+    }
+    fputs("}}}\n", out);
+    fflush(out);
+    funlockfile(out);
+}
+
+void stats_report_if_due(SchedStats *stats, FILE *out) {
+    if (!STATS_COMPILED || !stats || stats->interval_ns == 0) {
+        return;
+    }
+    uint64_t now = stats_clock_ns();
+    if (now >= stats->next_report_ns) {
+        stats_report(stats, out);
+        stats->next_report_ns = now + stats->interval_ns;
+    }
+}
@@ -4,53 +4,116 @@
 
 #define _POSIX_C_SOURCE 200809L
 
+#include <stddef.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include "task.h"
+#include "cpumask.h"
+#include "pool.h"
 
-Task *task_create(const char *task_id, int nice, const char *cgroup_id) {
-    if (!task_id) {
-        return NULL;
-    }
-    
-    Task *task = calloc(1, sizeof(Task));
-    if (!task) {
-        return NULL;
-    }
-    
-    strncpy(task->task_id, task_id, MAX_TASK_ID_LEN - 1);
-    task->task_id[MAX_TASK_ID_LEN - 1] = '\0';
+/* The hot fields must fit in the first cache line */
+_Static_assert(offsetof(Task, qnode) <= 64, "Task hot fields must fit in one cache line");
+
+/* 2^32 * y^n for y^32 = 1/2, as the kernel's runnable_avg_yN_inv */
+static const uint32_t pelt_decay_inv[PELT_HALFLIFE] = {
+    0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99b, 0xeac0c6e7, 0xe5b906e7,
+    0xe0ccdeec, 0xdbfbb797, 0xd744fcca, 0xd2a81d91, 0xce248c15, 0xc9b9bd86,
+    0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47, 0xb504f333, 0xb123f581,
+    0xad583eea, 0xa9a15ab4, 0xa5fed6a9, 0xa2704303, 0x9ef53260, 0x9b8d39b9,
+    0x9837f051, 0x94f4efa8, 0x91c3d373, 0x8ea4398b, 0x8b95c1e3, 0x88980e80,
+    0x85aac367, 0x82cd8698,
+};
+
+/**
+ * Fill a zeroed task; the ID strings are referenced, not copied
+ */
+static void task_init(Task *task, const char *task_id, int nice, const char *cgroup_id) {
+    task->task_id = task_id;
+    task->cgroup_id = cgroup_id ? cgroup_id : "0";  /* Main/default cgroup */
     
     /* Clamp nice value to valid range */
     if (nice < NICE_MIN) nice = NICE_MIN;
     if (nice > NICE_MAX) nice = NICE_MAX;
     task->nice = nice;
     task->weight = nice_to_weight(nice);
+    task_refresh_weight(task);
     
-    task->vruntime = 0.0;
+    task->vruntime = 0;
     task->state = TASK_STATE_RUNNABLE;
     
-    if (cgroup_id) {
-        strncpy(task->cgroup_id, cgroup_id, MAX_CGROUP_ID_LEN - 1);
-        task->cgroup_id[MAX_CGROUP_ID_LEN - 1] = '\0';
-    } else {
-        strncpy(task->cgroup_id, "0", MAX_CGROUP_ID_LEN - 1);
-        task->cgroup_id[MAX_CGROUP_ID_LEN - 1] = '\0';  /* Main/default cgroup */
-    }
-    
-    task->cpu_affinity = NULL;
-    task->affinity_count = 0;
+    cpumask_fill(&task->affinity);
+    cpumask_fill(&task->allowed);
     task->current_cpu = -1;
+    task->home_cpu = -1;
+    task->tclass = NULL;
     task->burst_remaining = 0;
     task->is_burst = false;
+    task->wake_tick = -1;
+    task->util_sum = 0;
+    task->util_avg = 0;
+    task->util_tick = 0;
     task->heap_index = -1;
+}
+
+Task *task_create(const char *task_id, int nice, const char *cgroup_id) {
+    if (!task_id) {
+        return NULL;
+    }
+    
+    /* Both IDs share one allocation */
+    size_t task_len = strlen(task_id) + 1;
+    size_t cgroup_len = cgroup_id ? strlen(cgroup_id) + 1 : 0;
+    Task *task = aligned_alloc(_Alignof(Task), sizeof(Task));
+    char *copy = malloc(task_len + cgroup_len);
+    if (!task || !copy) {
+        free(task);
+        free(copy);
+        return NULL;
+    }
+    memset(task, 0, sizeof(Task));
+    memcpy(copy, task_id, task_len);
+    if (cgroup_id) {
+        memcpy(copy + task_len, cgroup_id, cgroup_len);
+    }
+    
+    task_init(task, copy, nice, cgroup_id ? copy + task_len : NULL);
+    task->id_copy = copy;
+    return task;
+}
+
+void task_pools_init(TaskPools *pools) {
+    pool_init(&pools->tasks, sizeof(Task), _Alignof(Task), TASK_POOL_SLAB);
+}
+
+void task_pools_destroy(TaskPools *pools) {
+    pool_destroy(&pools->tasks);
+}
+
+Task *task_create_pooled(TaskPools *pools, const char *task_id, int nice,
+                         const char *cgroup_id) {
+    if (!pools || !task_id) {
+        return NULL;
+    }
+    
+    Task *task = pool_alloc(&pools->tasks);
+    if (!task) {
+        return NULL;
+    }
     
+    task_init(task, task_id, nice, cgroup_id);
+    task->pools = pools;
     return task;
 }
 
 void task_destroy(Task *task) {
-    if (task) {
-        free(task->cpu_affinity);
+    if (!task) {
+        return;
+    }
+    if (task->pools) {
+        pool_free(&task->pools->tasks, task);
+    } else {
+        free(task->id_copy);
         free(task);
     }
 }
@@ -60,21 +123,23 @@ int task_set_affinity(Task *task, const int *cpu_mask, int count) {
         return -1;
     }
     
-    /* Free existing affinity */
-    free(task->cpu_affinity);
-    task->cpu_affinity = NULL;
-    task->affinity_count = 0;
+    /* An empty list means any CPU */
+    cpumask_from_list(&task->affinity, cpu_mask, count);
+    task_refresh_allowed(task);
     
-    if (cpu_mask && count > 0) {
-        task->cpu_affinity = malloc(sizeof(int) * count);
-        if (!task->cpu_affinity) {
-            return -1;
-        }
-        memcpy(task->cpu_affinity, cpu_mask, sizeof(int) * count);
-        task->affinity_count = count;
+    return 0;
+}
+
+void task_refresh_allowed(Task *task) {
+    if (!task) {
+        return;
     }
     
-    return 0;
+    if (task->cgroup) {
+        cpumask_and(&task->allowed, &task->affinity, &task->cgroup->cpu_mask);
+    } else {
+        task->allowed = task->affinity;
+    }
 }
 
 void task_set_nice(Task *task, int nice) {
@@ -87,25 +152,39 @@ void task_set_nice(Task *task, int nice) {
     
     task->nice = nice;
     task->weight = nice_to_weight(nice);
+    task_refresh_weight(task);
 }
 
-bool task_can_run_on_cpu(const Task *task, int cpu_id) {
+void task_refresh_weight(Task *task) {
     if (!task) {
-        return false;
-    }
-    
-    /* No affinity set means can run on any CPU */
-    if (task->affinity_count == 0) {
-        return true;
+        return;
     }
     
-    for (int i = 0; i < task->affinity_count; i++) {
-        if (task->cpu_affinity[i] == cpu_id) {
-            return true;
+    /* Nice weights use the kernel's inverse table, like set_load_weight() */
+    long long weight = task->weight;
+    uint32_t wmult = sched_prio_to_wmult[task->nice - NICE_MIN];
+    const Cgroup *cgroup = task->cgroup;
+    if (cgroup && cgroup->effective_shares > 0 && cgroup->effective_shares != DEFAULT_CPU_SHARES) {
+        weight = (weight * cgroup->effective_shares) / DEFAULT_CPU_SHARES;
+        if (weight < 1) {
+            weight = 1;
+        }
+        if (weight > INT_MAX) {
+            weight = INT_MAX;
         }
+        wmult = WMULT_CONST / (uint32_t)weight;
     }
     
-    return false;
+#ifdef ALFS_FIXED_VRUNTIME
+    task->inv_weight = wmult;
+#else
+    (void)wmult;
+    task->inv_weight = (double)NICE_0_WEIGHT / (double)weight;
+#endif
+}
+
+bool task_can_run_on_cpu(const Task *task, int cpu_id) {
+    return task && cpumask_test(&task->affinity, cpu_id);
 }
 
 void task_update_vruntime(Task *task, double runtime) {
@@ -113,8 +192,38 @@ void task_update_vruntime(Task *task, double runtime) {
         return;  /* Don't update vruntime during CPU burst */
     }
     
-    double delta = calc_vruntime_delta(runtime, task->weight);
-    task->vruntime += delta;
+    task->vruntime += vruntime_delta(runtime, task->inv_weight);
+}
+
+/**
+ * val * y^periods, as the kernel's decay_load()
+ */
+static uint64_t pelt_decay(uint64_t val, int periods) {
+    if (periods <= 0) {
+        return val;
+    }
+    if (periods >= PELT_HALFLIFE * 64) {
+        return 0;
+    }
+    val >>= periods / PELT_HALFLIFE;
+    return mul_u64_u32_shr(val, pelt_decay_inv[periods % PELT_HALFLIFE], 32);
+}
+
+void task_update_util(Task *task, int now, int capacity) {
+    if (!task) {
+        return;
+    }
+    
+    if (now > task->util_tick) {
+        task->util_sum = pelt_decay(task->util_sum, now - task->util_tick);
+        task->util_tick = now;
+    }
+    if (capacity > 0) {
+        task->util_sum += (uint64_t)SCHED_CAPACITY_SCALE * (uint64_t)capacity;
+    }
+    
+    uint64_t util = task->util_sum / PELT_LOAD_AVG_MAX;
+    task->util_avg = util < SCHED_CAPACITY_SCALE ? (int)util : SCHED_CAPACITY_SCALE;
 }
 
 void task_set_state(Task *task, TaskState state) {
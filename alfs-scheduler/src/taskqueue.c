@@ -0,0 +1,299 @@
+/**
+ * ALFS - Task Queue Implementation
+ *
+ * Adapters from the TaskQueue operations to each backend:
+ * - heap, heap4, heap8: array heaps (heap.c) with 2, 4 or 8 children
+ * - pairing: intrusive pairing heap (pairing_heap.c), O(1) insert
+ * - rbtree: intrusive red-black tree (rbtree.c), cached leftmost
+ * - rbtree-aug: the same tree tracking each subtree's earliest deadline,
+ *   the only backend that can pick for EEVDF
+ *
+ * All of them order by task_before(), a total order, so every backend
+ * selects the same tasks. Only taskqueue_last(), which load balancing
+ * migrates from, depends on the backend's layout.
+ */
+
+#include <string.h>
+#include "taskqueue.h"
+#include "heap.h"
+#include "pairing_heap.h"
+#include "rbtree.h"
+
+#define TASKQUEUE_HEAP_CAPACITY 8
+
+/* ============================================================================
+ * Array Heaps
+ * ============================================================================ */
+
+static inline void heap_refresh_first(TaskQueue *queue) {
+    MinHeap *heap = &queue->impl.heap;
+    queue->first = heap->size > 0 ? heap->tasks[0] : NULL;
+}
+
+static int arity_init(TaskQueue *queue, int arity) {
+    queue->first = NULL;
+    return heap_init(&queue->impl.heap, TASKQUEUE_HEAP_CAPACITY, arity);
+}
+
+static int heap2_init(TaskQueue *queue) { return arity_init(queue, 2); }
+static int heap4_init(TaskQueue *queue) { return arity_init(queue, 4); }
+static int heap8_init(TaskQueue *queue) { return arity_init(queue, 8); }
+
+static void array_release(TaskQueue *queue) {
+    heap_release(&queue->impl.heap);
+    queue->first = NULL;
+}
+
+static int array_insert(TaskQueue *queue, Task *task) {
+    int rc = heap_insert(&queue->impl.heap, task);
+    heap_refresh_first(queue);
+    return rc;
+}
+
+static void array_remove(TaskQueue *queue, Task *task) {
+    heap_remove(&queue->impl.heap, task);
+    heap_refresh_first(queue);
+}
+
+static void array_update(TaskQueue *queue, Task *task) {
+    heap_update(&queue->impl.heap, task);
+    heap_refresh_first(queue);
+}
+
+static Task *array_extract_min(TaskQueue *queue) {
+    Task *task = heap_extract_min(&queue->impl.heap);
+    heap_refresh_first(queue);
+    return task;
+}
+
+/* Leaves have the largest vruntimes */
+static Task *array_last(const TaskQueue *queue) {
+    const MinHeap *heap = &queue->impl.heap;
+    return heap->size > 0 ? heap->tasks[heap->size - 1] : NULL;
+}
+
+static int array_size(const TaskQueue *queue) {
+    return queue->impl.heap.size;
+}
+
+static int array_collect(const TaskQueue *queue, Task **out) {
+    const MinHeap *heap = &queue->impl.heap;
+    memcpy(out, heap->tasks, sizeof(Task *) * (size_t)heap->size);
+    return heap->size;
+}
+
+static int array_validate(const TaskQueue *queue) {
+    return heap_validate(&queue->impl.heap);
+}
+
+/* ============================================================================
+ * Node Backends
+ * ============================================================================ */
+
+/**
+ * Copy a QueueNode tree in pre-order
+ */
+static int node_collect_from(const Task *root, Task **out) {
+    int n = 0;
+    for (const Task *node = root; node; node = task_node_next(node)) {
+        out[n++] = (Task *)node;
+    }
+    return n;
+}
+
+static int pairing_init(TaskQueue *queue) {
+    pairing_heap_init(&queue->impl.pairing);
+    queue->first = NULL;
+    return 0;
+}
+
+static void pairing_release(TaskQueue *queue) {
+    pairing_init(queue);
+}
+
+static int pairing_insert(TaskQueue *queue, Task *task) {
+    pairing_heap_insert(&queue->impl.pairing, task);
+    queue->first = queue->impl.pairing.root;
+    return 0;
+}
+
+static void pairing_remove(TaskQueue *queue, Task *task) {
+    pairing_heap_remove(&queue->impl.pairing, task);
+    queue->first = queue->impl.pairing.root;
+}
+
+static void pairing_update(TaskQueue *queue, Task *task) {
+    pairing_heap_update(&queue->impl.pairing, task);
+    queue->first = queue->impl.pairing.root;
+}
+
+static Task *pairing_extract_min(TaskQueue *queue) {
+    Task *task = pairing_heap_extract_min(&queue->impl.pairing);
+    queue->first = queue->impl.pairing.root;
+    return task;
+}
+
+static Task *pairing_last(const TaskQueue *queue) {
+    return pairing_heap_last(&queue->impl.pairing);
+}
+
+static int pairing_size(const TaskQueue *queue) {
+    return queue->impl.pairing.size;
+}
+
+static int pairing_collect(const TaskQueue *queue, Task **out) {
+    return node_collect_from(queue->impl.pairing.root, out);
+}
+
+static int pairing_validate(const TaskQueue *queue) {
+    return pairing_heap_validate(&queue->impl.pairing);
+}
+
+static int rb_init(TaskQueue *queue) {
+    rbtree_init(&queue->impl.rbtree, false);
+    queue->first = NULL;
+    return 0;
+}
+
+static int rb_aug_init(TaskQueue *queue) {
+    rbtree_init(&queue->impl.rbtree, true);
+    queue->first = NULL;
+    return 0;
+}
+
+static void rb_release(TaskQueue *queue) {
+    rbtree_init(&queue->impl.rbtree, queue->impl.rbtree.augmented);
+    queue->first = NULL;
+}
+
+static int rb_insert(TaskQueue *queue, Task *task) {
+    rbtree_insert(&queue->impl.rbtree, task);
+    queue->first = queue->impl.rbtree.leftmost;
+    return 0;
+}
+
+static void rb_remove(TaskQueue *queue, Task *task) {
+    rbtree_remove(&queue->impl.rbtree, task);
+    queue->first = queue->impl.rbtree.leftmost;
+}
+
+static void rb_update(TaskQueue *queue, Task *task) {
+    rbtree_update(&queue->impl.rbtree, task);
+    queue->first = queue->impl.rbtree.leftmost;
+}
+
+static Task *rb_extract_min(TaskQueue *queue) {
+    Task *task = rbtree_extract_min(&queue->impl.rbtree);
+    queue->first = queue->impl.rbtree.leftmost;
+    return task;
+}
+
+static Task *rb_last(const TaskQueue *queue) {
+    return rbtree_last(&queue->impl.rbtree);
+}
+
+static int rb_size(const TaskQueue *queue) {
+    return queue->impl.rbtree.size;
+}
+
+static int rb_collect(const TaskQueue *queue, Task **out) {
+    return node_collect_from(queue->impl.rbtree.root, out);
+}
+
+static int rb_validate(const TaskQueue *queue) {
+    return rbtree_validate(&queue->impl.rbtree);
+}
+
+static Task *rb_pick_eligible(const TaskQueue *queue, vruntime_t avg_vruntime) {
+    return rbtree_pick_eligible(&queue->impl.rbtree, avg_vruntime);
+}
+
+/* ============================================================================
+ * Backend Table
+ * ============================================================================ */
+
+static const QueueOps queue_backends[QUEUE_BACKEND_COUNT] = {
+    [QUEUE_HEAP] = {
+        QUEUE_HEAP, "heap", heap2_init, array_release, array_insert, array_remove,
+        array_update, array_extract_min, array_last, array_size, array_collect, array_validate, NULL
+    },
+    [QUEUE_HEAP4] = {
+        QUEUE_HEAP4, "heap4", heap4_init, array_release, array_insert, array_remove,
+        array_update, array_extract_min, array_last, array_size, array_collect, array_validate, NULL
+    },
+    [QUEUE_HEAP8] = {
+        QUEUE_HEAP8, "heap8", heap8_init, array_release, array_insert, array_remove,
+        array_update, array_extract_min, array_last, array_size, array_collect, array_validate, NULL
+    },
+    [QUEUE_PAIRING] = {
+        QUEUE_PAIRING, "pairing", pairing_init, pairing_release, pairing_insert, pairing_remove,
+        pairing_update, pairing_extract_min, pairing_last, pairing_size, pairing_collect,
+        pairing_validate, NULL
+    },
+    [QUEUE_RBTREE] = {
+        QUEUE_RBTREE, "rbtree", rb_init, rb_release, rb_insert, rb_remove,
+        rb_update, rb_extract_min, rb_last, rb_size, rb_collect, rb_validate, NULL
+    },
+    [QUEUE_RBTREE_AUG] = {
+        QUEUE_RBTREE_AUG, "rbtree-aug", rb_aug_init, rb_release, rb_insert, rb_remove,
+        rb_update, rb_extract_min, rb_last, rb_size, rb_collect, rb_validate, rb_pick_eligible
+    },
+};
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int taskqueue_init(TaskQueue *queue, QueueBackend backend) {
+    if (!queue || (int)backend < 0 || backend >= QUEUE_BACKEND_COUNT) {
+        return -1;
+    }
+    queue->ops = &queue_backends[backend];
+    return queue->ops->init(queue);
+}
+
+void taskqueue_destroy(TaskQueue *queue) {
+    if (queue && queue->ops) {
+        queue->ops->release(queue);
+    }
+}
+
+int taskqueue_parse_backend(const char *name, QueueBackend *backend) {
+    if (!name || !backend) {
+        return -1;
+    }
+
+    for (int i = 0; i < QUEUE_BACKEND_COUNT; i++) {
+        if (strcmp(name, queue_backends[i].name) == 0) {
+            *backend = (QueueBackend)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *taskqueue_backend_name(QueueBackend backend) {
+    if ((int)backend < 0 || backend >= QUEUE_BACKEND_COUNT) {
+        return "unknown";
+    }
+    return queue_backends[backend].name;
+}
+
+int taskqueue_validate(const TaskQueue *queue) {
+    if (!queue || !queue->ops || queue->ops->validate(queue) < 0) {
+        return -1;
+    }
+
+    /* The cached minimum must be the task every backend agrees on */
+    Task *min_task = NULL;
+    if (queue->ops->size(queue) > 0) {
+        if (queue->ops->backend == QUEUE_RBTREE || queue->ops->backend == QUEUE_RBTREE_AUG) {
+            min_task = queue->impl.rbtree.leftmost;
+        } else if (queue->ops->backend == QUEUE_PAIRING) {
+            min_task = queue->impl.pairing.root;
+        } else {
+            min_task = queue->impl.heap.tasks[0];
+        }
+    }
+    return queue->first == min_task ? 0 : -1;
+}
@@ -0,0 +1,445 @@
+/**
+ * ALFS - Multi-Tenant Server Implementation
+ *
+ * The calling thread accepts connections and pins each one to the worker
+ * with the fewest connections: the socket goes through that worker's
+ * SPSC queue and an eventfd wakes it. A worker owns everything about its
+ * connections. It builds their schedulers (so their memory is first
+ * touched on the worker's CPU), watches their sockets with its own epoll
+ * instance, and answers each complete timeframe as it arrives, exactly
+ * like the sequential loop of a single-node process. Workers share
+ * nothing but the totals collected once they exit.
+ *
+ * Receives are non-blocking; sends block, which suits lock-step testers
+ * that read every tick before sending the next frame. The binary HELLO
+ * goes out when a connection is opened and the peer's reply is checked
+ * as its first message, so a silent peer only stalls itself.
+ */
+
+#define _GNU_SOURCE     /* sched_getaffinity, pthread_setaffinity_np */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include "tenant.h"
+#include "spsc.h"
+#include "scheduler.h"
+#include "uds.h"
+#include "json_handler.h"
+#include "codec.h"
+#include "stats.h"
+
+#define TENANT_QUEUE_DEPTH 256      /* Accepted sockets waiting for their worker */
+#define TENANT_EPOLL_BATCH 64
+#define TENANT_POLL_MS 100          /* How often idle threads look for shutdown */
+
+/**
+ * One connection and the scheduler it drives
+ */
+typedef struct Tenant {
+    int sock;
+    UdsConn *conn;
+    Codec *codec;
+    Scheduler *sched;
+    TimeFrame *tf;
+    SchedulerTick *tick;
+    OutputBuffer output;
+    long frames;
+    bool greeting;                  /* HELLO sent, the peer's reply not yet checked */
+    struct Tenant *prev;            /* Worker's connection list */
+    struct Tenant *next;
+} Tenant;
+
+typedef struct {
+    int index;
+    const TenantConfig *config;
+    int epoll_fd;
+    int wake_fd;                    /* Signalled after sockets are queued */
+    SpscQueue incoming;             /* Acceptor -> worker: accepted sockets */
+    atomic_int connections;         /* Placed on this worker and not yet closed */
+    atomic_bool stop;
+    Tenant *tenants;
+    TenantTotals totals;            /* Read by the acceptor after the join */
+    pthread_t thread;
+} TenantWorker;
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+/**
+ * CPUs this process may run on
+ */
+static int usable_cpus(cpu_set_t *allowed) {
+    if (sched_getaffinity(0, sizeof(*allowed), allowed) != 0) {
+        CPU_ZERO(allowed);
+        return 0;
+    }
+    return CPU_COUNT(allowed);
+}
+
+/**
+ * Pin the calling worker to one of the usable CPUs, round robin by index
+ */
+static void pin_worker(int index) {
+    cpu_set_t allowed;
+    int usable = usable_cpus(&allowed);
+    if (usable <= 0) {
+        return;
+    }
+
+    int target = index % usable;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(cpu, &one);
+            pthread_setaffinity_np(pthread_self(), sizeof(one), &one);
+            return;
+        }
+    }
+}
+
+static void tenant_free(Tenant *tenant) {
+    json_output_free(&tenant->output);
+    scheduler_tick_free(tenant->tick);
+    json_free_timeframe(tenant->tf);
+    scheduler_destroy(tenant->sched);
+    codec_destroy(tenant->codec);
+    uds_conn_destroy(tenant->conn);
+    uds_disconnect(tenant->sock);
+    free(tenant);
+}
+
+/**
+ * Set up a scheduler and buffers for an accepted socket, send the
+ * protocol's greeting and start watching it
+ */
+static void tenant_open(TenantWorker *worker, int sock) {
+    const TenantConfig *config = worker->config;
+    Tenant *tenant = calloc(1, sizeof(Tenant));
+    if (!tenant) {
+        uds_disconnect(sock);
+        worker->totals.errors++;
+        atomic_fetch_sub(&worker->connections, 1);
+        return;
+    }
+
+    tenant->sock = sock;
+    tenant->conn = uds_conn_create(sock, config->framing);
+    tenant->codec = codec_create(config->protocol);
+    tenant->sched = config->create_scheduler(config->factory_arg);
+    tenant->tf = json_timeframe_create();
+    tenant->tick = tenant->sched ? scheduler_tick_create(tenant->sched) : NULL;
+
+    int greeted = -1;
+    if (tenant->conn && tenant->codec && tenant->tf && tenant->tick) {
+        uds_conn_set_nonblocking(tenant->conn, true);
+        greeted = codec_greet(tenant->codec, tenant->conn, config->cpu_count);
+    }
+    tenant->greeting = greeted > 0;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = tenant;
+    if (greeted < 0 || epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, sock, &event) < 0) {
+        fprintf(stderr, "Error: Failed to set up connection on socket %d\n", sock);
+        tenant_free(tenant);
+        worker->totals.errors++;
+        atomic_fetch_sub(&worker->connections, 1);
+        return;
+    }
+
+    tenant->next = worker->tenants;
+    if (worker->tenants) {
+        worker->tenants->prev = tenant;
+    }
+    worker->tenants = tenant;
+    worker->totals.connections++;
+    fprintf(stderr, "Connection on socket %d served by worker %d\n", sock, worker->index);
+}
+
+static void tenant_close(TenantWorker *worker, Tenant *tenant) {
+    epoll_ctl(worker->epoll_fd, EPOLL_CTL_DEL, tenant->sock, NULL);
+    if (tenant->prev) {
+        tenant->prev->next = tenant->next;
+    } else {
+        worker->tenants = tenant->next;
+    }
+    if (tenant->next) {
+        tenant->next->prev = tenant->prev;
+    }
+
+    fprintf(stderr, "Connection on socket %d closed after %ld timeframes\n",
+            tenant->sock, tenant->frames);
+    stats_report(tenant->sched->stats, stderr);
+    tenant_free(tenant);
+    atomic_fetch_sub(&worker->connections, 1);
+}
+
+/**
+ * Answer every complete timeframe a readable connection has buffered,
+ * checking the reply to the greeting first
+ * @return false once the connection is closed or failed
+ */
+static bool tenant_serve_ready(TenantWorker *worker, Tenant *tenant) {
+    Scheduler *sched = tenant->sched;
+
+    while (1) {
+        size_t length = 0;
+        char *input = uds_conn_receive(tenant->conn, &length);
+        if (!input) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            if (errno != 0) {
+                fprintf(stderr, "Error receiving on socket %d: %s\n", tenant->sock, strerror(errno));
+            }
+            return false;
+        }
+
+        if (tenant->greeting) {
+            if (codec_check_greeting(tenant->codec, input, length) < 0) {
+                worker->totals.errors++;
+                return false;
+            }
+            tenant->greeting = false;
+            continue;
+        }
+
+        uint64_t phase_start = stats_start(sched->stats);
+        if (codec_decode(tenant->codec, input, length, tenant->tf) < 0) {
+            fprintf(stderr, "Error: Failed to parse TimeFrame on socket %d\n", tenant->sock);
+            worker->totals.errors++;
+            continue;
+        }
+        stats_lap(sched->stats, STAT_PARSE, phase_start);
+
+        TimeFrame *tf = tenant->tf;
+        worker->totals.rejected += scheduler_process_events(sched, tf->events, tf->event_count);
+        if (scheduler_tick_into(sched, tf->vtime, tenant->tick) < 0) {
+            fprintf(stderr, "Error: Failed to generate scheduler tick on socket %d\n", tenant->sock);
+            continue;
+        }
+
+        phase_start = stats_start(sched->stats);
+        if (codec_encode(tenant->codec, tenant->tick, worker->config->include_meta,
+                         &tenant->output) < 0) {
+            fprintf(stderr, "Error: Failed to serialize scheduler tick on socket %d\n", tenant->sock);
+            continue;
+        }
+        stats_lap(sched->stats, STAT_SERIALIZE, phase_start);
+        if (uds_conn_send_output(tenant->conn, &tenant->output) < 0) {
+            return false;
+        }
+        tenant->frames++;
+        worker->totals.frames++;
+    }
+}
+
+/**
+ * Take over every socket the acceptor queued since the last wake-up
+ */
+static void tenant_take_incoming(TenantWorker *worker) {
+    eventfd_t pending;
+    eventfd_read(worker->wake_fd, &pending);
+
+    void *item;
+    while (spsc_try_pop(&worker->incoming, &item)) {
+        tenant_open(worker, (int)(intptr_t)item);
+    }
+}
+
+static void *tenant_worker(void *arg) {
+    TenantWorker *worker = arg;
+    pin_worker(worker->index);
+
+    struct epoll_event events[TENANT_EPOLL_BATCH];
+    while (!atomic_load_explicit(&worker->stop, memory_order_acquire)) {
+        int ready = epoll_wait(worker->epoll_fd, events, TENANT_EPOLL_BATCH, TENANT_POLL_MS);
+        if (ready < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            Tenant *tenant = events[i].data.ptr;
+            if (!tenant) {
+                tenant_take_incoming(worker);
+            } else if (!tenant_serve_ready(worker, tenant)) {
+                tenant_close(worker, tenant);
+            }
+        }
+    }
+
+    /* Shutdown: drop sockets never opened, then every live connection */
+    void *item;
+    while (spsc_try_pop(&worker->incoming, &item)) {
+        uds_disconnect((int)(intptr_t)item);
+        atomic_fetch_sub(&worker->connections, 1);
+    }
+    while (worker->tenants) {
+        tenant_close(worker, worker->tenants);
+    }
+    return NULL;
+}
+
+static int worker_init(TenantWorker *worker, int index, const TenantConfig *config) {
+    memset(worker, 0, sizeof(*worker));
+    worker->index = index;
+    worker->config = config;
+    worker->epoll_fd = -1;
+    worker->wake_fd = -1;
+    atomic_init(&worker->connections, 0);
+    atomic_init(&worker->stop, false);
+    worker->epoll_fd = epoll_create1(0);
+    worker->wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (worker->epoll_fd < 0 || worker->wake_fd < 0 ||
+        spsc_init(&worker->incoming, TENANT_QUEUE_DEPTH) < 0) {
+        return -1;
+    }
+
+    /* The wake-up descriptor is the only event without a tenant */
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    return epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->wake_fd, &event);
+}
+
+static void worker_destroy(TenantWorker *worker) {
+    if (worker->epoll_fd >= 0) {
+        close(worker->epoll_fd);
+    }
+    if (worker->wake_fd >= 0) {
+        close(worker->wake_fd);
+    }
+    if (worker->incoming.slots) {
+        spsc_destroy(&worker->incoming);
+    }
+}
+
+/**
+ * Stop and join the first `count` workers
+ */
+static void workers_stop(TenantWorker *workers, int count) {
+    for (int i = 0; i < count; i++) {
+        atomic_store_explicit(&workers[i].stop, true, memory_order_release);
+        eventfd_write(workers[i].wake_fd, 1);
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+}
+
+/**
+ * Hand an accepted socket to the worker with the fewest connections
+ */
+static void place_connection(TenantWorker *workers, int count, int sock) {
+    TenantWorker *target = &workers[0];
+    for (int i = 1; i < count; i++) {
+        if (atomic_load(&workers[i].connections) < atomic_load(&target->connections)) {
+            target = &workers[i];
+        }
+    }
+
+    atomic_fetch_add(&target->connections, 1);
+    if (!spsc_try_push(&target->incoming, (void *)(intptr_t)sock)) {
+        fprintf(stderr, "Error: Worker %d has too many pending connections\n", target->index);
+        atomic_fetch_sub(&target->connections, 1);
+        uds_disconnect(sock);
+        return;
+    }
+    eventfd_write(target->wake_fd, 1);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+int tenant_serve(const TenantConfig *config, volatile int *running, TenantTotals *totals) {
+    if (!config || !config->socket_path || !config->create_scheduler || !running) {
+        return -1;
+    }
+
+    cpu_set_t allowed;
+    int count = config->workers > 0 ? config->workers : usable_cpus(&allowed);
+    if (count <= 0) {
+        count = 1;
+    }
+    if (count > TENANT_MAX_WORKERS) {
+        count = TENANT_MAX_WORKERS;
+    }
+
+    TenantWorker *workers = calloc((size_t)count, sizeof(TenantWorker));
+    if (!workers) {
+        return -1;
+    }
+    int initialized = 0;
+    while (initialized < count && worker_init(&workers[initialized], initialized, config) == 0) {
+        initialized++;
+    }
+    int listen_sock = initialized == count ? uds_listen(config->socket_path) : -1;
+    if (listen_sock < 0) {
+        for (int i = 0; i <= initialized && i < count; i++) {
+            worker_destroy(&workers[i]);
+        }
+        free(workers);
+        return -1;
+    }
+
+    /* A peer that disconnects mid-send must not kill the other tenants */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Workers leave signal handling to the calling thread */
+    sigset_t blocked, previous;
+    sigfillset(&blocked);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    int started = 0;
+    while (started < count &&
+           pthread_create(&workers[started].thread, NULL, tenant_worker, &workers[started]) == 0) {
+        started++;
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+    int rc = started == count ? 0 : -1;
+    while (rc == 0 && *running) {
+        struct pollfd listener = {listen_sock, POLLIN, 0};
+        if (poll(&listener, 1, TENANT_POLL_MS) <= 0) {
+            continue;
+        }
+        int sock = accept(listen_sock, NULL, NULL);
+        if (sock >= 0) {
+            place_connection(workers, count, sock);
+        }
+    }
+
+    workers_stop(workers, started);
+    uds_disconnect(listen_sock);
+    unlink(config->socket_path);
+
+    TenantTotals sum = {0, 0, 0, 0};
+    for (int i = 0; i < count; i++) {
+        sum.connections += workers[i].totals.connections;
+        sum.frames += workers[i].totals.frames;
+        sum.rejected += workers[i].totals.rejected;
+        sum.errors += workers[i].totals.errors;
+        worker_destroy(&workers[i]);
+    }
+    free(workers);
+
+    if (totals) {
+        *totals = sum;
+    }
+    return rc;
+}
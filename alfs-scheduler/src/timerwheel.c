@@ -0,0 +1,111 @@
+/**
+ * ALFS - Timer Wheel Implementation
+ *
+ * One slot per tick, modulo TIMER_WHEEL_SLOTS. A timer further out than
+ * one revolution stays in its slot and is skipped until its round comes
+ * up, so periods shorter than the wheel fire with no extra visits.
+ */
+
+#include "timerwheel.h"
+
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+_Static_assert((TIMER_WHEEL_SLOTS & TIMER_WHEEL_MASK) == 0, "Wheel size must be a power of two");
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+static void link_node(TimerNode **head, TimerNode *node) {
+    node->next = *head;
+    if (*head) {
+        (*head)->pprev = &node->next;
+    }
+    node->pprev = head;
+    *head = node;
+}
+
+static void unlink_node(TimerNode *node) {
+    *node->pprev = node->next;
+    if (node->next) {
+        node->next->pprev = node->pprev;
+    }
+    node->next = NULL;
+    node->pprev = NULL;
+}
+
+/**
+ * Slot a timer waits in: its own, or the next tick's if already due
+ */
+static TimerNode **slot_for(TimerWheel *wheel, long long expires) {
+    long long tick = expires > wheel->now ? expires : wheel->now + 1;
+    return &wheel->slots[tick & TIMER_WHEEL_MASK];
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+void timer_wheel_init(TimerWheel *wheel, long long now) {
+    for (int i = 0; i < TIMER_WHEEL_SLOTS; i++) {
+        wheel->slots[i] = NULL;
+    }
+    wheel->now = now;
+    wheel->armed = 0;
+}
+
+void timer_wheel_add(TimerWheel *wheel, TimerNode *node, long long expires) {
+    if (timer_armed(node)) {
+        unlink_node(node);
+    } else {
+        wheel->armed++;
+    }
+    node->expires = expires;
+    link_node(slot_for(wheel, expires), node);
+}
+
+void timer_wheel_del(TimerWheel *wheel, TimerNode *node) {
+    if (timer_armed(node)) {
+        unlink_node(node);
+        wheel->armed--;
+    }
+}
+
+int timer_wheel_advance(TimerWheel *wheel, long long now, TimerFn fn, void *arg) {
+    long long span = now - wheel->now;
+    long long first = wheel->now + 1;
+    wheel->now = now;
+    if (span <= 0) {
+        return 0;
+    }
+    if (span > TIMER_WHEEL_SLOTS) {
+        span = TIMER_WHEEL_SLOTS;
+    }
+
+    int fired = 0;
+    for (long long i = 0; i < span; i++) {
+        TimerNode **slot = &wheel->slots[(first + i) & TIMER_WHEEL_MASK];
+
+        /*
+         * Move the slot to a local list so callbacks can re-arm into it;
+         * timers still waiting there stay armed and may be disarmed too
+         */
+        TimerNode *pending = *slot;
+        *slot = NULL;
+        if (pending) {
+            pending->pprev = &pending;
+        }
+        while (pending) {
+            TimerNode *node = pending;
+            unlink_node(node);
+            if (node->expires > now) {
+                link_node(slot, node);
+            } else {
+                wheel->armed--;
+                fired++;
+                fn(node, arg);
+            }
+        }
+    }
+    return fired;
+}
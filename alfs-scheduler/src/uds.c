@@ -8,15 +8,21 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <errno.h>
 #include "uds.h"
 
-#define INITIAL_BUFFER_SIZE 4096
+#define UDS_READ_CHUNK (64 * 1024)           /* Initial buffer and read size */
+#define UDS_LISTEN_BACKLOG 128
+#define UDS_LENGTH_HEADER 4                  /* Big-endian payload length */
 #define MAX_MESSAGE_SIZE (16 * 1024 * 1024)  /* 16MB max message */
 
+_Static_assert(OUTPUT_HEADROOM >= UDS_LENGTH_HEADER, "output headroom must fit a length header");
+
 int uds_connect(const char *socket_path) {
     if (!socket_path) {
         return -1;
@@ -42,6 +48,34 @@ int uds_connect(const char *socket_path) {
     return sock;
 }
 
+int uds_listen(const char *socket_path) {
+    if (!socket_path) {
+        return -1;
+    }
+    
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        return -1;
+    }
+    
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    
+    /* A stale socket file from an earlier run would make bind fail */
+    unlink(socket_path);
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(sock, UDS_LISTEN_BACKLOG) < 0) {
+        perror("bind/listen");
+        close(sock);
+        return -1;
+    }
+    
+    return sock;
+}
+
 void uds_disconnect(int sock) {
     if (sock >= 0) {
         close(sock);
@@ -65,86 +99,362 @@ int uds_receive(int sock, char *buffer, size_t buffer_size) {
     return (int)n;
 }
 
-char *uds_receive_message(int sock) {
+/* ============================================================================
+ * Buffered Connection
+ * ============================================================================ */
+
+/**
+ * Put back the byte the previous message's terminator overwrote
+ */
+static void uds_conn_release(UdsConn *conn) {
+    if (conn->holding) {
+        conn->buf[conn->held_pos] = conn->held_byte;
+        conn->holding = false;
+    }
+}
+
+/**
+ * Read one chunk after the pending bytes, compacting or growing the
+ * buffer first when there is no room left
+ * @return Bytes read, 0 on EOF, -1 on error
+ */
+static ssize_t uds_conn_fill(UdsConn *conn) {
+    if (conn->end == conn->capacity && conn->start > 0) {
+        size_t pending = conn->end - conn->start;
+        memmove(conn->buf, conn->buf + conn->start, pending);
+        conn->start = 0;
+        conn->end = pending;
+    }
+    
+    if (conn->end == conn->capacity) {
+        if (conn->capacity >= MAX_MESSAGE_SIZE) {
+            errno = EMSGSIZE;
+            return -1;  /* Message too large */
+        }
+        size_t new_capacity = conn->capacity * 2;
+        char *new_buf = realloc(conn->buf, new_capacity + 1);
+        if (!new_buf) {
+            errno = ENOMEM;
+            return -1;
+        }
+        conn->buf = new_buf;
+        conn->capacity = new_capacity;
+    }
+    
+    while (1) {
+        ssize_t n = recv(conn->sock, conn->buf + conn->end, conn->capacity - conn->end,
+                         conn->recv_flags);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n > 0) {
+            conn->end += (size_t)n;
+        }
+        return n;
+    }
+}
+
+/**
+ * Look for a complete frame in the pending bytes, resuming where the
+ * previous scan stopped
+ * @return 1 if found (offset/length/consumed are relative to start),
+ *         0 if more bytes are needed, -1 on a malformed frame
+ */
+static int uds_conn_find_frame(UdsConn *conn, size_t *offset, size_t *length,
+                               size_t *consumed) {
+    const char *data = conn->buf + conn->start;
+    size_t pending = conn->end - conn->start;
+    
+    switch (conn->framing) {
+        case UDS_FRAME_NEWLINE: {
+            const char *newline = memchr(data + conn->scanned, '\n', pending - conn->scanned);
+            if (!newline) {
+                conn->scanned = pending;
+                return 0;
+            }
+            *offset = 0;
+            *length = (size_t)(newline - data);
+            *consumed = *length + 1;
+            return 1;
+        }
+        
+        case UDS_FRAME_JSON: {
+            for (size_t i = conn->scanned; i < pending; i++) {
+                char c = data[i];
+                if (conn->in_string) {
+                    if (conn->escaped) {
+                        conn->escaped = false;
+                    } else if (c == '\\') {
+                        conn->escaped = true;
+                    } else if (c == '"') {
+                        conn->in_string = false;
+                    }
+                } else if (c == '"') {
+                    conn->in_string = true;
+                } else if (c == '{') {
+                    conn->found_start = true;
+                    conn->depth++;
+                } else if (c == '}' && conn->depth > 0 && --conn->depth == 0) {
+                    /* Complete top-level object */
+                    conn->found_start = false;
+                    *offset = 0;
+                    *length = i + 1;
+                    *consumed = i + 1;
+                    return 1;
+                }
+            }
+            conn->scanned = pending;
+            return 0;
+        }
+        
+        case UDS_FRAME_LENGTH: {
+            if (pending < UDS_LENGTH_HEADER) {
+                return 0;
+            }
+            const unsigned char *header = (const unsigned char *)data;
+            size_t payload = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) |
+                             ((size_t)header[2] << 8) | (size_t)header[3];
+            if (payload > MAX_MESSAGE_SIZE) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+            if (pending < UDS_LENGTH_HEADER + payload) {
+                return 0;
+            }
+            *offset = UDS_LENGTH_HEADER;
+            *length = payload;
+            *consumed = UDS_LENGTH_HEADER + payload;
+            return 1;
+        }
+    }
+    
+    errno = EINVAL;
+    return -1;
+}
+
+/**
+ * Handle EOF: trailing bytes without a terminator are the last message
+ * unless they are only framing whitespace
+ */
+static char *uds_conn_finish(UdsConn *conn, size_t *length) {
+    char *data = conn->buf + conn->start;
+    size_t pending = conn->end - conn->start;
+    conn->start = conn->end;
+    conn->scanned = 0;
+    
+    if (conn->framing == UDS_FRAME_LENGTH && pending > 0) {
+        errno = EPROTO;  /* Truncated frame */
+        return NULL;
+    }
+    
+    for (size_t i = 0; i < pending; i++) {
+        if (!isspace((unsigned char)data[i])) {
+            data[pending] = '\0';
+            if (length) {
+                *length = pending;
+            }
+            return data;
+        }
+    }
+    
+    errno = 0;  /* Clean EOF between messages */
+    return NULL;
+}
+
+UdsConn *uds_conn_create(int sock, UdsFraming framing) {
     if (sock < 0) {
         errno = EINVAL;
         return NULL;
     }
     
-    size_t buffer_size = INITIAL_BUFFER_SIZE;
-    char *buffer = malloc(buffer_size);
-    if (!buffer) {
+    UdsConn *conn = calloc(1, sizeof(UdsConn));
+    if (!conn) {
         errno = ENOMEM;
         return NULL;
     }
     
-    size_t total_received = 0;
-    int brace_count = 0;
-    bool in_string = false;
-    bool found_start = false;
+    /* One spare byte so a message ending at the buffer end can be terminated */
+    conn->buf = malloc(UDS_READ_CHUNK + 1);
+    if (!conn->buf) {
+        free(conn);
+        errno = ENOMEM;
+        return NULL;
+    }
+    conn->capacity = UDS_READ_CHUNK;
+    conn->sock = sock;
+    conn->framing = framing;
+    return conn;
+}
+
+void uds_conn_set_nonblocking(UdsConn *conn, bool nonblocking) {
+    if (conn) {
+        conn->recv_flags = nonblocking ? MSG_DONTWAIT : 0;
+    }
+}
+
+void uds_conn_destroy(UdsConn *conn) {
+    if (conn) {
+        free(conn->buf);
+        free(conn);
+    }
+}
+
+char *uds_conn_receive(UdsConn *conn, size_t *length) {
+    if (!conn) {
+        errno = EINVAL;
+        return NULL;
+    }
+    uds_conn_release(conn);
     
     while (1) {
-        /* Ensure we have room for more data */
-        if (total_received >= buffer_size - 1) {
-            if (buffer_size >= MAX_MESSAGE_SIZE) {
-                errno = EMSGSIZE;
-                free(buffer);
-                return NULL;  /* Message too large */
+        size_t offset = 0;
+        size_t message_length = 0;
+        size_t consumed = 0;
+        int found = uds_conn_find_frame(conn, &offset, &message_length, &consumed);
+        if (found < 0) {
+            return NULL;
+        }
+        
+        if (found > 0) {
+            char *message = conn->buf + conn->start + offset;
+            conn->start += consumed;
+            conn->scanned = 0;
+            
+            /* Terminate in place; a still-pending byte is restored next call */
+            size_t terminator = (size_t)(message - conn->buf) + message_length;
+            if (terminator >= conn->start && terminator < conn->end) {
+                conn->held_pos = terminator;
+                conn->held_byte = conn->buf[terminator];
+                conn->holding = true;
             }
-            buffer_size *= 2;
-            char *new_buffer = realloc(buffer, buffer_size);
-            if (!new_buffer) {
-                errno = ENOMEM;
-                free(buffer);
-                return NULL;
+            conn->buf[terminator] = '\0';
+            
+            if (length) {
+                *length = message_length;
             }
-            buffer = new_buffer;
+            return message;
         }
         
-        /* Receive one byte at a time for proper JSON boundary detection */
-        ssize_t n = recv(sock, buffer + total_received, 1, 0);
-        if (n <= 0) {
-            if (n < 0 && errno == EINTR) {
+        ssize_t n = uds_conn_fill(conn);
+        if (n < 0) {
+            return NULL;
+        }
+        if (n == 0) {
+            return uds_conn_finish(conn, length);
+        }
+    }
+}
+
+/**
+ * Send every byte of an iovec array, resuming after short writes
+ */
+static int uds_sendv(int sock, struct iovec *iov, int iov_count) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = iov_count;
+    
+    while (msg.msg_iovlen > 0) {
+        ssize_t n = sendmsg(sock, &msg, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
                 continue;
             }
-            /*
-             * Clean EOF can happen right after a newline terminator from the
-             * peer. If we never saw '{', the buffered bytes are only framing
-             * whitespace and should not be treated as a JSON message.
-             */
-            if (n == 0 && !found_start) {
-                errno = 0;  /* Clean EOF between JSON messages */
-                free(buffer);
-                return NULL;
-            }
-            if (total_received > 0) {
-                buffer[total_received] = '\0';
-                return buffer;
-            }
-            free(buffer);
-            return NULL;
+            perror("send");
+            return -1;
         }
         
-        char c = buffer[total_received];
-        total_received++;
-        
-        /* Track JSON structure for complete message detection */
-        if (c == '"' && (total_received < 2 || buffer[total_received - 2] != '\\')) {
-            in_string = !in_string;
-        } else if (!in_string) {
-            if (c == '{') {
-                found_start = true;
-                brace_count++;
-            } else if (c == '}') {
-                brace_count--;
-                if (found_start && brace_count == 0) {
-                    /* Complete JSON object received */
-                    buffer[total_received] = '\0';
-                    return buffer;
-                }
-            }
+        /* Skip fully written buffers, trim a partially written one */
+        size_t sent = (size_t)n;
+        while (msg.msg_iovlen > 0 && sent >= msg.msg_iov->iov_len) {
+            sent -= msg.msg_iov->iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
+        if (msg.msg_iovlen > 0) {
+            msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + sent;
+            msg.msg_iov->iov_len -= sent;
+        }
+    }
+    
+    return 0;
+}
+
+int uds_conn_send(UdsConn *conn, const char *message, size_t length) {
+    if (!conn || !message) {
+        return -1;
+    }
+    
+    /* Frame and payload go out in a single syscall */
+    struct iovec iov[2];
+    unsigned char header[UDS_LENGTH_HEADER];
+    if (conn->framing == UDS_FRAME_LENGTH) {
+        if (length > MAX_MESSAGE_SIZE) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        header[0] = (unsigned char)(length >> 24);
+        header[1] = (unsigned char)(length >> 16);
+        header[2] = (unsigned char)(length >> 8);
+        header[3] = (unsigned char)length;
+        iov[0].iov_base = header;
+        iov[0].iov_len = sizeof(header);
+        iov[1].iov_base = (void *)message;
+        iov[1].iov_len = length;
+    } else {
+        iov[0].iov_base = (void *)message;
+        iov[0].iov_len = length;
+        iov[1].iov_base = "\n";
+        iov[1].iov_len = 1;
+    }
+    
+    return uds_sendv(conn->sock, iov, 2);
+}
+
+int uds_conn_send_output(UdsConn *conn, OutputBuffer *out) {
+    if (!conn || !out || !out->data) {
+        return -1;
+    }
+    
+    char *payload = out->data + OUTPUT_HEADROOM;
+    size_t length = out->length;
+    int rc;
+    if (conn->framing == UDS_FRAME_LENGTH) {
+        if (length > MAX_MESSAGE_SIZE) {
+            errno = EMSGSIZE;
+            return -1;
         }
+        unsigned char *header = (unsigned char *)payload - UDS_LENGTH_HEADER;
+        header[0] = (unsigned char)(length >> 24);
+        header[1] = (unsigned char)(length >> 16);
+        header[2] = (unsigned char)(length >> 8);
+        header[3] = (unsigned char)length;
+        rc = uds_send(conn->sock, (const char *)header, length + UDS_LENGTH_HEADER);
+    } else {
+        /* The terminator takes the NUL's place for the write */
+        payload[length] = '\n';
+        rc = uds_send(conn->sock, payload, length + 1);
+        payload[length] = '\0';
+    }
+    
+    return rc < 0 ? -1 : 0;
+}
+
+int uds_parse_framing(const char *name, UdsFraming *framing) {
+    if (!name || !framing) {
+        return -1;
+    }
+    
+    if (strcmp(name, "newline") == 0) {
+        *framing = UDS_FRAME_NEWLINE;
+    } else if (strcmp(name, "json") == 0) {
+        *framing = UDS_FRAME_JSON;
+    } else if (strcmp(name, "length") == 0) {
+        *framing = UDS_FRAME_LENGTH;
+    } else {
+        return -1;
     }
+    return 0;
 }
 
 int uds_send(int sock, const char *message, size_t length) {
@@ -173,15 +483,15 @@ int uds_send_message(int sock, const char *message) {
         return -1;
     }
     
+    /* Message and newline terminator go out in a single syscall */
     size_t length = strlen(message);
-    int result = uds_send(sock, message, length);
-    
-    /* Send newline as message terminator */
-    if (result >= 0) {
-        if (send(sock, "\n", 1, 0) < 0) {
-            return -1;
-        }
+    struct iovec iov[2] = {
+        {(void *)message, length},
+        {"\n", 1}
+    };
+    if (uds_sendv(sock, iov, 2) < 0) {
+        return -1;
     }
     
-    return result;
+    return (int)length;
 }
@@ -0,0 +1,172 @@
+/**
+ * ALFS - Fork-Join Work Pool Implementation
+ *
+ * A job is published by bumping the generation counter; each helper runs
+ * its chunk and decrements `pending`, which the caller waits on after
+ * running its own chunk. Jobs are short (one tick's worth of picks), so
+ * both sides spin before sleeping, and the caller only takes the mutex
+ * to wake helpers that actually went to sleep.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <sched.h>
+#include "workpool.h"
+
+#define WORKPOOL_SPIN_LIMIT 4096
+
+typedef struct WorkPoolSlot {
+    WorkPool *pool;
+    int index;                      /* Chunk index; the caller runs chunk 0 */
+    pthread_t thread;
+} WorkPoolSlot;
+
+/* ============================================================================
+ * Helper Functions
+ * ============================================================================ */
+
+static void run_chunk(WorkPool *pool, int index) {
+    int threads = pool->helpers + 1;
+    int begin = (int)((long long)pool->count * index / threads);
+    int end = (int)((long long)pool->count * (index + 1) / threads);
+    if (begin < end) {
+        pool->fn(pool->arg, begin, end);
+    }
+}
+
+/**
+ * Wait for a generation other than `seen`: spin first, then sleep.
+ * The fence pairs with the one in workpool_wake: either we see the new
+ * generation, or the caller sees our sleepers increment.
+ */
+static unsigned int wait_generation(WorkPool *pool, unsigned int seen) {
+    unsigned int generation;
+    for (int spin = 0; spin < WORKPOOL_SPIN_LIMIT; spin++) {
+        generation = atomic_load_explicit(&pool->generation, memory_order_acquire);
+        if (generation != seen) {
+            return generation;
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add(&pool->sleepers, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    while ((generation = atomic_load_explicit(&pool->generation, memory_order_acquire)) == seen) {
+        pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    atomic_fetch_sub(&pool->sleepers, 1);
+    pthread_mutex_unlock(&pool->lock);
+    return generation;
+}
+
+/**
+ * Publish the next generation and wake sleeping helpers
+ */
+static void workpool_wake(WorkPool *pool) {
+    atomic_fetch_add_explicit(&pool->generation, 1, memory_order_release);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&pool->sleepers, memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->wake);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+static void *workpool_helper(void *arg) {
+    WorkPoolSlot *slot = arg;
+    WorkPool *pool = slot->pool;
+    unsigned int seen = 0;
+
+    for (;;) {
+        seen = wait_generation(pool, seen);
+        if (atomic_load_explicit(&pool->stop, memory_order_acquire)) {
+            return NULL;
+        }
+        run_chunk(pool, slot->index);
+        atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_release);
+    }
+}
+
+/**
+ * Join the first `started` helpers and free the pool
+ */
+static void workpool_free(WorkPool *pool, int started) {
+    atomic_store_explicit(&pool->stop, true, memory_order_release);
+    workpool_wake(pool);
+    for (int i = 0; i < started; i++) {
+        pthread_join(pool->slots[i].thread, NULL);
+    }
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->slots);
+    free(pool);
+}
+
+/* ============================================================================
+ * Public Functions
+ * ============================================================================ */
+
+WorkPool *workpool_create(int threads) {
+    if (threads < 2) {
+        return NULL;
+    }
+
+    WorkPool *pool = calloc(1, sizeof(WorkPool));
+    if (!pool) {
+        return NULL;
+    }
+    pool->helpers = threads - 1;
+    pool->slots = calloc((size_t)pool->helpers, sizeof(WorkPoolSlot));
+    if (!pool->slots) {
+        free(pool);
+        return NULL;
+    }
+    atomic_init(&pool->generation, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->sleepers, 0);
+    atomic_init(&pool->stop, false);
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool->slots);
+        free(pool);
+        return NULL;
+    }
+    if (pthread_cond_init(&pool->wake, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->slots);
+        free(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < pool->helpers; i++) {
+        pool->slots[i].pool = pool;
+        pool->slots[i].index = i + 1;
+        if (pthread_create(&pool->slots[i].thread, NULL, workpool_helper, &pool->slots[i]) != 0) {
+            workpool_free(pool, i);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void workpool_destroy(WorkPool *pool) {
+    if (pool) {
+        workpool_free(pool, pool->helpers);
+    }
+}
+
+void workpool_run(WorkPool *pool, WorkFn fn, void *arg, int count) {
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->count = count;
+    atomic_store_explicit(&pool->pending, pool->helpers, memory_order_relaxed);
+    workpool_wake(pool);
+
+    run_chunk(pool, 0);
+
+    for (int spin = 0; atomic_load_explicit(&pool->pending, memory_order_acquire) > 0; spin++) {
+        if (spin >= WORKPOOL_SPIN_LIMIT) {
+            sched_yield();
+        }
+    }
+}
@@ -0,0 +1,197 @@
+/**
+ * ALFS - JSON Parse/Serialize Microbenchmark
+ *
+ * Parses realistic timeframes with the cJSON DOM path that used to back
+ * json_parse_timeframe and with the streaming parser reusing one
+ * TimeFrame, then serializes ticks with the old cJSON tree builder and
+ * the direct writer reusing one OutputBuffer, and reports the speedups.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/json_handler.h"
+#include "../include/scheduler.h"
+#include "json_reference.h"
+
+#define BENCH_BYTES (64 * 1024 * 1024)
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * Build a timeframe with `events` events drawn from the generator's mix
+ * (mostly task state changes, some creates, affinity and cgroup updates)
+ */
+static char *make_frame(int events, size_t *length) {
+    size_t cap = (size_t)events * 160 + 64;
+    char *frame = malloc(cap);
+    if (!frame) {
+        return NULL;
+    }
+
+    unsigned int seed = 12345u;
+    size_t n = (size_t)sprintf(frame, "{\"vtime\": 1234, \"events\": [");
+    for (int i = 0; i < events; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int task = (int)((seed >> 8) % 4096);
+        const char *sep = i ? ", " : "";
+        switch ((seed >> 20) % 8) {
+            case 0:
+                n += (size_t)sprintf(frame + n, "%s{\"action\": \"TASK_CREATE\", \"taskId\": \"task-%d\", "
+                                     "\"nice\": %d, \"cgroupId\": \"web\"}", sep, task, task % 40 - 20);
+                break;
+            case 1:
+                n += (size_t)sprintf(frame + n, "%s{\"action\": \"TASK_SET_AFFINITY\", \"taskId\": \"task-%d\", "
+                                     "\"cpuMask\": [0, 1, %d, %d]}", sep, task, 2 + task % 6, 8 + task % 8);
+                break;
+            case 2:
+                n += (size_t)sprintf(frame + n, "%s{\"action\": \"CGROUP_MODIFY\", \"cgroupId\": \"cg-%d\", "
+                                     "\"cpuShares\": %d, \"cpuQuotaUs\": null, \"cpuPeriodUs\": 100000}",
+                                     sep, task % 16, 512 + task);
+                break;
+            case 3:
+                n += (size_t)sprintf(frame + n, "%s{\"action\": \"TASK_SETNICE\", \"taskId\": \"task-%d\", "
+                                     "\"newNice\": %d}", sep, task, task % 20);
+                break;
+            case 4:
+                n += (size_t)sprintf(frame + n, "%s{\"action\": \"TASK_BLOCK\", \"taskId\": \"task-%d\"}", sep, task);
+                break;
+            case 5:
+                n += (size_t)sprintf(frame + n, "%s{\"action\": \"TASK_UNBLOCK\", \"taskId\": \"task-%d\"}", sep, task);
+                break;
+            default:
+                n += (size_t)sprintf(frame + n, "%s{\"action\": \"TASK_YIELD\", \"taskId\": \"task-%d\"}", sep, task);
+                break;
+        }
+    }
+    n += (size_t)sprintf(frame + n, "]}");
+    *length = n;
+    return frame;
+}
+
+static int bench_events(int events) {
+    size_t length = 0;
+    char *frame = make_frame(events, &length);
+    if (!frame) {
+        return 1;
+    }
+    int iters = (int)(BENCH_BYTES / length);
+    if (iters > 200000) {
+        iters = 200000;
+    }
+
+    /* cJSON DOM, fresh TimeFrame per message */
+    long checksum_ref = 0;
+    double start = now_ns();
+    for (int i = 0; i < iters; i++) {
+        TimeFrame *tf = ref_parse_timeframe(frame);
+        checksum_ref += tf->event_count;
+        ref_free_timeframe(tf);
+    }
+    double ref_s = (now_ns() - start) / 1e9;
+
+    /* Streaming parser into a reused TimeFrame */
+    TimeFrame *tf = json_timeframe_create();
+    long checksum = 0;
+    start = now_ns();
+    for (int i = 0; i < iters; i++) {
+        if (json_parse_timeframe_into(frame, tf) == 0) {
+            checksum += tf->event_count;
+        }
+    }
+    double stream_s = (now_ns() - start) / 1e9;
+    json_free_timeframe(tf);
+
+    double mb = 1024.0 * 1024.0;
+    printf("  %5d events (%7zu B): cJSON %7.1f MB/s %8.0f frames/s   streaming %7.1f MB/s %8.0f frames/s  (%.1fx)\n",
+           events, length, (double)length * iters / mb / ref_s, iters / ref_s,
+           (double)length * iters / mb / stream_s, iters / stream_s, ref_s / stream_s);
+
+    free(frame);
+    if (checksum != checksum_ref) {
+        fprintf(stderr, "  event counts differ (%ld vs %ld)\n", checksum, checksum_ref);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Serialize a metadata tick listing `tasks` tasks on 8 CPUs
+ */
+static int bench_serialize(int tasks) {
+    Scheduler *sched = scheduler_init(8, 1);
+    scheduler_set_metadata(sched, true);
+    for (int i = 0; i < tasks; i++) {
+        Event event = {0};
+        char task_name[32];
+        event.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "task-%d", i);
+        event.task_id = task_name;
+        scheduler_process_event(sched, &event);
+        if (i % 3 == 0) {
+            event.action = EVENT_TASK_BLOCK;
+            scheduler_process_event(sched, &event);
+        }
+    }
+    SchedulerTick *tick = scheduler_tick(sched, 1234);
+    int iters = 4000000 / (tasks + 8);
+
+    /* cJSON tree, fresh string per tick */
+    size_t bytes_ref = 0;
+    double start = now_ns();
+    for (int i = 0; i < iters; i++) {
+        char *text = ref_serialize_tick(tick, true);
+        bytes_ref += strlen(text);
+        free(text);
+    }
+    double ref_s = (now_ns() - start) / 1e9;
+
+    /* Direct writer into a reused buffer */
+    OutputBuffer out = {0};
+    size_t bytes = 0;
+    start = now_ns();
+    for (int i = 0; i < iters; i++) {
+        if (json_serialize_tick_into(tick, true, &out) == 0) {
+            bytes += out.length;
+        }
+    }
+    double direct_s = (now_ns() - start) / 1e9;
+
+    printf("  %5d tasks (%7zu B): cJSON %8.0f ticks/s   direct %8.0f ticks/s  (%.1fx)\n",
+           tasks, out.length, iters / ref_s, iters / direct_s, ref_s / direct_s);
+
+    json_output_free(&out);
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    if (bytes != bytes_ref) {
+        fprintf(stderr, "  output sizes differ (%zu vs %zu)\n", bytes, bytes_ref);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    static const int sizes[] = {4, 64, 1024, 16384};
+    static const int task_counts[] = {8, 64, 1000};
+
+    printf("Running TimeFrame Parser Benchmark...\n");
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        failures += bench_events(sizes[i]);
+    }
+
+    printf("Running Tick Serializer Benchmark...\n");
+    for (size_t i = 0; i < sizeof(task_counts) / sizeof(task_counts[0]); i++) {
+        failures += bench_serialize(task_counts[i]);
+    }
+
+    return failures;
+}
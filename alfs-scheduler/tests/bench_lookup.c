@@ -0,0 +1,115 @@
+/**
+ * ALFS - ID Lookup Microbenchmark
+ *
+ * Compares the interned ID index against the linear strcmp scan it
+ * replaced, for task populations from 100 to 100k.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../include/idtable.h"
+#include "../include/task.h"
+
+#define INDEX_LOOKUPS 1000000
+#define SCAN_LOOKUPS 2000
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * Baseline: the old scheduler_find_task loop
+ */
+static Task *linear_find(Task **tasks, int count, const char *task_id) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(tasks[i]->task_id, task_id) == 0) {
+            return tasks[i];
+        }
+    }
+    return NULL;
+}
+
+static int bench_population(int count) {
+    Task **tasks = malloc(sizeof(Task *) * count);
+    IdTable *table = idtable_create(0);
+    if (!tasks || !table) {
+        free(tasks);
+        idtable_destroy(table);
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "task-%d", i);
+        tasks[i] = task_create(name, 0, NULL);
+        IdEntry *entry = idtable_acquire(table, name);
+        if (!tasks[i] || !entry) {
+            fprintf(stderr, "allocation failed at %d\n", i);
+            return 1;
+        }
+        entry->task = tasks[i];
+    }
+
+    /* Pre-pick random targets so both loops look up the same IDs */
+    unsigned int seed = 12345u;
+    int *targets = malloc(sizeof(int) * INDEX_LOOKUPS);
+    for (int i = 0; i < INDEX_LOOKUPS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        targets[i] = (int)((seed >> 8) % (unsigned int)count);
+    }
+
+    int misses = 0;
+    double start = now_ns();
+    for (int i = 0; i < INDEX_LOOKUPS; i++) {
+        Task *t = tasks[targets[i]];
+        IdEntry *entry = idtable_lookup(table, t->task_id);
+        if (!entry || entry->task != t) {
+            misses++;
+        }
+    }
+    double index_ns = (now_ns() - start) / INDEX_LOOKUPS;
+
+    start = now_ns();
+    for (int i = 0; i < SCAN_LOOKUPS; i++) {
+        Task *t = tasks[targets[i]];
+        if (linear_find(tasks, count, t->task_id) != t) {
+            misses++;
+        }
+    }
+    double scan_ns = (now_ns() - start) / SCAN_LOOKUPS;
+
+    printf("  %8d tasks: index %8.1f ns/lookup   linear scan %12.1f ns/lookup\n",
+           count, index_ns, scan_ns);
+
+    for (int i = 0; i < count; i++) {
+        task_destroy(tasks[i]);
+    }
+    free(targets);
+    free(tasks);
+    idtable_destroy(table);
+
+    if (misses) {
+        fprintf(stderr, "  %d lookups returned the wrong task\n", misses);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    static const int populations[] = {100, 1000, 10000, 100000};
+
+    printf("Running ID Lookup Benchmark...\n");
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(populations) / sizeof(populations[0]); i++) {
+        failures += bench_population(populations[i]);
+    }
+
+    return failures;
+}
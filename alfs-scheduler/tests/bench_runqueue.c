@@ -0,0 +1,214 @@
+/**
+ * ALFS - Run Queue Backend Microbenchmark
+ *
+ * Runs the same operation streams through every backend for queues of
+ * 16 to 64k tasks:
+ * - tick:   extract the minimum, charge it a slice, insert it back
+ * - churn:  remove a random task and insert it again (block/unblock)
+ * - update: move a random task's vruntime and restore the order (yield)
+ * Cache misses come from perf_event_open when the kernel allows it.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "../include/taskqueue.h"
+#include "../include/task.h"
+
+#define BENCH_OPS 2000000
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* ============================================================================
+ * Cache Miss Counter
+ * ============================================================================ */
+
+static int open_cache_misses(void) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void counter_start(int fd) {
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+/**
+ * Stop the counter and return its value, or -1 without one
+ */
+static long long counter_stop(int fd) {
+    long long count = -1;
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &count, sizeof(count)) != (ssize_t)sizeof(count)) {
+            count = -1;
+        }
+    }
+    return count;
+}
+
+/* ============================================================================
+ * Workloads
+ * ============================================================================ */
+
+typedef enum { WORK_TICK, WORK_CHURN, WORK_UPDATE, WORK_COUNT } Workload;
+
+static const char *workload_names[WORK_COUNT] = {"tick", "churn", "update"};
+
+static unsigned int next_random(unsigned int *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+/**
+ * Run one workload; every iteration is one queue operation pair
+ * @return Queue-order violations seen (should be 0)
+ */
+static int run_workload(TaskQueue *queue, Task **tasks, int count, Workload work,
+                        const unsigned int *targets, const unsigned int *slices) {
+    int errors = 0;
+    for (int i = 0; i < BENCH_OPS; i++) {
+        switch (work) {
+            case WORK_TICK: {
+                Task *t = taskqueue_extract_min(queue);
+                if (!t) {
+                    return errors + 1;
+                }
+                t->vruntime += (vruntime_t)(slices[i % count] + 1);
+                taskqueue_insert(queue, t);
+                break;
+            }
+            case WORK_CHURN: {
+                Task *t = tasks[targets[i % count]];
+                taskqueue_remove(queue, t);
+                taskqueue_insert(queue, t);
+                break;
+            }
+            default: {
+                Task *t = tasks[targets[i % count]];
+                t->vruntime += (vruntime_t)slices[i % count] - 500;
+                taskqueue_update(queue, t);
+                break;
+            }
+        }
+    }
+    errors += taskqueue_validate(queue) != 0;
+    return errors;
+}
+
+static int bench_backend(QueueBackend backend, Task **tasks, int count, int misses_fd,
+                         const unsigned int *targets, const unsigned int *slices) {
+    printf("  %8d tasks  %-7s", count, taskqueue_backend_name(backend));
+    int errors = 0;
+
+    for (int w = 0; w < WORK_COUNT; w++) {
+        TaskQueue queue;
+        if (taskqueue_init(&queue, backend) < 0) {
+            return 1;
+        }
+        for (int i = 0; i < count; i++) {
+            tasks[i]->vruntime = (vruntime_t)slices[i];
+            taskqueue_insert(&queue, tasks[i]);
+        }
+
+        counter_start(misses_fd);
+        double start = now_ns();
+        errors += run_workload(&queue, tasks, count, (Workload)w, targets, slices);
+        double elapsed = now_ns() - start;
+        long long misses = counter_stop(misses_fd);
+
+        printf("  %s %7.1f Mops/s", workload_names[w], BENCH_OPS / elapsed * 1e3);
+        if (misses >= 0) {
+            printf(" %5.2f miss/op", (double)misses / BENCH_OPS);
+        }
+
+        while (taskqueue_extract_min(&queue)) {
+        }
+        taskqueue_destroy(&queue);
+    }
+    printf("\n");
+
+    if (errors) {
+        fprintf(stderr, "  %s: queue order broken\n", taskqueue_backend_name(backend));
+    }
+    return errors ? 1 : 0;
+}
+
+static int bench_population(int count, int misses_fd) {
+    Task **tasks = malloc(sizeof(Task *) * count);
+    unsigned int *targets = malloc(sizeof(unsigned int) * count);
+    unsigned int *slices = malloc(sizeof(unsigned int) * count);
+    if (!tasks || !targets || !slices) {
+        free(tasks);
+        free(targets);
+        free(slices);
+        return 1;
+    }
+
+    unsigned int seed = 12345u;
+    for (int i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "task-%d", i);
+        tasks[i] = task_create(name, 0, NULL);
+        if (!tasks[i]) {
+            fprintf(stderr, "allocation failed at %d\n", i);
+            return 1;
+        }
+        tasks[i]->seq = (uint64_t)i;
+        targets[i] = next_random(&seed) % (unsigned int)count;
+        slices[i] = next_random(&seed) % 1000u;
+    }
+
+    int failures = 0;
+    for (int b = 0; b < QUEUE_BACKEND_COUNT; b++) {
+        failures += bench_backend((QueueBackend)b, tasks, count, misses_fd, targets, slices);
+    }
+
+    for (int i = 0; i < count; i++) {
+        task_destroy(tasks[i]);
+    }
+    free(slices);
+    free(targets);
+    free(tasks);
+    return failures;
+}
+
+int main(void) {
+    static const int populations[] = {16, 256, 4096, 65536};
+
+    printf("Running Run Queue Backend Benchmark...\n");
+    int misses_fd = open_cache_misses();
+    if (misses_fd < 0) {
+        printf("  (cache-miss counter unavailable: perf_event_open not permitted)\n");
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(populations) / sizeof(populations[0]); i++) {
+        failures += bench_population(populations[i], misses_fd);
+    }
+
+    if (misses_fd >= 0) {
+        close(misses_fd);
+    }
+    return failures;
+}
@@ -0,0 +1,431 @@
+/**
+ * ALFS - Scheduler Load Generator and Benchmark
+ *
+ * Synthesizes timeframes in process and drives them through
+ * scheduler_process_event and scheduler_tick_into, one frame per tick:
+ * - a task population that blocks, wakes, exits and is replaced at
+ *   configurable rates (the population size stays constant)
+ * - a share of tasks created with narrow CPU affinity masks
+ * - optional cgroups whose quotas cover a chosen share of the CPUs
+ *
+ * Each run prints one JSON object (JSON lines) with the configuration,
+ * p50/p99/p99.9 frame latency, events/s and the peak RSS, so results can
+ * be kept and compared between releases. Options are listed by --help.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/resource.h>
+#include "../include/scheduler.h"
+#include "../include/taskqueue.h"
+
+#define BENCH_ID_LEN 16             /* "cg" or "t", an int and the NUL */
+
+typedef struct {
+    int tasks;                      /* Population size */
+    int cpus;
+    int ticks;
+    double churn;                   /* Share of runnable tasks blocking per tick (as many wake) */
+    double exit_rate;               /* Share of tasks exiting per tick, each replaced by a new one */
+    double affinity;                /* Share of tasks created with an affinity mask */
+    int mask_cpus;                  /* CPUs in each affinity mask */
+    int cgroups;                    /* Cgroups tasks are spread over, 0 for none */
+    double quota;                   /* Quota per cgroup: its share of all CPUs x this (0 = unlimited) */
+    bool per_cpu;
+    int tick_threads;               /* Parallel tick threads (per-CPU mode), 1 = serial */
+    bool metadata;
+    SchedPolicy policy;
+    QueueBackend backend;
+    unsigned int seed;
+} BenchConfig;
+
+/**
+ * Generator state: the live task IDs, runnable ones first
+ */
+typedef struct {
+    int *ids;                       /* Numeric suffix of each live task */
+    int *masks;                     /* Affinity masks of the frame's creates */
+    int mask_used;
+    char *names;                    /* ID strings of the frame's events */
+    int name_used;
+    int runnable;                   /* ids[0, runnable) are runnable, the rest blocked */
+    int count;
+    int next_id;
+    unsigned int seed;
+    double block_credit;            /* Fractional events carried to the next tick */
+    double exit_credit;
+} Generator;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static unsigned int next_random(unsigned int *seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static double percentile(const double *sorted, int count, double p) {
+    int index = (int)(p * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+/* ============================================================================
+ * Event Synthesis
+ * ============================================================================ */
+
+static void swap_ids(Generator *gen, int a, int b) {
+    int id = gen->ids[a];
+    gen->ids[a] = gen->ids[b];
+    gen->ids[b] = id;
+}
+
+/**
+ * Format an ID into the frame's name store, reused like the masks
+ */
+static const char *frame_id(Generator *gen, const char *prefix, int id) {
+    char *name = gen->names + (size_t)gen->name_used * BENCH_ID_LEN;
+    gen->name_used++;
+    snprintf(name, BENCH_ID_LEN, "%s%d", prefix, id);
+    return name;
+}
+
+static void make_create(const BenchConfig *cfg, Generator *gen, Event *event) {
+    int id = gen->next_id++;
+    memset(event, 0, sizeof(*event));
+    event->action = EVENT_TASK_CREATE;
+    event->task_id = frame_id(gen, "t", id);
+    if (cfg->cgroups > 0) {
+        event->cgroup_id = frame_id(gen, "cg", id % cfg->cgroups);
+    }
+    event->nice = (int)(next_random(&gen->seed) % 11) - 5;
+    event->has_nice = true;
+
+    /* Affinity masks are a contiguous window of mask_cpus CPUs */
+    if ((double)(next_random(&gen->seed) % 10000) < cfg->affinity * 10000.0) {
+        int first = (int)(next_random(&gen->seed) % (unsigned int)cfg->cpus);
+        int *mask = gen->masks + gen->mask_used;
+        gen->mask_used += cfg->mask_cpus;
+        for (int i = 0; i < cfg->mask_cpus; i++) {
+            mask[i] = (first + i) % cfg->cpus;
+        }
+        event->cpu_mask = mask;
+        event->cpu_mask_count = cfg->mask_cpus;
+        event->has_cpu_mask = true;
+    }
+
+    /* New tasks are runnable: insert at the boundary */
+    gen->ids[gen->count] = id;
+    swap_ids(gen, gen->runnable, gen->count);
+    gen->runnable++;
+    gen->count++;
+}
+
+static void make_task_event(Generator *gen, Event *event, EventAction action, int id) {
+    memset(event, 0, sizeof(*event));
+    event->action = action;
+    event->task_id = frame_id(gen, "t", id);
+}
+
+/**
+ * Fill `events` with one timeframe of churn; returns the event count.
+ * The frame's affinity masks and IDs are reused by the next one, so each frame
+ * is processed before the next is generated.
+ */
+static int generate_frame(const BenchConfig *cfg, Generator *gen, Event *events, int capacity) {
+    int n = 0;
+    gen->mask_used = 0;
+    gen->name_used = 0;
+
+    /* Exits, each replaced by a create, keep the population constant */
+    gen->exit_credit += cfg->exit_rate * (double)gen->count;
+    while (gen->exit_credit >= 1.0 && n + 2 <= capacity && gen->count > 0) {
+        gen->exit_credit -= 1.0;
+        int victim = (int)(next_random(&gen->seed) % (unsigned int)gen->count);
+        make_task_event(gen, &events[n++], EVENT_TASK_EXIT, gen->ids[victim]);
+        if (victim < gen->runnable) {
+            swap_ids(gen, victim, gen->runnable - 1);
+            victim = --gen->runnable;
+        }
+        swap_ids(gen, victim, --gen->count);
+        make_create(cfg, gen, &events[n++]);
+    }
+
+    /* As many tasks wake as block, so the runnable share stays steady */
+    gen->block_credit += cfg->churn * (double)gen->runnable;
+    int blocks = (int)gen->block_credit;
+    gen->block_credit -= (double)blocks;
+    int blocked = gen->count - gen->runnable;
+    int wakes = blocks < blocked ? blocks : blocked;
+    for (int i = 0; i < wakes && n < capacity; i++) {
+        int index = gen->runnable + (int)(next_random(&gen->seed) % (unsigned int)(gen->count - gen->runnable));
+        make_task_event(gen, &events[n++], EVENT_TASK_UNBLOCK, gen->ids[index]);
+        swap_ids(gen, index, gen->runnable++);
+    }
+    for (int i = 0; i < blocks && n < capacity && gen->runnable > 0; i++) {
+        int index = (int)(next_random(&gen->seed) % (unsigned int)gen->runnable);
+        make_task_event(gen, &events[n++], EVENT_TASK_BLOCK, gen->ids[index]);
+        swap_ids(gen, index, --gen->runnable);
+    }
+    return n;
+}
+
+/* ============================================================================
+ * Benchmark Run
+ * ============================================================================ */
+
+static Scheduler *setup_scheduler(const BenchConfig *cfg) {
+    Scheduler *sched = scheduler_init(cfg->cpus, 1);
+    if (!sched || scheduler_reserve(sched, cfg->tasks) < 0) {
+        scheduler_destroy(sched);
+        return NULL;
+    }
+    scheduler_set_metadata(sched, cfg->metadata);
+    if (scheduler_set_policy(sched, cfg->policy) < 0 ||
+        (cfg->policy != SCHED_POLICY_EEVDF && scheduler_set_runqueue(sched, cfg->backend) < 0) ||
+        (cfg->per_cpu && scheduler_enable_per_cpu(sched, 4) < 0) ||
+        scheduler_enable_parallel_tick(sched, cfg->tick_threads) < 0) {
+        scheduler_destroy(sched);
+        return NULL;
+    }
+
+    for (int i = 0; i < cfg->cgroups; i++) {
+        Event event = {0};
+        char cgroup_name[32];
+        event.action = EVENT_CGROUP_CREATE;
+        snprintf(cgroup_name, sizeof(cgroup_name), "cg%d", i);
+        event.cgroup_id = cgroup_name;
+        event.cpu_period_us = DEFAULT_CPU_PERIOD_US;
+        event.has_cpu_period = true;
+        if (cfg->quota > 0.0) {
+            double share = (double)cfg->cpus / (double)cfg->cgroups;
+            event.cpu_quota_us = (int)(cfg->quota * share * DEFAULT_CPU_PERIOD_US);
+            event.has_cpu_quota = true;
+        }
+        if (scheduler_process_event(sched, &event) < 0) {
+            scheduler_destroy(sched);
+            return NULL;
+        }
+    }
+    return sched;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : -1;
+}
+
+static int run_bench(const BenchConfig *cfg) {
+    Generator gen = {0};
+    gen.seed = cfg->seed;
+    gen.ids = malloc(sizeof(int) * (size_t)(cfg->tasks + 1));
+    int event_capacity = cfg->tasks * 2 + 2;
+    gen.masks = malloc(sizeof(int) * (size_t)event_capacity * (size_t)cfg->mask_cpus);
+    gen.names = malloc((size_t)event_capacity * 2 * BENCH_ID_LEN);  /* At most two IDs per event */
+    Event *events = malloc(sizeof(Event) * (size_t)event_capacity);
+    double *frame_ns = malloc(sizeof(double) * (size_t)cfg->ticks);
+    Scheduler *sched = setup_scheduler(cfg);
+    SchedulerTick *tick = sched ? scheduler_tick_create(sched) : NULL;
+    if (!gen.ids || !gen.masks || !gen.names || !events || !frame_ns || !tick) {
+        fprintf(stderr, "bench_scheduler: setup failed\n");
+        free(gen.ids);
+        free(gen.masks);
+        free(gen.names);
+        free(events);
+        free(frame_ns);
+        scheduler_tick_free(tick);
+        scheduler_destroy(sched);
+        return 1;
+    }
+
+    /* Populate (untimed) */
+    long rejected = 0;
+    for (int i = 0; i < cfg->tasks; i++) {
+        gen.mask_used = 0;
+        gen.name_used = 0;
+        make_create(cfg, &gen, &events[0]);
+        rejected += scheduler_process_event(sched, &events[0]) < 0;
+    }
+
+    long total_events = 0;
+    long throttles = 0;
+    uint64_t digest = 14695981039346656037ull;
+    double busy_ns = 0.0;
+    for (int t = 0; t < cfg->ticks; t++) {
+        int count = generate_frame(cfg, &gen, events, event_capacity);
+
+        double start = now_ns();
+        for (int i = 0; i < count; i++) {
+            rejected += scheduler_process_event(sched, &events[i]) < 0;
+        }
+        int rc = scheduler_tick_into(sched, t, tick);
+        frame_ns[t] = now_ns() - start;
+
+        if (rc < 0) {
+            fprintf(stderr, "bench_scheduler: tick %d failed\n", t);
+            rejected++;
+        }
+        busy_ns += frame_ns[t];
+        total_events += count;
+        throttles += tick->meta->throttles;
+
+        /* FNV-1a over the schedules: equal digests mean equal schedules */
+        for (int cpu = 0; cpu < tick->cpu_count; cpu++) {
+            for (const char *c = tick->schedule[cpu]; *c; c++) {
+                digest = (digest ^ (unsigned char)*c) * 1099511628211ull;
+            }
+            digest = (digest ^ '|') * 1099511628211ull;
+        }
+    }
+
+    qsort(frame_ns, (size_t)cfg->ticks, sizeof(double), compare_double);
+    double seconds = busy_ns / 1e9 > 0.0 ? busy_ns / 1e9 : 1e-9;
+
+    printf("{\"bench\":\"scheduler\",\"tasks\":%d,\"cpus\":%d,\"ticks\":%d,"
+           "\"churn\":%g,\"exitRate\":%g,\"affinity\":%g,\"maskCpus\":%d,\"cgroups\":%d,\"quota\":%g,"
+           "\"perCpu\":%s,\"tickThreads\":%d,\"metadata\":%s,\"policy\":\"%s\",\"runqueue\":\"%s\",\"seed\":%u,",
+           cfg->tasks, cfg->cpus, cfg->ticks,
+           cfg->churn, cfg->exit_rate, cfg->affinity, cfg->mask_cpus, cfg->cgroups, cfg->quota,
+           cfg->per_cpu ? "true" : "false", cfg->tick_threads, cfg->metadata ? "true" : "false",
+           scheduler_policy_name(cfg->policy),
+           taskqueue_backend_name(cfg->policy == SCHED_POLICY_EEVDF ? QUEUE_RBTREE_AUG : cfg->backend),
+           cfg->seed);
+    printf("\"events\":%ld,\"rejected\":%ld,\"throttles\":%ld,\"scheduleDigest\":\"%016llx\","
+           "\"frameNs\":{\"p50\":%.0f,\"p99\":%.0f,\"p999\":%.0f,\"max\":%.0f},"
+           "\"eventsPerSec\":%.0f,\"ticksPerSec\":%.0f,\"peakRssKb\":%ld}\n",
+           total_events, rejected, throttles, (unsigned long long)digest,
+           percentile(frame_ns, cfg->ticks, 0.50), percentile(frame_ns, cfg->ticks, 0.99),
+           percentile(frame_ns, cfg->ticks, 0.999), frame_ns[cfg->ticks - 1],
+           (double)total_events / seconds, (double)cfg->ticks / seconds, peak_rss_kb());
+    fflush(stdout);
+
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    free(frame_ns);
+    free(events);
+    free(gen.masks);
+    free(gen.names);
+    free(gen.ids);
+    return rejected > 0 ? 1 : 0;
+}
+
+/* ============================================================================
+ * Command Line
+ * ============================================================================ */
+
+static struct option long_options[] = {
+    {"tasks",       required_argument, 0, 't'},
+    {"cpus",        required_argument, 0, 'c'},
+    {"ticks",       required_argument, 0, 'n'},
+    {"churn",       required_argument, 0, 'u'},
+    {"exit-rate",   required_argument, 0, 'e'},
+    {"affinity",    required_argument, 0, 'a'},
+    {"mask-cpus",   required_argument, 0, 'k'},
+    {"cgroups",     required_argument, 0, 'g'},
+    {"quota",       required_argument, 0, 'Q'},
+    {"per-cpu",     no_argument,       0, 'p'},
+    {"tick-threads", required_argument, 0, 'j'},
+    {"no-metadata", no_argument,       0, 'M'},
+    {"policy",      required_argument, 0, 'S'},
+    {"runqueue",    required_argument, 0, 'R'},
+    {"seed",        required_argument, 0, 's'},
+    {"help",        no_argument,       0, 'h'},
+    {0, 0, 0, 0}
+};
+
+static void print_usage(const char *program_name) {
+    fprintf(stderr, "Usage: %s [options]\n\n", program_name);
+    fprintf(stderr, "  -t, --tasks <num>      Task population (default: 1000)\n");
+    fprintf(stderr, "  -c, --cpus <num>       CPUs, 1-%d (default: 4)\n", MAX_CPUS);
+    fprintf(stderr, "  -n, --ticks <num>      Timeframes to run (default: 2000)\n");
+    fprintf(stderr, "  -u, --churn <rate>     Share of runnable tasks blocking per tick, as many\n");
+    fprintf(stderr, "                         blocked ones wake (default: 0.02)\n");
+    fprintf(stderr, "  -e, --exit-rate <rate> Share of tasks exiting per tick, each replaced by\n");
+    fprintf(stderr, "                         a new task (default: 0.001)\n");
+    fprintf(stderr, "  -a, --affinity <share> Share of tasks created with an affinity mask (default: 0.25)\n");
+    fprintf(stderr, "  -k, --mask-cpus <num>  CPUs in each affinity mask (default: cpus / 4, at least 1)\n");
+    fprintf(stderr, "  -g, --cgroups <num>    Cgroups to spread tasks over (default: 0)\n");
+    fprintf(stderr, "  -Q, --quota <share>    Cgroup quota as a share of its slice of all CPUs;\n");
+    fprintf(stderr, "                         below 1 throttles (default: 0 = unlimited)\n");
+    fprintf(stderr, "  -p, --per-cpu          Per-CPU run queues\n");
+    fprintf(stderr, "  -j, --tick-threads <n> Threads per tick with --per-cpu (default: 1)\n");
+    fprintf(stderr, "  -M, --no-metadata      Skip the runnable/blocked lists\n");
+    fprintf(stderr, "  -S, --policy <name>    cfs or eevdf (default: cfs)\n");
+    fprintf(stderr, "  -R, --runqueue <name>  Run queue backend (default: %s)\n",
+            taskqueue_backend_name(ALFS_RUNQUEUE_DEFAULT));
+    fprintf(stderr, "  -s, --seed <num>       Generator seed (default: 1)\n");
+}
+
+int main(int argc, char *argv[]) {
+    BenchConfig cfg = {
+        .tasks = 1000, .cpus = 4, .ticks = 2000, .churn = 0.02, .exit_rate = 0.001,
+        .affinity = 0.25, .mask_cpus = 0, .cgroups = 0, .quota = 0.0, .per_cpu = false,
+        .tick_threads = 1,
+        .metadata = true, .policy = SCHED_POLICY_CFS, .backend = ALFS_RUNQUEUE_DEFAULT, .seed = 1u,
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:c:n:u:e:a:k:g:Q:pj:MS:R:s:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 't': cfg.tasks = atoi(optarg); break;
+            case 'c': cfg.cpus = atoi(optarg); break;
+            case 'n': cfg.ticks = atoi(optarg); break;
+            case 'u': cfg.churn = atof(optarg); break;
+            case 'e': cfg.exit_rate = atof(optarg); break;
+            case 'a': cfg.affinity = atof(optarg); break;
+            case 'k': cfg.mask_cpus = atoi(optarg); break;
+            case 'g': cfg.cgroups = atoi(optarg); break;
+            case 'Q': cfg.quota = atof(optarg); break;
+            case 'p': cfg.per_cpu = true; break;
+            case 'j': cfg.tick_threads = atoi(optarg); break;
+            case 'M': cfg.metadata = false; break;
+            case 's': cfg.seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'S':
+                if (scheduler_parse_policy(optarg, &cfg.policy) < 0) {
+                    fprintf(stderr, "Error: Invalid policy\n");
+                    return 1;
+                }
+                break;
+            case 'R':
+                if (taskqueue_parse_backend(optarg, &cfg.backend) < 0) {
+                    fprintf(stderr, "Error: Invalid run queue\n");
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (cfg.tasks <= 0 || cfg.cpus <= 0 || cfg.cpus > MAX_CPUS || cfg.ticks <= 0 ||
+        cfg.churn < 0.0 || cfg.churn > 1.0 || cfg.exit_rate < 0.0 || cfg.exit_rate > 1.0 ||
+        cfg.affinity < 0.0 || cfg.affinity > 1.0 || cfg.cgroups < 0 ||
+        cfg.quota < 0.0 || cfg.mask_cpus < 0 || cfg.mask_cpus > cfg.cpus ||
+        cfg.tick_threads < 1 || (cfg.tick_threads > 1 && !cfg.per_cpu)) {
+        fprintf(stderr, "Error: Invalid benchmark configuration\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (cfg.mask_cpus == 0) {
+        cfg.mask_cpus = cfg.cpus / 4 > 0 ? cfg.cpus / 4 : 1;
+    }
+
+    return run_bench(&cfg);
+}
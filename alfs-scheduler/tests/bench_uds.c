@@ -0,0 +1,208 @@
+/**
+ * ALFS - UDS Receive Microbenchmark
+ *
+ * Streams newline-terminated timeframes through a socket pair and
+ * compares the buffered connection reader against the one-byte recv()
+ * loop it replaced, for small and large messages.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "../include/uds.h"
+
+#define STREAM_BYTES (64 * 1024 * 1024)
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/**
+ * Baseline: the old uds_receive_message, one recv() per byte and a
+ * fresh allocation per message
+ */
+static char *bytewise_receive(int sock) {
+    size_t buffer_size = 4096;
+    char *buffer = malloc(buffer_size);
+    if (!buffer) {
+        return NULL;
+    }
+
+    size_t total_received = 0;
+    int brace_count = 0;
+    bool in_string = false;
+    bool found_start = false;
+
+    while (1) {
+        if (total_received >= buffer_size - 1) {
+            buffer_size *= 2;
+            char *new_buffer = realloc(buffer, buffer_size);
+            if (!new_buffer) {
+                free(buffer);
+                return NULL;
+            }
+            buffer = new_buffer;
+        }
+
+        ssize_t n = recv(sock, buffer + total_received, 1, 0);
+        if (n <= 0) {
+            free(buffer);
+            return NULL;
+        }
+
+        char c = buffer[total_received];
+        total_received++;
+
+        if (c == '"' && (total_received < 2 || buffer[total_received - 2] != '\\')) {
+            in_string = !in_string;
+        } else if (!in_string) {
+            if (c == '{') {
+                found_start = true;
+                brace_count++;
+            } else if (c == '}') {
+                brace_count--;
+                if (found_start && brace_count == 0) {
+                    buffer[total_received] = '\0';
+                    return buffer;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Build one newline-terminated timeframe of roughly `size` bytes
+ */
+static char *make_message(size_t size, size_t *length) {
+    char *msg = malloc(size + 256);
+    if (!msg) {
+        return NULL;
+    }
+
+    size_t n = (size_t)sprintf(msg, "{\"vtime\":1,\"events\":[");
+    for (int i = 0; n < size; i++) {
+        n += (size_t)sprintf(msg + n, "%s{\"action\":\"TASK_CREATE\",\"taskId\":\"task-%d\",\"nice\":0}",
+                             i ? "," : "", i);
+    }
+    n += (size_t)sprintf(msg + n, "]}\n");
+    *length = n;
+    return msg;
+}
+
+/**
+ * Fork a writer that streams `count` copies of msg into fd, then closes it
+ */
+static pid_t start_writer(int fd, const char *msg, size_t length, int count) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < count; i++) {
+            if (uds_send(fd, msg, length) < 0) {
+                _exit(1);
+            }
+        }
+        close(fd);
+        _exit(0);
+    }
+    return pid;
+}
+
+static int bench_size(size_t size) {
+    size_t length = 0;
+    char *msg = make_message(size, &length);
+    if (!msg) {
+        return 1;
+    }
+    int count = (int)(STREAM_BYTES / length);
+    if (count > 20000) {
+        count = 20000;
+    }
+    /* The byte-at-a-time baseline gets a smaller stream to keep runs short */
+    int base_count = count / 8 > 0 ? count / 8 : 1;
+
+    int failures = 0;
+    double mb = 1024.0 * 1024.0;
+
+    /* Baseline */
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        free(msg);
+        return 1;
+    }
+    pid_t pid = start_writer(fds[1], msg, length, base_count);
+    close(fds[1]);
+    double start = now_ns();
+    int received = 0;
+    char *in;
+    while ((in = bytewise_receive(fds[0])) != NULL) {
+        received++;
+        free(in);
+    }
+    double base_s = (now_ns() - start) / 1e9;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    if (received != base_count) {
+        failures++;
+    }
+
+    /* Buffered connection */
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        free(msg);
+        return 1;
+    }
+    UdsConn *conn = uds_conn_create(fds[0], UDS_FRAME_NEWLINE);
+    pid = start_writer(fds[1], msg, length, count);
+    close(fds[1]);
+    start = now_ns();
+    received = 0;
+    size_t got = 0;
+    while (uds_conn_receive(conn, &got) != NULL) {
+        if (got + 1 != length) {
+            failures++;
+        }
+        received++;
+    }
+    double conn_s = (now_ns() - start) / 1e9;
+    uds_conn_destroy(conn);
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    if (received != count) {
+        failures++;
+    }
+
+    double base_mbs = (double)length * base_count / mb / base_s;
+    double conn_mbs = (double)length * count / mb / conn_s;
+    printf("  %8zu B msgs: byte recv %8.1f MB/s %9.0f msg/s   buffered %8.1f MB/s %9.0f msg/s  (%.0fx)\n",
+           length, base_mbs, base_count / base_s, conn_mbs, count / conn_s, conn_mbs / base_mbs);
+
+    free(msg);
+    if (failures) {
+        fprintf(stderr, "  %d framing errors\n", failures);
+    }
+    return failures ? 1 : 0;
+}
+
+int main(void) {
+    static const size_t sizes[] = {128, 4096, 256 * 1024};
+
+    printf("Running UDS Receive Benchmark...\n");
+    signal(SIGPIPE, SIG_IGN);
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        failures += bench_size(sizes[i]);
+    }
+
+    return failures;
+}
@@ -0,0 +1,230 @@
+/**
+ * ALFS - Reference JSON Handling (cJSON DOM)
+ *
+ * The cJSON-based parser and serializer that json_handler.c replaced,
+ * kept for the equivalence tests and the benchmarks. Events come back
+ * contiguous like the streaming parser's, but each cpu_mask and ID is its
+ * own allocation; free them with ref_free_timeframe.
+ */
+
+#ifndef JSON_REFERENCE_H
+#define JSON_REFERENCE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/json_handler.h"
+#include "../lib/cJSON/cJSON.h"
+
+static int *ref_parse_int_array(cJSON *array, int *out_count) {
+    int count = cJSON_GetArraySize(array);
+    if (count == 0) {
+        *out_count = 0;
+        return NULL;
+    }
+    
+    int *result = malloc(sizeof(int) * count);
+    if (!result) {
+        *out_count = 0;
+        return NULL;
+    }
+    
+    int idx = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, array) {
+        if (cJSON_IsNumber(item)) {
+            result[idx++] = item->valueint;
+        }
+    }
+    
+    *out_count = idx;
+    return result;
+}
+
+static const char *ref_parse_id(cJSON *event_json, const char *key) {
+    cJSON *id = cJSON_GetObjectItem(event_json, key);
+    return id && cJSON_IsString(id) ? strdup(id->valuestring) : NULL;
+}
+
+static void ref_free_event(Event *event) {
+    free(event->cpu_mask);
+    free((void *)event->task_id);
+    free((void *)event->cgroup_id);
+    free((void *)event->new_cgroup_id);
+    free((void *)event->parent_id);
+}
+
+static int ref_parse_event(cJSON *event_json, Event *event) {
+    memset(event, 0, sizeof(Event));
+    
+    cJSON *action = cJSON_GetObjectItem(event_json, "action");
+    if (!action || !cJSON_IsString(action)) {
+        return -1;
+    }
+    event->action = json_parse_action(action->valuestring);
+    if (event->action == EVENT_INVALID) {
+        return -1;
+    }
+    
+    event->task_id = ref_parse_id(event_json, "taskId");
+    event->cgroup_id = ref_parse_id(event_json, "cgroupId");
+    event->new_cgroup_id = ref_parse_id(event_json, "newCgroupId");
+    event->parent_id = ref_parse_id(event_json, "parentId");
+    
+    cJSON *nice = cJSON_GetObjectItem(event_json, "nice");
+    if (nice && cJSON_IsNumber(nice)) {
+        event->nice = nice->valueint;
+        event->has_nice = true;
+    }
+    cJSON *new_nice = cJSON_GetObjectItem(event_json, "newNice");
+    if (new_nice && cJSON_IsNumber(new_nice)) {
+        event->nice = new_nice->valueint;
+        event->has_nice = true;
+    }
+    
+    cJSON *cpu_mask = cJSON_GetObjectItem(event_json, "cpuMask");
+    if (cpu_mask && cJSON_IsArray(cpu_mask)) {
+        event->cpu_mask = ref_parse_int_array(cpu_mask, &event->cpu_mask_count);
+        event->has_cpu_mask = true;
+    }
+    
+    cJSON *cpu_shares = cJSON_GetObjectItem(event_json, "cpuShares");
+    if (cpu_shares && cJSON_IsNumber(cpu_shares)) {
+        event->cpu_shares = cpu_shares->valueint;
+        event->has_cpu_shares = true;
+    }
+    cJSON *cpu_quota = cJSON_GetObjectItem(event_json, "cpuQuotaUs");
+    if (cpu_quota) {
+        if (cJSON_IsNumber(cpu_quota)) {
+            event->cpu_quota_us = cpu_quota->valueint;
+        } else if (cJSON_IsNull(cpu_quota)) {
+            event->cpu_quota_us = -1;
+        }
+        event->has_cpu_quota = true;
+    }
+    cJSON *cpu_period = cJSON_GetObjectItem(event_json, "cpuPeriodUs");
+    if (cpu_period && cJSON_IsNumber(cpu_period)) {
+        event->cpu_period_us = cpu_period->valueint;
+        event->has_cpu_period = true;
+    }
+    cJSON *duration = cJSON_GetObjectItem(event_json, "duration");
+    if (duration && cJSON_IsNumber(duration)) {
+        event->burst_duration = duration->valueint;
+    }
+    
+    return 0;
+}
+
+static void ref_free_timeframe(TimeFrame *tf) {
+    if (tf) {
+        for (int i = 0; i < tf->event_count; i++) {
+            ref_free_event(&tf->events[i]);
+        }
+        free(tf->events);
+        free(tf);
+    }
+}
+
+static TimeFrame *ref_parse_timeframe(const char *json_str) {
+    cJSON *root = cJSON_Parse(json_str);
+    if (!root) {
+        return NULL;
+    }
+    
+    TimeFrame *tf = calloc(1, sizeof(TimeFrame));
+    if (!tf) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    
+    cJSON *vtime = cJSON_GetObjectItem(root, "vtime");
+    if (vtime && cJSON_IsNumber(vtime)) {
+        tf->vtime = vtime->valueint;
+    }
+    
+    cJSON *events = cJSON_GetObjectItem(root, "events");
+    if (events && cJSON_IsArray(events)) {
+        int event_count = cJSON_GetArraySize(events);
+        tf->events = calloc(event_count > 0 ? event_count : 1, sizeof(Event));
+        if (!tf->events) {
+            free(tf);
+            cJSON_Delete(root);
+            return NULL;
+        }
+        
+        cJSON *event_json;
+        cJSON_ArrayForEach(event_json, events) {
+            Event *event = &tf->events[tf->event_count];
+            if (ref_parse_event(event_json, event) == 0) {
+                tf->event_count++;
+            } else {
+                ref_free_event(event);
+            }
+        }
+    }
+    
+    cJSON_Delete(root);
+    return tf;
+}
+
+static char *ref_serialize_tick(const SchedulerTick *tick, bool include_meta) {
+    if (!tick) {
+        return NULL;
+    }
+    
+    cJSON *root = cJSON_CreateObject();
+    if (!root) {
+        return NULL;
+    }
+    
+    cJSON_AddNumberToObject(root, "vtime", tick->vtime);
+    
+    cJSON *schedule = cJSON_CreateArray();
+    if (!schedule) {
+        cJSON_Delete(root);
+        return NULL;
+    }
+    
+    for (int i = 0; i < tick->cpu_count; i++) {
+        const char *task_id = tick->schedule[i] ? tick->schedule[i] : "idle";
+        cJSON_AddItemToArray(schedule, cJSON_CreateString(task_id));
+    }
+    cJSON_AddItemToObject(root, "schedule", schedule);
+    
+    if (include_meta && tick->meta) {
+        cJSON *meta = cJSON_CreateObject();
+        if (meta) {
+            cJSON_AddNumberToObject(meta, "preemptions", tick->meta->preemptions);
+            cJSON_AddNumberToObject(meta, "migrations", tick->meta->migrations);
+            cJSON_AddNumberToObject(meta, "throttles", tick->meta->throttles);
+            cJSON_AddNumberToObject(meta, "unthrottles", tick->meta->unthrottles);
+            if (tick->meta->has_latency) {
+                cJSON_AddNumberToObject(meta, "wakeups", tick->meta->wakeups);
+                cJSON_AddNumberToObject(meta, "wakeupLatency", tick->meta->wakeup_latency);
+            }
+            
+            cJSON *runnable = cJSON_CreateArray();
+            for (int i = 0; i < tick->meta->runnable_count; i++) {
+                cJSON_AddItemToArray(runnable, 
+                    cJSON_CreateString(tick->meta->runnable_tasks[i]));
+            }
+            cJSON_AddItemToObject(meta, "runnableTasks", runnable);
+            
+            cJSON *blocked = cJSON_CreateArray();
+            for (int i = 0; i < tick->meta->blocked_count; i++) {
+                cJSON_AddItemToArray(blocked, 
+                    cJSON_CreateString(tick->meta->blocked_tasks[i]));
+            }
+            cJSON_AddItemToObject(meta, "blockedTasks", blocked);
+            
+            cJSON_AddItemToObject(root, "meta", meta);
+        }
+    }
+    
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    
+    return json_str;
+}
+
+#endif /* JSON_REFERENCE_H */
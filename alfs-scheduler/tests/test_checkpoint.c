@@ -0,0 +1,386 @@
+/**
+ * ALFS - Checkpoint Unit Tests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/checkpoint.h"
+#include "../include/scheduler.h"
+
+#define TEST_PASS() printf("  [PASS] %s\n", __func__)
+#define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+typedef struct {
+    const char *name;
+    int cpus;
+    bool per_cpu;
+    SchedPolicy policy;
+    QueueBackend backend;
+    const int *capacity;            /* NULL = uniform */
+} TestConfig;
+
+static const int asym_capacity[] = {1024, 1024, 512, 256};
+
+static const TestConfig configs[] = {
+    {"global heap", 3, false, SCHED_POLICY_CFS, QUEUE_HEAP, NULL},
+    {"global pairing", 3, false, SCHED_POLICY_CFS, QUEUE_PAIRING, NULL},
+    {"per-CPU heap4", 3, true, SCHED_POLICY_CFS, QUEUE_HEAP4, NULL},
+    {"per-CPU EEVDF", 3, true, SCHED_POLICY_EEVDF, QUEUE_RBTREE_AUG, NULL},
+    {"asymmetric rbtree", 4, true, SCHED_POLICY_CFS, QUEUE_RBTREE, asym_capacity},
+};
+
+static char snapshot_path[64];
+
+static Scheduler *make_scheduler(const TestConfig *cfg) {
+    Scheduler *sched = scheduler_init(cfg->cpus, 1);
+    scheduler_set_metadata(sched, true);
+    scheduler_set_policy(sched, cfg->policy);
+    scheduler_set_runqueue(sched, cfg->backend);
+    if (cfg->capacity) {
+        scheduler_set_capacity(sched, cfg->capacity, cfg->cpus);
+    }
+    if (cfg->per_cpu) {
+        scheduler_enable_per_cpu(sched, 2);
+    }
+    return sched;
+}
+
+static uint64_t fold(uint64_t digest, const char *s) {
+    for (; *s; s++) {
+        digest = (digest ^ (unsigned char)*s) * 1099511628211ull;
+    }
+    return (digest ^ '|') * 1099511628211ull;
+}
+
+/**
+ * One timeframe of random churn over nested cgroups with quotas, bursts
+ * and IDs of varying length, folded into the returned tick digest
+ */
+static uint64_t churn_frame(Scheduler *sched, unsigned int *seed, int vtime) {
+    static const EventAction actions[] = {
+        EVENT_TASK_CREATE, EVENT_TASK_CREATE, EVENT_TASK_BLOCK, EVENT_TASK_UNBLOCK,
+        EVENT_TASK_YIELD, EVENT_TASK_EXIT, EVENT_TASK_SETNICE, EVENT_TASK_SET_AFFINITY,
+        EVENT_TASK_MOVE_CGROUP, EVENT_CGROUP_CREATE, EVENT_CGROUP_MODIFY,
+        EVENT_CGROUP_DELETE, EVENT_CPU_BURST
+    };
+    for (int e = 0; e < 6; e++) {
+        *seed = *seed * 1103515245u + 12345u;
+        unsigned int s = *seed;
+        int mask[2] = {(int)((s >> 3) % (unsigned)sched->cpu_count),
+                       (int)((s >> 5) % (unsigned)sched->cpu_count)};
+        char task_name[64];
+        char cgroup_name[32];
+        char other_name[32];
+        Event event = {0};
+        event.action = actions[(s >> 8) % 13];
+        snprintf(task_name, sizeof(task_name), "task-%u%s", (s >> 16) % 24,
+                 (s >> 16) % 5 == 0 ? "-with-a-much-longer-identifier" : "");
+        snprintf(cgroup_name, sizeof(cgroup_name), "G%u", (s >> 20) % 5);
+        snprintf(other_name, sizeof(other_name), "G%u", (s >> 23) % 5);
+        event.task_id = task_name;
+        event.cgroup_id = cgroup_name;
+        event.new_cgroup_id = other_name;
+        event.parent_id = (s >> 26) % 2 ? other_name : NULL;
+        event.nice = (int)((s >> 4) % 40) - 20;
+        event.cpu_mask = mask;
+        event.cpu_mask_count = 1 + (int)((s >> 12) % 2);
+        event.has_cpu_mask = (s >> 14) % 3 == 0;
+        event.cpu_shares = 512 + (int)((s >> 9) % 1024);
+        event.has_cpu_shares = (s >> 13) % 2;
+        event.cpu_quota_us = 1000 + (int)((s >> 10) % 4000);
+        event.has_cpu_quota = (s >> 15) % 2;
+        event.cpu_period_us = 5000 + (int)((s >> 17) % 3) * 5000;
+        event.has_cpu_period = (s >> 19) % 2;
+        event.burst_duration = 1 + (int)((s >> 11) % 4);
+        scheduler_process_event(sched, &event);
+    }
+
+    SchedulerTick *tick = scheduler_tick(sched, vtime);
+    uint64_t digest = 14695981039346656037ull;
+    for (int cpu = 0; cpu < tick->cpu_count; cpu++) {
+        digest = fold(digest, tick->schedule[cpu]);
+    }
+    const SchedulerMeta *meta = tick->meta;
+    digest = (digest ^ (uint64_t)meta->preemptions) * 1099511628211ull;
+    digest = (digest ^ (uint64_t)meta->migrations) * 1099511628211ull;
+    digest = (digest ^ (uint64_t)meta->throttles) * 1099511628211ull;
+    digest = (digest ^ (uint64_t)meta->unthrottles) * 1099511628211ull;
+    for (int i = 0; i < meta->runnable_count; i++) {
+        digest = fold(digest, meta->runnable_tasks[i]);
+    }
+    for (int i = 0; i < meta->blocked_count; i++) {
+        digest = fold(digest, meta->blocked_tasks[i]);
+    }
+    scheduler_tick_free(tick);
+    return digest;
+}
+
+/* Run both schedulers through the same frames; 0 if every tick matches */
+static int run_lockstep(Scheduler *a, Scheduler *b, unsigned int seed, int from, int frames) {
+    unsigned int seed_b = seed;
+    for (int vtime = from; vtime < from + frames; vtime++) {
+        if (churn_frame(a, &seed, vtime) != churn_frame(b, &seed_b, vtime) ||
+            scheduler_validate(a) != 0 || scheduler_validate(b) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/* A scheduler that has run `frames` frames of churn from seed 11 */
+static Scheduler *churned_scheduler(const TestConfig *cfg, int frames, unsigned int *seed) {
+    Scheduler *sched = make_scheduler(cfg);
+    *seed = 11u;
+    for (int vtime = 0; vtime < frames; vtime++) {
+        churn_frame(sched, seed, vtime);
+    }
+    return sched;
+}
+
+static long file_size(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+/* Overwrite one byte, or cut the file at `offset` when truncate is set */
+static int damage_file(const char *path, long offset, bool truncate_file) {
+    if (truncate_file) {
+        return truncate(path, offset);
+    }
+    FILE *f = fopen(path, "r+b");
+    if (!f) {
+        return -1;
+    }
+    fseek(f, offset, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, offset, SEEK_SET);
+    fputc(c ^ 0x40, f);
+    fclose(f);
+    return 0;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+/**
+ * Test a restored scheduler ticks exactly like the one that was saved,
+ * for every run queue layout
+ */
+static int test_round_trip(void) {
+    static const int splits[] = {60, 150, 240};
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        for (size_t k = 0; k < sizeof(splits) / sizeof(splits[0]); k++) {
+            const TestConfig *cfg = &configs[c];
+            unsigned int seed;
+            Scheduler *original = churned_scheduler(cfg, splits[k], &seed);
+            if (checkpoint_save(original, snapshot_path) != 0) TEST_FAIL("Save failed");
+
+            Scheduler *restored = make_scheduler(cfg);
+            if (checkpoint_load(restored, snapshot_path) != 0) {
+                printf("    config: %s at frame %d\n", cfg->name, splits[k]);
+                TEST_FAIL("Load failed");
+            }
+            if (restored->task_count != original->task_count ||
+                restored->cgroup_count != original->cgroup_count ||
+                restored->current_vtime != original->current_vtime) {
+                TEST_FAIL("Restored scheduler has different contents");
+            }
+            if (run_lockstep(original, restored, seed, splits[k], 100) != 0) {
+                printf("    config: %s at frame %d\n", cfg->name, splits[k]);
+                TEST_FAIL("Restored scheduler diverged");
+            }
+            scheduler_destroy(original);
+            scheduler_destroy(restored);
+        }
+    }
+
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test saving is deterministic: a restored scheduler writes the same bytes
+ */
+static int test_snapshot_stable(void) {
+    unsigned int seed;
+    Scheduler *original = churned_scheduler(&configs[2], 120, &seed);
+    char second_path[80];
+    snprintf(second_path, sizeof(second_path), "%s.2", snapshot_path);
+    if (checkpoint_save(original, snapshot_path) != 0) TEST_FAIL("Save failed");
+
+    Scheduler *restored = make_scheduler(&configs[2]);
+    if (checkpoint_load(restored, snapshot_path) != 0) TEST_FAIL("Load failed");
+    if (checkpoint_save(restored, second_path) != 0) TEST_FAIL("Second save failed");
+
+    FILE *a = fopen(snapshot_path, "rb");
+    FILE *b = fopen(second_path, "rb");
+    int same = a && b;
+    while (same) {
+        int ca = fgetc(a);
+        int cb = fgetc(b);
+        same = ca == cb;
+        if (ca == EOF) {
+            break;
+        }
+    }
+    if (a) fclose(a);
+    if (b) fclose(b);
+    unlink(second_path);
+    if (!same) TEST_FAIL("Snapshot of the restored scheduler differs");
+
+    scheduler_destroy(original);
+    scheduler_destroy(restored);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test snapshots are refused by another configuration, when damaged or
+ * into a scheduler that already holds tasks
+ */
+static int test_load_rejects(void) {
+    unsigned int seed;
+    Scheduler *original = churned_scheduler(&configs[0], 80, &seed);
+    if (checkpoint_save(original, snapshot_path) != 0) TEST_FAIL("Save failed");
+
+    TestConfig other = configs[0];
+    other.cpus = 4;
+    Scheduler *sched = make_scheduler(&other);
+    if (checkpoint_load(sched, snapshot_path) == 0) TEST_FAIL("CPU count mismatch accepted");
+    if (sched->task_count != 0) TEST_FAIL("Rejected snapshot changed the scheduler");
+    scheduler_destroy(sched);
+
+    other = configs[0];
+    other.backend = QUEUE_RBTREE;
+    sched = make_scheduler(&other);
+    if (checkpoint_load(sched, snapshot_path) == 0) TEST_FAIL("Backend mismatch accepted");
+    scheduler_destroy(sched);
+
+    sched = make_scheduler(&configs[0]);
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "existing";
+    scheduler_process_event(sched, &create);
+    if (checkpoint_load(sched, snapshot_path) == 0) TEST_FAIL("Non-empty scheduler accepted");
+    scheduler_destroy(sched);
+
+    long size = file_size(snapshot_path);
+    if (damage_file(snapshot_path, size / 2, false) != 0) TEST_FAIL("Cannot damage snapshot");
+    sched = make_scheduler(&configs[0]);
+    if (checkpoint_load(sched, snapshot_path) == 0) TEST_FAIL("Corrupt snapshot accepted");
+    scheduler_destroy(sched);
+
+    checkpoint_save(original, snapshot_path);
+    if (damage_file(snapshot_path, size - 3, true) != 0) TEST_FAIL("Cannot truncate snapshot");
+    sched = make_scheduler(&configs[0]);
+    if (checkpoint_load(sched, snapshot_path) == 0) TEST_FAIL("Truncated snapshot accepted");
+    scheduler_destroy(sched);
+
+    unlink(snapshot_path);
+    sched = make_scheduler(&configs[0]);
+    errno = 0;
+    if (checkpoint_load(sched, snapshot_path) == 0 || errno != ENOENT) {
+        TEST_FAIL("Missing snapshot should fail with ENOENT");
+    }
+    scheduler_destroy(sched);
+
+    scheduler_destroy(original);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test a requested snapshot is written by a child from the state at the
+ * request, while the parent keeps ticking
+ */
+static int test_forked_writer(void) {
+    const TestConfig *cfg = &configs[3];
+    unsigned int seed;
+    unsigned int reference_seed;
+    Scheduler *sched = churned_scheduler(cfg, 100, &seed);
+    Scheduler *reference = churned_scheduler(cfg, 100, &reference_seed);
+    if (scheduler_enable_checkpoint(sched, snapshot_path, 0) != 0) TEST_FAIL("Enable failed");
+    Checkpointer *cp = sched->checkpoint;
+
+    checkpoint_poll(cp, sched);
+    if (cp->writer != 0) TEST_FAIL("Interval 0 should only write on request");
+    checkpoint_request();
+    checkpoint_poll(cp, sched);
+    if (cp->writer == 0) TEST_FAIL("Request should fork a writer");
+
+    /* Keep ticking while the child writes the state as of the request */
+    for (int vtime = 100; vtime < 150; vtime++) {
+        churn_frame(sched, &seed, vtime);
+    }
+    for (int tries = 0; cp->written == 0 && cp->failed == 0 && tries < 5000; tries++) {
+        struct timespec pause = {0, 1000000};
+        nanosleep(&pause, NULL);
+        checkpoint_poll(cp, sched);
+    }
+    if (cp->written != 1 || cp->failed != 0 || cp->writer != 0) TEST_FAIL("Writer did not finish");
+
+    Scheduler *restored = make_scheduler(cfg);
+    if (checkpoint_load(restored, snapshot_path) != 0) TEST_FAIL("Load of forked snapshot failed");
+    if (run_lockstep(reference, restored, reference_seed, 100, 100) != 0) {
+        TEST_FAIL("Forked snapshot does not match the state at the request");
+    }
+
+    /* Periodic snapshots, then the synchronous one at shutdown */
+    if (scheduler_enable_checkpoint(sched, snapshot_path, 3) != 0) TEST_FAIL("Enable failed");
+    cp = sched->checkpoint;
+    for (int frame = 0; frame < 9; frame++) {
+        checkpoint_poll(cp, sched);
+    }
+    if (checkpoint_flush(cp, sched) != 0 || cp->writer != 0) TEST_FAIL("Flush failed");
+    if (cp->written < 2 || cp->failed != 0) TEST_FAIL("Periodic snapshots were not written");
+
+    scheduler_destroy(sched);
+    scheduler_destroy(reference);
+    scheduler_destroy(restored);
+    unlink(snapshot_path);
+    TEST_PASS();
+    return 0;
+}
+
+/* ============================================================================
+ * Main
+ * ============================================================================ */
+
+int main(void) {
+    printf("Running Checkpoint Tests...\n");
+    snprintf(snapshot_path, sizeof(snapshot_path), "/tmp/alfs_checkpoint_%d.snap", (int)getpid());
+
+    int failures = 0;
+
+    failures += test_round_trip();
+    failures += test_snapshot_stable();
+    failures += test_load_rejects();
+    failures += test_forked_writer();
+
+    unlink(snapshot_path);
+    printf("\n");
+    if (failures == 0) {
+        printf("All checkpoint tests passed!\n");
+    } else {
+        printf("%d test(s) failed.\n", failures);
+    }
+
+    return failures;
+}
@@ -0,0 +1,497 @@
+/**
+ * ALFS - Binary Wire Protocol Unit Tests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../include/codec.h"
+#include "../include/binary_codec.h"
+#include "../include/json_handler.h"
+#include "../include/scheduler.h"
+#include "../include/uds.h"
+
+#define TEST_PASS() printf("  [PASS] %s\n", __func__)
+#define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
+
+/* ============================================================================
+ * Frame Builder
+ * ============================================================================ */
+
+/**
+ * Writes a TIMEFRAME the way the test server does: definitions, records,
+ * then the CPU masks of every event
+ */
+typedef struct {
+    unsigned char data[4096];
+    size_t length;
+    unsigned char masks[512];
+    size_t mask_length;
+    int defines;
+    int events;
+} Frame;
+
+static void put_le(unsigned char *p, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static void frame_begin(Frame *f, int vtime) {
+    memset(f, 0, sizeof(*f));
+    f->data[0] = BINARY_MSG_TIMEFRAME;
+    put_le(f->data + 4, (uint32_t)vtime, 4);
+    f->length = BINARY_FRAME_HEADER_SIZE;
+}
+
+/* Definitions must all come before the first event */
+static void frame_define(Frame *f, uint32_t handle, const char *name) {
+    size_t len = strlen(name);
+    put_le(f->data + f->length, handle, 4);
+    put_le(f->data + f->length + 4, (uint32_t)len, 2);
+    memcpy(f->data + f->length + 6, name, len);
+    f->length += 6 + len;
+    f->defines++;
+}
+
+static void frame_event(Frame *f, EventAction action, unsigned flags,
+                        uint32_t task, uint32_t cgroup, uint32_t new_cgroup,
+                        const int values[5], const int *mask, int mask_count) {
+    unsigned char *r = f->data + f->length;
+    memset(r, 0, BINARY_EVENT_SIZE);
+    r[0] = (unsigned char)action;
+    r[1] = (unsigned char)flags;
+    put_le(r + 2, (uint32_t)mask_count, 2);
+    put_le(r + 4, task, 4);
+    put_le(r + 8, cgroup, 4);
+    put_le(r + 12, new_cgroup, 4);
+    for (int i = 0; values && i < 5; i++) {
+        put_le(r + 16 + 4 * i, (uint32_t)values[i], 4);
+    }
+    for (int i = 0; i < mask_count; i++) {
+        put_le(f->masks + f->mask_length, (uint32_t)mask[i], 2);
+        f->mask_length += 2;
+    }
+    f->length += BINARY_EVENT_SIZE;
+    f->events++;
+}
+
+static const char *frame_end(Frame *f) {
+    put_le(f->data + 2, (uint32_t)f->defines, 2);
+    put_le(f->data + 8, (uint32_t)f->events, 4);
+    memcpy(f->data + f->length, f->masks, f->mask_length);
+    f->length += f->mask_length;
+    return (const char *)f->data;
+}
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static int quiet_stderr(void) {
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDERR_FILENO);
+    close(devnull);
+    return saved;
+}
+
+static void restore_stderr(int saved) {
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+}
+
+static bool same_id(const char *a, const char *b) {
+    return a && b ? strcmp(a, b) == 0 : a == b;
+}
+
+static uint32_t get_le(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Check every handle in a TICK names the ID the JSON tick lists there
+ * (for a delta tick: the changed CPUs and the removed tasks)
+ */
+static bool tick_matches(const unsigned char *msg, size_t length, const SchedulerTick *tick,
+                         const char **names) {
+    const SchedulerMeta *meta = tick->meta;
+    size_t latency = meta->has_latency ? 8 : 0;
+    size_t cpus = tick->delta ? 4 + 8 * (size_t)tick->changed_count : 4 * (size_t)tick->cpu_count;
+    size_t removed = tick->delta ? 4 + 4 * (size_t)meta->removed_count : 0;
+    size_t expected = BINARY_TICK_HEADER_SIZE + cpus + 24 + latency + removed +
+                      4 * (size_t)(meta->runnable_count + meta->blocked_count);
+    unsigned flags = BINARY_TICK_META | (meta->has_latency ? BINARY_TICK_LATENCY : 0) |
+                     (tick->delta ? BINARY_TICK_DELTA : 0);
+    if (length != expected || msg[0] != BINARY_MSG_TICK || msg[1] != flags ||
+        (int)get_le(msg + 4) != tick->vtime) {
+        return false;
+    }
+    const unsigned char *p = msg + BINARY_TICK_HEADER_SIZE;
+    int count = tick->cpu_count;
+    if (tick->delta) {
+        count = (int)get_le(p);
+        p += 4;
+    }
+    for (int i = 0; i < count; i++) {
+        int cpu = i;
+        if (tick->delta) {
+            cpu = (int)get_le(p);
+            if (cpu != tick->changed_cpus[i]) {
+                return false;
+            }
+            p += 4;
+        }
+        uint32_t handle = get_le(p);
+        const char *name = handle ? names[handle] : "idle";
+        if (strcmp(name, tick->schedule[cpu]) != 0) {
+            return false;
+        }
+        p += 4;
+    }
+    if ((int)get_le(p) != meta->preemptions || (int)get_le(p + 4) != meta->migrations ||
+        (int)get_le(p + 16) != meta->runnable_count || (int)get_le(p + 20) != meta->blocked_count) {
+        return false;
+    }
+    p += 24;
+    if (tick->delta) {
+        if ((int)get_le(p) != meta->removed_count) {
+            return false;
+        }
+        p += 4;
+    }
+    if (meta->has_latency) {
+        if ((int)get_le(p) != meta->wakeups || (int)get_le(p + 4) != meta->wakeup_latency) {
+            return false;
+        }
+        p += 8;
+    }
+    for (int i = 0; i < meta->runnable_count; i++, p += 4) {
+        if (strcmp(names[get_le(p)], meta->runnable_tasks[i]) != 0) {
+            return false;
+        }
+    }
+    for (int i = 0; i < meta->blocked_count; i++, p += 4) {
+        if (strcmp(names[get_le(p)], meta->blocked_tasks[i]) != 0) {
+            return false;
+        }
+    }
+    for (int i = 0; tick->delta && i < meta->removed_count; i++, p += 4) {
+        if (strcmp(names[get_le(p)], meta->removed_tasks[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+/**
+ * Test a binary frame decodes to the same events as its JSON form
+ */
+static int test_decode_matches_json(void) {
+    Frame f;
+    frame_begin(&f, 7);
+    frame_define(&f, 1, "task-a");
+    frame_define(&f, 2, "web");
+    frame_define(&f, 3, "batch");
+    frame_define(&f, 4, "web-api");
+    const int create[5] = {-5, 0, 0, 0, 0};
+    const int modify[5] = {0, 512, -1, 100000, 0};
+    const int burst[5] = {0, 0, 0, 0, 3};
+    const int mask[3] = {0, 2, 3};
+    frame_event(&f, EVENT_TASK_CREATE, BINARY_HAS_NICE | BINARY_HAS_CPU_MASK, 1, 2, 0, create, mask, 3);
+    frame_event(&f, EVENT_CGROUP_MODIFY,
+                BINARY_HAS_CPU_SHARES | BINARY_HAS_CPU_QUOTA | BINARY_HAS_CPU_PERIOD, 0, 2, 0, modify, NULL, 0);
+    frame_event(&f, EVENT_TASK_MOVE_CGROUP, 0, 1, 0, 3, NULL, NULL, 0);
+    frame_event(&f, EVENT_CPU_BURST, BINARY_HAS_CPU_MASK, 1, 0, 0, burst, mask + 1, 1);
+    frame_event(&f, EVENT_CGROUP_CREATE, 0, 0, 4, 2, NULL, NULL, 0);
+    const char *message = frame_end(&f);
+
+    const char *json =
+        "{\"vtime\": 7, \"events\": ["
+        "{\"action\": \"TASK_CREATE\", \"taskId\": \"task-a\", \"nice\": -5, \"cgroupId\": \"web\", \"cpuMask\": [0, 2, 3]},"
+        "{\"action\": \"CGROUP_MODIFY\", \"cgroupId\": \"web\", \"cpuShares\": 512, \"cpuQuotaUs\": null, \"cpuPeriodUs\": 100000},"
+        "{\"action\": \"TASK_MOVE_CGROUP\", \"taskId\": \"task-a\", \"newCgroupId\": \"batch\"},"
+        "{\"action\": \"CPU_BURST\", \"taskId\": \"task-a\", \"duration\": 3, \"cpuMask\": [2]},"
+        "{\"action\": \"CGROUP_CREATE\", \"cgroupId\": \"web-api\", \"parentId\": \"web\"}]}";
+
+    Codec *codec = codec_create(WIRE_BINARY);
+    TimeFrame *tf = json_timeframe_create();
+    TimeFrame *ref = json_parse_timeframe(json);
+    if (!codec || !tf || !ref) TEST_FAIL("Setup failed");
+    if (codec_decode(codec, message, f.length, tf) < 0) TEST_FAIL("Decode failed");
+
+    if (tf->vtime != ref->vtime || tf->event_count != ref->event_count) TEST_FAIL("Header mismatch");
+    for (int i = 0; i < tf->event_count; i++) {
+        const Event *x = &tf->events[i];
+        const Event *y = &ref->events[i];
+        if (x->action != y->action || !same_id(x->task_id, y->task_id) ||
+            !same_id(x->cgroup_id, y->cgroup_id) || !same_id(x->new_cgroup_id, y->new_cgroup_id) ||
+            !same_id(x->parent_id, y->parent_id) ||
+            x->has_nice != y->has_nice || (x->has_nice && x->nice != y->nice) ||
+            x->has_cpu_shares != y->has_cpu_shares || x->cpu_shares != y->cpu_shares ||
+            x->has_cpu_quota != y->has_cpu_quota || x->cpu_quota_us != y->cpu_quota_us ||
+            x->has_cpu_period != y->has_cpu_period || x->cpu_period_us != y->cpu_period_us ||
+            x->burst_duration != y->burst_duration ||
+            x->has_cpu_mask != y->has_cpu_mask || x->cpu_mask_count != y->cpu_mask_count) {
+            TEST_FAIL("Event differs from JSON decode");
+        }
+        for (int m = 0; m < x->cpu_mask_count; m++) {
+            if (x->cpu_mask[m] != y->cpu_mask[m]) TEST_FAIL("CPU mask differs");
+        }
+    }
+    if (tf->events[0].task_handle != 1 || tf->events[1].task_handle != 0) TEST_FAIL("Task handle not kept");
+
+    /* Handles stay defined for later frames */
+    frame_begin(&f, 8);
+    frame_event(&f, EVENT_TASK_BLOCK, 0, 1, 0, 0, NULL, NULL, 0);
+    message = frame_end(&f);
+    if (codec_decode(codec, message, f.length, tf) < 0) TEST_FAIL("Decode with known handle failed");
+    if (tf->event_count != 1 || strcmp(tf->events[0].task_id, "task-a") != 0) TEST_FAIL("Handle not resolved");
+
+    json_free_timeframe(ref);
+    json_free_timeframe(tf);
+    codec_destroy(codec);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run the frames of test_ticks_match_json, optionally with delta ticks
+ */
+static int ticks_match_json(int delta_interval) {
+    static const char *names[] = {NULL, "t0", "t1", "t2", "t3", "t4", "t5"};
+    Codec *codec = codec_create(WIRE_BINARY);
+    TimeFrame *tf = json_timeframe_create();
+    Scheduler *sched = scheduler_init(2, 1);
+    scheduler_set_metadata(sched, true);
+    if (delta_interval > 0) {
+        scheduler_set_delta(sched, delta_interval);
+    }
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    OutputBuffer out = {0};
+    if (!codec || !tf || !sched || !tick) TEST_FAIL("Setup failed");
+
+    Frame f;
+    for (int vtime = 0; vtime < 15; vtime++) {
+        frame_begin(&f, vtime);
+        if (vtime < 6) {
+            const int nice[5] = {vtime - 3, 0, 0, 0, 0};
+            frame_define(&f, (uint32_t)vtime + 1, names[vtime + 1]);
+            frame_event(&f, EVENT_TASK_CREATE, BINARY_HAS_NICE, (uint32_t)vtime + 1, 0, 0, nice, NULL, 0);
+        } else if (vtime == 7) {
+            frame_event(&f, EVENT_TASK_BLOCK, 0, 2, 0, 0, NULL, NULL, 0);
+        } else if (vtime == 9) {
+            frame_event(&f, EVENT_TASK_EXIT, 0, 3, 0, 0, NULL, NULL, 0);
+        }
+        const char *message = frame_end(&f);
+        if (codec_decode(codec, message, f.length, tf) < 0) TEST_FAIL("Decode failed");
+        for (int i = 0; i < tf->event_count; i++) {
+            scheduler_process_event(sched, &tf->events[i]);
+        }
+        scheduler_set_latency(sched, vtime % 2 == 1);
+        if (scheduler_tick_into(sched, tf->vtime, tick) < 0) TEST_FAIL("Tick failed");
+        if (codec_encode(codec, tick, true, &out) < 0) TEST_FAIL("Encode failed");
+        if (!tick_matches((unsigned char *)out.data + OUTPUT_HEADROOM, out.length, tick, names)) {
+            TEST_FAIL("Binary tick differs from JSON tick");
+        }
+    }
+    if (delta_interval == 0 && !out.lists_ready) TEST_FAIL("Unchanged lists should be cached");
+
+    /* Without metadata only the per-CPU handles are sent */
+    if (delta_interval == 0) {
+        if (codec_encode(codec, tick, false, &out) < 0) TEST_FAIL("Encode failed");
+        if (out.length != BINARY_TICK_HEADER_SIZE + 4 * 2 || out.data[OUTPUT_HEADROOM + 1] != 0) {
+            TEST_FAIL("Plain tick has wrong layout");
+        }
+    } else if (!tick->delta) {
+        TEST_FAIL("Expected a delta tick");
+    }
+
+    json_output_free(&out);
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    json_free_timeframe(tf);
+    codec_destroy(codec);
+    return 0;
+}
+
+/**
+ * Test binary ticks name the same tasks as JSON ticks, frame by frame
+ */
+static int test_ticks_match_json(void) {
+    if (ticks_match_json(0) != 0) return 1;
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test delta ticks list the changed CPUs and removed tasks by handle
+ */
+static int test_delta_ticks_match_json(void) {
+    if (ticks_match_json(5) != 0) return 1;
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test malformed frames are rejected and leave the TimeFrame empty
+ */
+static int test_malformed_frames(void) {
+    Codec *codec = codec_create(WIRE_BINARY);
+    TimeFrame *tf = json_timeframe_create();
+    if (!codec || !tf) TEST_FAIL("Setup failed");
+    int saved = quiet_stderr();
+    int failures = 0;
+
+    Frame f;
+    frame_begin(&f, 1);
+    frame_define(&f, 1, "a");
+    const int mask[2] = {0, 1};
+    frame_event(&f, EVENT_TASK_CREATE, BINARY_HAS_CPU_MASK, 1, 0, 0, NULL, mask, 2);
+    const char *message = frame_end(&f);
+
+    /* Every truncation, including inside the mask region */
+    for (size_t cut = 0; cut < f.length; cut++) {
+        if (codec_decode(codec, message, cut, tf) != -1 || tf->event_count != 0) {
+            failures++;
+        }
+    }
+    /* Trailing bytes */
+    if (codec_decode(codec, message, f.length + 1, tf) != -1) {
+        failures++;
+    }
+    if (codec_decode(codec, message, f.length, tf) != 0 || tf->event_count != 1) {
+        failures++;
+    }
+
+    /* Undefined handle, redefined handle, reserved handle 0 */
+    frame_begin(&f, 2);
+    frame_event(&f, EVENT_TASK_BLOCK, 0, 9, 0, 0, NULL, NULL, 0);
+    message = frame_end(&f);
+    if (codec_decode(codec, message, f.length, tf) != -1) {
+        failures++;
+    }
+    frame_begin(&f, 3);
+    frame_define(&f, 1, "b");
+    message = frame_end(&f);
+    if (codec_decode(codec, message, f.length, tf) != -1) {
+        failures++;
+    }
+    frame_begin(&f, 4);
+    frame_define(&f, 0, "c");
+    message = frame_end(&f);
+    if (codec_decode(codec, message, f.length, tf) != -1) {
+        failures++;
+    }
+
+    /* A repeated definition is fine; an unknown action is only dropped */
+    frame_begin(&f, 5);
+    frame_define(&f, 1, "a");
+    frame_event(&f, (EventAction)200, 0, 1, 0, 0, NULL, NULL, 0);
+    frame_event(&f, EVENT_TASK_YIELD, 0, 1, 0, 0, NULL, NULL, 0);
+    message = frame_end(&f);
+    if (codec_decode(codec, message, f.length, tf) != 0 || tf->event_count != 1 ||
+        tf->events[0].action != EVENT_TASK_YIELD) {
+        failures++;
+    }
+
+    restore_stderr(saved);
+    json_free_timeframe(tf);
+    codec_destroy(codec);
+    if (failures) TEST_FAIL("Malformed frame accepted");
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test the HELLO exchange over a socket pair
+ */
+static int test_handshake(void) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) TEST_FAIL("socketpair failed");
+    UdsConn *conn = uds_conn_create(fds[0], UDS_FRAME_LENGTH);
+    Codec *codec = codec_create(WIRE_BINARY);
+    if (!conn || !codec) TEST_FAIL("Setup failed");
+
+    /* The peer's reply can be queued before the scheduler asks */
+    const unsigned char reply[] = {0, 0, 0, 4, BINARY_MSG_HELLO, BINARY_VERSION, 0, 0};
+    if (send(fds[1], reply, sizeof(reply), 0) != (ssize_t)sizeof(reply)) TEST_FAIL("send failed");
+    if (codec_handshake(codec, conn, 6) != 0) TEST_FAIL("Handshake failed");
+
+    unsigned char hello[8];
+    if (recv(fds[1], hello, sizeof(hello), MSG_WAITALL) != (ssize_t)sizeof(hello)) TEST_FAIL("No HELLO sent");
+    const unsigned char expected[] = {0, 0, 0, 4, BINARY_MSG_HELLO, BINARY_VERSION, 6, 0};
+    if (memcmp(hello, expected, sizeof(expected)) != 0) TEST_FAIL("HELLO has wrong layout");
+
+    /* A peer on another version is refused */
+    const unsigned char wrong[] = {0, 0, 0, 4, BINARY_MSG_HELLO, BINARY_VERSION + 1, 0, 0};
+    if (send(fds[1], wrong, sizeof(wrong), 0) != (ssize_t)sizeof(wrong)) TEST_FAIL("send failed");
+    int saved = quiet_stderr();
+    int rc = codec_handshake(codec, conn, 6);
+    restore_stderr(saved);
+    if (rc != -1) TEST_FAIL("Version mismatch accepted");
+
+    /* JSON has nothing to negotiate */
+    Codec *json = codec_create(WIRE_JSON);
+    if (codec_handshake(json, conn, 6) != 0) TEST_FAIL("JSON handshake should be a no-op");
+
+    codec_destroy(json);
+    codec_destroy(codec);
+    uds_conn_destroy(conn);
+    close(fds[0]);
+    close(fds[1]);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test protocol names and the framing they imply
+ */
+static int test_parse_protocol(void) {
+    WireProtocol protocol = WIRE_BINARY;
+    if (codec_parse_protocol("json", &protocol) != 0 || protocol != WIRE_JSON) TEST_FAIL("json");
+    if (codec_parse_protocol("binary", &protocol) != 0 || protocol != WIRE_BINARY) TEST_FAIL("binary");
+    if (codec_parse_protocol("protobuf", &protocol) == 0) TEST_FAIL("Unknown protocol should be rejected");
+    if (codec_framing(WIRE_BINARY, UDS_FRAME_NEWLINE) != UDS_FRAME_LENGTH) TEST_FAIL("Binary needs length framing");
+    if (codec_framing(WIRE_JSON, UDS_FRAME_JSON) != UDS_FRAME_JSON) TEST_FAIL("JSON keeps framing");
+
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run all codec tests
+ */
+int main(void) {
+    printf("Running Wire Codec Tests...\n");
+
+    int failures = 0;
+
+    failures += test_decode_matches_json();
+    failures += test_ticks_match_json();
+    failures += test_delta_ticks_match_json();
+    failures += test_malformed_frames();
+    failures += test_handshake();
+    failures += test_parse_protocol();
+
+    printf("\n");
+    if (failures == 0) {
+        printf("All codec tests passed!\n");
+    } else {
+        printf("%d test(s) failed.\n", failures);
+    }
+
+    return failures;
+}
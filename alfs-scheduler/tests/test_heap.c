@@ -9,6 +9,7 @@
 #include <string.h>
 #include <assert.h>
 #include "../include/heap.h"
+#include "../include/taskqueue.h"
 #include "../include/task.h"
 
 #define TEST_PASS() printf("  [PASS] %s\n", __func__)
@@ -206,6 +207,288 @@ static int test_heap_stress(void) {
     return 0;
 }
 
+/**
+ * Test equal vruntimes come out in creation (seq) order
+ */
+static int test_heap_tie_break(void) {
+    MinHeap *heap = heap_create(4);
+    Task *tasks[8];
+    
+    /* Insert in reverse creation order so layout alone would not sort them */
+    for (int i = 7; i >= 0; i--) {
+        char name[16];
+        snprintf(name, sizeof(name), "T%d", i);
+        tasks[i] = task_create(name, 0, NULL);
+        tasks[i]->vruntime = 3.0;
+        tasks[i]->seq = (uint64_t)i;
+        heap_insert(heap, tasks[i]);
+    }
+    
+    if (heap_validate(heap) != 0) TEST_FAIL("Heap should validate after inserts");
+    
+    for (int i = 0; i < 8; i++) {
+        if (heap_extract_min(heap) != tasks[i]) TEST_FAIL("Ties should extract in seq order");
+    }
+    
+    for (int i = 0; i < 8; i++) {
+        task_destroy(tasks[i]);
+    }
+    heap_destroy(heap);
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test 4- and 8-ary heaps keep heap order and indices, and bad arities fail
+ */
+static int test_heap_dary(void) {
+    static const int arities[] = {4, 8};
+    Task *tasks[64];
+    
+    for (int i = 0; i < 64; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "T%d", i);
+        tasks[i] = task_create(name, 0, NULL);
+        tasks[i]->seq = (uint64_t)i;
+    }
+    
+    for (int a = 0; a < 2; a++) {
+        MinHeap heap;
+        if (heap_init(&heap, 2, arities[a]) != 0) TEST_FAIL("Failed to init d-ary heap");
+        if (heap.shift != a + 2) TEST_FAIL("Arity should be stored as a shift");
+        
+        for (int i = 0; i < 64; i++) {
+            tasks[i]->vruntime = (double)((i * 37) % 64);
+            heap_insert(&heap, tasks[i]);
+        }
+        if (heap_validate(&heap) != 0) TEST_FAIL("Heap should validate after inserts");
+        
+        tasks[10]->vruntime = -1.0;
+        heap_update(&heap, tasks[10]);
+        heap_remove(&heap, tasks[20]);
+        if (heap_validate(&heap) != 0) TEST_FAIL("Heap should validate after update/remove");
+        if (heap_extract_min(&heap) != tasks[10]) TEST_FAIL("Updated task should be the minimum");
+        
+        double last_vruntime = -1.0;
+        while (!heap_is_empty(&heap)) {
+            Task *t = heap_extract_min(&heap);
+            if (t->vruntime < last_vruntime) TEST_FAIL("Heap order violation");
+            last_vruntime = t->vruntime;
+        }
+        heap_release(&heap);
+    }
+    
+    MinHeap bad;
+    if (heap_init(&bad, 4, 3) == 0) TEST_FAIL("Arity 3 should be rejected");
+    
+    for (int i = 0; i < 64; i++) {
+        task_destroy(tasks[i]);
+    }
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test every run queue backend against a linear scan under random
+ * inserts, removes, updates and extracts, validating after each step
+ */
+static int test_queue_backends(void) {
+    enum { COUNT = 200, STEPS = 4000 };
+    Task *tasks[COUNT];
+    
+    for (int i = 0; i < COUNT; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "T%d", i);
+        tasks[i] = task_create(name, 0, NULL);
+        tasks[i]->seq = (uint64_t)i;
+    }
+    
+    for (int b = 0; b < QUEUE_BACKEND_COUNT; b++) {
+        TaskQueue queue;
+        if (taskqueue_init(&queue, (QueueBackend)b) != 0) TEST_FAIL("Failed to init queue");
+        unsigned int seed = 99u;
+        int queued = 0;
+        
+        for (int step = 0; step < STEPS; step++) {
+            seed = seed * 1103515245u + 12345u;
+            Task *t = tasks[(seed >> 8) % COUNT];
+            /* Few distinct vruntimes, so ties are common */
+            double vruntime = (double)((seed >> 16) % 50);
+            
+            switch ((seed >> 4) % 4) {
+                case 0:
+                    if (t->heap_index < 0) {
+                        t->vruntime = vruntime;
+                        if (taskqueue_insert(&queue, t) != 0) TEST_FAIL("Insert failed");
+                        queued++;
+                    }
+                    break;
+                case 1:
+                    if (t->heap_index >= 0) {
+                        taskqueue_remove(&queue, t);
+                        queued--;
+                    }
+                    break;
+                case 2:
+                    if (t->heap_index >= 0) {
+                        t->vruntime = vruntime;
+                        taskqueue_update(&queue, t);
+                    }
+                    break;
+                default:
+                    if (taskqueue_extract_min(&queue)) {
+                        queued--;
+                    }
+                    break;
+            }
+            
+            Task *expected = NULL;
+            for (int i = 0; i < COUNT; i++) {
+                if (tasks[i]->heap_index >= 0 && (!expected || task_before(tasks[i], expected))) {
+                    expected = tasks[i];
+                }
+            }
+            if (taskqueue_validate(&queue) != 0) TEST_FAIL("Queue failed validation");
+            if (taskqueue_size(&queue) != queued) TEST_FAIL("Wrong queue size");
+            if (taskqueue_peek(&queue) != expected) TEST_FAIL("Peek is not the minimum");
+        }
+        
+        /* A late task can be taken out from the middle */
+        Task *last = taskqueue_last(&queue);
+        if (queued > 0 && (!last || last->heap_index < 0)) TEST_FAIL("Last should be a queued task");
+        
+        Task *collected[COUNT];
+        if (taskqueue_collect(&queue, collected) != queued) TEST_FAIL("Collect missed tasks");
+        
+        Task *prev = NULL;
+        while (queued-- > 0) {
+            Task *t = taskqueue_extract_min(&queue);
+            if (!t || t->heap_index != -1 || (prev && task_before(t, prev))) TEST_FAIL("Drain out of order");
+            prev = t;
+        }
+        if (!taskqueue_is_empty(&queue) || taskqueue_extract_min(&queue)) TEST_FAIL("Queue should be empty");
+        taskqueue_destroy(&queue);
+    }
+    
+    for (int i = 0; i < COUNT; i++) {
+        task_destroy(tasks[i]);
+    }
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test the augmented RB-tree's earliest-eligible-deadline pick against
+ * a linear scan while vruntimes and deadlines move
+ */
+static int test_queue_pick_eligible(void) {
+    enum { COUNT = 150, STEPS = 3000 };
+    Task *tasks[COUNT];
+    
+    for (int i = 0; i < COUNT; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "T%d", i);
+        tasks[i] = task_create(name, 0, NULL);
+        tasks[i]->seq = (uint64_t)i;
+    }
+    
+    for (int b = 0; b < QUEUE_BACKEND_COUNT; b++) {
+        TaskQueue queue;
+        if (taskqueue_init(&queue, (QueueBackend)b) != 0) TEST_FAIL("Failed to init queue");
+        if (taskqueue_has_deadlines(&queue) != (b == QUEUE_RBTREE_AUG)) {
+            TEST_FAIL("Only rbtree-aug should track deadlines");
+        }
+        taskqueue_destroy(&queue);
+    }
+    
+    TaskQueue queue;
+    if (taskqueue_init(&queue, QUEUE_RBTREE_AUG) != 0) TEST_FAIL("Failed to init queue");
+    unsigned int seed = 7u;
+    
+    for (int step = 0; step < STEPS; step++) {
+        seed = seed * 1103515245u + 12345u;
+        Task *t = tasks[(seed >> 8) % COUNT];
+        double vruntime = (double)((seed >> 16) % 40);
+        double deadline = vruntime + (double)((seed >> 12) % 8);
+        
+        switch ((seed >> 4) % 4) {
+            case 0:
+                if (t->heap_index < 0) {
+                    t->vruntime = vruntime;
+                    t->deadline = deadline;
+                    taskqueue_insert(&queue, t);
+                }
+                break;
+            case 1:
+                if (t->heap_index >= 0) {
+                    taskqueue_remove(&queue, t);
+                }
+                break;
+            case 2:
+                /* Sometimes only the deadline moves and the node stays put */
+                if (t->heap_index >= 0) {
+                    if (seed & 1u) {
+                        t->vruntime = vruntime;
+                    }
+                    t->deadline = deadline;
+                    taskqueue_update(&queue, t);
+                }
+                break;
+            default:
+                taskqueue_extract_min(&queue);
+                break;
+        }
+        if (taskqueue_validate(&queue) != 0) TEST_FAIL("Augmented tree failed validation");
+        
+        for (int bound = -1; bound <= 41; bound += 7) {
+            Task *expected = NULL;
+            for (int i = 0; i < COUNT; i++) {
+                if (tasks[i]->heap_index >= 0 && tasks[i]->vruntime <= (vruntime_t)bound &&
+                    (!expected || deadline_before(tasks[i], expected))) {
+                    expected = tasks[i];
+                }
+            }
+            if (taskqueue_pick_eligible(&queue, (vruntime_t)bound) != expected) {
+                TEST_FAIL("Pick is not the earliest eligible deadline");
+            }
+        }
+    }
+    
+    while (taskqueue_extract_min(&queue)) {
+    }
+    taskqueue_destroy(&queue);
+    for (int i = 0; i < COUNT; i++) {
+        task_destroy(tasks[i]);
+    }
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test backend names round-trip and unknown names are rejected
+ */
+static int test_queue_backend_names(void) {
+    for (int b = 0; b < QUEUE_BACKEND_COUNT; b++) {
+        QueueBackend parsed;
+        if (taskqueue_parse_backend(taskqueue_backend_name((QueueBackend)b), &parsed) != 0 ||
+            parsed != (QueueBackend)b) {
+            TEST_FAIL("Backend name should round-trip");
+        }
+    }
+    
+    QueueBackend backend = QUEUE_HEAP;
+    if (taskqueue_parse_backend("splay", &backend) == 0) TEST_FAIL("Unknown name should fail");
+    if (taskqueue_parse_backend(NULL, &backend) == 0) TEST_FAIL("NULL name should fail");
+    if (strcmp(taskqueue_backend_name(QUEUE_BACKEND_COUNT), "unknown") != 0) TEST_FAIL("Bad backend name");
+    
+    TaskQueue queue;
+    if (taskqueue_init(&queue, QUEUE_BACKEND_COUNT) == 0) TEST_FAIL("Unknown backend should not init");
+    
+    TEST_PASS();
+    return 0;
+}
+
 /**
  * Run all heap tests
  */
@@ -220,6 +503,11 @@ int main(void) {
     failures += test_heap_update();
     failures += test_heap_remove();
     failures += test_heap_stress();
+    failures += test_heap_tie_break();
+    failures += test_heap_dary();
+    failures += test_queue_backends();
+    failures += test_queue_pick_eligible();
+    failures += test_queue_backend_names();
     
     printf("\n");
     if (failures == 0) {
@@ -0,0 +1,827 @@
+/**
+ * ALFS - Streaming Parser and Tick Serializer Unit Tests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/json_handler.h"
+#include "../include/scheduler.h"
+#include "../include/binary_codec.h"
+#include "json_reference.h"
+
+#define TEST_PASS() printf("  [PASS] %s\n", __func__)
+#define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
+
+#define FUZZ_CASES 40000
+#define FUZZ_MUTATIONS 4
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static bool same_id(const char *a, const char *b) {
+    return a && b ? strcmp(a, b) == 0 : a == b;
+}
+
+/**
+ * Compare a streaming parse result with the cJSON reference
+ */
+static bool same_timeframe(const TimeFrame *a, const TimeFrame *b) {
+    if (!a || !b) {
+        return a == b;
+    }
+    if (a->vtime != b->vtime || a->event_count != b->event_count) {
+        return false;
+    }
+    for (int i = 0; i < a->event_count; i++) {
+        const Event *x = &a->events[i];
+        const Event *y = &b->events[i];
+        if (x->action != y->action ||
+            !same_id(x->task_id, y->task_id) ||
+            !same_id(x->cgroup_id, y->cgroup_id) ||
+            !same_id(x->new_cgroup_id, y->new_cgroup_id) ||
+            !same_id(x->parent_id, y->parent_id) ||
+            x->nice != y->nice || x->has_nice != y->has_nice ||
+            x->cpu_shares != y->cpu_shares || x->has_cpu_shares != y->has_cpu_shares ||
+            x->cpu_quota_us != y->cpu_quota_us || x->has_cpu_quota != y->has_cpu_quota ||
+            x->cpu_period_us != y->cpu_period_us || x->has_cpu_period != y->has_cpu_period ||
+            x->burst_duration != y->burst_duration ||
+            x->has_cpu_mask != y->has_cpu_mask || x->cpu_mask_count != y->cpu_mask_count) {
+            return false;
+        }
+        for (int m = 0; m < x->cpu_mask_count; m++) {
+            if (x->cpu_mask[m] != y->cpu_mask[m]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Parse with both parsers and compare (tf is reused by the streaming side)
+ */
+static bool parsers_agree(const char *json, TimeFrame *tf) {
+    TimeFrame *expected = ref_parse_timeframe(json);
+    int rc = json_parse_timeframe_into(json, tf);
+    bool same = same_timeframe(rc == 0 ? tf : NULL, expected);
+    ref_free_timeframe(expected);
+    return same;
+}
+
+/* Both parsers report bad events on stderr; keep the fuzz output readable */
+static int quiet_stderr(void) {
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDERR_FILENO);
+        close(null_fd);
+    }
+    return saved;
+}
+
+static void restore_stderr(int saved) {
+    fflush(stderr);
+    if (saved >= 0) {
+        dup2(saved, STDERR_FILENO);
+        close(saved);
+    }
+}
+
+/* ============================================================================
+ * Random Input Generation
+ * ============================================================================ */
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t cap;
+    uint64_t seed;
+} Gen;
+
+static uint32_t gen_rand(Gen *g) {
+    g->seed = g->seed * 6364136223846793005ull + 1442695040888963407ull;
+    return (uint32_t)(g->seed >> 33);
+}
+
+static void gen_put(Gen *g, const char *s) {
+    size_t n = strlen(s);
+    if (g->len + n + 1 > g->cap) {
+        g->cap = (g->len + n + 1) * 2;
+        g->buf = realloc(g->buf, g->cap);
+    }
+    memcpy(g->buf + g->len, s, n + 1);
+    g->len += n;
+}
+
+static void gen_ws(Gen *g) {
+    static const char *ws[] = {"", "", "", " ", "\n", "\t ", "\r\n  "};
+    gen_put(g, ws[gen_rand(g) % 7]);
+}
+
+/* Key names, with case variants cJSON also matches */
+static void gen_key(Gen *g, const char *key) {
+    char name[32];
+    snprintf(name, sizeof(name), "%s", key);
+    uint32_t r = gen_rand(g) % 16;
+    if (r == 0) {
+        for (char *c = name; *c; c++) {
+            if (*c >= 'a' && *c <= 'z') *c = (char)(*c - 32);
+        }
+    } else if (r == 1 && name[0]) {
+        name[1] = '\0';              /* Truncated: never matches */
+    }
+    gen_put(g, "\"");
+    if (r == 2) {
+        /* Escaped first character still names the same key */
+        char escaped[8];
+        snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)name[0]);
+        gen_put(g, escaped);
+        gen_put(g, name + 1);
+    } else {
+        gen_put(g, name);
+    }
+    gen_put(g, "\"");
+    gen_ws(g);
+    gen_put(g, ":");
+    gen_ws(g);
+}
+
+static void gen_string(Gen *g) {
+    static const char *parts[] = {
+        "T1", "task-42", "cg", "0", "\\\"q\\\"", "\\\\", "\\/", "\\n\\t",
+        "\\u00e9", "\\u4e2d", "\\ud83d\\ude00", "\\u0000cut", "\\uZZZZ",
+        "caf\xc3\xa9", "{}[]", ",:", "TASK_CREATE", "x"
+    };
+    gen_put(g, "\"");
+    int n = (int)(gen_rand(g) % 4);
+    for (int i = 0; i < n; i++) {
+        gen_put(g, parts[gen_rand(g) % (sizeof(parts) / sizeof(parts[0]))]);
+    }
+    if (gen_rand(g) % 64 == 0) {
+        for (int i = 0; i < 300; i++) {
+            gen_put(g, "L");         /* Longer than the ID buffers */
+        }
+    }
+    gen_put(g, "\"");
+}
+
+static void gen_number(Gen *g) {
+    static const char *forms[] = {
+        "0", "-0", "7", "-3", "19", "-20", "1024", "100000", "2147483647",
+        "2147483648", "-2147483649", "99999999999", "1.5", "-2.7", "1e3",
+        "2E-2", "1e999", "-1e999", "0.0001", "007", "123456789", "1234567890"
+    };
+    gen_put(g, forms[gen_rand(g) % (sizeof(forms) / sizeof(forms[0]))]);
+}
+
+static void gen_value(Gen *g, int depth);
+
+static void gen_scalar(Gen *g) {
+    switch (gen_rand(g) % 5) {
+        case 0: gen_string(g); break;
+        case 1: gen_put(g, "null"); break;
+        case 2: gen_put(g, gen_rand(g) % 2 ? "true" : "false"); break;
+        default: gen_number(g); break;
+    }
+}
+
+static void gen_value(Gen *g, int depth) {
+    uint32_t r = gen_rand(g) % 8;
+    if (depth > 3 || r < 5) {
+        gen_scalar(g);
+    } else if (r < 7) {
+        gen_put(g, "[");
+        int n = (int)(gen_rand(g) % 3);
+        for (int i = 0; i < n; i++) {
+            if (i) gen_put(g, ",");
+            gen_ws(g);
+            gen_value(g, depth + 1);
+        }
+        gen_put(g, "]");
+    } else {
+        gen_put(g, "{");
+        int n = (int)(gen_rand(g) % 3);
+        for (int i = 0; i < n; i++) {
+            if (i) gen_put(g, ",");
+            gen_key(g, gen_rand(g) % 2 ? "nested" : "nice");
+            gen_value(g, depth + 1);
+        }
+        gen_put(g, "}");
+    }
+}
+
+static void gen_event(Gen *g) {
+    static const char *actions[] = {
+        "TASK_CREATE", "TASK_EXIT", "TASK_BLOCK", "TASK_UNBLOCK", "TASK_YIELD",
+        "TASK_SETNICE", "TASK_SET_AFFINITY", "CGROUP_CREATE", "CGROUP_MODIFY",
+        "CGROUP_DELETE", "TASK_MOVE_CGROUP", "CPU_BURST", "task_create", "BOGUS"
+    };
+    static const char *keys[] = {
+        "taskId", "cgroupId", "newCgroupId", "parentId", "nice", "newNice", "cpuMask",
+        "cpuShares", "cpuQuotaUs", "cpuPeriodUs", "duration", "extra", "action"
+    };
+
+    gen_put(g, "{");
+    gen_ws(g);
+    int members = 0;
+    if (gen_rand(g) % 16) {
+        gen_key(g, "action");
+        if (gen_rand(g) % 16) {
+            gen_put(g, "\"");
+            gen_put(g, actions[gen_rand(g) % (sizeof(actions) / sizeof(actions[0]))]);
+            gen_put(g, "\"");
+        } else {
+            gen_scalar(g);
+        }
+        members++;
+    }
+    int n = (int)(gen_rand(g) % 6);
+    for (int i = 0; i < n; i++) {
+        if (members++) {
+            gen_ws(g);
+            gen_put(g, ",");
+            gen_ws(g);
+        }
+        const char *key = keys[gen_rand(g) % (sizeof(keys) / sizeof(keys[0]))];
+        gen_key(g, key);
+        if (strcmp(key, "cpuMask") == 0 && gen_rand(g) % 4) {
+            gen_put(g, "[");
+            int cpus = (int)(gen_rand(g) % 5);
+            for (int c = 0; c < cpus; c++) {
+                if (c) gen_put(g, ",");
+                if (gen_rand(g) % 8) gen_number(g); else gen_scalar(g);
+            }
+            gen_put(g, "]");
+        } else if (gen_rand(g) % 3) {
+            if (strstr(key, "Id")) gen_string(g); else gen_number(g);
+        } else {
+            gen_value(g, 1);
+        }
+    }
+    gen_ws(g);
+    gen_put(g, "}");
+}
+
+/**
+ * Build one timeframe-like document (often valid, sometimes odd)
+ */
+static void gen_timeframe(Gen *g) {
+    g->len = 0;
+    gen_put(g, "");
+    if (gen_rand(g) % 64 == 0) {
+        gen_value(g, 0);             /* Root that is not an object */
+        return;
+    }
+    gen_ws(g);
+    gen_put(g, "{");
+    gen_key(g, "vtime");
+    if (gen_rand(g) % 8) gen_number(g); else gen_scalar(g);
+    gen_put(g, ",");
+    gen_key(g, "events");
+    if (gen_rand(g) % 16 == 0) {
+        gen_scalar(g);
+    } else {
+        gen_put(g, "[");
+        int n = (int)(gen_rand(g) % 6);
+        for (int i = 0; i < n; i++) {
+            if (i) gen_put(g, ",");
+            gen_ws(g);
+            if (gen_rand(g) % 16) gen_event(g); else gen_scalar(g);
+        }
+        gen_put(g, "]");
+    }
+    if (gen_rand(g) % 8 == 0) {
+        gen_put(g, ",");
+        gen_key(g, gen_rand(g) % 2 ? "vtime" : "meta");
+        gen_value(g, 1);
+    }
+    gen_ws(g);
+    gen_put(g, "}");
+    if (gen_rand(g) % 16 == 0) {
+        gen_put(g, " trailing");
+    }
+}
+
+/**
+ * Corrupt a document: flip, insert, delete or truncate bytes
+ */
+static void gen_mutate(Gen *g) {
+    static const char alphabet[] = "{}[]\":,\\u0123456789-+.eEnulltruefalse \t\n\x01\x7f\xc3\xa9";
+    if (g->len == 0) {
+        return;
+    }
+    size_t pos = gen_rand(g) % g->len;
+    switch (gen_rand(g) % 4) {
+        case 0:
+            g->buf[pos] = alphabet[gen_rand(g) % (sizeof(alphabet) - 1)];
+            break;
+        case 1:
+            if (g->len + 2 > g->cap) {
+                g->cap = g->len * 2 + 2;
+                g->buf = realloc(g->buf, g->cap);
+            }
+            memmove(g->buf + pos + 1, g->buf + pos, g->len - pos + 1);
+            g->buf[pos] = alphabet[gen_rand(g) % (sizeof(alphabet) - 1)];
+            g->len++;
+            break;
+        case 2:
+            memmove(g->buf + pos, g->buf + pos + 1, g->len - pos);
+            g->len--;
+            break;
+        default:
+            g->buf[pos] = '\0';
+            g->len = pos;
+            break;
+    }
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+/**
+ * Test a typical timeframe field by field
+ */
+static int test_parse_fields(void) {
+    const char *json =
+        "{\"vtime\": 12, \"events\": ["
+        "{\"action\":\"TASK_CREATE\",\"taskId\":\"T1\",\"nice\":-5,\"cgroupId\":\"web\"},"
+        "{\"action\":\"TASK_SET_AFFINITY\",\"taskId\":\"T1\",\"cpuMask\":[0, 2, 5]},"
+        "{\"action\":\"CGROUP_MODIFY\",\"cgroupId\":\"web\",\"cpuQuotaUs\":null,\"cpuShares\":2048},"
+        "{\"action\":\"TASK_MOVE_CGROUP\",\"taskId\":\"T1\",\"newCgroupId\":\"db\"},"
+        "{\"action\":\"CPU_BURST\",\"taskId\":\"T1\",\"duration\":3},"
+        "{\"action\":\"CGROUP_CREATE\",\"cgroupId\":\"web-api\",\"parentId\":\"web\"}]}";
+
+    TimeFrame *tf = json_parse_timeframe(json);
+    if (!tf) TEST_FAIL("Valid timeframe rejected");
+    if (tf->vtime != 12 || tf->event_count != 6) TEST_FAIL("Wrong vtime or event count");
+
+    const Event *e = tf->events;
+    if (e[0].action != EVENT_TASK_CREATE || strcmp(e[0].task_id, "T1") != 0 ||
+        e[0].nice != -5 || !e[0].has_nice || strcmp(e[0].cgroup_id, "web") != 0) {
+        TEST_FAIL("TASK_CREATE fields wrong");
+    }
+    if (!e[1].has_cpu_mask || e[1].cpu_mask_count != 3 || e[1].cpu_mask[2] != 5) {
+        TEST_FAIL("cpuMask wrong");
+    }
+    if (!e[2].has_cpu_quota || e[2].cpu_quota_us != -1 || e[2].cpu_shares != 2048) {
+        TEST_FAIL("null quota should mean unlimited");
+    }
+    if (strcmp(e[3].new_cgroup_id, "db") != 0) TEST_FAIL("newCgroupId wrong");
+    if (e[4].burst_duration != 3) TEST_FAIL("duration wrong");
+    if (strcmp(e[5].parent_id, "web") != 0 || e[0].parent_id != NULL) TEST_FAIL("parentId wrong");
+
+    json_free_timeframe(tf);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test the cJSON rules the streaming parser has to reproduce
+ */
+static int test_cjson_compat(void) {
+    static const char *cases[] = {
+        /* Case-insensitive keys, first match wins, newNice overrides nice */
+        "{\"VTIME\":3,\"vtime\":9,\"events\":[{\"ACTION\":\"TASK_EXIT\",\"TaskId\":\"A\"}]}",
+        "{\"events\":[{\"nice\":\"x\",\"nice\":4,\"action\":\"TASK_CREATE\",\"taskId\":\"B\"}]}",
+        "{\"events\":[{\"newNice\":7,\"action\":\"TASK_SETNICE\",\"taskId\":\"C\",\"nice\":1}]}",
+        /* Escapes, \\u0000 cutting an ID, invalid hex decoding to NUL */
+        "{\"events\":[{\"action\":\"TASK_CREATE\",\"taskId\":\"a\\\"b\\\\c\\u00e9\\ud83d\\ude00\"}]}",
+        "{\"events\":[{\"action\":\"TASK_CREATE\",\"taskId\":\"keep\\u0000drop\"}]}",
+        "{\"events\":[{\"action\":\"TASK_CREATE\",\"taskId\":\"x\\uZZZZy\"}]}",
+        "{\"events\":[{\"action\":\"TASK_CREATE\",\"taskId\":\"\\ud800\"}]}",
+        "{\"events\":[{\"act\\u0069on\":\"TASK_YIELD\",\"taskId\":\"D\"}]}",
+        /* Numbers: truncation, saturation, exponents, leading zeros */
+        "{\"vtime\":2.9,\"events\":[{\"action\":\"TASK_CREATE\",\"nice\":1e1,\"taskId\":\"E\"}]}",
+        "{\"vtime\":1e999,\"events\":[{\"action\":\"CGROUP_CREATE\",\"cpuShares\":-99999999999}]}",
+        "{\"vtime\":007,\"events\":[]}",
+        "{\"vtime\":1.2.3}",
+        "{\"vtime\":-}",
+        /* Invalid events are dropped, their masks with them */
+        "{\"events\":[1,\"s\",{\"taskId\":\"F\",\"cpuMask\":[1,2]},{\"action\":\"NOPE\"},"
+        "{\"action\":\"TASK_SET_AFFINITY\",\"cpuMask\":[3,\"x\",[4],5]}]}",
+        /* Roots and trailing text */
+        "[1,2,3]", "42", "\"str\"", "{\"vtime\":1} trailing", "\xEF\xBB\xBF{\"vtime\":5}",
+        "", "   ", "{", "{\"vtime\":1,}", "{\"events\":[{\"action\":\"TASK_EXIT\"},]}",
+        "{\"vtime\" 1}", "{\"a\":tru}", "{\"a\":\"unterminated}", "{\"a\":\"bad\\q\"}",
+        "{\"cpuQuotaUs\":1,\"events\":[{\"action\":\"CGROUP_MODIFY\",\"cpuQuotaUs\":\"str\"}]}",
+    };
+
+    int saved = quiet_stderr();
+    TimeFrame *tf = json_timeframe_create();
+    int mismatch = -1;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]) && mismatch < 0; i++) {
+        if (!parsers_agree(cases[i], tf)) {
+            mismatch = (int)i;
+        }
+    }
+    json_free_timeframe(tf);
+    restore_stderr(saved);
+
+    if (mismatch >= 0) {
+        printf("    case %d: %s\n", mismatch, cases[mismatch]);
+        TEST_FAIL("Streaming parser disagrees with cJSON");
+    }
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test deep nesting hits the same limit as cJSON
+ */
+static int test_nesting_limit(void) {
+    static char deep[4200];
+    TimeFrame *tf = json_timeframe_create();
+    int saved = quiet_stderr();
+    bool agree = true;
+
+    for (int depth = 998; depth <= 1002 && agree; depth++) {
+        size_t n = (size_t)sprintf(deep, "{\"x\":");
+        for (int i = 1; i < depth; i++) deep[n++] = '[';
+        for (int i = 1; i < depth; i++) deep[n++] = ']';
+        deep[n++] = '}';
+        deep[n] = '\0';
+        agree = parsers_agree(deep, tf);
+    }
+
+    restore_stderr(saved);
+    json_free_timeframe(tf);
+    if (!agree) TEST_FAIL("Nesting limit differs from cJSON");
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test action names map through the perfect hash
+ */
+static int test_action_lookup(void) {
+    for (int a = EVENT_TASK_CREATE; a <= EVENT_CPU_BURST; a++) {
+        if (json_parse_action(json_action_to_string((EventAction)a)) != (EventAction)a) {
+            TEST_FAIL("Action name did not round-trip");
+        }
+    }
+    static const char *bad[] = {"", "TASK", "task_create", "TASK_CREATEX", "TASK_CREAT",
+                                "CPU_BURSS", "TASK_SET_AFFINITYY", "XXXXX_CREATE"};
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        if (json_parse_action(bad[i]) != EVENT_INVALID) TEST_FAIL("Unknown action accepted");
+    }
+
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Fuzz: random and corrupted documents must parse identically to cJSON
+ */
+static int test_fuzz_against_cjson(void) {
+    Gen g = {NULL, 0, 0, 0x5eed};
+    TimeFrame *tf = json_timeframe_create();
+    int saved = quiet_stderr();
+    char *failed = NULL;
+    int valid = 0;
+
+    for (int i = 0; i < FUZZ_CASES && !failed; i++) {
+        gen_timeframe(&g);
+        for (int m = 0; m <= FUZZ_MUTATIONS && !failed; m++) {
+            if (m > 0) {
+                gen_mutate(&g);
+            }
+            if (!parsers_agree(g.buf, tf)) {
+                failed = strdup(g.buf);
+            } else if (m == 0 && tf->event_count > 0) {
+                valid++;
+            }
+        }
+    }
+
+    restore_stderr(saved);
+    json_free_timeframe(tf);
+    free(g.buf);
+
+    if (failed) {
+        printf("    input: %s\n", failed);
+        free(failed);
+        TEST_FAIL("Streaming parser disagrees with cJSON");
+    }
+    if (valid < FUZZ_CASES / 4) TEST_FAIL("Generator produced too few usable timeframes");
+
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test ticks serialize byte-for-byte like the cJSON serializer, for IDs
+ * that need escaping and a task literally named "idle"
+ */
+static int test_serialize_matches_cjson(void) {
+    static const char *ids[] = {
+        "T1", "idle", "q\"uote", "back\\slash", "tab\tnew\nline", "\x01\x1f ctl",
+        "caf\xc3\xa9", "/slash", "\b\f\r", "T10"
+    };
+    int id_count = (int)(sizeof(ids) / sizeof(ids[0]));
+    
+    Scheduler *sched = scheduler_init(3, 1);
+    scheduler_set_metadata(sched, true);
+    for (int i = 0; i < id_count; i++) {
+        Event event = {0};
+        char task_name[32];
+        event.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "%s", ids[i]);
+        event.task_id = task_name;
+        scheduler_process_event(sched, &event);
+    }
+    
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    OutputBuffer out = {0};
+    int mismatches = 0;
+    for (int vtime = 0; vtime < 40; vtime++) {
+        /* Block and wake tasks so both metadata lists are populated */
+        Event event = {0};
+        char task_name[32];
+        event.action = vtime % 3 == 2 ? EVENT_TASK_UNBLOCK : EVENT_TASK_BLOCK;
+        snprintf(task_name, sizeof(task_name), "%s", ids[(vtime * 7) % id_count]);
+        event.task_id = task_name;
+        scheduler_process_event(sched, &event);
+        scheduler_set_latency(sched, vtime >= 20);
+        scheduler_tick_into(sched, vtime, tick);
+        
+        for (int meta = 0; meta <= 1; meta++) {
+            char *expected = ref_serialize_tick(tick, meta);
+            char *direct = json_serialize_tick(tick, meta);
+            if (json_serialize_tick_into(tick, meta, &out) < 0 ||
+                strcmp(out.data + OUTPUT_HEADROOM, expected) != 0 ||
+                out.length != strlen(expected) || strcmp(direct, expected) != 0) {
+                mismatches++;
+            }
+            free(expected);
+            free(direct);
+        }
+    }
+    
+    /* A hand-built tick has no pins: every ID is quoted on the spot */
+    const char *schedule[] = {"a\"b", NULL};
+    SchedulerMeta meta = {0};
+    meta.preemptions = -7;
+    meta.migrations = 2147483647;
+    meta.runnable_tasks = schedule;
+    meta.runnable_count = 1;
+    SchedulerTick bare = {0};
+    bare.vtime = -2147483647 - 1;
+    bare.schedule = schedule;
+    bare.cpu_count = 2;
+    bare.meta = &meta;
+    char *expected = ref_serialize_tick(&bare, true);
+    if (json_serialize_tick_into(&bare, true, &out) < 0 ||
+        strcmp(out.data + OUTPUT_HEADROOM, expected) != 0) {
+        mismatches++;
+    }
+    free(expected);
+    
+    json_output_free(&out);
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    
+    if (mismatches) TEST_FAIL("Serialized tick differs from cJSON output");
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test the output buffer is reused once it fits the tick
+ */
+static int test_output_buffer_reuse(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    scheduler_set_metadata(sched, true);
+    for (int i = 0; i < 500; i++) {
+        Event event = {0};
+        char task_name[32];
+        event.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "task-with-a-long-name-%d", i);
+        event.task_id = task_name;
+        scheduler_process_event(sched, &event);
+    }
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    OutputBuffer out = {0};
+    if (json_serialize_tick_into(tick, true, &out) < 0) TEST_FAIL("Serialization failed");
+    if (out.capacity <= 4096) TEST_FAIL("Buffer should have grown past its initial size");
+    
+    char *data = out.data;
+    size_t capacity = out.capacity;
+    for (int vtime = 1; vtime < 20; vtime++) {
+        scheduler_tick_into(sched, vtime, tick);
+        if (json_serialize_tick_into(tick, true, &out) < 0) TEST_FAIL("Serialization failed");
+    }
+    if (out.data != data || out.capacity != capacity) TEST_FAIL("Buffer should be reused");
+    if (out.data[OUTPUT_HEADROOM + out.length] != '\0') TEST_FAIL("Payload should be NUL-terminated");
+    
+    json_output_free(&out);
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test delta ticks serialize the changed CPUs as an object and the task
+ * list changes, and keyframes like ordinary ticks
+ */
+static int test_delta_output(void) {
+    static const char *expected[] = {
+        "{\"vtime\":0,\"schedule\":[\"A\",\"B\"],\"meta\":{\"preemptions\":0,\"migrations\":0,"
+        "\"throttles\":0,\"unthrottles\":0,\"runnableTasks\":[\"A\",\"B\",\"C\"],\"blockedTasks\":[]}}",
+        "{\"vtime\":1,\"delta\":true,\"schedule\":{},\"meta\":{\"preemptions\":0,\"migrations\":0,"
+        "\"throttles\":0,\"unthrottles\":0,\"runnableTasks\":[],\"blockedTasks\":[\"C\"],\"removedTasks\":[]}}",
+        "{\"vtime\":2,\"delta\":true,\"schedule\":{\"0\":\"B\",\"1\":\"idle\"},\"meta\":{\"preemptions\":0,"
+        "\"migrations\":1,\"throttles\":0,\"unthrottles\":0,\"runnableTasks\":[],\"blockedTasks\":[],"
+        "\"removedTasks\":[\"A\"]}}",
+        "{\"vtime\":3,\"schedule\":[\"B\",\"idle\"],\"meta\":{\"preemptions\":0,\"migrations\":0,"
+        "\"throttles\":0,\"unthrottles\":0,\"runnableTasks\":[\"B\"],\"blockedTasks\":[\"C\"]}}",
+        "{\"vtime\":4,\"delta\":true,\"schedule\":{\"0\":\"C\",\"1\":\"B\"},\"meta\":{\"preemptions\":1,"
+        "\"migrations\":1,\"throttles\":0,\"unthrottles\":0,\"runnableTasks\":[\"C\"],\"blockedTasks\":[],"
+        "\"removedTasks\":[]}}"
+    };
+    static const struct { int vtime; EventAction action; const char *task; } events[] = {
+        {0, EVENT_TASK_CREATE, "A"}, {0, EVENT_TASK_CREATE, "B"}, {0, EVENT_TASK_CREATE, "C"},
+        {1, EVENT_TASK_BLOCK, "C"}, {2, EVENT_TASK_EXIT, "A"}, {4, EVENT_TASK_UNBLOCK, "C"}
+    };
+    
+    Scheduler *sched = scheduler_init(2, 1);
+    scheduler_set_metadata(sched, true);
+    scheduler_set_delta(sched, 3);
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    OutputBuffer out = {0};
+    size_t next = 0;
+    for (int vtime = 0; vtime < 5; vtime++) {
+        for (; next < sizeof(events) / sizeof(events[0]) && events[next].vtime == vtime; next++) {
+            Event event = {0};
+            char task_name[8];
+            event.action = events[next].action;
+            snprintf(task_name, sizeof(task_name), "%s", events[next].task);
+            event.task_id = task_name;
+            scheduler_process_event(sched, &event);
+        }
+        scheduler_tick_into(sched, vtime, tick);
+        if (json_serialize_tick_into(tick, true, &out) < 0) TEST_FAIL("Serialization failed");
+        if (strcmp(out.data + OUTPUT_HEADROOM, expected[vtime]) != 0) TEST_FAIL("Delta tick differs");
+    }
+    
+    json_output_free(&out);
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test task lists copied from the output buffer's cache serialize like
+ * freshly encoded ones, and a list change replaces the cached version
+ */
+static int test_list_cache(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    scheduler_set_metadata(sched, true);
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    OutputBuffer out = {0};
+    char task_name[16];
+    uint64_t epoch = 0;
+    int repeats = 0;                /* Earlier ticks in a row at this list version */
+    int hits = 0;
+    for (int vtime = 0; vtime < 30; vtime++) {
+        Event event = {0};
+        snprintf(task_name, sizeof(task_name), "\"T%d\"", vtime / 6);
+        event.task_id = task_name;
+        event.action = vtime % 6 == 0 ? EVENT_TASK_CREATE : vtime % 12 == 4 ? EVENT_TASK_BLOCK : EVENT_TASK_YIELD;
+        scheduler_process_event(sched, &event);
+        scheduler_tick_into(sched, vtime, tick);
+        repeats = tick->list_epoch == epoch ? repeats + 1 : 0;
+        epoch = tick->list_epoch;
+        
+        char *expected = ref_serialize_tick(tick, true);
+        if (json_serialize_tick_into(tick, true, &out) < 0) TEST_FAIL("Serialization failed");
+        if (strcmp(out.data + OUTPUT_HEADROOM, expected) != 0) TEST_FAIL("Tick differs from cJSON output");
+        free(expected);
+        
+        /* A version is captured on its second tick and copied from then on */
+        if (out.lists_ready != (repeats >= 1)) TEST_FAIL("Lists should be captured on the second tick");
+        hits += repeats >= 2;
+    }
+    if (hits == 0) TEST_FAIL("Unchanged lists should be copied from the cache");
+    
+    json_output_free(&out);
+    if (out.lists || out.lists_ready) TEST_FAIL("Freeing should drop the cache");
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test that a binary tick with no tasks caches its empty lists
+ */
+static int test_empty_list_cache(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    scheduler_set_metadata(sched, true);
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    OutputBuffer out = {0};
+    for (int vtime = 0; vtime < 5; vtime++) {
+        scheduler_tick_into(sched, vtime, tick);
+        OutputBuffer fresh = {0};
+        if (binary_encode_tick(tick, true, &out) < 0 || binary_encode_tick(tick, true, &fresh) < 0) {
+            TEST_FAIL("Encoding failed");
+        }
+        if (out.length != fresh.length ||
+            memcmp(out.data + OUTPUT_HEADROOM, fresh.data + OUTPUT_HEADROOM, out.length) != 0) {
+            TEST_FAIL("Reused buffer should encode the same tick");
+        }
+        json_output_free(&fresh);
+    }
+    if (!out.lists_ready || out.lists_length != 0) TEST_FAIL("Empty lists should be cached");
+    
+    json_output_free(&out);
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test that long IDs survive whole while the ID store grows mid-frame
+ */
+static int test_long_ids(void) {
+    enum { LONG_EVENTS = 64, LONG_ID_LEN = 400 };
+    size_t capacity = 64 + (size_t)LONG_EVENTS * (LONG_ID_LEN + 64);
+    char *json = malloc(capacity);
+    if (!json) TEST_FAIL("Allocation failed");
+    
+    size_t used = (size_t)snprintf(json, capacity, "{\"vtime\":1,\"events\":[");
+    for (int i = 0; i < LONG_EVENTS; i++) {
+        used += (size_t)snprintf(json + used, capacity - used, "%s{\"action\":\"TASK_CREATE\",\"taskId\":\"%03d",
+                                 i ? "," : "", i);
+        memset(json + used, 'a' + i % 26, LONG_ID_LEN - 3);
+        used += LONG_ID_LEN - 3;
+        used += (size_t)snprintf(json + used, capacity - used, "\",\"cgroupId\":\"g%d\"}", i);
+    }
+    snprintf(json + used, capacity - used, "]}");
+    
+    TimeFrame *tf = json_timeframe_create();
+    if (!tf || json_parse_timeframe_into(json, tf) != 0) TEST_FAIL("Parse failed");
+    if (tf->event_count != LONG_EVENTS) TEST_FAIL("Event count wrong");
+    for (int i = 0; i < LONG_EVENTS; i++) {
+        const Event *event = &tf->events[i];
+        char prefix[8];
+        char cgroup_name[8];
+        snprintf(prefix, sizeof(prefix), "%03d", i);
+        snprintf(cgroup_name, sizeof(cgroup_name), "g%d", i);
+        if (!event->task_id || strlen(event->task_id) != LONG_ID_LEN ||
+            strncmp(event->task_id, prefix, 3) != 0 ||
+            event->task_id[LONG_ID_LEN - 1] != 'a' + i % 26) {
+            TEST_FAIL("Long task ID not kept whole");
+        }
+        if (!same_id(event->cgroup_id, cgroup_name) || event->new_cgroup_id != NULL) {
+            TEST_FAIL("Short IDs wrong after the store grew");
+        }
+    }
+    
+    json_free_timeframe(tf);
+    free(json);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run all JSON tests
+ */
+int main(void) {
+    printf("Running JSON Parser Tests...\n");
+
+    int failures = 0;
+
+    failures += test_parse_fields();
+    failures += test_cjson_compat();
+    failures += test_nesting_limit();
+    failures += test_action_lookup();
+    failures += test_fuzz_against_cjson();
+    failures += test_serialize_matches_cjson();
+    failures += test_output_buffer_reuse();
+    failures += test_delta_output();
+    failures += test_list_cache();
+    failures += test_empty_list_cache();
+    failures += test_long_ids();
+
+    printf("\n");
+    if (failures == 0) {
+        printf("All JSON tests passed!\n");
+    } else {
+        printf("%d test(s) failed.\n", failures);
+    }
+
+    return failures;
+}
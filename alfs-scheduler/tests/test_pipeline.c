@@ -0,0 +1,269 @@
+/**
+ * ALFS - SPSC Queue, Work Pool and Pipelined I/O Unit Tests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "../include/spsc.h"
+#include "../include/workpool.h"
+#include "../include/pipeline.h"
+#include "../include/scheduler.h"
+#include "../include/uds.h"
+#include "../include/json_handler.h"
+#include "../include/codec.h"
+
+#define TEST_PASS() printf("  [PASS] %s\n", __func__)
+#define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
+
+#define ORDER_ITEMS 200000
+#define PIPE_FRAMES 400
+#define POOL_JOBS 5000
+#define POOL_RANGE 67
+
+static void *produce_sequence(void *arg) {
+    SpscQueue *queue = arg;
+    for (uintptr_t i = 1; i <= ORDER_ITEMS; i++) {
+        spsc_push(queue, (void *)i);
+    }
+    spsc_push(queue, NULL);
+    return NULL;
+}
+
+/**
+ * Test non-blocking push/pop at the capacity bounds
+ */
+static int test_spsc_bounds(void) {
+    SpscQueue queue;
+    if (spsc_init(&queue, 3) < 0) TEST_FAIL("Failed to init queue");
+    if (queue.capacity != 4) TEST_FAIL("Capacity should round up to a power of two");
+    
+    void *item = NULL;
+    if (spsc_try_pop(&queue, &item)) TEST_FAIL("Pop from empty queue should fail");
+    for (uintptr_t i = 0; i < 4; i++) {
+        if (!spsc_try_push(&queue, (void *)i)) TEST_FAIL("Push below capacity should succeed");
+    }
+    if (spsc_try_push(&queue, (void *)99)) TEST_FAIL("Push into full queue should fail");
+    
+    /* Indices wrap around the slot array */
+    for (uintptr_t i = 0; i < 10; i++) {
+        if (!spsc_try_pop(&queue, &item) || item != (void *)i) TEST_FAIL("FIFO order broken");
+        if (!spsc_try_push(&queue, (void *)(i + 4))) TEST_FAIL("Push after pop should succeed");
+    }
+    
+    spsc_destroy(&queue);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test FIFO order across threads through a tiny queue (both sides block)
+ */
+static int test_spsc_threads(void) {
+    SpscQueue queue;
+    if (spsc_init(&queue, 4) < 0) TEST_FAIL("Failed to init queue");
+    
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, produce_sequence, &queue) != 0) {
+        TEST_FAIL("Failed to start producer");
+    }
+    
+    uintptr_t expected = 1;
+    void *item;
+    int errors = 0;
+    while ((item = spsc_pop(&queue)) != NULL) {
+        if ((uintptr_t)item != expected) {
+            errors++;
+        }
+        expected++;
+    }
+    pthread_join(producer, NULL);
+    
+    if (errors || expected != ORDER_ITEMS + 1) TEST_FAIL("Items lost or reordered");
+    
+    spsc_destroy(&queue);
+    TEST_PASS();
+    return 0;
+}
+
+static void mark_range(void *arg, int begin, int end) {
+    int *hits = arg;
+    for (int i = begin; i < end; i++) {
+        hits[i]++;
+    }
+}
+
+/**
+ * Test every job covers its range exactly once, across many short jobs
+ * and ranges smaller than the thread count
+ */
+static int test_workpool_ranges(void) {
+    if (workpool_create(1) != NULL) TEST_FAIL("A pool needs at least one helper");
+    WorkPool *pool = workpool_create(4);
+    if (!pool || workpool_threads(pool) != 4) TEST_FAIL("Failed to start pool");
+    
+    int hits[POOL_RANGE];
+    int errors = 0;
+    for (int job = 0; job < POOL_JOBS; job++) {
+        int count = job % POOL_RANGE;
+        memset(hits, 0, sizeof(hits));
+        workpool_run(pool, mark_range, hits, count);
+        for (int i = 0; i < POOL_RANGE; i++) {
+            errors += hits[i] != (i < count ? 1 : 0);
+        }
+    }
+    workpool_destroy(pool);
+    
+    if (errors) TEST_FAIL("Indices skipped or run twice");
+    TEST_PASS();
+    return 0;
+}
+
+typedef struct {
+    int fd;
+    char **frames;
+    int count;
+    char **responses;
+    int received;
+} Peer;
+
+/**
+ * Stream every frame without waiting for responses, then half-close
+ */
+static void *peer_send(void *arg) {
+    Peer *peer = arg;
+    for (int i = 0; i < peer->count; i++) {
+        uds_send(peer->fd, peer->frames[i], strlen(peer->frames[i]));
+        uds_send(peer->fd, "\n", 1);
+    }
+    shutdown(peer->fd, SHUT_WR);
+    return NULL;
+}
+
+static void *peer_receive(void *arg) {
+    Peer *peer = arg;
+    UdsConn *conn = uds_conn_create(peer->fd, UDS_FRAME_NEWLINE);
+    char *line;
+    while (peer->received < peer->count && (line = uds_conn_receive(conn, NULL)) != NULL) {
+        peer->responses[peer->received++] = strdup(line);
+    }
+    uds_conn_destroy(conn);
+    return NULL;
+}
+
+/**
+ * Build a timeframe that creates, blocks, wakes and yields tasks
+ */
+static char *make_frame(int vtime, unsigned int *seed) {
+    char *frame = malloc(4096);
+    int n = sprintf(frame, "{\"vtime\":%d,\"events\":[", vtime);
+    
+    /* One new task per frame for the first 32 frames, then only state changes */
+    if (vtime < 32) {
+        n += sprintf(frame + n, "{\"action\":\"TASK_CREATE\",\"taskId\":\"T%d\",\"nice\":%d},",
+                     vtime, vtime % 10 - 5);
+    }
+    for (int e = 0; e < 4; e++) {
+        *seed = *seed * 1103515245u + 12345u;
+        int task = (int)((*seed >> 8) % 32);
+        static const char *actions[] = {"TASK_BLOCK", "TASK_UNBLOCK", "TASK_YIELD"};
+        const char *action = actions[(*seed >> 20) % 3];
+        n += sprintf(frame + n, "%s{\"action\":\"%s\",\"taskId\":\"T%d\"}",
+                     e ? "," : "", action, task);
+    }
+    sprintf(frame + n, "]}");
+    return frame;
+}
+
+/**
+ * Test the pipeline answers a streamed (non-lockstep) peer exactly like
+ * the sequential loop, in order
+ */
+static int test_pipeline_matches_sequential(void) {
+    char *frames[PIPE_FRAMES];
+    char *expected[PIPE_FRAMES];
+    char *responses[PIPE_FRAMES] = {0};
+    unsigned int seed = 7u;
+    
+    /* Reference: the sequential main loop */
+    Scheduler *reference = scheduler_init(4, 1);
+    for (int i = 0; i < PIPE_FRAMES; i++) {
+        frames[i] = make_frame(i, &seed);
+        TimeFrame *tf = json_parse_timeframe(frames[i]);
+        for (int e = 0; e < tf->event_count; e++) {
+            scheduler_process_event(reference, &tf->events[e]);
+        }
+        SchedulerTick *tick = scheduler_tick(reference, tf->vtime);
+        expected[i] = json_serialize_tick(tick, true);
+        scheduler_tick_free(tick);
+        json_free_timeframe(tf);
+    }
+    scheduler_destroy(reference);
+    
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) TEST_FAIL("socketpair failed");
+    Peer peer = {fds[1], frames, PIPE_FRAMES, responses, 0};
+    pthread_t sender, receiver;
+    pthread_create(&sender, NULL, peer_send, &peer);
+    pthread_create(&receiver, NULL, peer_receive, &peer);
+    
+    Scheduler *sched = scheduler_init(4, 1);
+    UdsConn *conn = uds_conn_create(fds[0], UDS_FRAME_NEWLINE);
+    Codec *codec = codec_create(WIRE_JSON);
+    volatile int running = 1;
+    int rc = pipeline_run(sched, conn, codec, true, &running);
+    pthread_join(sender, NULL);
+    pthread_join(receiver, NULL);
+    
+    int mismatches = 0;
+    for (int i = 0; i < PIPE_FRAMES; i++) {
+        if (!responses[i] || strcmp(responses[i], expected[i]) != 0) {
+            mismatches++;
+        }
+        free(responses[i]);
+        free(expected[i]);
+        free(frames[i]);
+    }
+    
+    codec_destroy(codec);
+    uds_conn_destroy(conn);
+    close(fds[0]);
+    close(fds[1]);
+    scheduler_destroy(sched);
+    
+    if (rc != 0) TEST_FAIL("pipeline_run failed");
+    if (peer.received != PIPE_FRAMES) TEST_FAIL("Missing responses");
+    if (mismatches) TEST_FAIL("Pipelined responses differ from the sequential loop");
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run all pipeline tests
+ */
+int main(void) {
+    printf("Running Pipeline Tests...\n");
+    
+    int failures = 0;
+    
+    failures += test_spsc_bounds();
+    failures += test_spsc_threads();
+    failures += test_workpool_ranges();
+    failures += test_pipeline_matches_sequential();
+    
+    printf("\n");
+    if (failures == 0) {
+        printf("All pipeline tests passed!\n");
+    } else {
+        printf("%d test(s) failed.\n", failures);
+    }
+    
+    return failures;
+}
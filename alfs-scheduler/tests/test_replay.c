@@ -0,0 +1,275 @@
+/**
+ * ALFS - Trace Replay Unit Tests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/replay.h"
+#include "../include/codec.h"
+#include "../include/binary_codec.h"
+#include "../include/json_handler.h"
+#include "../include/scheduler.h"
+#include "cJSON/cJSON.h"
+
+#define TEST_PASS() printf("  [PASS] %s\n", __func__)
+#define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
+
+/* ============================================================================
+ * Helpers
+ * ============================================================================ */
+
+static int quiet_stderr(void) {
+    fflush(stderr);
+    int saved = dup(STDERR_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    dup2(devnull, STDERR_FILENO);
+    close(devnull);
+    return saved;
+}
+
+static void restore_stderr(int saved) {
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+}
+
+static char *read_file(const char *path, size_t *length) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = malloc((size_t)size + 1);
+    if (data && fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data) {
+        data[size] = '\0';
+        if (length) {
+            *length = (size_t)size;
+        }
+    }
+    return data;
+}
+
+static int write_file(const char *path, const void *data, size_t length) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return -1;
+    }
+    size_t n = fwrite(data, 1, length, f);
+    fclose(f);
+    return n == length ? 0 : -1;
+}
+
+/**
+ * Replay a trace with a fresh 4-CPU scheduler
+ */
+static int replay_file(const char *trace, const char *output, WireProtocol protocol,
+                       bool include_meta, ReplayStats *stats) {
+    Scheduler *sched = scheduler_init(4, 1);
+    Codec *codec = codec_create(protocol);
+    volatile int running = 1;
+    int saved = quiet_stderr();
+    int rc = replay_run(sched, codec, trace, output, include_meta, &running, stats);
+    restore_stderr(saved);
+    codec_destroy(codec);
+    scheduler_destroy(sched);
+    return rc;
+}
+
+/**
+ * Parse JSON-lines output into one cJSON array
+ */
+static cJSON *parse_lines(char *text) {
+    cJSON *array = cJSON_CreateArray();
+    for (char *line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) {
+        cJSON_AddItemToArray(array, cJSON_Parse(line));
+    }
+    return array;
+}
+
+/* ============================================================================
+ * Tests
+ * ============================================================================ */
+
+/**
+ * Test replaying a test_server.py input file reproduces its expected output
+ */
+static int test_replay_matches_expected(void) {
+    static const char *inputs[] = {"tests/sample_input.json", "tests/sample_input2.json"};
+    static const char *expected[] = {"tests/sample_input_output.json", "tests/sample_input2_output.json"};
+    char output[] = "/tmp/alfs_replay_XXXXXX";
+    int fd = mkstemp(output);
+    if (fd < 0) TEST_FAIL("mkstemp failed");
+    close(fd);
+
+    for (int i = 0; i < 2; i++) {
+        ReplayStats stats;
+        if (replay_file(inputs[i], output, WIRE_JSON, true, &stats) < 0) TEST_FAIL("Replay failed");
+
+        char *text = read_file(output, NULL);
+        char *reference = read_file(expected[i], NULL);
+        if (!text || !reference) TEST_FAIL("Missing output");
+        cJSON *got = parse_lines(text);
+        cJSON *want = cJSON_Parse(reference);
+        bool same = cJSON_Compare(got, want, true);
+        int count = cJSON_GetArraySize(want);
+        cJSON_Delete(got);
+        cJSON_Delete(want);
+        free(text);
+        free(reference);
+        if (!same) TEST_FAIL("Ticks differ from the expected output");
+        if (stats.frames != count || stats.errors != 0) TEST_FAIL("Wrong replay totals");
+    }
+
+    unlink(output);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test JSON-lines parsing: blank lines, CRLF, a missing final newline,
+ * and bad lines and rejected events that are counted and skipped
+ */
+static int test_replay_json_lines(void) {
+    char trace[] = "/tmp/alfs_trace_XXXXXX";
+    char output[] = "/tmp/alfs_replay_XXXXXX";
+    int fd = mkstemp(trace);
+    if (fd < 0) TEST_FAIL("mkstemp failed");
+    close(fd);
+    fd = mkstemp(output);
+    if (fd < 0) TEST_FAIL("mkstemp failed");
+    close(fd);
+
+    const char *lines =
+        "{\"vtime\": 0, \"events\": [{\"action\": \"TASK_CREATE\", \"taskId\": \"a\"}]}\n"
+        "\n"
+        "{\"vtime\": 1, \"events\": [\r\n"
+        "{\"vtime\": 2, \"events\": [{\"action\": \"TASK_CREATE\", \"taskId\": \"b\"},"
+        " {\"action\": \"TASK_CREATE\", \"taskId\": \"a\"}]}\r\n"
+        "   \n"
+        "{\"vtime\": 3, \"events\": []}";
+    if (write_file(trace, lines, strlen(lines)) < 0) TEST_FAIL("Failed to write trace");
+
+    ReplayStats stats;
+    if (replay_file(trace, output, WIRE_JSON, false, &stats) < 0) TEST_FAIL("Replay failed");
+    if (stats.frames != 3 || stats.events != 3 || stats.errors != 1 || stats.rejected != 1) {
+        TEST_FAIL("Wrong replay totals");
+    }
+
+    size_t length = 0;
+    char *text = read_file(output, &length);
+    if (!text) TEST_FAIL("Missing output");
+    const char *want =
+        "{\"vtime\":0,\"schedule\":[\"a\",\"idle\",\"idle\",\"idle\"]}\n"
+        "{\"vtime\":2,\"schedule\":[\"b\",\"a\",\"idle\",\"idle\"]}\n"
+        "{\"vtime\":3,\"schedule\":[\"b\",\"a\",\"idle\",\"idle\"]}\n";
+    bool same = strcmp(text, want) == 0 && stats.output_bytes == length;
+    free(text);
+    if (!same) TEST_FAIL("Unexpected ticks");
+
+    /* An empty trace replays nothing */
+    if (write_file(trace, "", 0) < 0) TEST_FAIL("Failed to write trace");
+    if (replay_file(trace, output, WIRE_JSON, false, &stats) < 0 || stats.frames != 0) {
+        TEST_FAIL("Empty trace should replay cleanly");
+    }
+    if (replay_file("/nonexistent/trace", output, WIRE_JSON, false, &stats) != -1) {
+        TEST_FAIL("Missing trace should fail");
+    }
+
+    unlink(trace);
+    unlink(output);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test a binary trace replays to length-prefixed binary ticks, and a
+ * truncated final frame stops the replay without losing earlier ticks
+ */
+static int test_replay_binary(void) {
+    char trace[] = "/tmp/alfs_trace_XXXXXX";
+    char output[] = "/tmp/alfs_replay_XXXXXX";
+    int fd = mkstemp(trace);
+    if (fd < 0) TEST_FAIL("mkstemp failed");
+    close(fd);
+    fd = mkstemp(output);
+    if (fd < 0) TEST_FAIL("mkstemp failed");
+    close(fd);
+
+    /* Frame 0 defines handle 7 = "w" and creates it; frame 1 is empty */
+    unsigned char data[128];
+    size_t n = 0;
+    const unsigned char frame0[] = {
+        0, 0, 0, 12 + 7 + BINARY_EVENT_SIZE,
+        BINARY_MSG_TIMEFRAME, 0, 1, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+        7, 0, 0, 0, 1, 0, 'w'
+    };
+    memcpy(data, frame0, sizeof(frame0));
+    n = sizeof(frame0);
+    memset(data + n, 0, BINARY_EVENT_SIZE);
+    data[n] = EVENT_TASK_CREATE;
+    data[n + 4] = 7;
+    n += BINARY_EVENT_SIZE;
+    const unsigned char frame1[] = {0, 0, 0, 12, BINARY_MSG_TIMEFRAME, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0};
+    memcpy(data + n, frame1, sizeof(frame1));
+    n += sizeof(frame1);
+    if (write_file(trace, data, n) < 0) TEST_FAIL("Failed to write trace");
+
+    ReplayStats stats;
+    if (replay_file(trace, output, WIRE_BINARY, false, &stats) < 0) TEST_FAIL("Replay failed");
+    if (stats.frames != 2 || stats.events != 1 || stats.errors != 0) TEST_FAIL("Wrong replay totals");
+
+    size_t length = 0;
+    unsigned char *ticks = (unsigned char *)read_file(output, &length);
+    size_t tick_size = BINARY_TICK_HEADER_SIZE + 4 * 4;
+    if (!ticks || length != 2 * (4 + tick_size)) TEST_FAIL("Wrong output size");
+    if (ticks[3] != tick_size || ticks[4] != BINARY_MSG_TICK || ticks[4 + 8] != 7 ||
+        ticks[4 + 12] != 0 || ticks[4 + tick_size + 4 + 4] != 1) {
+        TEST_FAIL("Unexpected ticks");
+    }
+    free(ticks);
+
+    /* Cut the second frame short */
+    if (write_file(trace, data, n - 3) < 0) TEST_FAIL("Failed to write trace");
+    if (replay_file(trace, output, WIRE_BINARY, false, &stats) < 0) TEST_FAIL("Replay failed");
+    if (stats.frames != 1 || stats.errors != 1) TEST_FAIL("Truncated frame not reported");
+
+    unlink(trace);
+    unlink(output);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run all replay tests
+ */
+int main(void) {
+    printf("Running Trace Replay Tests...\n");
+
+    int failures = 0;
+
+    failures += test_replay_matches_expected();
+    failures += test_replay_json_lines();
+    failures += test_replay_binary();
+
+    printf("\n");
+    if (failures == 0) {
+        printf("All replay tests passed!\n");
+    } else {
+        printf("%d test(s) failed.\n", failures);
+    }
+
+    return failures;
+}
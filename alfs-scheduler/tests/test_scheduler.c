@@ -8,14 +8,57 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
-#include <math.h>
 #include "../include/scheduler.h"
 #include "../include/task.h"
 #include "../include/cgroup.h"
+#include "../include/cpumask.h"
+#include "../include/idtable.h"
+#include "../include/pool.h"
+#include "../include/taskqueue.h"
+#include "../include/runqueue.h"
+#include "../include/stats.h"
+#include "../include/timerwheel.h"
 
 #define TEST_PASS() printf("  [PASS] %s\n", __func__)
 #define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
 
+/*
+ * Counting allocator: the test binary is linked with --wrap for the
+ * allocation functions, so every call made by the scheduler lands here.
+ */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+char *__real_strdup(const char *str);
+void *__real_aligned_alloc(size_t align, size_t size);
+
+static long alloc_calls = 0;
+
+void *__wrap_malloc(size_t size) {
+    alloc_calls++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    alloc_calls++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    alloc_calls++;
+    return __real_realloc(ptr, size);
+}
+
+char *__wrap_strdup(const char *str) {
+    alloc_calls++;
+    return __real_strdup(str);
+}
+
+void *__wrap_aligned_alloc(size_t align, size_t size) {
+    alloc_calls++;
+    return __real_aligned_alloc(align, size);
+}
+
 /**
  * Test scheduler initialization
  */
@@ -36,7 +79,7 @@ static int test_task_create_event(void) {
     
     Event event = {0};
     event.action = EVENT_TASK_CREATE;
-    strcpy(event.task_id, "T1");
+    event.task_id = "T1";
     event.nice = 0;
     event.has_nice = true;
     
@@ -64,14 +107,14 @@ static int test_basic_scheduling(void) {
     /* Create two tasks */
     Event e1 = {0};
     e1.action = EVENT_TASK_CREATE;
-    strcpy(e1.task_id, "T1");
+    e1.task_id = "T1";
     e1.nice = 0;
     e1.has_nice = true;
     scheduler_process_event(sched, &e1);
     
     Event e2 = {0};
     e2.action = EVENT_TASK_CREATE;
-    strcpy(e2.task_id, "T2");
+    e2.task_id = "T2";
     e2.nice = 0;
     e2.has_nice = true;
     scheduler_process_event(sched, &e2);
@@ -105,13 +148,13 @@ static int test_task_block_unblock(void) {
     /* Create task */
     Event e1 = {0};
     e1.action = EVENT_TASK_CREATE;
-    strcpy(e1.task_id, "T1");
+    e1.task_id = "T1";
     scheduler_process_event(sched, &e1);
     
     /* Block task */
     Event e2 = {0};
     e2.action = EVENT_TASK_BLOCK;
-    strcpy(e2.task_id, "T1");
+    e2.task_id = "T1";
     scheduler_process_event(sched, &e2);
     
     Task *task = scheduler_find_task(sched, "T1");
@@ -125,7 +168,7 @@ static int test_task_block_unblock(void) {
     /* Unblock task */
     Event e3 = {0};
     e3.action = EVENT_TASK_UNBLOCK;
-    strcpy(e3.task_id, "T1");
+    e3.task_id = "T1";
     scheduler_process_event(sched, &e3);
     
     if (task->state != TASK_STATE_RUNNABLE) TEST_FAIL("Task should be runnable");
@@ -149,7 +192,7 @@ static int test_nice_values(void) {
     /* Create high priority task (nice=-10) */
     Event e1 = {0};
     e1.action = EVENT_TASK_CREATE;
-    strcpy(e1.task_id, "HIGH");
+    e1.task_id = "HIGH";
     e1.nice = -10;
     e1.has_nice = true;
     scheduler_process_event(sched, &e1);
@@ -157,7 +200,7 @@ static int test_nice_values(void) {
     /* Create low priority task (nice=10) */
     Event e2 = {0};
     e2.action = EVENT_TASK_CREATE;
-    strcpy(e2.task_id, "LOW");
+    e2.task_id = "LOW";
     e2.nice = 10;
     e2.has_nice = true;
     scheduler_process_event(sched, &e2);
@@ -182,13 +225,13 @@ static int test_cpu_affinity(void) {
     /* Create task with affinity to CPU 0 only */
     Event e1 = {0};
     e1.action = EVENT_TASK_CREATE;
-    strcpy(e1.task_id, "T1");
+    e1.task_id = "T1";
     scheduler_process_event(sched, &e1);
     
     int cpu_mask[] = {0};
     Event e2 = {0};
     e2.action = EVENT_TASK_SET_AFFINITY;
-    strcpy(e2.task_id, "T1");
+    e2.task_id = "T1";
     e2.cpu_mask = cpu_mask;
     e2.cpu_mask_count = 1;
     scheduler_process_event(sched, &e2);
@@ -211,7 +254,7 @@ static int test_cgroup_create(void) {
     int cpu_mask[] = {0, 1, 2, 3};
     Event e1 = {0};
     e1.action = EVENT_CGROUP_CREATE;
-    strcpy(e1.cgroup_id, "mygroup");
+    e1.cgroup_id = "mygroup";
     e1.cpu_shares = 2048;
     e1.has_cpu_shares = true;
     e1.cpu_quota_us = -1;
@@ -241,12 +284,12 @@ static int test_task_yield(void) {
     /* Create two tasks */
     Event e1 = {0};
     e1.action = EVENT_TASK_CREATE;
-    strcpy(e1.task_id, "T1");
+    e1.task_id = "T1";
     scheduler_process_event(sched, &e1);
     
     Event e2 = {0};
     e2.action = EVENT_TASK_CREATE;
-    strcpy(e2.task_id, "T2");
+    e2.task_id = "T2";
     scheduler_process_event(sched, &e2);
     
     /* First tick - T1 should run (created first, same vruntime) */
@@ -256,7 +299,7 @@ static int test_task_yield(void) {
     /* T1 yields */
     Event e3 = {0};
     e3.action = EVENT_TASK_YIELD;
-    strcpy(e3.task_id, "T1");
+    e3.task_id = "T1";
     scheduler_process_event(sched, &e3);
     
     /* After yield, T1's vruntime should be max, so T2 runs next */
@@ -279,7 +322,7 @@ static int test_task_exit(void) {
     /* Create task */
     Event e1 = {0};
     e1.action = EVENT_TASK_CREATE;
-    strcpy(e1.task_id, "T1");
+    e1.task_id = "T1";
     scheduler_process_event(sched, &e1);
     
     if (!scheduler_find_task(sched, "T1")) TEST_FAIL("Task should exist");
@@ -287,7 +330,7 @@ static int test_task_exit(void) {
     /* Exit task */
     Event e2 = {0};
     e2.action = EVENT_TASK_EXIT;
-    strcpy(e2.task_id, "T1");
+    e2.task_id = "T1";
     scheduler_process_event(sched, &e2);
     
     if (scheduler_find_task(sched, "T1")) TEST_FAIL("Task should not exist after exit");
@@ -325,7 +368,7 @@ static int test_cgroup_quota_enforcement(void) {
     int cpu_mask[] = {0};
     Event cgroup = {0};
     cgroup.action = EVENT_CGROUP_CREATE;
-    strcpy(cgroup.cgroup_id, "limited");
+    cgroup.cgroup_id = "limited";
     cgroup.cpu_shares = 1024;
     cgroup.has_cpu_shares = true;
     cgroup.cpu_quota_us = 50000;   /* 50ms quota */
@@ -339,8 +382,8 @@ static int test_cgroup_quota_enforcement(void) {
     
     Event create = {0};
     create.action = EVENT_TASK_CREATE;
-    strcpy(create.task_id, "TQ");
-    strcpy(create.cgroup_id, "limited");
+    create.task_id = "TQ";
+    create.cgroup_id = "limited";
     scheduler_process_event(sched, &create);
     
     SchedulerTick *tick = scheduler_tick(sched, 0);
@@ -369,7 +412,7 @@ static int test_cgroup_quota_multi_cpu_enforcement(void) {
     int cpu_mask[] = {0, 1};
     Event cgroup = {0};
     cgroup.action = EVENT_CGROUP_CREATE;
-    strcpy(cgroup.cgroup_id, "multi");
+    cgroup.cgroup_id = "multi";
     cgroup.cpu_shares = 1024;
     cgroup.has_cpu_shares = true;
     cgroup.cpu_quota_us = 50000;   /* Only enough for one CPU for one tick */
@@ -383,14 +426,14 @@ static int test_cgroup_quota_multi_cpu_enforcement(void) {
     
     Event t1 = {0};
     t1.action = EVENT_TASK_CREATE;
-    strcpy(t1.task_id, "A");
-    strcpy(t1.cgroup_id, "multi");
+    t1.task_id = "A";
+    t1.cgroup_id = "multi";
     scheduler_process_event(sched, &t1);
     
     Event t2 = {0};
     t2.action = EVENT_TASK_CREATE;
-    strcpy(t2.task_id, "B");
-    strcpy(t2.cgroup_id, "multi");
+    t2.task_id = "B";
+    t2.cgroup_id = "multi";
     scheduler_process_event(sched, &t2);
     
     SchedulerTick *tick = scheduler_tick(sched, 0);
@@ -424,6 +467,75 @@ static int test_cgroup_quota_multi_cpu_enforcement(void) {
     return 0;
 }
 
+/**
+ * Test a throttled cgroup is parked as a whole and restored on refill
+ */
+static int test_cgroup_throttle_parking(void) {
+    Scheduler *sched = scheduler_init(2, 50);  /* 50ms quanta */
+    
+    Event cgroup = {0};
+    cgroup.action = EVENT_CGROUP_CREATE;
+    cgroup.cgroup_id = "capped";
+    cgroup.cpu_quota_us = 50000;   /* One CPU for one tick per period */
+    cgroup.has_cpu_quota = true;
+    cgroup.cpu_period_us = 100000; /* Reset every 2 ticks at 50ms */
+    cgroup.has_cpu_period = true;
+    scheduler_process_event(sched, &cgroup);
+    
+    for (int i = 0; i < 4; i++) {
+        Event create = {0};
+        char task_name[32];
+        create.action = EVENT_TASK_CREATE;
+        if (i < 3) {
+            snprintf(task_name, sizeof(task_name), "C%d", i);
+            create.task_id = task_name;
+            create.cgroup_id = "capped";
+        } else {
+            create.task_id = "FREE";
+        }
+        scheduler_process_event(sched, &create);
+    }
+    Cgroup *capped = scheduler_find_cgroup(sched, "capped");
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    if (tick->meta->throttles != 0) TEST_FAIL("Nothing should be throttled at period start");
+    scheduler_tick_free(tick);
+    
+    tick = scheduler_tick(sched, 1);
+    if (tick->meta->throttles != 1) TEST_FAIL("Cgroup should be throttled once quota is used");
+    if (!capped->throttled) TEST_FAIL("Cgroup should be marked throttled");
+    if (sched->runqueue.active_count != 1) TEST_FAIL("Only the unthrottled class should stay active");
+    if (sched->runqueue.nr_parked != 3) TEST_FAIL("All capped tasks should be parked");
+    if (strcmp(tick->schedule[0], "FREE") != 0 || strcmp(tick->schedule[1], "idle") != 0) {
+        TEST_FAIL("Only the unthrottled task should run");
+    }
+    scheduler_tick_free(tick);
+    
+    tick = scheduler_tick(sched, 2);
+    if (tick->meta->unthrottles != 1) TEST_FAIL("Cgroup should be unthrottled on period reset");
+    if (capped->throttled || sched->runqueue.nr_parked != 0) TEST_FAIL("Parked tasks should return");
+    if (tick->schedule[0][0] != 'C' && tick->schedule[1][0] != 'C') {
+        TEST_FAIL("A capped task should run after the refill");
+    }
+    scheduler_tick_free(tick);
+    
+    /* Lifting the quota unthrottles immediately */
+    tick = scheduler_tick(sched, 3);
+    scheduler_tick_free(tick);
+    Event modify = {0};
+    modify.action = EVENT_CGROUP_MODIFY;
+    modify.cgroup_id = "capped";
+    modify.cpu_quota_us = -1;
+    modify.has_cpu_quota = true;
+    scheduler_process_event(sched, &modify);
+    if (capped->throttled) TEST_FAIL("Unlimited quota should unthrottle the cgroup");
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Run queue diverged from task states");
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
 /**
  * Test cgroup shares impact scheduling fairness
  */
@@ -433,7 +545,7 @@ static int test_cgroup_shares_effect(void) {
     
     Event high = {0};
     high.action = EVENT_CGROUP_CREATE;
-    strcpy(high.cgroup_id, "high");
+    high.cgroup_id = "high";
     high.cpu_shares = 4096;
     high.has_cpu_shares = true;
     high.cpu_quota_us = -1;
@@ -447,7 +559,7 @@ static int test_cgroup_shares_effect(void) {
     
     Event low = {0};
     low.action = EVENT_CGROUP_CREATE;
-    strcpy(low.cgroup_id, "low");
+    low.cgroup_id = "low";
     low.cpu_shares = 128;
     low.has_cpu_shares = true;
     low.cpu_quota_us = -1;
@@ -461,14 +573,14 @@ static int test_cgroup_shares_effect(void) {
     
     Event htask = {0};
     htask.action = EVENT_TASK_CREATE;
-    strcpy(htask.task_id, "H");
-    strcpy(htask.cgroup_id, "high");
+    htask.task_id = "H";
+    htask.cgroup_id = "high";
     scheduler_process_event(sched, &htask);
     
     Event ltask = {0};
     ltask.action = EVENT_TASK_CREATE;
-    strcpy(ltask.task_id, "L");
-    strcpy(ltask.cgroup_id, "low");
+    ltask.task_id = "L";
+    ltask.cgroup_id = "low";
     scheduler_process_event(sched, &ltask);
     
     int h_runs = 0;
@@ -497,7 +609,7 @@ static int test_cgroup_modify_delete(void) {
     
     Event create = {0};
     create.action = EVENT_CGROUP_CREATE;
-    strcpy(create.cgroup_id, "grp");
+    create.cgroup_id = "grp";
     create.cpu_shares = 1024;
     create.has_cpu_shares = true;
     create.cpu_quota_us = -1;
@@ -511,8 +623,8 @@ static int test_cgroup_modify_delete(void) {
 
     Event task_create = {0};
     task_create.action = EVENT_TASK_CREATE;
-    strcpy(task_create.task_id, "T_GROUP");
-    strcpy(task_create.cgroup_id, "grp");
+    task_create.task_id = "T_GROUP";
+    task_create.cgroup_id = "grp";
     scheduler_process_event(sched, &task_create);
 
     SchedulerTick *tick = scheduler_tick(sched, 10);
@@ -520,7 +632,7 @@ static int test_cgroup_modify_delete(void) {
     
     Event modify = {0};
     modify.action = EVENT_CGROUP_MODIFY;
-    strcpy(modify.cgroup_id, "grp");
+    modify.cgroup_id = "grp";
     modify.cpu_shares = 2048;
     modify.has_cpu_shares = true;
     modify.cpu_quota_us = 50000;
@@ -538,11 +650,11 @@ static int test_cgroup_modify_delete(void) {
     if (group->cpu_quota_us != 50000) TEST_FAIL("Cgroup quota should be updated");
     if (group->cpu_period_us != 200000) TEST_FAIL("Cgroup period should be updated");
     if (group->period_start_vtime != 10) TEST_FAIL("Cgroup period should reset at current vtime");
-    if (group->cpu_mask_count != 1 || group->cpu_mask[0] != 1) TEST_FAIL("Cgroup mask should be updated");
+    if (!cgroup_allows_cpu(group, 1) || cgroup_allows_cpu(group, 0)) TEST_FAIL("Cgroup mask should be updated");
     
     Event del = {0};
     del.action = EVENT_CGROUP_DELETE;
-    strcpy(del.cgroup_id, "grp");
+    del.cgroup_id = "grp";
     scheduler_process_event(sched, &del);
     
     if (scheduler_find_cgroup(sched, "grp")) TEST_FAIL("Cgroup should be deleted");
@@ -556,6 +668,228 @@ static int test_cgroup_modify_delete(void) {
     return 0;
 }
 
+/**
+ * Create a cgroup under `parent` (NULL for a root cgroup)
+ */
+static int create_child_cgroup(Scheduler *sched, const char *id, const char *parent,
+                               int shares, int quota_us, int period_us, int *mask, int mask_count) {
+    Event create = {0};
+    create.action = EVENT_CGROUP_CREATE;
+    create.cgroup_id = id;
+    if (parent) {
+        create.parent_id = parent;
+    }
+    create.cpu_shares = shares;
+    create.has_cpu_shares = true;
+    create.cpu_quota_us = quota_us;
+    create.has_cpu_quota = true;
+    create.cpu_period_us = period_us;
+    create.has_cpu_period = period_us > 0;
+    create.cpu_mask = mask;
+    create.cpu_mask_count = mask_count;
+    create.has_cpu_mask = mask_count > 0;
+    return scheduler_process_event(sched, &create);
+}
+
+static int count_running(const SchedulerTick *tick, char prefix) {
+    int running = 0;
+    for (int i = 0; i < tick->cpu_count; i++) {
+        if (tick->schedule[i][0] == prefix) {
+            running++;
+        }
+    }
+    return running;
+}
+
+/**
+ * Test nested cgroups: inherited shares and masks, quota charged up the
+ * tree, and a throttled parent parking its whole subtree
+ */
+static int test_cgroup_hierarchy(void) {
+    Scheduler *sched = scheduler_init(4, 1);  /* 1ms quanta */
+    int pod_cpus[] = {0, 1, 2};
+    int web_cpus[] = {1, 2, 3};
+
+    /* Two ticks of CPU time every 10 ticks for the whole pod */
+    if (create_child_cgroup(sched, "pod", NULL, 512, 2000, 10000, pod_cpus, 3) != 0) {
+        TEST_FAIL("Root cgroup should be created");
+    }
+    if (create_child_cgroup(sched, "web", "pod", 2048, -1, 0, web_cpus, 3) != 0 ||
+        create_child_cgroup(sched, "db", "pod", 1024, -1, 0, NULL, 0) != 0) {
+        TEST_FAIL("Child cgroups should be created");
+    }
+    if (create_child_cgroup(sched, "orphan", "missing", 1024, -1, 0, NULL, 0) != -1 ||
+        scheduler_find_cgroup(sched, "orphan")) {
+        TEST_FAIL("A cgroup with an unknown parent should be refused");
+    }
+
+    Cgroup *pod = scheduler_find_cgroup(sched, "pod");
+    Cgroup *web = scheduler_find_cgroup(sched, "web");
+    Cgroup *db = scheduler_find_cgroup(sched, "db");
+    if (web->parent != pod || db->parent != pod || web->depth != 1) {
+        TEST_FAIL("Children should be linked under their parent");
+    }
+    if (pod->effective_shares != 512 || web->effective_shares != 1024 || db->effective_shares != 512) {
+        TEST_FAIL("Shares should compound down the tree");
+    }
+    if (cgroup_allows_cpu(web, 0) || !cgroup_allows_cpu(web, 1) || cgroup_allows_cpu(web, 3)) {
+        TEST_FAIL("A child mask should be limited to its parent's CPUs");
+    }
+    if (web->quota_group != pod || db->quota_group != pod) {
+        TEST_FAIL("Unlimited children should be charged to the parent quota");
+    }
+
+    const char *tasks[][2] = {{"W1", "web"}, {"W2", "web"}, {"D1", "db"}};
+    for (int i = 0; i < 3; i++) {
+        Event create = {0};
+        create.action = EVENT_TASK_CREATE;
+        create.task_id = tasks[i][0];
+        create.cgroup_id = tasks[i][1];
+        scheduler_process_event(sched, &create);
+    }
+
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    if (count_running(tick, 'W') + count_running(tick, 'D') != 2) {
+        TEST_FAIL("The parent quota should cap the subtree at two CPUs");
+    }
+    if (strcmp(tick->schedule[3], "idle") != 0) TEST_FAIL("CPU 3 is outside every mask");
+    scheduler_tick_free(tick);
+
+    tick = scheduler_tick(sched, 1);
+    if (tick->meta->throttles != 1) TEST_FAIL("Only the parent should throttle");
+    if (!pod->throttled || web->throttled || web->throttle_count != 1 || db->throttle_count != 1) {
+        TEST_FAIL("Children should be held by the throttled parent");
+    }
+    if (pod->quota_used != 2000 || web->quota_used != 0) {
+        TEST_FAIL("Runtime should be charged to the quota holder");
+    }
+    if (sched->runqueue.nr_parked != 3) TEST_FAIL("The whole subtree should be parked");
+    scheduler_tick_free(tick);
+
+    /* Cap web at one CPU inside the pod for the next period */
+    Event modify = {0};
+    modify.action = EVENT_CGROUP_MODIFY;
+    modify.cgroup_id = "web";
+    modify.cpu_quota_us = 1000;
+    modify.has_cpu_quota = true;
+    scheduler_process_event(sched, &modify);
+    if (web->quota_group != web) TEST_FAIL("A limited child should hold its own quota");
+
+    tick = scheduler_tick(sched, 9);
+    if (count_running(tick, 'W') + count_running(tick, 'D') != 0) TEST_FAIL("Pod should stay throttled");
+    scheduler_tick_free(tick);
+
+    tick = scheduler_tick(sched, 10);
+    if (tick->meta->unthrottles != 1 || pod->throttled || db->throttle_count != 0) {
+        TEST_FAIL("Pod should unthrottle on its period reset");
+    }
+    if (count_running(tick, 'W') != 1 || count_running(tick, 'D') != 1) {
+        TEST_FAIL("Both the child and the parent quota should apply");
+    }
+    scheduler_tick_free(tick);
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Hierarchy should validate");
+
+    Event del = {0};
+    del.action = EVENT_CGROUP_DELETE;
+    del.cgroup_id = "pod";
+    scheduler_process_event(sched, &del);
+    if (scheduler_find_cgroup(sched, "pod") != pod) TEST_FAIL("A parent with children should not be deleted");
+    del.cgroup_id = "web";
+    scheduler_process_event(sched, &del);
+    del.cgroup_id = "db";
+    scheduler_process_event(sched, &del);
+    if (pod->first_child) TEST_FAIL("Deleted children should be unlinked");
+    del.cgroup_id = "pod";
+    scheduler_process_event(sched, &del);
+    if (scheduler_find_cgroup(sched, "pod")) TEST_FAIL("An empty parent should be deleted");
+
+    char id[16];
+    char parent[16] = "";
+    for (int depth = 0; depth <= MAX_CGROUP_DEPTH; depth++) {
+        snprintf(id, sizeof(id), "L%d", depth);
+        if (create_child_cgroup(sched, id, depth ? parent : NULL, 1024, -1, 0, NULL, 0) != 0) {
+            TEST_FAIL("Cgroups up to the depth limit should be created");
+        }
+        strcpy(parent, id);
+    }
+    if (create_child_cgroup(sched, "too-deep", parent, 1024, -1, 0, NULL, 0) != -1) {
+        TEST_FAIL("The depth limit should be enforced");
+    }
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Deep chain should validate");
+
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+typedef struct TimerCheck {
+    TimerNode *nodes;
+    int *fired;
+    long long before;               /* Wheel tick before this advance */
+    long long now;
+    int late;
+} TimerCheck;
+
+static void check_timer(TimerNode *node, void *arg) {
+    TimerCheck *check = arg;
+    check->fired[node - check->nodes]++;
+    if (node->expires > check->now || (node->expires <= check->before && node->expires > 0)) {
+        check->late++;
+    }
+}
+
+/**
+ * Test the timer wheel fires each timer exactly once, on the first
+ * advance that reaches it, across jumps longer than the wheel
+ */
+static int test_timer_wheel(void) {
+    enum { TIMERS = 200 };
+    TimerWheel wheel;
+    TimerNode nodes[TIMERS];
+    int fired[TIMERS] = {0};
+    memset(nodes, 0, sizeof(nodes));
+    timer_wheel_init(&wheel, 0);
+
+    unsigned int seed = 11u;
+    for (int i = 0; i < TIMERS; i++) {
+        seed = seed * 1103515245u + 12345u;
+        timer_wheel_add(&wheel, &nodes[i], 1 + (long long)((seed >> 8) % 3000));
+    }
+    /* Re-arming moves a timer; disarming drops it */
+    timer_wheel_add(&wheel, &nodes[0], 700);
+    timer_wheel_del(&wheel, &nodes[1]);
+    timer_wheel_del(&wheel, &nodes[1]);
+    if (wheel.armed != TIMERS - 1) TEST_FAIL("Armed count should track add and delete");
+
+    TimerCheck check = {nodes, fired, 0, 0, 0};
+    int total = 0;
+    while (wheel.armed > 0 && check.now < 4000) {
+        seed = seed * 1103515245u + 12345u;
+        long long step = (seed >> 4) % 4 == 0 ? 1 + (long long)((seed >> 8) % 700) : 1;
+        check.before = check.now;
+        check.now += step;
+        total += timer_wheel_advance(&wheel, check.now, check_timer, &check);
+    }
+    if (check.late != 0) TEST_FAIL("Timers should fire on the first advance past their expiry");
+    if (total != TIMERS - 1 || wheel.armed != 0) TEST_FAIL("Every armed timer should fire");
+    for (int i = 0; i < TIMERS; i++) {
+        if (fired[i] != (i == 1 ? 0 : 1)) TEST_FAIL("Each timer should fire exactly once");
+        if (timer_armed(&nodes[i])) TEST_FAIL("Fired timers should be unarmed");
+    }
+
+    /* A timer already due fires on the next advance */
+    timer_wheel_add(&wheel, &nodes[2], check.now - 5);
+    check.before = check.now;
+    check.now += 1;
+    check.late = 0;
+    if (timer_wheel_advance(&wheel, check.now, check_timer, &check) != 1) {
+        TEST_FAIL("An overdue timer should fire on the next advance");
+    }
+
+    TEST_PASS();
+    return 0;
+}
+
 /**
  * Test moving task between cgroups changes CPU eligibility
  */
@@ -566,7 +900,7 @@ static int test_task_move_cgroup(void) {
     
     Event cg_a = {0};
     cg_a.action = EVENT_CGROUP_CREATE;
-    strcpy(cg_a.cgroup_id, "A");
+    cg_a.cgroup_id = "A";
     cg_a.cpu_shares = 1024;
     cg_a.has_cpu_shares = true;
     cg_a.cpu_quota_us = -1;
@@ -580,7 +914,7 @@ static int test_task_move_cgroup(void) {
     
     Event cg_b = {0};
     cg_b.action = EVENT_CGROUP_CREATE;
-    strcpy(cg_b.cgroup_id, "B");
+    cg_b.cgroup_id = "B";
     cg_b.cpu_shares = 1024;
     cg_b.has_cpu_shares = true;
     cg_b.cpu_quota_us = -1;
@@ -594,8 +928,8 @@ static int test_task_move_cgroup(void) {
     
     Event create = {0};
     create.action = EVENT_TASK_CREATE;
-    strcpy(create.task_id, "TM");
-    strcpy(create.cgroup_id, "A");
+    create.task_id = "TM";
+    create.cgroup_id = "A";
     scheduler_process_event(sched, &create);
     
     SchedulerTick *tick = scheduler_tick(sched, 0);
@@ -604,8 +938,8 @@ static int test_task_move_cgroup(void) {
     
     Event move = {0};
     move.action = EVENT_TASK_MOVE_CGROUP;
-    strcpy(move.task_id, "TM");
-    strcpy(move.new_cgroup_id, "B");
+    move.task_id = "TM";
+    move.new_cgroup_id = "B";
     scheduler_process_event(sched, &move);
     
     tick = scheduler_tick(sched, 1);
@@ -619,46 +953,1840 @@ static int test_task_move_cgroup(void) {
 }
 
 /**
- * Test CPU_BURST disables vruntime updates for burst duration
+ * Test tasks naming a cgroup before it exists are bound once it is created,
+ * and duplicate IDs are rejected
  */
-static int test_cpu_burst_vruntime(void) {
-    Scheduler *sched = scheduler_init(1, 1);
+static int test_cgroup_late_binding(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    int cpu1[] = {1};
     
     Event create = {0};
     create.action = EVENT_TASK_CREATE;
-    strcpy(create.task_id, "B1");
-    scheduler_process_event(sched, &create);
+    create.task_id = "EARLY";
+    create.cgroup_id = "later";
+    if (scheduler_process_event(sched, &create) != 0) TEST_FAIL("Task create should succeed");
+    if (scheduler_process_event(sched, &create) == 0) TEST_FAIL("Duplicate task ID should be rejected");
+    
+    Task *task = scheduler_find_task(sched, "EARLY");
+    if (!task || task->cgroup != NULL) TEST_FAIL("Task should not be bound before cgroup exists");
+    
+    Event cg = {0};
+    cg.action = EVENT_CGROUP_CREATE;
+    cg.cgroup_id = "later";
+    cg.cpu_mask = cpu1;
+    cg.cpu_mask_count = 1;
+    cg.has_cpu_mask = true;
+    if (scheduler_process_event(sched, &cg) != 0) TEST_FAIL("Cgroup create should succeed");
+    if (scheduler_process_event(sched, &cg) == 0) TEST_FAIL("Duplicate cgroup ID should be rejected");
+    
+    if (task->cgroup != scheduler_find_cgroup(sched, "later")) TEST_FAIL("Task should be bound to new cgroup");
     
     SchedulerTick *tick = scheduler_tick(sched, 0);
+    if (strcmp(tick->schedule[1], "EARLY") != 0) TEST_FAIL("Task should follow the cgroup CPU mask");
     scheduler_tick_free(tick);
     
-    tick = scheduler_tick(sched, 1);
-    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Drive random task/cgroup churn, validating after every event and tick
+ * Ticks are folded into *digest (FNV-1a over the schedules) when given.
+ */
+static int run_churn(bool per_cpu, SchedPolicy policy, QueueBackend backend, uint64_t *digest) {
+    Scheduler *sched = scheduler_init(3, 1);
+    if (scheduler_set_policy(sched, policy) != 0 || scheduler_set_runqueue(sched, backend) != 0) {
+        scheduler_destroy(sched);
+        return 1;
+    }
+    if (per_cpu) {
+        scheduler_enable_per_cpu(sched, 3);
+    }
+    static const EventAction actions[] = {
+        EVENT_TASK_CREATE, EVENT_TASK_BLOCK, EVENT_TASK_UNBLOCK,
+        EVENT_TASK_YIELD, EVENT_TASK_EXIT, EVENT_TASK_SETNICE,
+        EVENT_TASK_SET_AFFINITY, EVENT_TASK_MOVE_CGROUP,
+        EVENT_CGROUP_CREATE, EVENT_CGROUP_MODIFY, EVENT_CGROUP_DELETE
+    };
+    unsigned int seed = 7u;
+    int failed = 0;
+    
+    for (int vtime = 0; vtime < 200 && !failed; vtime++) {
+        for (int e = 0; e < 4; e++) {
+            seed = seed * 1103515245u + 12345u;
+            int mask[2] = {(int)((seed >> 3) % 3), (int)((seed >> 5) % 3)};
+            Event event = {0};
+            char task_name[32];
+            char cgroup_name[32];
+            char new_cgroup_name[32];
+            event.action = actions[(seed >> 8) % 11];
+            snprintf(task_name, sizeof(task_name), "T%u", (seed >> 16) % 12);
+            event.task_id = task_name;
+            snprintf(cgroup_name, sizeof(cgroup_name), "G%u", (seed >> 20) % 3);
+            event.cgroup_id = cgroup_name;
+            snprintf(new_cgroup_name, sizeof(new_cgroup_name), "G%u", (seed >> 22) % 3);
+            event.new_cgroup_id = new_cgroup_name;
+            event.nice = (int)((seed >> 4) % 40) - 20;
+            event.cpu_mask = mask;
+            event.cpu_mask_count = 1 + (int)((seed >> 12) % 2);
+            event.has_cpu_mask = (seed >> 14) % 2;
+            event.cpu_quota_us = 1500;
+            event.has_cpu_quota = (seed >> 15) % 2;
+            scheduler_process_event(sched, &event);
+            if (scheduler_validate(sched) != 0) {
+                failed = 1;
+                break;
+            }
+        }
+        
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        for (int cpu = 0; digest && cpu < tick->cpu_count; cpu++) {
+            for (const char *c = tick->schedule[cpu]; *c; c++) {
+                *digest = (*digest ^ (unsigned char)*c) * 1099511628211ull;
+            }
+            *digest = (*digest ^ '|') * 1099511628211ull;
+        }
+        scheduler_tick_free(tick);
+        if (scheduler_validate(sched) != 0) {
+            failed = 1;
+        }
+    }
     
-    Task *task = scheduler_find_task(sched, "B1");
-    if (!task) TEST_FAIL("Task should exist");
-    double before_burst = task->vruntime;
+    scheduler_destroy(sched);
+    return failed;
+}
+
+/**
+ * Test the incrementally maintained run queues match a rebuild under churn
+ */
+static int test_incremental_heap_matches_rebuild(void) {
+    if (run_churn(false, SCHED_POLICY_CFS, QUEUE_HEAP, NULL) != 0) TEST_FAIL("Global run queue diverged from task states");
+    if (run_churn(true, SCHED_POLICY_CFS, QUEUE_HEAP, NULL) != 0) TEST_FAIL("Per-CPU run queues diverged from task states");
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test every run queue backend survives the churn and, being ordered by
+ * the same total order, produces the same ticks as the binary heap
+ */
+static int test_runqueue_backends_agree(void) {
+    uint64_t reference = 14695981039346656037ull;
+    if (run_churn(false, SCHED_POLICY_CFS, QUEUE_HEAP, &reference) != 0) TEST_FAIL("Heap churn failed");
+    
+    for (int b = QUEUE_HEAP4; b < QUEUE_BACKEND_COUNT; b++) {
+        uint64_t digest = 14695981039346656037ull;
+        if (run_churn(false, SCHED_POLICY_CFS, (QueueBackend)b, &digest) != 0) TEST_FAIL("Global churn diverged");
+        if (digest != reference) TEST_FAIL("Backend changed the global schedule");
+        if (run_churn(true, SCHED_POLICY_CFS, (QueueBackend)b, NULL) != 0) TEST_FAIL("Per-CPU churn diverged");
+    }
+    
+    /* Classes keep their backend, so switching is refused once tasks are queued */
+    Scheduler *sched = scheduler_init(2, 1);
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "A";
+    scheduler_process_event(sched, &create);
+    if (scheduler_set_runqueue(sched, QUEUE_RBTREE) == 0) TEST_FAIL("Switch with queued tasks should fail");
+    if (scheduler_set_runqueue(sched, QUEUE_BACKEND_COUNT) == 0) TEST_FAIL("Unknown backend should fail");
+    scheduler_destroy(sched);
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test policy names, that EEVDF switches to the augmented tree and
+ * refuses other backends, and that its state survives the churn
+ */
+static int test_eevdf_policy(void) {
+    SchedPolicy policy = SCHED_POLICY_CFS;
+    if (scheduler_parse_policy("eevdf", &policy) != 0 || policy != SCHED_POLICY_EEVDF) {
+        TEST_FAIL("eevdf should parse");
+    }
+    if (scheduler_parse_policy("fifo", &policy) == 0) TEST_FAIL("Unknown policy should fail");
+    if (strcmp(scheduler_policy_name(SCHED_POLICY_CFS), "cfs") != 0) TEST_FAIL("Bad policy name");
+    
+    Scheduler *sched = scheduler_init(2, 1);
+    if (scheduler_set_policy(sched, SCHED_POLICY_EEVDF) != 0) TEST_FAIL("Failed to select EEVDF");
+    if (sched->runqueue.backend != QUEUE_RBTREE_AUG) TEST_FAIL("EEVDF should use the augmented tree");
+    if (scheduler_set_runqueue(sched, QUEUE_HEAP) == 0) TEST_FAIL("EEVDF should refuse the heap");
+    
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "A";
+    scheduler_process_event(sched, &create);
+    if (scheduler_set_policy(sched, SCHED_POLICY_CFS) == 0) TEST_FAIL("Switch with tasks should fail");
+    scheduler_destroy(sched);
+    
+    if (run_churn(false, SCHED_POLICY_EEVDF, QUEUE_RBTREE_AUG, NULL) != 0) TEST_FAIL("Global EEVDF churn diverged");
+    if (run_churn(true, SCHED_POLICY_EEVDF, QUEUE_RBTREE_AUG, NULL) != 0) TEST_FAIL("Per-CPU EEVDF churn diverged");
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test EEVDF picks the eligible task with the earliest deadline, not the
+ * lowest vruntime, and keeps the lag of a sleeper
+ */
+static int test_eevdf_selection(void) {
+    Scheduler *sched = scheduler_init(1, 1);
+    scheduler_set_policy(sched, SCHED_POLICY_EEVDF);
+    
+    /* A light task's weighted slice puts its deadline far out */
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "A";
+    create.nice = 19;
+    create.has_nice = true;
+    scheduler_process_event(sched, &create);
+    create.task_id = "B";
+    create.has_nice = false;
+    scheduler_process_event(sched, &create);
     
+    /* Both are eligible at the average; B's burst requests a shorter slice */
     Event burst = {0};
     burst.action = EVENT_CPU_BURST;
-    strcpy(burst.task_id, "B1");
+    burst.task_id = "B";
     burst.burst_duration = 2;
     scheduler_process_event(sched, &burst);
     
-    tick = scheduler_tick(sched, 2);
+    Task *a = scheduler_find_task(sched, "A");
+    Task *b = scheduler_find_task(sched, "B");
+    if (b->deadline >= a->deadline) TEST_FAIL("A burst should pull the deadline in");
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    if (strcmp(tick->schedule[0], "B") != 0) TEST_FAIL("Earliest deadline should run first");
     scheduler_tick_free(tick);
-    tick = scheduler_tick(sched, 3);
+    
+    /* B ran ahead of the average: it is ineligible despite a fresh deadline */
+    tick = scheduler_tick(sched, 1);
+    if (strcmp(tick->schedule[0], "A") != 0) TEST_FAIL("Ineligible task should wait");
     scheduler_tick_free(tick);
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Scheduler failed validation");
+    
+    /* A sleeper rejoins as far behind the average as it left */
+    Event block = {0};
+    block.action = EVENT_TASK_BLOCK;
+    block.task_id = "A";
+    scheduler_process_event(sched, &block);
+    vruntime_t lag = a->vlag;
+    vruntime_t avg_vruntime = runqueue_avg_vruntime(&sched->runqueue);
+    if (lag <= 0) TEST_FAIL("A waited behind B, so it should be owed service");
+    block.action = EVENT_TASK_UNBLOCK;
+    scheduler_process_event(sched, &block);
+    if (a->vruntime != avg_vruntime - lag) TEST_FAIL("Lag should be restored on wake-up");
     
-    if (fabs(task->vruntime - before_burst) > 1e-9) {
-        TEST_FAIL("Vruntime should not change during CPU burst");
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run 8 CPU hogs and 2 tasks that sleep and wake every 5 ticks on 2 CPUs;
+ * return the wake-up latency summed over the metadata (or -1)
+ */
+static int run_wakeups(SchedPolicy policy, bool burst_on_wake) {
+    Scheduler *sched = scheduler_init(2, 1);
+    scheduler_set_policy(sched, policy);
+    scheduler_set_latency(sched, true);
+    
+    Event event = {0};
+    char task_name[32];
+    event.action = EVENT_TASK_CREATE;
+    for (int i = 0; i < 10; i++) {
+        snprintf(task_name, sizeof(task_name), i < 8 ? "H%d" : "I%d", i);
+        event.task_id = task_name;
+        scheduler_process_event(sched, &event);
     }
     
-    tick = scheduler_tick(sched, 4);
+    int latency = 0;
+    for (int vtime = 0; vtime < 400; vtime++) {
+        for (int i = 8; i < 10; i++) {
+            Event wake = {0};
+            char task_name[32];
+            snprintf(task_name, sizeof(task_name), "I%d", i);
+            wake.task_id = task_name;
+            if (vtime % 5 == i - 8) {
+                wake.action = EVENT_TASK_BLOCK;
+                scheduler_process_event(sched, &wake);
+            } else if (vtime % 5 == i - 6) {
+                wake.action = EVENT_TASK_UNBLOCK;
+                scheduler_process_event(sched, &wake);
+                if (burst_on_wake) {
+                    wake.action = EVENT_CPU_BURST;
+                    wake.burst_duration = 1;
+                    scheduler_process_event(sched, &wake);
+                }
+            }
+        }
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        if (!tick->meta->has_latency) {
+            latency = -1;
+        }
+        if (latency >= 0 && vtime >= 10) {
+            latency += tick->meta->wakeup_latency;
+        }
+        scheduler_tick_free(tick);
+    }
+    
+    scheduler_destroy(sched);
+    return latency;
+}
+
+/**
+ * Test the wake-up latency counters, and that under EEVDF tasks waking
+ * into a short CPU_BURST slice wait less than the same tasks without one
+ */
+static int test_wakeup_latency(void) {
+    Scheduler *sched = scheduler_init(1, 1);
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "A";
+    scheduler_process_event(sched, &create);
+    create.task_id = "B";
+    scheduler_process_event(sched, &create);
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    if (tick->meta->has_latency) TEST_FAIL("Latency should be off by default");
+    if (tick->meta->wakeups != 1 || tick->meta->wakeup_latency != 0) TEST_FAIL("First run should wait 0 ticks");
+    scheduler_tick_free(tick);
+    tick = scheduler_tick(sched, 1);
+    if (tick->meta->wakeups != 1 || tick->meta->wakeup_latency != 1) TEST_FAIL("Second task should wait 1 tick");
     scheduler_tick_free(tick);
+    tick = scheduler_tick(sched, 2);
+    if (tick->meta->wakeups != 0) TEST_FAIL("Tasks that already ran are not wake-ups");
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
     
-    if (task->vruntime <= before_burst) {
-        TEST_FAIL("Vruntime should increase after burst finishes");
+    int plain = run_wakeups(SCHED_POLICY_EEVDF, false);
+    int burst = run_wakeups(SCHED_POLICY_EEVDF, true);
+    if (plain < 0 || burst < 0) TEST_FAIL("Latency should be reported");
+    if (burst >= plain) TEST_FAIL("Short slices should cut wake-up latency");
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run the 8-task/4-CPU workload and return total migrations (or -1)
+ */
+static int count_migrations(bool per_cpu) {
+    Scheduler *sched = scheduler_init(4, 1);
+    if (per_cpu) {
+        scheduler_enable_per_cpu(sched, 4);
+    }
+    
+    for (int i = 0; i < 8; i++) {
+        Event create = {0};
+        char task_name[32];
+        create.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "T%d", i);
+        create.task_id = task_name;
+        create.nice = (i % 3) * 5;
+        create.has_nice = true;
+        scheduler_process_event(sched, &create);
+    }
+    
+    int migrations = 0;
+    for (int vtime = 0; vtime < 100; vtime++) {
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        migrations += tick->meta->migrations;
+        scheduler_tick_free(tick);
+        if (scheduler_validate(sched) != 0) {
+            migrations = -1;
+            break;
+        }
+    }
+    
+    scheduler_destroy(sched);
+    return migrations;
+}
+
+/**
+ * Test per-CPU run queues keep tasks on their home CPU
+ */
+static int test_per_cpu_fewer_migrations(void) {
+    int global = count_migrations(false);
+    int per_cpu = count_migrations(true);
+    
+    if (global < 0 || per_cpu < 0) TEST_FAIL("Run queues diverged from task states");
+    if (per_cpu >= global) TEST_FAIL("Per-CPU queues should migrate less than the global heap");
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test idle CPUs steal work without violating affinity or cgroup masks
+ */
+static int test_per_cpu_steal_respects_masks(void) {
+    Scheduler *sched = scheduler_init(4, 1);
+    scheduler_enable_per_cpu(sched, 0);
+    
+    int group_mask[] = {2, 3};
+    Event group = {0};
+    group.action = EVENT_CGROUP_CREATE;
+    group.cgroup_id = "g";
+    group.cpu_mask = group_mask;
+    group.cpu_mask_count = 2;
+    group.has_cpu_mask = true;
+    scheduler_process_event(sched, &group);
+    
+    /* Four tasks pinned to CPU 1, two confined to CPUs 2-3 by their cgroup */
+    int pin_mask[] = {1};
+    for (int i = 0; i < 6; i++) {
+        Event create = {0};
+        char task_name[32];
+        create.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "T%d", i);
+        create.task_id = task_name;
+        if (i < 4) {
+            create.cpu_mask = pin_mask;
+            create.cpu_mask_count = 1;
+            create.has_cpu_mask = true;
+        } else {
+            create.cgroup_id = "g";
+        }
+        scheduler_process_event(sched, &create);
+    }
+    
+    for (int vtime = 0; vtime < 20; vtime++) {
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        for (int cpu = 0; cpu < 4; cpu++) {
+            const char *id = tick->schedule[cpu];
+            bool pinned = id[0] == 'T' && id[1] < '4';
+            bool grouped = id[0] == 'T' && id[1] >= '4';
+            if (cpu == 0 && strcmp(id, "idle") != 0) TEST_FAIL("CPU 0 should stay idle");
+            if (pinned && cpu != 1) TEST_FAIL("Pinned task stolen onto the wrong CPU");
+            if (grouped && cpu < 2) TEST_FAIL("Cgroup mask violated by stealing");
+            if (cpu >= 1 && strcmp(id, "idle") == 0) TEST_FAIL("CPU with eligible work left idle");
+        }
+        scheduler_tick_free(tick);
+        if (scheduler_validate(sched) != 0) TEST_FAIL("Run queues diverged from task states");
+    }
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Drive a seeded per-CPU load with quota-limited cgroups, affinity masks
+ * and enough blocking that idle CPUs steal, folding every schedule into
+ * *digest; *retries gets the picks the parallel merge had to redo
+ */
+static int run_parallel_load(int threads, SchedPolicy policy, uint64_t *digest, uint64_t *retries) {
+    Scheduler *sched = scheduler_init(16, 1);
+    scheduler_set_policy(sched, policy);
+    scheduler_enable_per_cpu(sched, 2);
+    if (scheduler_enable_parallel_tick(sched, threads) != 0) {
+        scheduler_destroy(sched);
+        return 1;
+    }
+    if (STATS_COMPILED) {
+        scheduler_enable_stats(sched, 0);
+    }
+    
+    for (int g = 0; g < 4; g++) {
+        Event group = {0};
+        char cgroup_name[32];
+        group.action = EVENT_CGROUP_CREATE;
+        snprintf(cgroup_name, sizeof(cgroup_name), "G%d", g);
+        group.cgroup_id = cgroup_name;
+        group.cpu_quota_us = 2000 + g * 1000;
+        group.has_cpu_quota = g < 3;
+        scheduler_process_event(sched, &group);
+    }
+    
+    unsigned int seed = 11u;
+    int failed = 0;
+    for (int vtime = 0; vtime < 300 && !failed; vtime++) {
+        for (int e = 0; e < 6; e++) {
+            seed = seed * 1103515245u + 12345u;
+            int mask[3] = {(int)((seed >> 3) % 16), (int)((seed >> 7) % 16), (int)((seed >> 11) % 16)};
+            Event event = {0};
+            char task_name[32];
+            char cgroup_name[32];
+            char new_cgroup_name[32];
+            static const EventAction actions[] = {
+                EVENT_TASK_CREATE, EVENT_TASK_CREATE, EVENT_TASK_BLOCK, EVENT_TASK_UNBLOCK,
+                EVENT_TASK_YIELD, EVENT_TASK_SET_AFFINITY, EVENT_TASK_MOVE_CGROUP, EVENT_TASK_EXIT
+            };
+            event.action = actions[(seed >> 16) % 8];
+            snprintf(task_name, sizeof(task_name), "T%u", (seed >> 20) % 80);
+            event.task_id = task_name;
+            snprintf(cgroup_name, sizeof(cgroup_name), "G%u", (seed >> 24) % 4);
+            event.cgroup_id = cgroup_name;
+            snprintf(new_cgroup_name, sizeof(new_cgroup_name), "G%u", (seed >> 26) % 4);
+            event.new_cgroup_id = new_cgroup_name;
+            event.nice = (int)((seed >> 4) % 40) - 20;
+            event.cpu_mask = mask;
+            event.cpu_mask_count = 1 + (int)((seed >> 13) % 3);
+            event.has_cpu_mask = (seed >> 15) % 3 == 0;
+            scheduler_process_event(sched, &event);
+        }
+        
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        for (int cpu = 0; cpu < tick->cpu_count; cpu++) {
+            for (const char *c = tick->schedule[cpu]; *c; c++) {
+                *digest = (*digest ^ (unsigned char)*c) * 1099511628211ull;
+            }
+            *digest = (*digest ^ '|') * 1099511628211ull;
+        }
+        scheduler_tick_free(tick);
+        failed = scheduler_validate(sched) != 0;
+    }
+    
+    *retries = sched->stats ? atomic_load(&sched->stats->counters[STAT_PICK_RETRY]) : 0;
+    scheduler_destroy(sched);
+    return failed;
+}
+
+/**
+ * Test the parallel tick reproduces the serial schedule exactly, with
+ * steals and quota reservations forcing some picks back to the merge
+ */
+static int test_parallel_tick_matches_serial(void) {
+    static const SchedPolicy policies[] = {SCHED_POLICY_CFS, SCHED_POLICY_EEVDF};
+    for (int p = 0; p < 2; p++) {
+        uint64_t reference = 14695981039346656037ull;
+        uint64_t retries = 0;
+        if (run_parallel_load(1, policies[p], &reference, &retries) != 0) TEST_FAIL("Serial load failed");
+        if (retries != 0) TEST_FAIL("Serial ticks should never retry");
+        
+        for (int threads = 2; threads <= 5; threads += 3) {
+            uint64_t digest = 14695981039346656037ull;
+            if (run_parallel_load(threads, policies[p], &digest, &retries) != 0) TEST_FAIL("Parallel load failed");
+            if (digest != reference) TEST_FAIL("Parallel tick changed the schedule");
+            if (STATS_COMPILED && retries == 0) TEST_FAIL("Load should invalidate some parallel picks");
+        }
+    }
+    
+    /* The CPUs of a global run queue pick from the same queue */
+    Scheduler *sched = scheduler_init(4, 1);
+    if (scheduler_enable_parallel_tick(sched, 2) == 0) TEST_FAIL("Parallel tick needs per-CPU queues");
+    if (scheduler_enable_parallel_tick(sched, 1) != 0) TEST_FAIL("Serial tick is always allowed");
+    scheduler_destroy(sched);
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test capacity lists parse, and runtime on a smaller CPU is charged to
+ * vruntime and cgroup quota at that CPU's share of the fastest core
+ */
+static int test_capacity_accounting(void) {
+    int capacity[8];
+    if (scheduler_parse_capacity("4x1024,4x512", capacity, 8) != 0 ||
+        capacity[3] != 1024 || capacity[4] != 512) TEST_FAIL("Repeat syntax not parsed");
+    if (scheduler_parse_capacity("1024,768,512,256", capacity, 4) != 0 ||
+        capacity[1] != 768) TEST_FAIL("Plain list not parsed");
+    if (scheduler_parse_capacity("2x1024", capacity, 4) == 0) TEST_FAIL("Short list accepted");
+    if (scheduler_parse_capacity("3x1024,2x512", capacity, 4) == 0) TEST_FAIL("Long list accepted");
+    if (scheduler_parse_capacity("1024,1025", capacity, 2) == 0 ||
+        scheduler_parse_capacity("0,512", capacity, 2) == 0 ||
+        scheduler_parse_capacity("1024,", capacity, 2) == 0) TEST_FAIL("Bad capacity accepted");
+    
+    Scheduler *sched = scheduler_init(2, 1);
+    int caps[] = {1024, 256};
+    if (scheduler_set_capacity(sched, caps, 1) == 0) TEST_FAIL("Capacity count not checked");
+    if (scheduler_set_capacity(sched, caps, 2) != 0) TEST_FAIL("Failed to set capacity");
+    
+    Event group = {0};
+    group.action = EVENT_CGROUP_CREATE;
+    group.cgroup_id = "g";
+    group.cpu_quota_us = 50000;
+    group.has_cpu_quota = true;
+    scheduler_process_event(sched, &group);
+    
+    /* A runs on the big CPU, B on the quarter-capacity one */
+    for (int i = 0; i < 2; i++) {
+        int mask[] = {i};
+        Event create = {0};
+        create.action = EVENT_TASK_CREATE;
+        create.task_id = i == 0 ? "A" : "B";
+        create.cgroup_id = "g";
+        create.cpu_mask = mask;
+        create.cpu_mask_count = 1;
+        create.has_cpu_mask = true;
+        scheduler_process_event(sched, &create);
+    }
+    
+    /* Nine ticks charge the first eight quanta */
+    for (int vtime = 0; vtime < 9; vtime++) {
+        scheduler_tick_free(scheduler_tick(sched, vtime));
+    }
+    
+    Task *a = scheduler_find_task(sched, "A");
+    Task *b = scheduler_find_task(sched, "B");
+    if (a->vruntime != 8 * vruntime_delta(1.0, a->inv_weight)) TEST_FAIL("Big CPU charge wrong");
+    if (b->vruntime != 8 * vruntime_delta(0.25, b->inv_weight)) TEST_FAIL("Small CPU not scaled");
+    if (scheduler_find_cgroup(sched, "g")->quota_used != 8 * 1000.0 + 8 * 250.0) {
+        TEST_FAIL("Quota not charged by capacity");
+    }
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test PELT utilization: it saturates at the capacity of the CPU a task
+ * runs on and halves every PELT_HALFLIFE ticks once the task blocks
+ */
+static int test_pelt_utilization(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    int caps[] = {1024, 512};
+    scheduler_set_capacity(sched, caps, 2);
+    
+    for (int i = 0; i < 2; i++) {
+        int mask[] = {i};
+        Event create = {0};
+        create.action = EVENT_TASK_CREATE;
+        create.task_id = i == 0 ? "big" : "little";
+        create.cpu_mask = mask;
+        create.cpu_mask_count = 1;
+        create.has_cpu_mask = true;
+        scheduler_process_event(sched, &create);
+    }
+    
+    int vtime = 0;
+    for (; vtime < 300; vtime++) {
+        scheduler_tick_free(scheduler_tick(sched, vtime));
+    }
+    int big = scheduler_get_task_util(sched, "big");
+    int little = scheduler_get_task_util(sched, "little");
+    if (big < 1000 || big > SCHED_CAPACITY_SCALE) TEST_FAIL("Busy task should reach full utilization");
+    if (little < 490 || little > 512) TEST_FAIL("Utilization should be capacity-invariant");
+    
+    Event block = {0};
+    block.action = EVENT_TASK_BLOCK;
+    block.task_id = "big";
+    scheduler_process_event(sched, &block);
+    for (int end = vtime + PELT_HALFLIFE; vtime < end; vtime++) {
+        scheduler_tick_free(scheduler_tick(sched, vtime));
+    }
+    int decayed = scheduler_get_task_util(sched, "big");
+    if (decayed < big / 2 - 32 || decayed > big / 2 + 32) TEST_FAIL("Blocked utilization should halve");
+    if (scheduler_get_task_util(sched, "none") != -1) TEST_FAIL("Unknown task should report -1");
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test misfit migration on a little + big pair with per-CPU queues: a
+ * CPU-bound task starting on the little core moves to the big one once
+ * its utilization outgrows the little core, and a mostly sleeping task
+ * is left on the little core
+ */
+static int test_misfit_migration(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    int caps[] = {512, 1024};
+    scheduler_set_capacity(sched, caps, 2);
+    scheduler_enable_per_cpu(sched, 4);
+    
+    const char *ids[] = {"heavy", "light"};
+    for (int i = 0; i < 2; i++) {
+        Event create = {0};
+        create.action = EVENT_TASK_CREATE;
+        create.task_id = ids[i];
+        scheduler_process_event(sched, &create);
+    }
+    
+    int heavy_early_little = 0;
+    int heavy_late_big = 0;
+    int light_late_big = 0;
+    for (int vtime = 0; vtime < 300; vtime++) {
+        /* light runs about one tick in four */
+        Event event = {0};
+        event.action = vtime % 4 == 1 ? EVENT_TASK_BLOCK : EVENT_TASK_UNBLOCK;
+        event.task_id = "light";
+        if (vtime % 4 <= 1) {
+            scheduler_process_event(sched, &event);
+        }
+        
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        if (vtime < 10 && strcmp(tick->schedule[0], "heavy") == 0) {
+            heavy_early_little++;
+        }
+        if (vtime >= 200) {
+            heavy_late_big += strcmp(tick->schedule[1], "heavy") == 0;
+            light_late_big += strcmp(tick->schedule[1], "light") == 0;
+        }
+        scheduler_tick_free(tick);
+        if (scheduler_validate(sched) != 0) TEST_FAIL("Run queues diverged from task states");
+    }
+    
+    if (heavy_early_little < 10) TEST_FAIL("Heavy task should start on the little core");
+    if (heavy_late_big < 100) TEST_FAIL("Misfit task not moved to the big core");
+    if (light_late_big > 0) TEST_FAIL("Light task should stay on the little core");
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+static int test_hot_path_stats(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    if (!STATS_COMPILED) {
+        if (scheduler_enable_stats(sched, 0) == 0) TEST_FAIL("Stats enabled in an ALFS_NO_STATS build");
+        scheduler_destroy(sched);
+        TEST_PASS();
+        return 0;
+    }
+    if (scheduler_enable_stats(sched, 0) != 0) TEST_FAIL("Failed to enable stats");
+    
+    /* Three tasks on two CPUs, one of them pinned to CPU 1 */
+    for (int i = 0; i < 3; i++) {
+        Event create = {0};
+        char task_name[32];
+        create.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "t%d", i);
+        create.task_id = task_name;
+        scheduler_process_event(sched, &create);
+    }
+    int cpus[] = {1};
+    Event pin = {0};
+    pin.action = EVENT_TASK_SET_AFFINITY;
+    pin.task_id = "t0";
+    pin.cpu_mask = cpus;
+    pin.cpu_mask_count = 1;
+    pin.has_cpu_mask = true;
+    scheduler_process_event(sched, &pin);
+    
+    for (int vtime = 0; vtime < 10; vtime++) {
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        scheduler_tick_free(tick);
+    }
+    
+    SchedStats *stats = sched->stats;
+    if (atomic_load(&stats->phases[STAT_EVENT + EVENT_TASK_CREATE].count) != 3) {
+        TEST_FAIL("Create events not timed");
+    }
+    if (atomic_load(&stats->phases[STAT_EVENT + EVENT_TASK_SET_AFFINITY].count) != 1) {
+        TEST_FAIL("Affinity event not timed");
+    }
+    if (atomic_load(&stats->phases[STAT_TICK].count) != 10 ||
+        atomic_load(&stats->phases[STAT_TICK_PICK].count) != 10) {
+        TEST_FAIL("Every tick should be timed");
+    }
+    if (atomic_load(&stats->phases[STAT_TICK_BALANCE].count) != 0) {
+        TEST_FAIL("Global queue mode never balances");
+    }
+    
+    /* Both CPUs run every tick: 20 picks, 18 of them put back later */
+    if (atomic_load(&stats->counters[STAT_QUEUE_EXTRACT]) != 20 ||
+        atomic_load(&stats->counters[STAT_QUEUE_REINSERT]) != 18) {
+        TEST_FAIL("Queue operations miscounted");
+    }
+    if (atomic_load(&stats->counters[STAT_IDLE]) != 0) TEST_FAIL("No CPU should idle");
+    
+    uint64_t bucketed = 0;
+    for (int i = 0; i < STATS_BUCKETS; i++) {
+        bucketed += atomic_load(&stats->phases[STAT_TICK].buckets[i]);
+    }
+    if (bucketed != 10) TEST_FAIL("Histogram buckets do not add up to the count");
+    
+    char *report = NULL;
+    size_t length = 0;
+    FILE *out = open_memstream(&report, &length);
+    stats_report(stats, out);
+    fclose(out);
+    if (!strstr(report, "\"TASK_CREATE\":{\"count\":3,") || !strstr(report, "\"queueExtract\":20") ||
+        strstr(report, "tick.balance") || report[length - 1] != '\n') {
+        TEST_FAIL("Unexpected report line");
+    }
+    free(report);
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+#define BATCH_EVENTS 10
+
+/**
+ * Lockstep a scheduler fed one event at a time against one fed whole
+ * frames through scheduler_process_events; frames are dense in repeated
+ * SETNICE and CPU_BURST events on few tasks, so many are superseded
+ * @return 0 if every tick, task and failure count matched
+ */
+static int run_batched(bool per_cpu, SchedPolicy policy, uint64_t *coalesced) {
+    Scheduler *single = scheduler_init(3, 1);
+    Scheduler *batched = scheduler_init(3, 1);
+    Scheduler *both[2] = {single, batched};
+    for (int s = 0; s < 2; s++) {
+        scheduler_set_policy(both[s], policy);
+        if (per_cpu) {
+            scheduler_enable_per_cpu(both[s], 3);
+        }
+    }
+    scheduler_enable_stats(batched, 0);
+    
+    static const EventAction actions[] = {
+        EVENT_TASK_CREATE, EVENT_TASK_BLOCK, EVENT_TASK_UNBLOCK,
+        EVENT_TASK_YIELD, EVENT_TASK_EXIT, EVENT_TASK_SETNICE,
+        EVENT_TASK_SETNICE, EVENT_CPU_BURST, EVENT_CPU_BURST,
+        EVENT_TASK_SET_AFFINITY, EVENT_TASK_MOVE_CGROUP,
+        EVENT_CGROUP_CREATE, EVENT_CGROUP_MODIFY
+    };
+    unsigned int seed = 11u;
+    int mask[2] = {0, 2};
+    char names[BATCH_EVENTS][3][16];
+    int failed = 0;
+    
+    for (int vtime = 0; vtime < 300 && !failed; vtime++) {
+        Event events[BATCH_EVENTS] = {{0}};
+        for (int e = 0; e < BATCH_EVENTS; e++) {
+            seed = seed * 1103515245u + 12345u;
+            Event *event = &events[e];
+            event->action = actions[(seed >> 8) % 13];
+            snprintf(names[e][0], sizeof(names[e][0]), "T%u", (seed >> 16) % 5);
+            snprintf(names[e][1], sizeof(names[e][1]), "G%u", (seed >> 20) % 2);
+            snprintf(names[e][2], sizeof(names[e][2]), "G%u", (seed >> 22) % 2);
+            event->task_id = names[e][0];
+            event->cgroup_id = names[e][1];
+            event->new_cgroup_id = names[e][2];
+            event->nice = (int)((seed >> 4) % 40) - 20;
+            event->has_nice = true;
+            event->burst_duration = 1 + (int)((seed >> 12) % 4);
+            event->cpu_mask = mask;
+            event->cpu_mask_count = 1 + (int)((seed >> 13) % 2);
+            event->has_cpu_mask = (seed >> 14) % 2;
+            event->cpu_shares = 512 + (int)((seed >> 10) % 1024);
+            event->has_cpu_shares = true;
+        }
+        
+        int rejected = 0;
+        for (int e = 0; e < BATCH_EVENTS; e++) {
+            rejected += scheduler_process_event(single, &events[e]) < 0;
+        }
+        if (scheduler_process_events(batched, events, BATCH_EVENTS) != rejected ||
+            scheduler_validate(batched) != 0) {
+            failed = 1;
+            break;
+        }
+        
+        SchedulerTick *a = scheduler_tick(single, vtime);
+        SchedulerTick *b = scheduler_tick(batched, vtime);
+        for (int cpu = 0; cpu < a->cpu_count; cpu++) {
+            failed |= strcmp(a->schedule[cpu], b->schedule[cpu]) != 0;
+        }
+        scheduler_tick_free(a);
+        scheduler_tick_free(b);
+        for (int t = 0; t < 5 && !failed; t++) {
+            char id[16];
+            snprintf(id, sizeof(id), "T%d", t);
+            Task *x = scheduler_find_task(single, id);
+            Task *y = scheduler_find_task(batched, id);
+            failed = !x != !y || (x && (x->vruntime != y->vruntime || x->weight != y->weight ||
+                                        x->burst_remaining != y->burst_remaining));
+        }
+    }
+    
+    *coalesced = STATS_COMPILED ? atomic_load(&batched->stats->counters[STAT_EVENT_COALESCED]) : 0;
+    scheduler_destroy(single);
+    scheduler_destroy(batched);
+    return failed;
+}
+
+/**
+ * Test batched event processing skips superseded events yet matches
+ * processing every event, for both policies and queue modes
+ */
+static int test_batched_events(void) {
+    uint64_t coalesced = 0;
+    if (run_batched(false, SCHED_POLICY_CFS, &coalesced) != 0) TEST_FAIL("Global CFS batch diverged");
+    if (STATS_COMPILED && coalesced == 0) TEST_FAIL("Nothing was coalesced");
+    if (run_batched(true, SCHED_POLICY_CFS, &coalesced) != 0) TEST_FAIL("Per-CPU CFS batch diverged");
+    if (run_batched(true, SCHED_POLICY_EEVDF, &coalesced) != 0) TEST_FAIL("Per-CPU EEVDF batch diverged");
+    if (STATS_COMPILED && coalesced == 0) TEST_FAIL("EEVDF should still coalesce SETNICE");
+    
+    /* Only the last nice counts; a cgroup event in between keeps both */
+    Scheduler *sched = scheduler_init(1, 1);
+    scheduler_enable_stats(sched, 0);
+    Event events[5] = {{0}};
+    events[0].action = EVENT_TASK_CREATE;
+    events[0].task_id = "A";
+    events[1].action = EVENT_TASK_SETNICE;
+    events[1].task_id = "A";
+    events[1].nice = 5;
+    events[2].action = EVENT_TASK_SETNICE;
+    events[2].task_id = "A";
+    events[2].nice = -3;
+    events[3].action = EVENT_CGROUP_CREATE;
+    events[3].cgroup_id = "G";
+    events[4].action = EVENT_TASK_SETNICE;
+    events[4].task_id = "A";
+    events[4].nice = 2;
+    if (scheduler_process_events(sched, events, 5) != 0) TEST_FAIL("Batch should succeed");
+    if (scheduler_find_task(sched, "A")->nice != 2) TEST_FAIL("Last nice should win");
+    if (STATS_COMPILED && atomic_load(&sched->stats->counters[STAT_EVENT_COALESCED]) != 1) {
+        TEST_FAIL("Only the first SETNICE is superseded");
+    }
+    if (scheduler_process_events(sched, NULL, 0) != 0) TEST_FAIL("Empty batch should succeed");
+    if (scheduler_process_events(NULL, events, 5) != -1) TEST_FAIL("NULL scheduler should fail");
+    scheduler_destroy(sched);
+    
+    TEST_PASS();
+    return 0;
+}
+
+#define DELTA_TASKS 12
+
+/**
+ * Index of a churn task ID ("T<n>")
+ */
+static int churn_task(const char *id) {
+    return atoi(id + 1);
+}
+
+/**
+ * Test delta ticks rebuild the full ticks: a scheduler with delta output
+ * runs in lockstep with one without, and applying its changes to the
+ * last keyframe gives the same schedule and task lists every tick
+ */
+static int test_delta_ticks(void) {
+    Scheduler *full = scheduler_init(3, 1);
+    Scheduler *delta = scheduler_init(3, 1);
+    if (scheduler_set_delta(delta, -1) == 0) TEST_FAIL("Negative interval should fail");
+    if (scheduler_set_delta(delta, 5) != 0) TEST_FAIL("Failed to enable deltas");
+    scheduler_enable_per_cpu(full, 3);
+    scheduler_enable_per_cpu(delta, 3);
+    SchedulerTick *a = scheduler_tick_create(full);
+    SchedulerTick *b = scheduler_tick_create(delta);
+    
+    static const EventAction actions[] = {
+        EVENT_TASK_CREATE, EVENT_TASK_CREATE, EVENT_TASK_BLOCK, EVENT_TASK_UNBLOCK,
+        EVENT_TASK_EXIT, EVENT_TASK_YIELD, EVENT_TASK_SET_AFFINITY
+    };
+    char schedule[3][16] = {"idle", "idle", "idle"};
+    int listed[DELTA_TASKS] = {0};      /* 0 = none, 1 = runnable, 2 = blocked */
+    unsigned int seed = 5u;
+    int mask[1] = {1};
+    int deltas = 0;
+    
+    for (int vtime = 0; vtime < 400; vtime++) {
+        for (int e = 0; e < 3; e++) {
+            seed = seed * 1103515245u + 12345u;
+            char task_name[16];
+            snprintf(task_name, sizeof(task_name), "T%u", (seed >> 16) % DELTA_TASKS);
+            Event event = {0};
+            event.action = actions[(seed >> 8) % 7];
+            event.task_id = task_name;
+            event.cpu_mask = mask;
+            event.cpu_mask_count = 1;
+            scheduler_process_event(full, &event);
+            scheduler_process_event(delta, &event);
+        }
+        if (scheduler_tick_into(full, vtime, a) < 0 || scheduler_tick_into(delta, vtime, b) < 0) {
+            TEST_FAIL("Tick failed");
+        }
+        if (b->delta == (vtime % 5 == 0)) TEST_FAIL("Every fifth tick should be a keyframe");
+        
+        /* Apply the tick, then compare with the full one */
+        const SchedulerMeta *meta = b->meta;
+        if (b->delta) {
+            deltas++;
+            for (int i = 0; i < b->changed_count; i++) {
+                int cpu = b->changed_cpus[i];
+                if (i > 0 && cpu <= b->changed_cpus[i - 1]) TEST_FAIL("Changed CPUs out of order");
+                if (strcmp(schedule[cpu], b->schedule[cpu]) == 0) TEST_FAIL("Unchanged CPU listed");
+            }
+            for (int i = 0; i < meta->removed_count; i++) {
+                listed[churn_task(meta->removed_tasks[i])] = 0;
+            }
+        } else {
+            memset(listed, 0, sizeof(listed));
+        }
+        for (int cpu = 0; cpu < b->cpu_count; cpu++) {
+            if (!b->delta || strcmp(schedule[cpu], b->schedule[cpu]) != 0) {
+                bool changed = false;
+                for (int i = 0; i < b->changed_count; i++) {
+                    changed |= b->changed_cpus[i] == cpu;
+                }
+                if (b->delta && !changed) TEST_FAIL("Changed CPU left out of the delta");
+                snprintf(schedule[cpu], sizeof(schedule[cpu]), "%s", b->schedule[cpu]);
+            }
+            if (strcmp(schedule[cpu], a->schedule[cpu]) != 0) TEST_FAIL("Rebuilt schedule differs");
+        }
+        for (int i = 0; i < meta->runnable_count; i++) {
+            listed[churn_task(meta->runnable_tasks[i])] = 1;
+        }
+        for (int i = 0; i < meta->blocked_count; i++) {
+            listed[churn_task(meta->blocked_tasks[i])] = 2;
+        }
+        
+        int expected[DELTA_TASKS] = {0};
+        for (int i = 0; i < a->meta->runnable_count; i++) {
+            expected[churn_task(a->meta->runnable_tasks[i])] = 1;
+        }
+        for (int i = 0; i < a->meta->blocked_count; i++) {
+            expected[churn_task(a->meta->blocked_tasks[i])] = 2;
+        }
+        if (memcmp(listed, expected, sizeof(listed)) != 0) TEST_FAIL("Rebuilt task lists differ");
+    }
+    if (deltas != 320) TEST_FAIL("Expected 320 delta ticks");
+    
+    /* Re-enabling forgets what was sent, so the next tick is full */
+    scheduler_set_delta(delta, 5);
+    if (scheduler_tick_into(delta, 400, b) < 0 || b->delta) TEST_FAIL("Expected a keyframe");
+    
+    scheduler_tick_free(a);
+    scheduler_tick_free(b);
+    scheduler_destroy(full);
+    scheduler_destroy(delta);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test ticks keep their task lists while no task changes list: two
+ * alternating ticks (as in the pipeline) list exactly what a fresh tick
+ * lists, and reuse their entries until a task blocks, wakes or exits
+ */
+static int test_list_horizon(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    SchedulerTick *ticks[2] = {scheduler_tick_create(sched), scheduler_tick_create(sched)};
+    if (!ticks[0] || !ticks[1]) TEST_FAIL("Failed to create ticks");
+    
+    char task_name[16];
+    for (int i = 0; i < 6; i++) {
+        Event create = {0};
+        create.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "T%d", i);
+        create.task_id = task_name;
+        scheduler_process_event(sched, &create);
+    }
+    int other_ids = idtable_count(sched->ids) - sched->task_count;     /* Cgroup IDs */
+    
+    int kept = 0;
+    for (int vtime = 0; vtime < 60; vtime++) {
+        Event event = {0};
+        snprintf(task_name, sizeof(task_name), "T%d", vtime % 6);
+        event.task_id = task_name;
+        event.nice = vtime % 7;
+        event.has_nice = true;
+        event.action = vtime % 10 == 3 ? EVENT_TASK_BLOCK :
+                       vtime % 10 == 6 ? EVENT_TASK_UNBLOCK :
+                       vtime % 20 == 9 ? EVENT_TASK_EXIT :
+                       vtime % 20 == 19 ? EVENT_TASK_CREATE : EVENT_TASK_SETNICE;
+        uint64_t epoch = sched->list_epoch;
+        scheduler_process_event(sched, &event);
+        bool moved = sched->list_epoch != epoch;
+        if (event.action == EVENT_TASK_SETNICE && moved) TEST_FAIL("SETNICE moved no task between lists");
+        
+        SchedulerTick *tick = ticks[vtime % 2];
+        IdEntry *first = tick->meta->runnable_count > 0 ? tick->meta->task_entries[0] : NULL;
+        bool current = tick->list_epoch == sched->list_epoch;
+        if (scheduler_tick_into(sched, vtime, tick) < 0) TEST_FAIL("Tick failed");
+        if (current) {
+            kept++;
+            if (tick->meta->runnable_count > 0 && tick->meta->task_entries[0] != first) {
+                TEST_FAIL("Current lists should be kept");
+            }
+        }
+        
+        /* Compare with the lists the state column gives now */
+        if (tick->list_serial != sched->list_serial || tick->list_epoch != sched->list_epoch) {
+            TEST_FAIL("Lists should carry the scheduler's version");
+        }
+        const char *expected[16];
+        int runnable = 0, listed = 0;
+        for (int pass = 0; pass < 2; pass++) {
+            for (int i = 0; i < sched->task_count; i++) {
+                uint8_t state = sched->task_states[i];
+                bool runs = state == TASK_STATE_RUNNABLE || state == TASK_STATE_RUNNING;
+                if (pass == 0 ? runs : state == TASK_STATE_BLOCKED) {
+                    expected[listed++] = sched->task_entries[i]->str;
+                }
+            }
+            if (pass == 0) {
+                runnable = listed;
+            }
+        }
+        if (tick->meta->runnable_count != runnable || tick->meta->blocked_count != listed - runnable) {
+            TEST_FAIL("Kept lists have the wrong length");
+        }
+        for (int i = 0; i < listed; i++) {
+            if (tick->meta->runnable_tasks[i] != expected[i]) TEST_FAIL("Kept lists differ from fresh lists");
+        }
+    }
+    if (kept == 0) TEST_FAIL("Some ticks should keep their lists");
+    
+    scheduler_tick_free(ticks[0]);
+    scheduler_tick_free(ticks[1]);
+    if (idtable_count(sched->ids) != sched->task_count + other_ids) {
+        TEST_FAIL("Freed ticks should release every kept ID");
+    }
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test tasks sharing a CPU mask and cgroup share one affinity class, and
+ * picks for other CPUs leave that class untouched
+ */
+static int test_affinity_classes(void) {
+    Scheduler *sched = scheduler_init(4, 1);
+    
+    /* T0-T7 pinned to CPU 3, F0-F3 unrestricted */
+    int pin_mask[] = {3};
+    for (int i = 0; i < 12; i++) {
+        Event create = {0};
+        char task_name[32];
+        create.action = EVENT_TASK_CREATE;
+        if (i < 8) {
+            snprintf(task_name, sizeof(task_name), "T%d", i);
+            create.task_id = task_name;
+            create.cpu_mask = pin_mask;
+            create.cpu_mask_count = 1;
+            create.has_cpu_mask = true;
+        } else {
+            snprintf(task_name, sizeof(task_name), "F%d", i - 8);
+            create.task_id = task_name;
+        }
+        scheduler_process_event(sched, &create);
+    }
+    
+    Task *t0 = scheduler_find_task(sched, "T0");
+    Task *t5 = scheduler_find_task(sched, "T5");
+    Task *f0 = scheduler_find_task(sched, "F0");
+    if (!t0->tclass || t0->tclass != t5->tclass) TEST_FAIL("Pinned tasks should share a class");
+    if (t0->tclass == f0->tclass) TEST_FAIL("Unrestricted tasks need their own class");
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    for (int cpu = 0; cpu < 3; cpu++) {
+        if (tick->schedule[cpu][0] != 'F') TEST_FAIL("CPUs 0-2 should run unrestricted tasks");
+    }
+    if (strcmp(tick->schedule[3], "T0") != 0) TEST_FAIL("CPU 3 should run the first pinned task");
+    scheduler_tick_free(tick);
+    
+    /* Queued pinned tasks were never moved by the picks for CPUs 0-2 */
+    if (taskqueue_size(&t5->tclass->queue) != 7) TEST_FAIL("Pinned class should still hold 7 tasks");
+    
+    /* Affinity change moves the task to its new class */
+    int any_mask[] = {0, 1, 2, 3};
+    Event affinity = {0};
+    affinity.action = EVENT_TASK_SET_AFFINITY;
+    affinity.task_id = "T5";
+    affinity.cpu_mask = any_mask;
+    affinity.cpu_mask_count = 4;
+    scheduler_process_event(sched, &affinity);
+    if (t5->tclass == scheduler_find_task(sched, "T6")->tclass) {
+        TEST_FAIL("Task should leave its class after an affinity change");
+    }
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Run queue diverged from task states");
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test affinity bitmasks above CPU 64 and the cached affinity AND cgroup mask
+ */
+static int test_affinity_bitmask(void) {
+    Scheduler *sched = scheduler_init(MAX_CPUS, 1);
+    
+    int group_cpus[] = {100, 127};
+    Event create_group = {0};
+    create_group.action = EVENT_CGROUP_CREATE;
+    create_group.cgroup_id = "high";
+    create_group.cpu_mask = group_cpus;
+    create_group.cpu_mask_count = 2;
+    create_group.has_cpu_mask = true;
+    scheduler_process_event(sched, &create_group);
+    
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "T1";
+    create.cgroup_id = "high";
+    scheduler_process_event(sched, &create);
+    
+    int task_cpus[] = {3, 70, 127};
+    Event affinity = {0};
+    affinity.action = EVENT_TASK_SET_AFFINITY;
+    affinity.task_id = "T1";
+    affinity.cpu_mask = task_cpus;
+    affinity.cpu_mask_count = 3;
+    scheduler_process_event(sched, &affinity);
+    
+    Task *task = scheduler_find_task(sched, "T1");
+    if (!task_can_run_on_cpu(task, 70) || task_can_run_on_cpu(task, 100)) {
+        TEST_FAIL("Affinity bits should follow the CPU list");
+    }
+    if (!cpumask_test(&task->allowed, 127) || cpumask_test(&task->allowed, 70) ||
+        cpumask_test(&task->allowed, 3)) {
+        TEST_FAIL("Allowed mask should be affinity AND cgroup mask");
+    }
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    if (tick->cpu_count != MAX_CPUS || strcmp(tick->schedule[127], "T1") != 0) {
+        TEST_FAIL("Task should run on the only allowed CPU");
+    }
+    scheduler_tick_free(tick);
+    
+    /* Leaving the cgroup restores the full task affinity */
+    Event move = {0};
+    move.action = EVENT_TASK_MOVE_CGROUP;
+    move.task_id = "T1";
+    move.new_cgroup_id = "";
+    scheduler_process_event(sched, &move);
+    if (!cpumask_test(&task->allowed, 70) || !cpumask_test(&task->allowed, 3)) {
+        TEST_FAIL("Allowed mask should drop the cgroup mask after leaving it");
+    }
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Run queue diverged from task states");
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test the tracked min/max vruntime against full scans
+ */
+static int test_vruntime_tracking(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    
+    for (int i = 0; i < 6; i++) {
+        Event create = {0};
+        char task_name[32];
+        create.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "T%d", i);
+        create.task_id = task_name;
+        create.nice = i - 3;
+        create.has_nice = true;
+        scheduler_process_event(sched, &create);
+    }
+    
+    vruntime_t last_min = scheduler_get_min_vruntime(sched);
+    for (int vtime = 0; vtime < 40; vtime++) {
+        SchedulerTick *tick = scheduler_tick(sched, vtime);
+        scheduler_tick_free(tick);
+        
+        vruntime_t scan_min = VRUNTIME_MAX;
+        vruntime_t scan_max = 0;
+        Task *max_task = NULL;
+        for (int i = 0; i < sched->task_count; i++) {
+            Task *task = sched->all_tasks[i];
+            if (task->state == TASK_STATE_BLOCKED) {
+                continue;
+            }
+            if (task->vruntime < scan_min) scan_min = task->vruntime;
+            if (task->vruntime > scan_max) {
+                scan_max = task->vruntime;
+                max_task = task;
+            }
+        }
+        
+        vruntime_t min_vr = scheduler_get_min_vruntime(sched);
+        if (min_vr < last_min) TEST_FAIL("min_vruntime should never decrease");
+        if (min_vr != scan_min) TEST_FAIL("min_vruntime should follow the smallest vruntime");
+        if (scheduler_get_max_vruntime(sched) != scan_max) TEST_FAIL("max_vruntime mismatch");
+        last_min = min_vr;
+        
+        /* Blocking the maximum's holder forces a rescan on the next query */
+        if (vtime % 10 == 5) {
+            Event block = {0};
+            block.action = EVENT_TASK_BLOCK;
+            block.task_id = max_task->task_id;
+            scheduler_process_event(sched, &block);
+            if (scheduler_get_max_vruntime(sched) >= scan_max) {
+                TEST_FAIL("max_vruntime should drop when its holder blocks");
+            }
+            if (scheduler_validate(sched) != 0) TEST_FAIL("Tracked vruntimes diverged");
+        }
+    }
+    
+    /* A long-blocked task wakes just behind the floor */
+    Event unblock = {0};
+    unblock.action = EVENT_TASK_UNBLOCK;
+    for (int i = 0; i < sched->task_count; i++) {
+        if (sched->all_tasks[i]->state == TASK_STATE_BLOCKED) {
+            unblock.task_id = sched->all_tasks[i]->task_id;
+            break;
+        }
+    }
+    Task *woken = scheduler_find_task(sched, unblock.task_id);
+    woken->vruntime = 0.0;
+    scheduler_process_event(sched, &unblock);
+    if (woken->vruntime != scheduler_get_min_vruntime(sched) - VRUNTIME_QUANTUM) {
+        TEST_FAIL("Unblocked task should be placed at min_vruntime - 1");
+    }
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Tracked vruntimes diverged");
+    scheduler_destroy(sched);
+    
+    /*
+     * The floor outlives the task that set it: after the only runnable
+     * task exits, the minimum over runnable tasks would fall back to 0,
+     * but a task waking now is still placed against the floor
+     */
+    sched = scheduler_init(1, 1);
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "Runner";
+    scheduler_process_event(sched, &create);
+    create.task_id = "Sleeper";
+    scheduler_process_event(sched, &create);
+    for (int vtime = 0; vtime < 2; vtime++) {
+        scheduler_tick_free(scheduler_tick(sched, vtime));
+    }
+    Event block = {0};
+    block.action = EVENT_TASK_BLOCK;
+    block.task_id = "Sleeper";
+    scheduler_process_event(sched, &block);
+    for (int vtime = 2; vtime < 12; vtime++) {
+        scheduler_tick_free(scheduler_tick(sched, vtime));
+    }
+    
+    vruntime_t floor = scheduler_get_min_vruntime(sched);
+    Task *sleeper = scheduler_find_task(sched, "Sleeper");
+    if (sleeper->vruntime >= floor - VRUNTIME_QUANTUM) TEST_FAIL("Sleeper should have fallen behind");
+    Event exit_event = {0};
+    exit_event.action = EVENT_TASK_EXIT;
+    exit_event.task_id = "Runner";
+    scheduler_process_event(sched, &exit_event);
+    if (scheduler_get_min_vruntime(sched) != floor) {
+        TEST_FAIL("min_vruntime should stay put when the minimum's holder exits");
+    }
+    
+    unblock.task_id = "Sleeper";
+    scheduler_process_event(sched, &unblock);
+    if (sleeper->vruntime != floor - VRUNTIME_QUANTUM) {
+        TEST_FAIL("Task waking after the minimum left should be placed at the floor");
+    }
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Tracked vruntimes diverged");
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test the kernel-style fixed-point delta and the per-task cached inverse
+ * weight, which follows nice, cgroup shares and cgroup moves
+ */
+static int test_inverse_weight(void) {
+    /* __calc_delta(1 ms, NICE_0, weight): exact at nice 0, 3056716 ns at nice 5 */
+    if (calc_vruntime_delta_fixed(1000000, sched_prio_to_wmult[20]) != 1000000 ||
+        calc_vruntime_delta_fixed(1000000, sched_prio_to_wmult[25]) != 3056716 ||
+        calc_vruntime_delta_fixed(1000000, sched_prio_to_wmult[0]) != 11536) {
+        TEST_FAIL("Fixed-point delta differs from the kernel's");
+    }
+    
+    Scheduler *sched = scheduler_init(1, 1);
+    Event cgroup = {0};
+    cgroup.action = EVENT_CGROUP_CREATE;
+    cgroup.cgroup_id = "G";
+    cgroup.cpu_shares = 2048;
+    cgroup.has_cpu_shares = true;
+    scheduler_process_event(sched, &cgroup);
+    
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "W";
+    scheduler_process_event(sched, &create);
+    Task *task = scheduler_find_task(sched, "W");
+    if (!task) TEST_FAIL("Task not created");
+    if (vruntime_delta(1.0, task->inv_weight) != VRUNTIME_QUANTUM) {
+        TEST_FAIL("A nice-0 task should advance one quantum per quantum");
+    }
+    
+    /* Twice the shares: half the vruntime per quantum */
+    Event move = {0};
+    move.action = EVENT_TASK_MOVE_CGROUP;
+    move.task_id = "W";
+    move.new_cgroup_id = "G";
+    scheduler_process_event(sched, &move);
+    vruntime_t half = vruntime_delta(1.0, task->inv_weight);
+    if (half < VRUNTIME_QUANTUM / 2 - 1 || half > VRUNTIME_QUANTUM / 2) {
+        TEST_FAIL("Cgroup shares not applied on move");
+    }
+    
+    Event modify = {0};
+    modify.action = EVENT_CGROUP_MODIFY;
+    modify.cgroup_id = "G";
+    modify.cpu_shares = 1024;
+    modify.has_cpu_shares = true;
+    scheduler_process_event(sched, &modify);
+    if (vruntime_delta(1.0, task->inv_weight) != VRUNTIME_QUANTUM) {
+        TEST_FAIL("Cached inverse not refreshed on CGROUP_MODIFY");
+    }
+    
+    Event nice = {0};
+    nice.action = EVENT_TASK_SETNICE;
+    nice.task_id = "W";
+    nice.nice = 5;
+    nice.has_nice = true;
+    scheduler_process_event(sched, &nice);
+    vruntime_t slow = vruntime_delta(1.0, task->inv_weight);
+    if (slow < 3.0566 * VRUNTIME_QUANTUM || slow > 3.0568 * VRUNTIME_QUANTUM) {
+        TEST_FAIL("Cached inverse not refreshed on SETNICE");
+    }
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test CPU_BURST disables vruntime updates for burst duration
+ */
+static int test_cpu_burst_vruntime(void) {
+    Scheduler *sched = scheduler_init(1, 1);
+    
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "B1";
+    scheduler_process_event(sched, &create);
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    scheduler_tick_free(tick);
+    
+    tick = scheduler_tick(sched, 1);
+    scheduler_tick_free(tick);
+    
+    Task *task = scheduler_find_task(sched, "B1");
+    if (!task) TEST_FAIL("Task should exist");
+    vruntime_t before_burst = task->vruntime;
+    
+    Event burst = {0};
+    burst.action = EVENT_CPU_BURST;
+    burst.task_id = "B1";
+    burst.burst_duration = 2;
+    scheduler_process_event(sched, &burst);
+    
+    tick = scheduler_tick(sched, 2);
+    scheduler_tick_free(tick);
+    tick = scheduler_tick(sched, 3);
+    scheduler_tick_free(tick);
+    
+    if (task->vruntime != before_burst) {
+        TEST_FAIL("Vruntime should not change during CPU burst");
+    }
+    
+    tick = scheduler_tick(sched, 4);
+    scheduler_tick_free(tick);
+    
+    if (task->vruntime <= before_burst) {
+        TEST_FAIL("Vruntime should increase after burst finishes");
+    }
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test that a reused tick keeps the IDs it lists valid after the tasks exit
+ */
+static int test_tick_pins_ids(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "GONE";
+    scheduler_process_event(sched, &create);
+    create.task_id = "STAY";
+    scheduler_process_event(sched, &create);
+    
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    if (!tick) TEST_FAIL("Failed to create tick");
+    if (scheduler_tick_into(sched, 0, tick) != 0) TEST_FAIL("Tick failed");
+    
+    const char *gone = strcmp(tick->schedule[0], "GONE") == 0 ? tick->schedule[0] : tick->schedule[1];
+    if (strcmp(gone, "GONE") != 0) TEST_FAIL("GONE should be running");
+    if (tick->meta->runnable_count != 2) TEST_FAIL("Both tasks should be listed");
+    
+    /* The tick still pins the exited task's ID */
+    Event exit_event = {0};
+    exit_event.action = EVENT_TASK_EXIT;
+    exit_event.task_id = "GONE";
+    scheduler_process_event(sched, &exit_event);
+    if (scheduler_find_task(sched, "GONE")) TEST_FAIL("GONE should have exited");
+    if (strcmp(gone, "GONE") != 0) TEST_FAIL("Pinned ID should survive the task");
+    
+    /* Refilling releases the old pins; a reused ID gets a fresh task */
+    create.task_id = "GONE";
+    if (scheduler_process_event(sched, &create) != 0) TEST_FAIL("ID should be reusable");
+    if (scheduler_tick_into(sched, 1, tick) != 0) TEST_FAIL("Tick failed");
+    if (tick->meta->runnable_count != 2 || tick->pin_count != 2) {
+        TEST_FAIL("Refilled tick should pin exactly the listed IDs");
+    }
+    for (int i = 0; i < 2; i++) {
+        if (tick->meta->task_entries[i]->str != tick->meta->runnable_tasks[i]) {
+            TEST_FAIL("Listed IDs should be referenced by their entries");
+        }
+    }
+    
+    scheduler_tick_free(tick);
+    if (idtable_count(sched->ids) != 3) TEST_FAIL("Released pins should leave only live IDs");
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test that refilling a tick allocates nothing once its buffers fit
+ */
+static int test_tick_zero_alloc(void) {
+    enum { ZERO_ALLOC_TASKS = 1024 };
+    Scheduler *sched = scheduler_init(16, 1);
+    
+    Event cgroup = {0};
+    cgroup.action = EVENT_CGROUP_CREATE;
+    cgroup.cgroup_id = "G";
+    cgroup.cpu_shares = 512;
+    cgroup.has_cpu_shares = true;
+    scheduler_process_event(sched, &cgroup);
+    
+    for (int i = 0; i < ZERO_ALLOC_TASKS; i++) {
+        Event create = {0};
+        char task_name[32];
+        create.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "load-task-%d", i);
+        create.task_id = task_name;
+        create.cgroup_id = i % 2 ? "G" : "0";
+        create.nice = i % 40 - 20;
+        create.has_nice = true;
+        scheduler_process_event(sched, &create);
+    }
+    for (int i = 0; i < ZERO_ALLOC_TASKS; i += 3) {
+        Event block = {0};
+        char task_name[32];
+        block.action = EVENT_TASK_BLOCK;
+        snprintf(task_name, sizeof(task_name), "load-task-%d", i);
+        block.task_id = task_name;
+        scheduler_process_event(sched, &block);
+    }
+    
+    SchedulerTick *tick = scheduler_tick_create(sched);
+    if (!tick) TEST_FAIL("Failed to create tick");
+    
+    /* The first fill sizes the buffers (and proves the counter is live) */
+    long first = alloc_calls;
+    if (scheduler_tick_into(sched, 0, tick) != 0) TEST_FAIL("Tick failed");
+    if (alloc_calls == first) TEST_FAIL("Allocation counter is not wired in");
+    if (tick->meta->runnable_count + tick->meta->blocked_count != ZERO_ALLOC_TASKS) {
+        TEST_FAIL("Metadata should list every task");
+    }
+    
+    long before = alloc_calls;
+    for (int vtime = 1; vtime <= 200; vtime++) {
+        if (scheduler_tick_into(sched, vtime, tick) != 0) TEST_FAIL("Tick failed");
+    }
+    long per_run = alloc_calls - before;
+    
+    if (tick->meta->blocked_count != (ZERO_ALLOC_TASKS + 2) / 3) TEST_FAIL("Blocked list wrong");
+    scheduler_tick_free(tick);
+    scheduler_destroy(sched);
+    
+#ifndef DEBUG
+    /* DEBUG builds validate against a freshly allocated rebuild every tick */
+    if (per_run != 0) TEST_FAIL("Steady-state ticks should not allocate");
+#else
+    (void)per_run;
+#endif
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test the state/ID columns follow tasks through blocking, running and
+ * the swap-with-last removal on exit
+ */
+static int test_task_columns(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    const char *names[] = {"c0", "c1", "c2", "c3", "c4", "c5"};
+    for (int i = 0; i < 6; i++) {
+        Event create = {0};
+        create.action = EVENT_TASK_CREATE;
+        create.task_id = names[i];
+        scheduler_process_event(sched, &create);
+    }
+    Event event = {0};
+    event.action = EVENT_TASK_BLOCK;
+    event.task_id = "c4";
+    scheduler_process_event(sched, &event);
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    if (!tick) TEST_FAIL("Tick failed");
+    scheduler_tick_free(tick);
+    
+    /* c1 leaves; c5 takes over its slot */
+    event.action = EVENT_TASK_EXIT;
+    event.task_id = "c1";
+    scheduler_process_event(sched, &event);
+    Task *moved = scheduler_find_task(sched, "c5");
+    if (!moved || moved->task_index != 1) TEST_FAIL("Last task should fill the freed slot");
+    if (sched->task_entries[1] != moved->id_entry ||
+        sched->task_states[1] != (uint8_t)moved->state) {
+        TEST_FAIL("Columns not moved with the task");
+    }
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Columns out of step with tasks");
+    
+    tick = scheduler_tick(sched, 1);
+    if (!tick) TEST_FAIL("Tick failed");
+    const char *want_runnable[] = {"c0", "c5", "c2", "c3"};
+    bool ok = tick->meta->runnable_count == 4 && tick->meta->blocked_count == 1 &&
+              strcmp(tick->meta->blocked_tasks[0], "c4") == 0;
+    for (int i = 0; ok && i < 4; i++) {
+        ok = strcmp(tick->meta->runnable_tasks[i], want_runnable[i]) == 0;
+    }
+    scheduler_tick_free(tick);
+    if (!ok) TEST_FAIL("Metadata lists wrong");
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Columns out of step after tick");
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test pool slots are aligned, recycled most-recent-first, and reused
+ * without allocator calls once the pool has grown
+ */
+static int test_pool_reuse(void) {
+    Pool pool;
+    pool_init(&pool, sizeof(Task), _Alignof(Task), 8);
+    
+    void *objects[20];
+    for (int i = 0; i < 20; i++) {
+        objects[i] = pool_alloc(&pool);
+        if (!objects[i]) TEST_FAIL("Allocation failed");
+        if ((uintptr_t)objects[i] % 64 != 0) TEST_FAIL("Slot not cache-line aligned");
+    }
+    if (pool.live != 20 || pool.slab_count != 3) TEST_FAIL("Wrong pool totals");
+    
+    /* The last slot released is the first handed back, zeroed */
+    memset(objects[5], 0xab, sizeof(Task));
+    pool_free(&pool, objects[5]);
+    void *again = pool_alloc(&pool);
+    if (again != objects[5]) TEST_FAIL("Freed slot not reused first");
+    if (((unsigned char *)again)[sizeof(Task) - 1] != 0) TEST_FAIL("Reused slot not zeroed");
+    
+    long before = alloc_calls;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 20; i++) {
+            pool_free(&pool, objects[i]);
+        }
+        for (int i = 0; i < 20; i++) {
+            objects[i] = pool_alloc(&pool);
+        }
+    }
+    if (alloc_calls != before) TEST_FAIL("Recycling should not allocate");
+    if (pool.live != 20 || pool.slab_count != 3) TEST_FAIL("Pool grew during churn");
+    
+    pool_destroy(&pool);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test task and cgroup churn recycles pool slots instead of growing
+ */
+static int test_pool_task_churn(void) {
+    Scheduler *sched = scheduler_init(4, 1);
+    
+    Event cgroup = {0};
+    cgroup.action = EVENT_CGROUP_CREATE;
+    cgroup.cgroup_id = "G";
+    
+    size_t task_slabs = 0;
+    size_t cgroup_slabs = 0;
+    for (int round = 0; round < 50; round++) {
+        scheduler_process_event(sched, &cgroup);
+        for (int i = 0; i < 200; i++) {
+            Event create = {0};
+            char task_name[32];
+            create.action = EVENT_TASK_CREATE;
+            snprintf(task_name, sizeof(task_name), "churn-%d-%d", round, i);
+            create.task_id = task_name;
+            create.cgroup_id = "G";
+            if (scheduler_process_event(sched, &create) != 0) TEST_FAIL("Create failed");
+        }
+        Task *task = scheduler_find_task(sched, "churn-0-0");
+        if (round == 0 && (!task || task->pools != &sched->task_pools ||
+                           strcmp(task->task_id, "churn-0-0") != 0 ||
+                           strcmp(task->cgroup_id, "G") != 0)) {
+            TEST_FAIL("Task not created from the scheduler pools");
+        }
+        if (round > 0 && task) TEST_FAIL("Exited task still registered");
+        if (sched->task_pools.tasks.live != 200 || sched->cgroup_pool.live != 1) {
+            TEST_FAIL("Wrong live counts");
+        }
+        
+        for (int i = 0; i < 200; i++) {
+            Event exit_event = {0};
+            char task_name[32];
+            exit_event.action = EVENT_TASK_EXIT;
+            snprintf(task_name, sizeof(task_name), "churn-%d-%d", round, i);
+            exit_event.task_id = task_name;
+            scheduler_process_event(sched, &exit_event);
+        }
+        Event remove = {0};
+        remove.action = EVENT_CGROUP_DELETE;
+        remove.cgroup_id = "G";
+        scheduler_process_event(sched, &remove);
+        
+        if (round == 0) {
+            task_slabs = sched->task_pools.tasks.slab_count;
+            cgroup_slabs = sched->cgroup_pool.slab_count;
+        }
+    }
+    
+    if (sched->task_pools.tasks.live != 0 ||
+        sched->cgroup_pool.live != 0) {
+        TEST_FAIL("Exited objects not returned to their pools");
+    }
+    if (sched->task_pools.tasks.slab_count != task_slabs ||
+        sched->cgroup_pool.slab_count != cgroup_slabs) {
+        TEST_FAIL("Pools grew across churn rounds");
+    }
+    
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test that task and cgroup storage grow past their initial size and
+ * that long IDs are kept whole
+ */
+static int test_storage_growth(void) {
+    enum { GROWTH_TASKS = 5000, GROWTH_CGROUPS = 100, LONG_ID_LEN = 300 };
+    Scheduler *sched = scheduler_init(4, 1);
+    if (!sched) TEST_FAIL("Scheduler init failed");
+    
+    char long_id[LONG_ID_LEN + 1];
+    memset(long_id, 'x', LONG_ID_LEN);
+    long_id[LONG_ID_LEN] = '\0';
+    
+    for (int i = 0; i < GROWTH_CGROUPS; i++) {
+        Event cgroup = {0};
+        char cgroup_name[32];
+        cgroup.action = EVENT_CGROUP_CREATE;
+        snprintf(cgroup_name, sizeof(cgroup_name), "grow-cg-%d", i);
+        cgroup.cgroup_id = cgroup_name;
+        if (scheduler_process_event(sched, &cgroup) != 0) TEST_FAIL("Cgroup create failed");
+    }
+    for (int i = 0; i < GROWTH_TASKS; i++) {
+        Event create = {0};
+        char task_name[32];
+        char cgroup_name[32];
+        create.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "grow-task-%d", i);
+        snprintf(cgroup_name, sizeof(cgroup_name), "grow-cg-%d", i % GROWTH_CGROUPS);
+        create.task_id = task_name;
+        create.cgroup_id = cgroup_name;
+        if (scheduler_process_event(sched, &create) != 0) TEST_FAIL("Task create failed");
+    }
+    
+    /* The source buffer is reused, so the task must hold its own copy */
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = long_id;
+    if (scheduler_process_event(sched, &create) != 0) TEST_FAIL("Long ID create failed");
+    Task *task = scheduler_find_task(sched, long_id);
+    long_id[0] = 'y';
+    if (!task || strlen(task->task_id) != LONG_ID_LEN || task->task_id[0] != 'x') {
+        TEST_FAIL("Long task ID not kept whole");
+    }
+    
+    if (sched->task_count != GROWTH_TASKS + 1 || sched->cgroup_count != GROWTH_CGROUPS) {
+        TEST_FAIL("Counts wrong after growth");
+    }
+    if (sched->task_capacity < sched->task_count || sched->cgroup_capacity < sched->cgroup_count) {
+        TEST_FAIL("Capacity below count");
+    }
+    if (scheduler_validate(sched) != 0) TEST_FAIL("Validation failed after growth");
+    
+    SchedulerTick *tick = scheduler_tick(sched, 1);
+    if (!tick || tick->meta->runnable_count != GROWTH_TASKS + 1) TEST_FAIL("Tick lost tasks");
+    scheduler_tick_free(tick);
+    
+    /* Reserving ahead leaves no growth for the population it covers */
+    Scheduler *reserved = scheduler_init(4, 1);
+    if (!reserved || scheduler_reserve(reserved, GROWTH_TASKS) != 0) TEST_FAIL("Reserve failed");
+    int capacity = reserved->task_capacity;
+    if (capacity < GROWTH_TASKS) TEST_FAIL("Reserve too small");
+    for (int i = 0; i < GROWTH_TASKS; i++) {
+        Event event = {0};
+        char task_name[32];
+        event.action = EVENT_TASK_CREATE;
+        snprintf(task_name, sizeof(task_name), "grow-task-%d", i);
+        event.task_id = task_name;
+        scheduler_process_event(reserved, &event);
+    }
+    if (reserved->task_capacity != capacity) TEST_FAIL("Reserved storage grew again");
+    
+    scheduler_destroy(reserved);
+    scheduler_destroy(sched);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test that a task picked up by a lower-numbered CPU stays running when the
+ * CPU it left switches to another task
+ */
+static int test_preempted_task_keeps_new_cpu(void) {
+    Scheduler *sched = scheduler_init(2, 1);
+    
+    Event create = {0};
+    create.action = EVENT_TASK_CREATE;
+    create.task_id = "A";
+    scheduler_process_event(sched, &create);
+    create.task_id = "B";
+    scheduler_process_event(sched, &create);
+    
+    SchedulerTick *tick = scheduler_tick(sched, 0);
+    Task *blocked = scheduler_find_task(sched, tick->schedule[0]);
+    Task *moved = scheduler_find_task(sched, tick->schedule[1]);
+    scheduler_tick_free(tick);
+    if (!blocked || !moved) TEST_FAIL("Both CPUs should run a task");
+    
+    Event block = {0};
+    block.action = EVENT_TASK_BLOCK;
+    block.task_id = blocked->task_id;
+    scheduler_process_event(sched, &block);
+    
+    /* C may only take CPU 1, so the other task moves over to CPU 0 */
+    int cpu_mask[] = {1};
+    create.task_id = "C";
+    scheduler_process_event(sched, &create);
+    Event affinity = {0};
+    affinity.action = EVENT_TASK_SET_AFFINITY;
+    affinity.task_id = "C";
+    affinity.cpu_mask = cpu_mask;
+    affinity.cpu_mask_count = 1;
+    scheduler_process_event(sched, &affinity);
+    
+    tick = scheduler_tick(sched, 1);
+    if (strcmp(tick->schedule[0], moved->task_id) != 0 ||
+        strcmp(tick->schedule[1], "C") != 0) {
+        TEST_FAIL("Task should migrate to CPU 0 and C should take CPU 1");
+    }
+    scheduler_tick_free(tick);
+    if (moved->state != TASK_STATE_RUNNING || moved->current_cpu != 0) {
+        TEST_FAIL("Migrated task should stay running on CPU 0");
+    }
+    
+    double before = moved->vruntime;
+    tick = scheduler_tick(sched, 2);
+    scheduler_tick_free(tick);
+    if (moved->vruntime <= before) {
+        TEST_FAIL("Migrated task should be charged for its quantum");
     }
     
     scheduler_destroy(sched);
@@ -686,10 +2814,40 @@ int main(void) {
     failures += test_invalid_event_action();
     failures += test_cgroup_quota_enforcement();
     failures += test_cgroup_quota_multi_cpu_enforcement();
+    failures += test_cgroup_throttle_parking();
     failures += test_cgroup_shares_effect();
     failures += test_cgroup_modify_delete();
+    failures += test_cgroup_hierarchy();
+    failures += test_timer_wheel();
     failures += test_task_move_cgroup();
     failures += test_cpu_burst_vruntime();
+    failures += test_inverse_weight();
+    failures += test_cgroup_late_binding();
+    failures += test_preempted_task_keeps_new_cpu();
+    failures += test_incremental_heap_matches_rebuild();
+    failures += test_runqueue_backends_agree();
+    failures += test_eevdf_policy();
+    failures += test_eevdf_selection();
+    failures += test_wakeup_latency();
+    failures += test_per_cpu_fewer_migrations();
+    failures += test_per_cpu_steal_respects_masks();
+    failures += test_parallel_tick_matches_serial();
+    failures += test_capacity_accounting();
+    failures += test_pelt_utilization();
+    failures += test_misfit_migration();
+    failures += test_hot_path_stats();
+    failures += test_batched_events();
+    failures += test_delta_ticks();
+    failures += test_list_horizon();
+    failures += test_affinity_classes();
+    failures += test_affinity_bitmask();
+    failures += test_vruntime_tracking();
+    failures += test_tick_pins_ids();
+    failures += test_tick_zero_alloc();
+    failures += test_task_columns();
+    failures += test_pool_reuse();
+    failures += test_pool_task_churn();
+    failures += test_storage_growth();
     
     printf("\n");
     if (failures == 0) {
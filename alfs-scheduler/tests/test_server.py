@@ -4,7 +4,27 @@ ALFS Test Server
 Simulates the tester that sends events and receives scheduler decisions.
 
 Usage:
-    python3 test_server.py [socket_path] [input_file]
+    python3 test_server.py [socket_path] [input_file] [framing] [--expect file]
+    python3 test_server.py --write-trace input_file trace_file [json|binary]
+    python3 test_server.py --connect clients socket_path input_file [framing]
+    
+    framing is "newline" (default), "length" or "binary"; start the
+    scheduler with the matching --framing option, or with
+    --protocol binary for "binary" (length-framed, handle-based records).
+    
+    --write-trace converts an input file into a trace for
+    ./alfs_scheduler --replay (JSON-lines, or length-prefixed binary
+    TIMEFRAME messages to replay with --protocol binary).
+    
+    --connect plays the input on several concurrent connections to a
+    scheduler started with --listen; every connection has its own
+    scheduler, so all of them must receive the same ticks.
+    
+    Delta ticks (scheduler started with --delta) are applied to the
+    last full state, so the results always hold complete ticks.
+    --expect compares them with a previous *_output.json and exits 1 on
+    a mismatch; task lists rebuilt from deltas are compared as sets,
+    since their order is the scheduler's internal slot order.
     
 Example:
     python3 tests/test_server.py event.socket tests/sample_input.json
@@ -12,12 +32,189 @@ Example:
 
 import socket
 import os
+import struct
 import sys
 import json
 import time
+import threading
 
 DEFAULT_SOCKET = "event.socket"
 
+# Binary protocol (see include/binary_codec.h)
+BINARY_VERSION = 1
+MSG_HELLO, MSG_TIMEFRAME, MSG_TICK = 1, 2, 3
+ACTIONS = ["TASK_CREATE", "TASK_EXIT", "TASK_BLOCK", "TASK_UNBLOCK", "TASK_YIELD",
+           "TASK_SETNICE", "TASK_SET_AFFINITY", "CGROUP_CREATE", "CGROUP_MODIFY",
+           "CGROUP_DELETE", "TASK_MOVE_CGROUP", "CPU_BURST"]
+ACTION_CODES = {name: code for code, name in enumerate(ACTIONS)}
+HAS_NICE, HAS_CPU_SHARES, HAS_CPU_QUOTA, HAS_CPU_PERIOD, HAS_CPU_MASK = 1, 2, 4, 8, 16
+TICK_META, TICK_LATENCY, TICK_DELTA = 1, 2, 4
+EVENT_RECORD = struct.Struct("<BBHIIIiiiii")
+
+class BinaryCodec:
+    """Encoder/decoder state for one binary connection"""
+    
+    def __init__(self, conn):
+        self.conn = conn
+        self.handles = {}
+        self.names = {0: "idle"}
+    
+    def handshake(self):
+        """Answer the scheduler's HELLO"""
+        hello = receive_frame(self.conn)
+        if hello is None or len(hello) < 4 or hello[0] != MSG_HELLO:
+            raise RuntimeError("scheduler did not send HELLO")
+        if hello[1] != BINARY_VERSION:
+            raise RuntimeError(f"unsupported binary version {hello[1]}")
+        cpus = struct.unpack_from("<H", hello, 2)[0]
+        send_frame(self.conn, struct.pack("<BBH", MSG_HELLO, BINARY_VERSION, 0))
+        print(f"Binary protocol v{BINARY_VERSION} ({cpus} CPUs)")
+    
+    def handle(self, name, defines):
+        """Handle for an ID, defining it on first use"""
+        if not name:
+            return 0
+        name = str(name)
+        if name not in self.handles:
+            handle = len(self.handles) + 1
+            self.handles[name] = handle
+            self.names[handle] = name
+            raw = name.encode('utf-8')
+            defines.append(struct.pack("<IH", handle, len(raw)) + raw)
+        return self.handles[name]
+    
+    def encode(self, timeframe):
+        """Encode a timeframe as a TIMEFRAME message"""
+        defines, records, masks = [], [], []
+        for event in timeframe['events']:
+            flags = 0
+            nice = shares = quota = period = 0
+            if 'nice' in event:
+                flags |= HAS_NICE
+                nice = event['nice']
+            if 'newNice' in event:
+                flags |= HAS_NICE
+                nice = event['newNice']
+            if 'cpuShares' in event:
+                flags |= HAS_CPU_SHARES
+                shares = event['cpuShares']
+            if 'cpuQuotaUs' in event:
+                flags |= HAS_CPU_QUOTA
+                quota = -1 if event['cpuQuotaUs'] is None else event['cpuQuotaUs']
+            if 'cpuPeriodUs' in event:
+                flags |= HAS_CPU_PERIOD
+                period = event['cpuPeriodUs']
+            mask = event.get('cpuMask')
+            if mask is not None:
+                flags |= HAS_CPU_MASK
+                masks.extend(mask)
+            records.append(EVENT_RECORD.pack(
+                ACTION_CODES.get(event.get('action'), 255), flags, len(mask or []),
+                self.handle(event.get('taskId'), defines),
+                self.handle(event.get('cgroupId'), defines),
+                self.handle(event.get('parentId' if event.get('action') == 'CGROUP_CREATE'
+                                      else 'newCgroupId'), defines),
+                nice, shares, quota, period, event.get('duration', 0)))
+        header = struct.pack("<BBHiI", MSG_TIMEFRAME, 0, len(defines),
+                             timeframe['vtime'], len(records))
+        return header + b"".join(defines) + b"".join(records) + struct.pack(f"<{len(masks)}H", *masks)
+    
+    def decode(self, message):
+        """Decode a TICK message into the scheduler's JSON tick layout"""
+        kind, flags, cpus, vtime = struct.unpack_from("<BBHi", message, 0)
+        if kind != MSG_TICK:
+            raise RuntimeError(f"unexpected message type {kind}")
+        tick = {"vtime": vtime}
+        if flags & TICK_DELTA:
+            changed = struct.unpack_from("<I", message, 8)[0]
+            pairs = struct.unpack_from(f"<{2 * changed}I", message, 12)
+            tick["delta"] = True
+            tick["schedule"] = {str(pairs[i]): self.names[pairs[i + 1]]
+                                for i in range(0, len(pairs), 2)}
+            offset = 12 + 8 * changed
+        else:
+            tick["schedule"] = [self.names[h] for h in struct.unpack_from(f"<{cpus}I", message, 8)]
+            offset = 8 + 4 * cpus
+        if flags & TICK_META:
+            preemptions, migrations, throttles, unthrottles, runnable, blocked = \
+                struct.unpack_from("<iiiiII", message, offset)
+            offset += 24
+            removed = 0
+            if flags & TICK_DELTA:
+                removed = struct.unpack_from("<I", message, offset)[0]
+                offset += 4
+            meta = {"preemptions": preemptions, "migrations": migrations,
+                    "throttles": throttles, "unthrottles": unthrottles}
+            if flags & TICK_LATENCY:
+                meta["wakeups"], meta["wakeupLatency"] = struct.unpack_from("<II", message, offset)
+                offset += 8
+            handles = [self.names[h] for h in
+                       struct.unpack_from(f"<{runnable + blocked + removed}I", message, offset)]
+            meta["runnableTasks"] = handles[:runnable]
+            meta["blockedTasks"] = handles[runnable:runnable + blocked]
+            if flags & TICK_DELTA:
+                meta["removedTasks"] = handles[runnable + blocked:]
+            tick["meta"] = meta
+        return tick
+
+class TickState:
+    """Rebuilds complete ticks from a stream of keyframes and delta ticks"""
+    
+    def __init__(self):
+        self.schedule = None
+        self.runnable = []
+        self.blocked = []
+    
+    def apply(self, tick):
+        """Return the complete tick, and whether it was rebuilt from a delta"""
+        if not tick.get("delta"):
+            self.schedule = list(tick["schedule"])
+            if "meta" in tick:
+                self.runnable = list(tick["meta"]["runnableTasks"])
+                self.blocked = list(tick["meta"]["blockedTasks"])
+            return tick, False
+        if self.schedule is None:
+            raise RuntimeError(f"delta tick at vtime {tick['vtime']} before any keyframe")
+        
+        for cpu, task in tick["schedule"].items():
+            self.schedule[int(cpu)] = task
+        full = {"vtime": tick["vtime"], "schedule": list(self.schedule)}
+        if "meta" in tick:
+            meta = dict(tick["meta"])
+            changed = set(meta.pop("removedTasks")) | set(meta["runnableTasks"]) | \
+                      set(meta["blockedTasks"])
+            self.runnable = [t for t in self.runnable if t not in changed] + meta["runnableTasks"]
+            self.blocked = [t for t in self.blocked if t not in changed] + meta["blockedTasks"]
+            meta["runnableTasks"] = list(self.runnable)
+            meta["blockedTasks"] = list(self.blocked)
+            full["meta"] = meta
+        return full, True
+
+def ticks_match(tick, expected, rebuilt):
+    """Compare a tick with an expected one; rebuilt task lists as sets"""
+    if not rebuilt or "meta" not in tick or "meta" not in expected:
+        return tick == expected
+    unordered = ("runnableTasks", "blockedTasks")
+    meta = {k: v for k, v in tick["meta"].items() if k not in unordered}
+    want = {k: v for k, v in expected["meta"].items() if k not in unordered}
+    return (tick["vtime"] == expected["vtime"] and tick["schedule"] == expected["schedule"] and
+            meta == want and
+            all(sorted(tick["meta"][k]) == sorted(expected["meta"].get(k, [])) for k in unordered))
+
+def check_expected(results, rebuilt, expect_file):
+    """Compare results with an expected output file; True if they match"""
+    with open(expect_file, 'r') as f:
+        expected = json.load(f)
+    if len(results) != len(expected):
+        print(f"Expected {len(expected)} ticks, received {len(results)}")
+        return False
+    for tick, want, delta in zip(results, expected, rebuilt):
+        if not ticks_match(tick, want, delta):
+            print(f"Tick at vtime {tick['vtime']} differs from {expect_file}")
+            return False
+    print(f"All {len(results)} ticks match {expect_file}")
+    return True
+
 def create_socket(socket_path):
     """Create a Unix Domain Socket server"""
     # Remove existing socket file
@@ -31,14 +228,45 @@ def create_socket(socket_path):
     print(f"Test server listening on {socket_path}")
     return sock
 
-def send_timeframe(conn, timeframe):
+def send_frame(conn, payload):
+    """Send one length-prefixed message"""
+    conn.sendall(struct.pack(">I", len(payload)) + payload)
+
+def send_timeframe(conn, timeframe, framing="newline", codec=None):
     """Send a single timeframe to the scheduler"""
-    json_str = json.dumps(timeframe) + "\n"
-    conn.sendall(json_str.encode('utf-8'))
+    if codec:
+        send_frame(conn, codec.encode(timeframe))
+    elif framing == "length":
+        send_frame(conn, json.dumps(timeframe).encode('utf-8'))
+    else:
+        conn.sendall(json.dumps(timeframe).encode('utf-8') + b"\n")
     print(f"Sent vtime={timeframe['vtime']}: {len(timeframe['events'])} events")
 
-def receive_tick(conn):
+def receive_exact(conn, size):
+    """Receive exactly size bytes, or None if the connection closes first"""
+    buffer = b""
+    while len(buffer) < size:
+        data = conn.recv(size - len(buffer))
+        if not data:
+            return None
+        buffer += data
+    return buffer
+
+def receive_frame(conn):
+    """Receive one length-prefixed message"""
+    header = receive_exact(conn, 4)
+    if header is None:
+        return None
+    return receive_exact(conn, struct.unpack(">I", header)[0])
+
+def receive_tick(conn, framing="newline", codec=None):
     """Receive a scheduler tick response"""
+    if framing != "newline":
+        payload = receive_frame(conn)
+        if payload is None:
+            return None
+        return codec.decode(payload) if codec else json.loads(payload.decode('utf-8'))
+    
     buffer = b""
     while True:
         data = conn.recv(4096)
@@ -51,7 +279,7 @@ def receive_tick(conn):
     line = buffer.split(b"\n")[0]
     return json.loads(line.decode('utf-8'))
 
-def run_test(socket_path, input_file):
+def run_test(socket_path, input_file, framing="newline", expect_file=None):
     """Run the test with the given input file"""
     # Load input events
     with open(input_file, 'r') as f:
@@ -67,32 +295,47 @@ def run_test(socket_path, input_file):
     print("Scheduler connected!")
     
     try:
+        codec = None
+        if framing == "binary":
+            codec = BinaryCodec(conn)
+            codec.handshake()
+        
         results = []
+        rebuilt = []
+        state = TickState()
+        start = time.perf_counter()
         
         for tf in timeframes:
             # Send timeframe
-            send_timeframe(conn, tf)
+            send_timeframe(conn, tf, framing, codec)
             
             # Receive response
-            tick = receive_tick(conn)
+            tick = receive_tick(conn, framing, codec)
             if tick:
+                tick, delta = state.apply(tick)
                 results.append(tick)
+                rebuilt.append(delta)
                 schedule_str = ", ".join(tick['schedule'])
                 print(f"  Response vtime={tick['vtime']}: [{schedule_str}]")
                 
                 if 'meta' in tick:
                     meta = tick['meta']
                     print(f"    Preemptions: {meta.get('preemptions', 0)}, "
-                          f"Migrations: {meta.get('migrations', 0)}")
+                          f"Migrations: {meta.get('migrations', 0)}, "
+                          f"Throttles: {meta.get('throttles', 0)}, "
+                          f"Unthrottles: {meta.get('unthrottles', 0)}")
             else:
                 print("  No response received")
         
+        elapsed = time.perf_counter() - start
+        
         # Print summary
         print("\n" + "="*60)
         print("TEST COMPLETE")
         print("="*60)
         print(f"Total timeframes: {len(timeframes)}")
         print(f"Responses received: {len(results)}")
+        print(f"Elapsed: {elapsed:.3f} s ({len(timeframes) / max(elapsed, 1e-9):.0f} frames/s, {framing})")
         
         # Output results to file
         output_file = input_file.replace(".json", "_output.json")
@@ -100,20 +343,117 @@ def run_test(socket_path, input_file):
             json.dump(results, f, indent=2)
         print(f"Results written to: {output_file}")
         
+        if expect_file and not check_expected(results, rebuilt, expect_file):
+            sys.exit(1)
+        
     finally:
         conn.close()
         server_sock.close()
         os.unlink(socket_path)
 
+def play_client(socket_path, timeframes, framing, results, index):
+    """Play every timeframe on one connection, lock-step"""
+    conn = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    conn.connect(socket_path)
+    try:
+        codec = None
+        if framing == "binary":
+            codec = BinaryCodec(conn)
+            codec.handshake()
+        ticks = []
+        state = TickState()
+        for tf in timeframes:
+            send_timeframe(conn, tf, framing, codec)
+            tick = receive_tick(conn, framing, codec)
+            if tick is None:
+                break
+            ticks.append(state.apply(tick)[0])
+        results[index] = ticks
+    finally:
+        conn.close()
+
+def run_clients(clients, socket_path, input_file, framing="newline"):
+    """Run the input on concurrent connections to a --listen scheduler"""
+    with open(input_file, 'r') as f:
+        timeframes = json.load(f)
+    
+    results = [None] * clients
+    threads = [threading.Thread(target=play_client,
+                                args=(socket_path, timeframes, framing, results, i))
+               for i in range(clients)]
+    start = time.perf_counter()
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    elapsed = time.perf_counter() - start
+    
+    frames = sum(len(r) for r in results if r)
+    print(f"{clients} connections, {frames} ticks in {elapsed:.3f} s "
+          f"({frames / max(elapsed, 1e-9):.0f} ticks/s)")
+    
+    output_file = input_file.replace(".json", "_output.json")
+    with open(output_file, 'w') as f:
+        json.dump(results[0] or [], f, indent=2)
+    print(f"Results of connection 0 written to: {output_file}")
+    
+    if any(r is None or r != results[0] or len(r) != len(timeframes) for r in results):
+        print("Connections received different or missing ticks")
+        sys.exit(1)
+
+def write_trace(input_file, trace_file, protocol="json"):
+    """Write timeframes as a replay trace"""
+    with open(input_file, 'r') as f:
+        timeframes = json.load(f)
+    
+    codec = BinaryCodec(None) if protocol == "binary" else None
+    with open(trace_file, 'wb') as out:
+        for tf in timeframes:
+            if codec:
+                payload = codec.encode(tf)
+                out.write(struct.pack(">I", len(payload)) + payload)
+            else:
+                out.write(json.dumps(tf).encode('utf-8') + b"\n")
+    print(f"Wrote {len(timeframes)} timeframes to {trace_file} ({protocol})")
+
 def main():
-    socket_path = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_SOCKET
-    input_file = sys.argv[2] if len(sys.argv) > 2 else "tests/sample_input.json"
+    if len(sys.argv) > 1 and sys.argv[1] == "--write-trace":
+        if len(sys.argv) < 4 or (len(sys.argv) > 4 and sys.argv[4] not in ("json", "binary")):
+            print("Usage: test_server.py --write-trace input_file trace_file [json|binary]")
+            sys.exit(1)
+        write_trace(sys.argv[2], sys.argv[3], sys.argv[4] if len(sys.argv) > 4 else "json")
+        return
+    if len(sys.argv) > 1 and sys.argv[1] == "--connect":
+        if len(sys.argv) < 5:
+            print("Usage: test_server.py --connect clients socket_path input_file [framing]")
+            sys.exit(1)
+        run_clients(int(sys.argv[2]), sys.argv[3], sys.argv[4],
+                    sys.argv[5] if len(sys.argv) > 5 else "newline")
+        return
+    
+    args = sys.argv[1:]
+    expect_file = None
+    if "--expect" in args:
+        index = args.index("--expect")
+        if index + 1 >= len(args):
+            print("Usage: test_server.py [socket_path] [input_file] [framing] [--expect file]")
+            sys.exit(1)
+        expect_file = args[index + 1]
+        del args[index:index + 2]
+    
+    socket_path = args[0] if len(args) > 0 else DEFAULT_SOCKET
+    input_file = args[1] if len(args) > 1 else "tests/sample_input.json"
+    framing = args[2] if len(args) > 2 else "newline"
+    
+    if framing not in ("newline", "length", "binary"):
+        print(f"Error: Unknown framing '{framing}'")
+        sys.exit(1)
     
     if not os.path.exists(input_file):
         print(f"Error: Input file '{input_file}' not found")
         sys.exit(1)
     
-    run_test(socket_path, input_file)
+    run_test(socket_path, input_file, framing, expect_file)
 
 if __name__ == "__main__":
     main()
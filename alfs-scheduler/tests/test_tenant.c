@@ -0,0 +1,315 @@
+/**
+ * ALFS - Multi-Tenant Server Unit Tests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "../include/tenant.h"
+#include "../include/scheduler.h"
+#include "../include/uds.h"
+#include "../include/json_handler.h"
+#include "../include/binary_codec.h"
+
+#define TEST_PASS() printf("  [PASS] %s\n", __func__)
+#define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
+
+#define TENANT_CLIENTS 6
+#define TENANT_FRAMES 200
+
+typedef struct {
+    TenantConfig config;
+    volatile int running;
+    TenantTotals totals;
+    int rc;
+    pthread_t thread;
+} Server;
+
+typedef struct {
+    const char *socket_path;
+    unsigned int seed;
+    int frames;                     /* Frames to send before closing */
+    bool read_ticks;                /* false: stream and hang up without reading */
+    int mismatches;
+    int received;
+} Client;
+
+static Scheduler *create_test_scheduler(void *arg) {
+    (void)arg;
+    return scheduler_init(4, 1);
+}
+
+static void *server_main(void *arg) {
+    Server *server = arg;
+    server->rc = tenant_serve(&server->config, &server->running, &server->totals);
+    return NULL;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+}
+
+/**
+ * Start a server on a per-process socket and wait until it accepts
+ */
+static int server_start(Server *server, char *socket_path, size_t size, int workers,
+                        WireProtocol protocol) {
+    snprintf(socket_path, size, "/tmp/alfs_test_tenant_%d.sock", (int)getpid());
+    unlink(socket_path);
+    memset(server, 0, sizeof(*server));
+    server->config.socket_path = socket_path;
+    server->config.workers = workers;
+    server->config.framing = protocol == WIRE_BINARY ? UDS_FRAME_LENGTH : UDS_FRAME_NEWLINE;
+    server->config.protocol = protocol;
+    server->config.include_meta = true;
+    server->config.cpu_count = 4;
+    server->config.create_scheduler = create_test_scheduler;
+    server->running = 1;
+    if (pthread_create(&server->thread, NULL, server_main, server) != 0) {
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < 200; attempt++) {
+        if (access(socket_path, F_OK) == 0) {
+            sleep_ms(20);       /* The file appears at bind, just before listen */
+            return 0;
+        }
+        sleep_ms(5);
+    }
+    return -1;
+}
+
+static void server_stop(Server *server) {
+    server->running = 0;
+    pthread_join(server->thread, NULL);
+}
+
+/**
+ * Build a timeframe that creates, blocks, wakes and yields tasks
+ */
+static char *make_frame(int vtime, unsigned int *seed) {
+    char *frame = malloc(4096);
+    int n = sprintf(frame, "{\"vtime\":%d,\"events\":[", vtime);
+
+    /* One new task per frame for the first 32 frames, then only state changes */
+    if (vtime < 32) {
+        n += sprintf(frame + n, "{\"action\":\"TASK_CREATE\",\"taskId\":\"T%d\",\"nice\":%d},",
+                     vtime, vtime % 10 - 5);
+    }
+    for (int e = 0; e < 4; e++) {
+        *seed = *seed * 1103515245u + 12345u;
+        int task = (int)((*seed >> 8) % 32);
+        static const char *actions[] = {"TASK_BLOCK", "TASK_UNBLOCK", "TASK_YIELD"};
+        const char *action = actions[(*seed >> 20) % 3];
+        n += sprintf(frame + n, "%s{\"action\":\"%s\",\"taskId\":\"T%d\"}",
+                     e ? "," : "", action, task);
+    }
+    sprintf(frame + n, "]}");
+    return frame;
+}
+
+/**
+ * Play a seeded stream lock-step and compare every tick with a private
+ * sequential scheduler fed the same frames
+ */
+static void *client_main(void *arg) {
+    Client *client = arg;
+    int sock = uds_connect(client->socket_path);
+    if (sock < 0) {
+        client->mismatches = -1;
+        return NULL;
+    }
+    UdsConn *conn = uds_conn_create(sock, UDS_FRAME_NEWLINE);
+    Scheduler *reference = scheduler_init(4, 1);
+    unsigned int seed = client->seed;
+
+    for (int i = 0; i < client->frames; i++) {
+        char *frame = make_frame(i, &seed);
+        uds_send(sock, frame, strlen(frame));
+        uds_send(sock, "\n", 1);
+        if (client->read_ticks) {
+            TimeFrame *tf = json_parse_timeframe(frame);
+            for (int e = 0; e < tf->event_count; e++) {
+                scheduler_process_event(reference, &tf->events[e]);
+            }
+            SchedulerTick *tick = scheduler_tick(reference, tf->vtime);
+            char *expected = json_serialize_tick(tick, true);
+            char *line = uds_conn_receive(conn, NULL);
+            if (line) {
+                client->received++;
+            }
+            if (!line || strcmp(line, expected) != 0) {
+                client->mismatches++;
+            }
+            free(expected);
+            scheduler_tick_free(tick);
+            json_free_timeframe(tf);
+        }
+        free(frame);
+    }
+
+    scheduler_destroy(reference);
+    uds_conn_destroy(conn);
+    uds_disconnect(sock);
+    return NULL;
+}
+
+/**
+ * Test concurrent connections each get their own scheduler: every
+ * stream matches the sequential loop and the totals add up
+ */
+static int test_tenants_match_sequential(void) {
+    char socket_path[108];
+    Server server;
+    if (server_start(&server, socket_path, sizeof(socket_path), 3, WIRE_JSON) < 0) {
+        TEST_FAIL("Server did not start");
+    }
+
+    Client clients[TENANT_CLIENTS];
+    pthread_t threads[TENANT_CLIENTS];
+    for (int c = 0; c < TENANT_CLIENTS; c++) {
+        clients[c] = (Client){socket_path, 7u + (unsigned int)c * 31u, TENANT_FRAMES, true, 0, 0};
+        pthread_create(&threads[c], NULL, client_main, &clients[c]);
+    }
+    int mismatches = 0;
+    int received = 0;
+    for (int c = 0; c < TENANT_CLIENTS; c++) {
+        pthread_join(threads[c], NULL);
+        mismatches += clients[c].mismatches;
+        received += clients[c].received;
+    }
+    server_stop(&server);
+
+    if (server.rc != 0) TEST_FAIL("tenant_serve failed");
+    if (mismatches) TEST_FAIL("A connection's ticks differ from the sequential loop");
+    if (received != TENANT_CLIENTS * TENANT_FRAMES) TEST_FAIL("Missing responses");
+    if (server.totals.connections != TENANT_CLIENTS) TEST_FAIL("Wrong connection total");
+    if (server.totals.frames != TENANT_CLIENTS * TENANT_FRAMES) TEST_FAIL("Wrong frame total");
+    if (access(socket_path, F_OK) == 0) TEST_FAIL("Socket file should be removed on shutdown");
+
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test a peer hanging up mid-stream without reading its ticks leaves the
+ * connections sharing its worker untouched
+ */
+static int test_tenant_disconnect_mid_stream(void) {
+    char socket_path[108];
+    Server server;
+    if (server_start(&server, socket_path, sizeof(socket_path), 1, WIRE_JSON) < 0) {
+        TEST_FAIL("Server did not start");
+    }
+
+    Client quitter = {socket_path, 3u, TENANT_FRAMES / 2, false, 0, 0};
+    Client steady = {socket_path, 5u, TENANT_FRAMES, true, 0, 0};
+    pthread_t quitter_thread, steady_thread;
+    pthread_create(&quitter_thread, NULL, client_main, &quitter);
+    pthread_create(&steady_thread, NULL, client_main, &steady);
+    pthread_join(quitter_thread, NULL);
+    pthread_join(steady_thread, NULL);
+
+    /* A late connection on the same worker is still accepted and served */
+    Client late = {socket_path, 9u, 10, true, 0, 0};
+    pthread_t late_thread;
+    pthread_create(&late_thread, NULL, client_main, &late);
+    pthread_join(late_thread, NULL);
+    server_stop(&server);
+
+    if (server.rc != 0) TEST_FAIL("tenant_serve failed");
+    if (steady.mismatches || steady.received != TENANT_FRAMES) {
+        TEST_FAIL("Steady connection disturbed by the disconnect");
+    }
+    if (late.mismatches || late.received != 10) TEST_FAIL("Late connection not served");
+    if (server.totals.connections != 3) TEST_FAIL("Wrong connection total");
+
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test a binary peer that never answers the HELLO does not hold up the
+ * connections sharing its worker
+ */
+static int test_tenant_silent_handshake(void) {
+    char socket_path[108];
+    Server server;
+    if (server_start(&server, socket_path, sizeof(socket_path), 1, WIRE_BINARY) < 0) {
+        TEST_FAIL("Server did not start");
+    }
+
+    /* Connects first and never reads or replies */
+    int silent = uds_connect(socket_path);
+    if (silent < 0) TEST_FAIL("Silent peer could not connect");
+    sleep_ms(20);
+
+    /* A stalled worker shows up as a receive timeout, not a hang */
+    int sock = uds_connect(socket_path);
+    if (sock < 0) TEST_FAIL("Second peer could not connect");
+    struct timeval timeout = {2, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    UdsConn *conn = uds_conn_create(sock, UDS_FRAME_LENGTH);
+
+    size_t length = 0;
+    const unsigned char *hello = (const unsigned char *)uds_conn_receive(conn, &length);
+    bool greeted = hello && length == BINARY_HELLO_SIZE && hello[0] == BINARY_MSG_HELLO;
+    int received = 0;
+    if (greeted) {
+        const unsigned char reply[BINARY_HELLO_SIZE] = {BINARY_MSG_HELLO, BINARY_VERSION, 0, 0};
+        uds_conn_send(conn, (const char *)reply, sizeof(reply));
+        for (int vtime = 0; vtime < 20; vtime++) {
+            const unsigned char frame[BINARY_FRAME_HEADER_SIZE] = {BINARY_MSG_TIMEFRAME, 0, 0, 0,
+                                                                   (unsigned char)vtime, 0, 0, 0};
+            uds_conn_send(conn, (const char *)frame, sizeof(frame));
+            const unsigned char *tick = (const unsigned char *)uds_conn_receive(conn, &length);
+            if (!tick || length < BINARY_TICK_HEADER_SIZE || tick[0] != BINARY_MSG_TICK || tick[4] != vtime) {
+                break;
+            }
+            received++;
+        }
+    }
+
+    uds_conn_destroy(conn);
+    uds_disconnect(sock);
+    uds_disconnect(silent);
+    server_stop(&server);
+
+    if (server.rc != 0) TEST_FAIL("tenant_serve failed");
+    if (!greeted) TEST_FAIL("Second peer got no HELLO while the first stayed silent");
+    if (received != 20) TEST_FAIL("Second peer stopped getting ticks");
+    if (server.totals.connections != 2) TEST_FAIL("Wrong connection total");
+
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run all multi-tenant server tests
+ */
+int main(void) {
+    printf("Running Multi-Tenant Server Tests...\n");
+
+    int failures = 0;
+
+    failures += test_tenants_match_sequential();
+    failures += test_tenant_disconnect_mid_stream();
+    failures += test_tenant_silent_handshake();
+
+    printf("\n");
+    if (failures == 0) {
+        printf("All multi-tenant server tests passed!\n");
+    } else {
+        printf("%d test(s) failed.\n", failures);
+    }
+
+    return failures;
+}
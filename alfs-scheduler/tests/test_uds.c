@@ -0,0 +1,210 @@
+/**
+ * ALFS - Buffered UDS Connection Unit Tests
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../include/uds.h"
+
+#define TEST_PASS() printf("  [PASS] %s\n", __func__)
+#define TEST_FAIL(msg) do { printf("  [FAIL] %s: %s\n", __func__, msg); return 1; } while(0)
+
+/**
+ * Write all bytes to one end of a socket pair
+ */
+static int write_all(int fd, const char *data, size_t length) {
+    return uds_send(fd, data, length) == (int)length ? 0 : -1;
+}
+
+/**
+ * Test newline framing with several messages per read and a split message
+ */
+static int test_newline_framing(void) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) TEST_FAIL("socketpair failed");
+    UdsConn *conn = uds_conn_create(fds[0], UDS_FRAME_NEWLINE);
+    if (!conn) TEST_FAIL("Failed to create connection");
+    
+    /* Two whole messages and the first half of a third in one write */
+    const char *burst = "{\"vtime\":1}\n{\"vtime\":2}\n{\"vt";
+    write_all(fds[1], burst, strlen(burst));
+    
+    size_t length = 0;
+    char *msg = uds_conn_receive(conn, &length);
+    if (!msg || strcmp(msg, "{\"vtime\":1}") != 0 || length != 11) TEST_FAIL("First message wrong");
+    msg = uds_conn_receive(conn, &length);
+    if (!msg || strcmp(msg, "{\"vtime\":2}") != 0) TEST_FAIL("Buffered second message wrong");
+    
+    /* The partial third message carries over until the rest arrives */
+    write_all(fds[1], "ime\":3}\n", 8);
+    msg = uds_conn_receive(conn, &length);
+    if (!msg || strcmp(msg, "{\"vtime\":3}") != 0) TEST_FAIL("Split message not reassembled");
+    
+    /* A last line without a terminator is still delivered at EOF */
+    write_all(fds[1], "{\"vtime\":4}", 11);
+    close(fds[1]);
+    msg = uds_conn_receive(conn, &length);
+    if (!msg || strcmp(msg, "{\"vtime\":4}") != 0) TEST_FAIL("Unterminated last message lost");
+    errno = EINVAL;
+    if (uds_conn_receive(conn, &length) != NULL || errno != 0) TEST_FAIL("Expected clean EOF");
+    
+    uds_conn_destroy(conn);
+    close(fds[0]);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test JSON object framing with braces and escapes inside strings
+ */
+static int test_json_framing(void) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) TEST_FAIL("socketpair failed");
+    UdsConn *conn = uds_conn_create(fds[0], UDS_FRAME_JSON);
+    if (!conn) TEST_FAIL("Failed to create connection");
+    
+    const char *first = "{\"id\":\"a}\\\\\",\"x\":{\"y\":1}}";
+    const char *second = "{\"id\":\"\\\"{\"}";
+    char input[128];
+    snprintf(input, sizeof(input), "%s%s  \n", first, second);
+    write_all(fds[1], input, strlen(input));
+    close(fds[1]);
+    
+    char *msg = uds_conn_receive(conn, NULL);
+    if (!msg || strcmp(msg, first) != 0) TEST_FAIL("Braces inside strings split the object");
+    
+    /* The held byte after the first object must be restored */
+    msg = uds_conn_receive(conn, NULL);
+    if (!msg || strcmp(msg, second) != 0) TEST_FAIL("Escaped quote ended the string early");
+    
+    errno = EINVAL;
+    if (uds_conn_receive(conn, NULL) != NULL || errno != 0) TEST_FAIL("Trailing whitespace is not a message");
+    
+    uds_conn_destroy(conn);
+    close(fds[0]);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test length-prefixed framing, including a message larger than the
+ * initial buffer and the matching send framing
+ */
+static int test_length_framing(void) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) TEST_FAIL("socketpair failed");
+    UdsConn *reader = uds_conn_create(fds[0], UDS_FRAME_LENGTH);
+    UdsConn *writer = uds_conn_create(fds[1], UDS_FRAME_LENGTH);
+    if (!reader || !writer) TEST_FAIL("Failed to create connections");
+    
+    size_t big_length = 150 * 1024;
+    char *big = malloc(big_length);
+    if (!big) TEST_FAIL("Allocation failed");
+    for (size_t i = 0; i < big_length; i++) {
+        big[i] = (char)('a' + i % 26);
+    }
+    
+    /* Payloads may contain newlines: only the prefix delimits them */
+    if (uds_conn_send(writer, "line\none", 8) < 0) TEST_FAIL("Send failed");
+    if (uds_conn_send(writer, big, big_length) < 0) TEST_FAIL("Large send failed");
+    if (uds_conn_send(writer, "", 0) < 0) TEST_FAIL("Empty send failed");
+    
+    size_t length = 0;
+    char *msg = uds_conn_receive(reader, &length);
+    if (!msg || length != 8 || strcmp(msg, "line\none") != 0) TEST_FAIL("Small frame wrong");
+    msg = uds_conn_receive(reader, &length);
+    if (!msg || length != big_length || memcmp(msg, big, big_length) != 0 || msg[length] != '\0') {
+        TEST_FAIL("Large frame wrong");
+    }
+    msg = uds_conn_receive(reader, &length);
+    if (!msg || length != 0 || msg[0] != '\0') TEST_FAIL("Empty frame wrong");
+    
+    /* A frame cut short by EOF is an error, not a message */
+    write_all(fds[1], "\0\0\0\x10{}", 6);
+    close(fds[1]);
+    if (uds_conn_receive(reader, &length) != NULL || errno != EPROTO) {
+        TEST_FAIL("Truncated frame should fail with EPROTO");
+    }
+    
+    free(big);
+    uds_conn_destroy(writer);
+    uds_conn_destroy(reader);
+    close(fds[0]);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test an OutputBuffer goes out framed in one piece and is left intact
+ */
+static int test_send_output(void) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) TEST_FAIL("socketpair failed");
+    UdsConn *writer = uds_conn_create(fds[1], UDS_FRAME_NEWLINE);
+    if (!writer) TEST_FAIL("Failed to create connection");
+    
+    char storage[OUTPUT_HEADROOM + 16];
+    OutputBuffer out = {.data = storage, .length = 11, .capacity = sizeof(storage)};
+    memcpy(storage + OUTPUT_HEADROOM, "{\"vtime\":1}", 12);
+    
+    if (uds_conn_send_output(writer, &out) < 0) TEST_FAIL("Newline send failed");
+    if (strcmp(storage + OUTPUT_HEADROOM, "{\"vtime\":1}") != 0) TEST_FAIL("Payload not restored");
+    writer->framing = UDS_FRAME_LENGTH;
+    if (uds_conn_send_output(writer, &out) < 0) TEST_FAIL("Length send failed");
+    
+    char received[64];
+    close(fds[1]);
+    ssize_t n = recv(fds[0], received, sizeof(received), MSG_WAITALL);
+    if (n != 12 + 4 + 11) TEST_FAIL("Wrong number of bytes sent");
+    if (memcmp(received, "{\"vtime\":1}\n", 12) != 0) TEST_FAIL("Newline frame wrong");
+    if (memcmp(received + 12, "\0\0\0\x0b{\"vtime\":1}", 15) != 0) TEST_FAIL("Length frame wrong");
+    
+    uds_conn_destroy(writer);
+    close(fds[0]);
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Test framing names accepted on the command line
+ */
+static int test_parse_framing(void) {
+    UdsFraming framing = UDS_FRAME_JSON;
+    if (uds_parse_framing("newline", &framing) != 0 || framing != UDS_FRAME_NEWLINE) TEST_FAIL("newline");
+    if (uds_parse_framing("json", &framing) != 0 || framing != UDS_FRAME_JSON) TEST_FAIL("json");
+    if (uds_parse_framing("length", &framing) != 0 || framing != UDS_FRAME_LENGTH) TEST_FAIL("length");
+    if (uds_parse_framing("bogus", &framing) == 0) TEST_FAIL("Unknown framing should be rejected");
+    
+    TEST_PASS();
+    return 0;
+}
+
+/**
+ * Run all UDS tests
+ */
+int main(void) {
+    printf("Running UDS Connection Tests...\n");
+    
+    int failures = 0;
+    
+    failures += test_newline_framing();
+    failures += test_json_framing();
+    failures += test_length_framing();
+    failures += test_send_output();
+    failures += test_parse_framing();
+    
+    printf("\n");
+    if (failures == 0) {
+        printf("All UDS tests passed!\n");
+    } else {
+        printf("%d test(s) failed.\n", failures);
+    }
+    
+    return failures;
+}